@@ -93,6 +93,7 @@ AeolusQueue::completeService(){
         assert(!_enqueued_low.empty());
         pkt = _enqueued_low.pop();
         _queuesize_low -= pkt->size();
+        update_port_queuesize();
 
         //ECN mark on deque
         if (decide_ECN()) {
@@ -108,6 +109,7 @@ AeolusQueue::completeService(){
             _queuesize_high_watermark = _queuesize_high;
         }
         _queuesize_high -= pkt->size();
+        update_port_queuesize();
         if (_logger) _logger->logQueue(*this, QueueLogger::PKT_SERVICE, *pkt);
 
         _num_prio_packets++;
@@ -149,6 +151,7 @@ AeolusQueue::receivePacket(Packet& pkt) {
             Packet* pkt_p = &pkt;
             _enqueued_high.push(pkt_p);
             _queuesize_high += pkt.size();
+            update_port_queuesize();
 
             if (_logger) _logger->logQueue(*this, QueueLogger::PKT_ENQUEUE, pkt);
 
@@ -165,6 +168,7 @@ AeolusQueue::receivePacket(Packet& pkt) {
             Packet* pkt_p = &pkt;
             _enqueued_low.push(pkt_p);
             _queuesize_low += pkt.size();
+            update_port_queuesize();
             
             if (_logger) _logger->logQueue(*this, QueueLogger::PKT_ENQUEUE, pkt);
         }
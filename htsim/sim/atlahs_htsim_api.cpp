@@ -4,7 +4,102 @@
 
 #include "logsim-interface.h"
 #include "lgs/LogGOPSim.hpp"
-    
+#include "uec_pdcses.h"
+
+struct AtlahsHtsimApi::PooledConnection : public UecMsg::StatusCallback {
+    AtlahsHtsimApi* api;
+    int from;
+    int to;
+    UecSrc* src;
+    UecSink* sink;
+    UecPdcSes* pdc;
+
+    // the message being sent
+    int tag;
+    int size;
+    simtime_picosec start;
+    graph_node_properties node;
+
+    virtual void msg_status_changed(UecPdcSes& pdc, UecMsg::msgid_t msg_id, UecMsg::MsgStatus status) {
+        assert(status == UecMsg::MsgStatus::Finished);
+        api->messageFinished(this);
+    }
+};
+
+AtlahsHtsimApi::PooledConnection*
+AtlahsHtsimApi::getConnection(int from, int to, simtime_picosec base_rtt) {
+    std::vector<PooledConnection*>& idle = idle_connections[std::make_pair(from, to)];
+    if (!idle.empty()) {
+        PooledConnection* conn = idle.back();
+        idle.pop_back();
+        // start the next message from the initial window, as a new
+        // connection would
+        conn->src->initNscc(cwnd_b, base_rtt);
+        connections_reused++;
+        return conn;
+    }
+
+    TrafficLoggerSimple* traffic_logger = NULL;
+
+    // Construct a fresh multipath instance per connection
+    if (!mp_factory) {
+        std::cerr << "Error: Multipath not set in AtlahsHtsimApi" << std::endl;
+        exit(0);
+    }
+    auto per_flow_mp = mp_factory();
+
+    PooledConnection* conn = new PooledConnection();
+    conn->api = this;
+    conn->from = from;
+    conn->to = to;
+
+    UecSrc *uecSrc = new UecSrc(traffic_logger, *_eventlist, std::move(per_flow_mp), *uec_nics.at(from), 1);
+    uecSrc->initNscc(cwnd_b, base_rtt);
+    uecSrc->setName("uec_" + std::to_string(from) + "_" + std::to_string(to));
+    uecSrc->from = from;
+    uecSrc->to = to;
+
+    UecSink *uecSink = new UecSink(traffic_logger,
+                                   linkspeed,
+                                   1.1,
+                                   UecBasePacket::unquantize(UecSink::_credit_per_pull),
+                                   *_eventlist,
+                                   *uec_nics.at(to),
+                                   1);
+    uecSink->setName("uec_sink_Rand");
+    uecSink->from_sink = from;
+    uecSink->to_sink = to;
+
+    uecSrc->set_dst(to);
+    uecSrc->setSrc(from);
+    uecSrc->setDst(to);
+    uecSink->set_src(from);
+
+    conn->src = uecSrc;
+    conn->sink = uecSink;
+    conn->pdc = new UecPdcSes(uecSrc, *_eventlist, UecSrc::_mss, UecSrc::_hdr_size,
+                              "flow_id " + std::to_string(uecSrc->flowId()));
+    // the connection outlives its messages
+    conn->pdc->freeCompletedMsgs();
+    connections_created++;
+    return conn;
+}
+
+void AtlahsHtsimApi::messageFinished(PooledConnection* conn) {
+    simtime_picosec now = _eventlist->now();
+    if (print_stats_flows) {
+        flowInfos.push_back(FlowInfo(timeAsUs(conn->start), timeAsUs(now), timeAsUs(now - conn->start),
+                                     conn->size, 1, conn->src->cwnd()));
+    }
+    EventOver flow_over(conn->from, conn->to, conn->size, conn->tag, now, AtlahsEventType::SEND_EVENT_OVER);
+    flow_over.node = &conn->node;
+    flow_over.start_time_event = conn->start;
+
+    // free for the next message before LGS is told, as it may send one
+    idle_connections[std::make_pair(conn->from, conn->to)].push_back(conn);
+    EventFinished(flow_over);
+}
+
 void AtlahsHtsimApi::Send(const SendEvent &event, graph_node_properties elem) {
     //std::cout << "AtlahsHtsimApi: Sending event" << std::endl;
 
@@ -44,70 +139,43 @@ void AtlahsHtsimApi::Send(const SendEvent &event, graph_node_properties elem) {
     }
 
     if (_logsim_interface->get_protocol() == UEC_PROTOCOL) { 
-        TrafficLoggerSimple* traffic_logger = NULL;
-
-        // Construct a fresh multipath instance per flow
-        if (!mp_factory) {
-            std::cerr << "Error: Multipath not set in AtlahsHtsimApi" << std::endl;
-            exit(0);
+        PooledConnection* conn = getConnection(from, to, base_rtt_bw_two_points);
+        bool created = !conn->src->hasStarted();  // reused ones have sent a message
+        conn->tag = tag;
+        conn->size = size;
+        conn->start = _eventlist->now();
+        conn->node = elem;
+        conn->src->tag = tag;
+        conn->src->send_size = size;
+        conn->sink->tag_sink = tag;
+
+        UecMsg* msg = conn->pdc->enque(size, 0, true);
+        msg->setStatusCallback(UecMsg::MsgStatus::Finished, conn);
+
+        if (created) {
+            // with -lazy_topology the ToRs may not exist yet
+            _topo->build_tor(_topo->cfg().HOST_POD_SWITCH(from));
+            _topo->build_tor(_topo->cfg().HOST_POD_SWITCH(to));
+
+            const Route* srctotor = RouteCache::intern({_topo->queues_ns_nlp[from][_topo->cfg().HOST_POD_SWITCH(from)][0],
+                                                        _topo->pipes_ns_nlp[from][_topo->cfg().HOST_POD_SWITCH(from)][0],
+                                                        _topo->queues_ns_nlp[from][_topo->cfg().HOST_POD_SWITCH(from)][0]->getRemoteEndpoint()});
+
+            const Route* dsttotor = RouteCache::intern({_topo->queues_ns_nlp[to][_topo->cfg().HOST_POD_SWITCH(to)][0],
+                                                        _topo->pipes_ns_nlp[to][_topo->cfg().HOST_POD_SWITCH(to)][0],
+                                                        _topo->queues_ns_nlp[to][_topo->cfg().HOST_POD_SWITCH(to)][0]->getRemoteEndpoint()});
+
+            conn->src->connectPort(0, *srctotor, *dsttotor, *conn->sink, _eventlist->now());
+
+            //register src and snk to receive packets from their respective TORs; they
+            //stay registered while the connection is in the pool
+            assert(_topo->switches_lp[_topo->cfg().HOST_POD_SWITCH(from)]);
+            assert(_topo->switches_lp[_topo->cfg().HOST_POD_SWITCH(to)]);
+            _topo->switches_lp[_topo->cfg().HOST_POD_SWITCH(from)]->addHostPort(
+                            from, conn->sink->flowId(), conn->src->getPort(0));
+            _topo->switches_lp[_topo->cfg().HOST_POD_SWITCH(to)]->addHostPort(
+                            to, conn->src->flowId(), conn->sink->getPort(0));
         }
-        auto per_flow_mp = mp_factory();
-
-        UecSrc *uecSrc = new UecSrc(traffic_logger, *_eventlist, std::move(per_flow_mp), *uec_nics.at(from), 1);
-
-        // setFlowsize is the correct method name
-        uecSrc->setFlowsize(size);
-        uecSrc->initNscc(cwnd_b, base_rtt_bw_two_points);
-
-
-        uecSrc->setName("uec_" + std::to_string(from) + "_" + std::to_string(to));
-        uecSrc->from = from;
-        uecSrc->to = to;
-        uecSrc->tag = tag;
-        uecSrc->send_size = size;
-        uecSrc->_atlahs_api = this;
-
-        UecSink *uecSink = new UecSink(traffic_logger,
-                                  linkspeed,
-                                  1.1,
-                                  UecBasePacket::unquantize(UecSink::_credit_per_pull),
-                                  *_eventlist,
-                                  *uec_nics.at(to),
-                                  1);
-        uecSink->setName("uec_sink_Rand");
-        uecSink->from_sink = from;
-        uecSink->to_sink = to;
-        uecSink->tag_sink = tag;
-
-        uecSrc->set_dst(to);
-        uecSrc->setSrc(from);
-        uecSrc->setDst(to);
-        uecSink->set_src(from);
-
-        Route* srctotor = new Route();
-        srctotor->push_back(_topo->queues_ns_nlp[from][_topo->cfg().HOST_POD_SWITCH(from)][0]);
-        srctotor->push_back(_topo->pipes_ns_nlp[from][_topo->cfg().HOST_POD_SWITCH(from)][0]);
-        srctotor->push_back(_topo->queues_ns_nlp[from][_topo->cfg().HOST_POD_SWITCH(from)][0]->getRemoteEndpoint());
-
-        Route* dsttotor = new Route();
-        dsttotor->push_back(_topo->queues_ns_nlp[to][_topo->cfg().HOST_POD_SWITCH(to)][0]);
-        dsttotor->push_back(_topo->pipes_ns_nlp[to][_topo->cfg().HOST_POD_SWITCH(to)][0]);
-        dsttotor->push_back(_topo->queues_ns_nlp[to][_topo->cfg().HOST_POD_SWITCH(to)][0]->getRemoteEndpoint());
-
-        graph_node_properties* node_copy = new graph_node_properties(elem);
-        uecSrc->lgs_node = node_copy;
-        //uecSrc->connect(srctotor, dsttotor, *uecSink, _eventlist->now());
-
-        uecSrc->connectPort(0, *srctotor, *dsttotor, *uecSink, _eventlist->now());
-
-        //register src and snk to receive packets from their respective TORs. 
-        assert(_topo->switches_lp[_topo->cfg().HOST_POD_SWITCH(from)]);
-        assert(_topo->switches_lp[_topo->cfg().HOST_POD_SWITCH(from)]);
-        _topo->switches_lp[_topo->cfg().HOST_POD_SWITCH(from)]->addHostPort(
-                        from, uecSink->flowId(), uecSrc->getPort(0));
-        _topo->switches_lp[_topo->cfg().HOST_POD_SWITCH(to)]->addHostPort(
-                        to, uecSrc->flowId(), uecSink->getPort(0));
-
     }
     // TODO: Move this stuff to a CreateConnection function inside UEC. 
     // TODO: Support different tranports, not just UEC
@@ -4,7 +4,9 @@
 #include "atlahs_api.h"
 #include <iostream>
 #include <functional>
+#include <map>
 #include <memory>
+#include <vector>
 #include "compute_event.h"
 #include "null_event.h"
 #include "atlahs_event.h"
@@ -147,7 +149,24 @@ public:
     // Replace single-instance setter with a factory to create a new instance per flow
     void setMultipathFactory(std::function<std::unique_ptr<UecMultipath>()> f) { mp_factory = std::move(f); }
 
+    // connections built so far, and how many sends reused one
+    uint64_t connectionsCreated() const { return connections_created; }
+    uint64_t connectionsReused() const { return connections_reused; }
+
 private:
+    // A UEC connection between two hosts that carries one message at a
+    // time.  When its message has been acked it goes back to the pool
+    // for (src, dst), and the next send between the same hosts is
+    // carried on it as a new message, so a trace needs as many
+    // connections as it has messages in flight at once rather than one
+    // per message.
+    struct PooledConnection;
+    PooledConnection* getConnection(int from, int to, simtime_picosec base_rtt);
+    void messageFinished(PooledConnection* conn);
+    std::map<std::pair<int, int>, std::vector<PooledConnection*>> idle_connections;
+    uint64_t connections_created = 0;
+    uint64_t connections_reused = 0;
+
     EventList* _eventlist = nullptr;
     UecRtxTimerScanner* _uecRtxScanner = nullptr;
     FatTreeTopology* _topo = nullptr;
@@ -1,11 +1,12 @@
 #include "buffer_reps.h"
+#include "checkpoint.h"
 
 // Static member initialization, for now these are fixed to keep things simple. But ideally the user should be able to set these.
-template <typename T> bool CircularBufferREPS<T>::repsUseFreezing = true;
-template <typename T> uint16_t CircularBufferREPS<T>::repsBufferSize = 8;
-template <typename T> uint16_t CircularBufferREPS<T>::repsMaxLifetimeEntropy = 1;
-template <typename T> bool CircularBufferREPS<T>::compressed_acks_reuse = false;
-template <typename T> uint64_t CircularBufferREPS<T>::exit_freeze_after = 10000000000;
+thread_local bool RepsParams::repsUseFreezing = true;
+thread_local uint16_t RepsParams::repsBufferSize = 8;
+thread_local uint16_t RepsParams::repsMaxLifetimeEntropy = 1;
+thread_local bool RepsParams::compressed_acks_reuse = false;
+thread_local uint64_t RepsParams::exit_freeze_after = 10000000000;
 
 
 // Constructor
@@ -179,4 +180,29 @@ template <typename T> bool CircularBufferREPS<T>::containsEntropy(uint16_t given
     return false;
 }
 
+template <typename T> void CircularBufferREPS<T>::checkpoint(Checkpoint& cp) {
+    // the size comes from the command line, as for a new buffer
+    uint16_t size = max_size;
+    cp.io(size);
+    if (size != max_size)
+        cp.unsupported("a REPS buffer of a different size");
+    for (int i = 0; i < max_size; i++) {
+        cp.io(buffer[i].value);
+        cp.io(buffer[i].isValid);
+        cp.io(buffer[i].usable_lifetime);
+    }
+    cp.io(head);
+    cp.io(tail);
+    cp.io(count);
+    cp.io(head_frozen_mode);
+    cp.io(head_round);
+    cp.io(number_fresh_entropies);
+    cp.io(frozen_mode);
+    cp.io(circle_mode);
+    cp.io(can_enter_frozen_mode);
+    cp.io(can_exit_frozen_mode);
+    cp.io(last_received_ack);
+    cp.io(explore_counter);
+}
+
 template class CircularBufferREPS<uint16_t>;
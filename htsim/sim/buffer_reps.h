@@ -5,7 +5,22 @@
 #include <stdexcept>
 #include "stdint.h"
 
-template <typename T> class CircularBufferREPS {
+class Checkpoint;
+
+// Parameters shared by all CircularBufferREPS types, one copy per
+// simulation thread.  They live outside the template as GCC does not
+// handle thread_local static members of class templates used from
+// other files.
+class RepsParams {
+  public:
+    static thread_local bool repsUseFreezing;
+    static thread_local uint16_t repsBufferSize;
+    static thread_local uint16_t repsMaxLifetimeEntropy;
+    static thread_local bool compressed_acks_reuse;
+    static thread_local uint64_t exit_freeze_after;
+};
+
+template <typename T> class CircularBufferREPS : public RepsParams {
   private:
     struct Element {
         T value;
@@ -42,6 +57,7 @@ template <typename T> class CircularBufferREPS {
     void print();
     void resetBuffer();
     uint16_t numValid() const;
+    void checkpoint(Checkpoint& cp);
     void setFrozenMode(bool mode) {
         if (repsUseFreezing) {
             frozen_mode = mode;
@@ -56,14 +72,9 @@ template <typename T> class CircularBufferREPS {
             compressed_acks_reuse = true;
         }
     };
-    static bool repsUseFreezing;
-    static uint16_t repsBufferSize;
-    static uint16_t repsMaxLifetimeEntropy;
-    static bool compressed_acks_reuse;
 
     uint64_t can_enter_frozen_mode = 0;
     uint64_t can_exit_frozen_mode = 0;
-    static uint64_t exit_freeze_after;
 
 
     uint64_t last_received_ack = 0;
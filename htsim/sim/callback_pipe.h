@@ -18,6 +18,7 @@ class CallbackPipe : public Pipe {
 public:
     CallbackPipe(simtime_picosec delay, EventList& eventlist, PacketSink* callback);
     virtual void doNextEvent(); // inherited from Pipe
+    virtual const type_info& checkpoint_class() const {return typeid(CallbackPipe);}
 private:
     PacketSink* _callback;
 };
@@ -1,4 +1,4 @@
 #include "cbrpacket.h"
 
-PacketDB<CbrPacket> CbrPacket::_packetdb;
+thread_local PacketDB<CbrPacket> CbrPacket::_packetdb;
 
@@ -0,0 +1,261 @@
+// -*- c-basic-offset: 4; indent-tabs-mode: nil -*-
+#include "checkpoint.h"
+#include <cxxabi.h>
+#include <iostream>
+#include <sstream>
+#include "eventlist.h"
+#include "network.h"
+#include "route.h"
+
+static const char* const MAGIC = "htsim checkpoint";
+static const uint32_t VERSION = 7;
+
+Checkpointable::Checkpointable()
+{
+    _checkpoint_index = registry().size();
+    registry().push_back(this);
+}
+
+Checkpointable::Checkpointable(unregistered_t)
+    : _checkpoint_index(NONE)
+{
+}
+
+Checkpointable::~Checkpointable()
+{
+    if (_checkpoint_index != NONE)
+        registry()[_checkpoint_index] = NULL;
+}
+
+vector<Checkpointable*>&
+Checkpointable::registry()
+{
+    static thread_local vector<Checkpointable*> objects;
+    return objects;
+}
+
+Checkpoint::PacketType::PacketType(int type, packet_allocator alloc)
+{
+    packet_types()[type] = alloc;
+}
+
+map<int, Checkpoint::packet_allocator>&
+Checkpoint::packet_types()
+{
+    static map<int, packet_allocator> types;
+    return types;
+}
+
+string
+Checkpoint::class_name(const type_info& type) {
+    int status;
+    char* name = abi::__cxa_demangle(type.name(), NULL, NULL, &status);
+    if (status != 0)
+        return type.name();
+    string result(name);
+    free(name);
+    return result;
+}
+
+Checkpoint::Checkpoint(bool saving, const string& filename)
+    : _saving(saving), _filename(filename), _count(0)
+{
+    _file.open(filename, (saving ? ios::out | ios::trunc : ios::in) | ios::binary);
+    if (!_file)
+        fail("can't open " + filename);
+}
+
+void
+Checkpoint::save(const string& filename, EventList& eventlist)
+{
+    Checkpoint cp(true, filename);
+    cp.run(eventlist);
+    cp._file.close();
+    if (!cp._file)
+        cp.fail("error writing " + filename);
+}
+
+void
+Checkpoint::restore(const string& filename, EventList& eventlist)
+{
+    Checkpoint cp(false, filename);
+    cp.run(eventlist);
+}
+
+void
+Checkpoint::run(EventList& eventlist)
+{
+    vector<Checkpointable*>& objects = Checkpointable::registry();
+
+    string magic = MAGIC;
+    io(magic);
+    uint32_t version = VERSION;
+    io(version);
+    if (magic != MAGIC || version != VERSION)
+        fail(_filename + " is not a checkpoint of this version of htsim");
+
+    _count = objects.size();
+    io(_count);
+    if (restoring() && _count > objects.size()) {
+        stringstream ss;
+        ss << "the checkpoint has " << _count << " objects but this simulation only has "
+           << objects.size() << "; it must be set up like the one that was saved";
+        fail(ss.str());
+    }
+
+    string rng = saving() ? random_state() : "";
+    io(rng);
+    if (restoring())
+        set_random_state(rng);
+
+    // the events refer to objects that are restored below, which may
+    // in turn need the events (queued timers look for theirs)
+    eventlist.checkpoint(*this);
+
+    for (size_t i = 0; i < _count; i++) {
+        Checkpointable* obj = objects[i];
+        bool present = obj != NULL;
+        io(present);
+        if (!present) {
+            if (obj)
+                fail("a " + class_name(typeid(*obj)) + " here was deleted before the checkpoint was taken");
+            continue;
+        }
+        if (!obj)
+            fail("an object in the checkpoint has been deleted here");
+        string type = typeid(*obj).name();
+        if (saving() && typeid(*obj) != obj->checkpoint_class())
+            unsupported(class_name(typeid(*obj)) + " objects");
+        io(type);
+        if (restoring() && type != typeid(*obj).name()) {
+            stringstream ss;
+            ss << "object " << i << " is a " << class_name(typeid(*obj))
+               << " here; the simulation must be set up like the one that was saved";
+            fail(ss.str());
+        }
+        obj->checkpoint(*this);
+    }
+
+    string end = "end";
+    io(end);
+    if (end != "end")
+        fail(_filename + " is corrupt");
+
+    if (restoring()) {
+        for (size_t i = 0; i < _count; i++) {
+            if (objects[i])
+                objects[i]->checkpoint_restored();
+        }
+    }
+}
+
+void
+Checkpoint::io_raw(void* p, size_t n)
+{
+    if (saving())
+        _file.write((const char*)p, n);
+    else if (!_file.read((char*)p, n))
+        fail(_filename + " is truncated");
+}
+
+void
+Checkpoint::io(string& s)
+{
+    size_t n = io_size(s.size());
+    if (restoring()) {
+        if (n > (1 << 30))
+            fail(_filename + " is corrupt");
+        s.resize(n);
+    }
+    io_raw(&s[0], n);
+}
+
+size_t
+Checkpoint::io_size(size_t n)
+{
+    uint64_t size = n;
+    io(size);
+    return size;
+}
+
+Checkpointable*
+Checkpoint::io_ref(Checkpointable* obj, const type_info* type)
+{
+    uint64_t index = obj ? obj->_checkpoint_index : Checkpointable::NONE;
+    if (saving() && obj && index == Checkpointable::NONE)
+        unsupported("a pointer to a " + class_name(*type) + " that has no checkpoint number");
+    io(index);
+    if (saving() || index == Checkpointable::NONE)
+        return obj;
+    if (index >= _count)
+        fail(_filename + " is corrupt");
+    obj = Checkpointable::registry()[index];
+    if (!obj)
+        fail("a " + class_name(*type) + " in the checkpoint has been deleted here");
+    return obj;
+}
+
+void
+Checkpoint::io(const Route*& route)
+{
+    bool present = route != NULL;
+    io(present);
+    if (!present) {
+        route = NULL;
+        return;
+    }
+    vector<PacketSink*> hops;
+    int path_id = 0, no_of_paths = 0;
+    if (saving()) {
+        if (route->reverse())
+            unsupported("a route with a reverse route");
+        hops.assign(route->begin(), route->end());
+        path_id = route->path_id();
+        no_of_paths = route->no_of_paths();
+    }
+    io(hops);
+    io(path_id);
+    io(no_of_paths);
+    if (saving())
+        return;
+
+    // restored packets and forwarding tables share routes
+    Route r(hops.size());
+    for (PacketSink* hop : hops) {
+        r.push_back(hop);
+    }
+    r.set_path_id(path_id, no_of_paths);
+    route = RouteCache::intern(r);
+}
+
+Packet*
+Checkpoint::io_packet(Packet* pkt)
+{
+    int type = pkt ? pkt->type() : -1;
+    io(type);
+    if (type < 0)
+        return NULL;
+    auto i = packet_types().find(type);
+    if (i == packet_types().end()) {
+        if (saving())
+            unsupported("a " + class_name(typeid(*pkt)) + " packet");
+        fail(_filename + " is corrupt");
+    }
+    if (restoring())
+        pkt = i->second();
+    pkt->checkpoint(*this);
+    return pkt;
+}
+
+void
+Checkpoint::unsupported(const string& what)
+{
+    fail("can't checkpoint " + what);
+}
+
+void
+Checkpoint::fail(const string& what)
+{
+    cerr << "Checkpoint: " << what << endl;
+    exit(1);
+}
@@ -0,0 +1,278 @@
+// -*- c-basic-offset: 4; indent-tabs-mode: nil -*-
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+/*
+ * Saving a running simulation to a file and restoring it in another
+ * process, so that a long warm-up only needs to be simulated once and
+ * the rest of the run can then be repeated with different flags.
+ *
+ * Objects that hold simulation state derive from Checkpointable.  They
+ * are numbered in the order they are constructed, so a process that
+ * runs the same setup code recreates each of them under the same
+ * number, and pointers between them are saved as these numbers.  A
+ * class's checkpoint() passes its dynamic state through Checkpoint::io(),
+ * which writes it when saving and reads it back when restoring, so one
+ * function describes both directions.  Parameters that come from the
+ * command line are not saved: the restored simulation runs with those
+ * of the process it is restored into.
+ *
+ * Packets and routes are saved by value, with whatever holds them
+ * (queue, pipe, NIC, ...); restored routes are shared through the
+ * RouteCache.  The pending events of the EventList and the state of the
+ * random number generator are saved too.
+ *
+ * Anything the checkpoint can't capture makes saving fail with a
+ * message saying what it was, rather than produce a checkpoint that
+ * would silently diverge: an object whose class doesn't implement
+ * checkpoint() itself (checkpoint_class() says which class does), a
+ * pending event of a source that isn't Checkpointable, a pointer to an
+ * object that isn't, or a packet type nobody registered.
+ *
+ * Objects created after the last one in the checkpoint, such as
+ * connections added to the end of the traffic matrix, are left with
+ * the state and events they were set up with.
+ */
+
+#include <fstream>
+#include <list>
+#include <map>
+#include <optional>
+#include <typeinfo>
+#include <type_traits>
+#include <vector>
+#include "config.h"
+#include "circular_buffer.h"
+
+class Checkpoint;
+class EventList;
+class Packet;
+class Route;
+
+class Checkpointable {
+    friend class Checkpoint;
+public:
+    enum unregistered_t {UNREGISTERED};
+    Checkpointable();
+    // for objects created on first use, whose number would depend on
+    // when that happened; they can't be pointed to from saved state
+    Checkpointable(unregistered_t);
+    virtual ~Checkpointable();
+
+    // save or restore the object's dynamic state
+    virtual void checkpoint(Checkpoint& cp) = 0;
+    // the class whose checkpoint() covers all of the object's state;
+    // objects of subclasses that don't override it are refused
+    virtual const std::type_info& checkpoint_class() const = 0;
+    // called once every object has been restored
+    virtual void checkpoint_restored() {}
+
+    static const size_t NONE = SIZE_MAX;
+private:
+    size_t _checkpoint_index;
+    // every Checkpointable of this thread's simulation, in construction
+    // order; deleted ones are left as NULL
+    static std::vector<Checkpointable*>& registry();
+};
+
+class Checkpoint {
+public:
+    // write the simulation running on this thread to filename
+    static void save(const std::string& filename, EventList& eventlist);
+    // load it back; the same setup must have been run first
+    static void restore(const std::string& filename, EventList& eventlist);
+
+    inline bool saving() const {return _saving;}
+    inline bool restoring() const {return !_saving;}
+    // whether obj's state is in the checkpoint, rather than it having
+    // been set up after the last object that is
+    inline bool covers(const Checkpointable& obj) const {return obj._checkpoint_index < _count;}
+
+    // numbers, enums and plain structs are copied as they are; classes
+    // with a checkpoint(Checkpoint&) method are passed to it
+    template<class T> void io(T& v);
+    // packets are saved by value, other objects by their number
+    template<class T> void io(T*& p);
+    void io(const Route*& route);
+    void io(std::string& s);
+    template<class A, class B> void io(std::pair<A, B>& p) {io(p.first); io(p.second);}
+    template<class T> void io(std::vector<T>& v);
+    template<class T> void io(std::list<T>& l);
+    template<class K, class V> void io(std::map<K, V>& m);
+    template<class K, class V> void io(std::multimap<K, V>& m);
+    template<class T> void io(std::optional<T>& o);
+    template<class T> void io(CircularBuffer<T>& b);
+    template<class T> void io_array(T* a, size_t n);
+    // a size saved with the container that has it; returns the saved
+    // size when restoring
+    size_t io_size(size_t n);
+
+    // give up: the simulation has state the checkpoint can't capture
+    [[noreturn]] void unsupported(const std::string& what);
+
+    // Packets are restored by allocating one of the type recorded in
+    // the checkpoint and passing it to its checkpoint().  Each packet
+    // class that supports this registers an allocator for its type.
+    typedef Packet* (*packet_allocator)();
+    struct PacketType {
+        PacketType(int type, packet_allocator alloc);
+    };
+
+    static std::string class_name(const std::type_info& type);
+private:
+    Checkpoint(bool saving, const std::string& filename);
+    void run(EventList& eventlist);
+    void io_raw(void* p, size_t n);
+    Checkpointable* io_ref(Checkpointable* obj, const std::type_info* type);
+    Packet* io_packet(Packet* pkt);
+    [[noreturn]] void fail(const std::string& what);
+    static std::map<int, packet_allocator>& packet_types();
+
+    template<class T, class = void> struct has_checkpoint : std::false_type {};
+    template<class T> struct has_checkpoint<T, std::void_t<decltype(std::declval<T&>().checkpoint(std::declval<Checkpoint&>()))>>
+        : std::true_type {};
+
+    bool _saving;
+    std::string _filename;
+    std::fstream _file;
+    // objects covered by the checkpoint
+    size_t _count;
+};
+
+template<class T> void
+Checkpoint::io(T& v) {
+    if constexpr (std::is_arithmetic<T>::value || std::is_enum<T>::value) {
+        io_raw(&v, sizeof(v));
+    } else if constexpr (has_checkpoint<T>::value) {
+        v.checkpoint(*this);
+    } else {
+        static_assert(std::is_trivially_copyable<T>::value, "give the class a checkpoint() method");
+        io_raw(&v, sizeof(v));
+    }
+}
+
+template<class T> void
+Checkpoint::io(T*& p) {
+    if constexpr (std::is_base_of<Packet, T>::value) {
+        Packet* pkt = io_packet(p);
+        if (restoring())
+            p = static_cast<T*>(pkt);
+    } else {
+        Checkpointable* obj = NULL;
+        if (saving() && p) {
+            obj = dynamic_cast<Checkpointable*>(p);
+            if (!obj)
+                unsupported("a pointer to a " + class_name(typeid(*p)) + ", which isn't Checkpointable");
+        }
+        obj = io_ref(obj, &typeid(T));
+        if (restoring()) {
+            p = obj ? dynamic_cast<T*>(obj) : NULL;
+            if (obj && !p)
+                fail("a pointer to a " + class_name(typeid(T)) + " refers to a " + class_name(typeid(*obj)));
+        }
+    }
+}
+
+template<class T> void
+Checkpoint::io(std::vector<T>& v) {
+    size_t n = io_size(v.size());
+    if (restoring())
+        v.resize(n);
+    for (T& x : v) {
+        io(x);
+    }
+}
+
+template<class T> void
+Checkpoint::io(std::list<T>& l) {
+    size_t n = io_size(l.size());
+    if (restoring())
+        l.resize(n);
+    for (T& x : l) {
+        io(x);
+    }
+}
+
+template<class K, class V> void
+Checkpoint::io(std::map<K, V>& m) {
+    size_t n = io_size(m.size());
+    if (saving()) {
+        for (auto& i : m) {
+            K k = i.first;
+            io(k);
+            io(i.second);
+        }
+        return;
+    }
+    m.clear();
+    for (size_t i = 0; i < n; i++) {
+        std::pair<K, V> kv;
+        io(kv);
+        m.insert(m.end(), kv);
+    }
+}
+
+template<class K, class V> void
+Checkpoint::io(std::multimap<K, V>& m) {
+    // equal keys are restored in the order they were saved
+    size_t n = io_size(m.size());
+    if (saving()) {
+        for (auto& i : m) {
+            K k = i.first;
+            io(k);
+            io(i.second);
+        }
+        return;
+    }
+    m.clear();
+    for (size_t i = 0; i < n; i++) {
+        std::pair<K, V> kv;
+        io(kv);
+        m.insert(m.end(), kv);
+    }
+}
+
+template<class T> void
+Checkpoint::io(std::optional<T>& o) {
+    bool present = o.has_value();
+    io(present);
+    if (restoring()) {
+        if (present)
+            o.emplace();
+        else
+            o.reset();
+    }
+    if (present)
+        io(*o);
+}
+
+template<class T> void
+Checkpoint::io(CircularBuffer<T>& b) {
+    // saved from the next to pop; restoring pushes them back in order
+    size_t n = io_size(b.size());
+    if (saving()) {
+        for (size_t i = 0; i < n; i++) {
+            io(b.at(i));
+        }
+        return;
+    }
+    b.clear();
+    for (size_t i = 0; i < n; i++) {
+        T x = T();
+        io(x);
+        b.push(x);
+    }
+}
+
+template<class T> void
+Checkpoint::io_array(T* a, size_t n) {
+    if constexpr (std::is_arithmetic<T>::value || std::is_enum<T>::value) {
+        io_raw(a, n * sizeof(T));
+    } else {
+        for (size_t i = 0; i < n; i++) {
+            io(a[i]);
+        }
+    }
+}
+
+#endif
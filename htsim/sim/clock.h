@@ -8,12 +8,15 @@
 
 #include "config.h"
 #include "eventlist.h"
+#include "checkpoint.h"
 
-class Clock : public EventSource {
+class Clock : public EventSource, public Checkpointable {
 public:
         Clock(simtime_picosec period, EventList& eventlist); 
         bool isTraffic() {return false;};
         void doNextEvent();
+        virtual void checkpoint(Checkpoint& cp) {cp.io(_smallticks);}
+        virtual const type_info& checkpoint_class() const {return typeid(Clock);}
 private:
         simtime_picosec _period;
         int _smallticks;
@@ -1,4 +1,4 @@
 // -*- c-basic-offset: 4; indent-tabs-mode: nil -*- 
 #include "cnppacket.h"
 
-PacketDB<CNPPacket> CNPPacket::_packetdb;
+thread_local PacketDB<CNPPacket> CNPPacket::_packetdb;
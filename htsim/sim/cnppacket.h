@@ -18,8 +18,7 @@ public:
         p->set_route(flow,route,ACKSIZE,ackno);
         p->_type = CNP;
         p->_is_header = true;
-        p->_ackno = ackno;
-        p->_path_len = 0;
+        p->_ackno = ackno;
         p->_direction = NONE;
         p->set_dst(destination);
         return p;
@@ -33,7 +32,7 @@ public:
     const static int ACKSIZE=64; 
 protected:
     seq_t _ackno;
-    static PacketDB<CNPPacket> _packetdb;
+    static thread_local PacketDB<CNPPacket> _packetdb;
 };
 
 #endif
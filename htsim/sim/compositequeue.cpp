@@ -6,7 +6,7 @@
 #include "ecn.h"
 #include "uecpacket.h"  // For MQL update in SMaRTT-REPS-CONGA
 
-static int global_queue_id=0;
+static thread_local int global_queue_id=0;
 #define DEBUG_QUEUE_ID -1 // set to queue ID to enable debugging
 
 CompositeQueue::CompositeQueue(linkspeed_bps bitrate, mem_b maxsize, EventList& eventlist, 
@@ -42,6 +42,25 @@ CompositeQueue::CompositeQueue(linkspeed_bps bitrate, mem_b maxsize, EventList&
         cout << "queueid " << _queue_id << " bitrate " << bitrate/1000000 << "Mb/s," << endl;
 }
 
+void
+CompositeQueue::checkpoint(Checkpoint& cp) {
+    Queue::checkpoint(cp);
+    cp.io(_queuesize_low);
+    cp.io(_queuesize_high);
+    cp.io(_num_packets);
+    cp.io(_num_headers);
+    cp.io(_num_acks);
+    cp.io(_num_nacks);
+    cp.io(_num_pulls);
+    cp.io(_num_stripped);
+    cp.io(_num_bounced);
+    cp.io(_queuesize_high_watermark);
+    cp.io(_serv);
+    cp.io(_crt);
+    cp.io(_enqueued_low);
+    cp.io(_enqueued_high);
+}
+
 void CompositeQueue::beginService(){
     if (!_enqueued_high.empty()&&!_enqueued_low.empty()){
         _crt++;
@@ -91,6 +110,7 @@ void CompositeQueue::completeService(){
         assert(!_enqueued_low.empty());
         pkt = _enqueued_low.pop();
         _queuesize_low -= pkt->size();
+        update_port_queuesize();
 
         bool ecn = decide_ECN();
         //ECN mark on deque
@@ -114,6 +134,7 @@ void CompositeQueue::completeService(){
             _queuesize_high_watermark = _queuesize_high;
         }
         _queuesize_high -= pkt->size();
+        update_port_queuesize();
         if (_logger) _logger->logQueue(*this, QueueLogger::PKT_SERVICE, *pkt);
         if (pkt->type() == NDPACK)
             _num_acks++;
@@ -161,7 +182,8 @@ void CompositeQueue::receivePacket(Packet& pkt)
     
     // Update MQL for SMaRTT-REPS-CONGA
     // UecDataPacket records maximum queue length along path
-    if (UecDataPacket* uec_pkt = dynamic_cast<UecDataPacket*>(&pkt)) {
+    if (pkt.type() == UECDATA) {
+        UecDataPacket* uec_pkt = static_cast<UecDataPacket*>(&pkt);
         uint8_t local_mql = quantizeQueueLengthMQL();
         uint8_t current_mql = uec_pkt->mql_level();
         if (local_mql > current_mql) {
@@ -186,6 +208,7 @@ void CompositeQueue::receivePacket(Packet& pkt)
                 //take last packet from low prio queue, make it a header and place it in the high prio queue
                 Packet* booted_pkt = _enqueued_low.pop_front();
                 _queuesize_low -= booted_pkt->size();
+                update_port_queuesize();
                 if (_logger) _logger->logQueue(*this, QueueLogger::PKT_UNQUEUE, *booted_pkt);
 
                 if (_disable_trim) {
@@ -233,6 +256,7 @@ void CompositeQueue::receivePacket(Packet& pkt)
                     } else {
                         _enqueued_high.push(booted_pkt);
                         _queuesize_high += booted_pkt->size();
+                        update_port_queuesize();
                         if (_logger)
                             _logger->logQueue(*this, QueueLogger::PKT_ENQUEUE, *booted_pkt);
                     }
@@ -243,6 +267,7 @@ void CompositeQueue::receivePacket(Packet& pkt)
             Packet* pkt_p = &pkt;
             _enqueued_low.push(pkt_p);
             _queuesize_low += pkt.size();
+            update_port_queuesize();
             if (_logger) _logger->logQueue(*this, QueueLogger::PKT_ENQUEUE, pkt);
             
             if (_serv==QUEUE_INVALID) {
@@ -315,6 +340,7 @@ void CompositeQueue::receivePacket(Packet& pkt)
     Packet* pkt_p = &pkt;
     _enqueued_high.push(pkt_p);
     _queuesize_high += pkt.size();
+    update_port_queuesize();
     if (_logger) _logger->logQueue(*this, QueueLogger::PKT_ENQUEUE, pkt);
     
     //cout << "BH[ " << _enqueued_low.size() << " " << _enqueued_high.size() << " ]" << endl;
@@ -42,6 +42,8 @@ class CompositeQueue : public Queue {
     }
 
     void setRTS(bool return_to_sender){ _return_to_sender = return_to_sender;}
+    virtual void checkpoint(Checkpoint& cp);
+    virtual const type_info& checkpoint_class() const {return typeid(CompositeQueue);}
 
     virtual const string& nodename() { return _nodename; }
     void set_ecn_threshold(mem_b ecn_thresh) {
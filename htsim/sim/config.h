@@ -10,6 +10,9 @@
 #include <string>
 #include <sstream>
 double drand();
+// state of the generator behind rand()/random(), as a string
+std::string random_state();
+void set_random_state(const std::string& state);
 
 
 #ifdef _WIN32
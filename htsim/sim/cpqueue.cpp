@@ -66,6 +66,7 @@ CutPayloadQueue::receivePacket(Packet& pkt)
     Packet* pkt_p = &pkt;
     _enqueued.push(pkt_p);
     _queuesize += pkt.size();
+    update_port_queuesize();
 
     if (_logger) _logger->logQueue(*this, QueueLogger::PKT_ENQUEUE, pkt);
     
@@ -6,16 +6,17 @@
 #include "queue_lossless.h"
 #include "queue_lossless_output.h"
 
-unordered_map<BaseQueue*,uint32_t> FatTreeSwitch::_port_flow_counts;
+thread_local unordered_map<BaseQueue*,uint32_t> FatTreeSwitch::_port_flow_counts;
 
-FatTreeSwitch::FatTreeSwitch(EventList& eventlist, string s, switch_type t, uint32_t id,simtime_picosec delay, FatTreeTopology* ft): Switch(eventlist, s) {
+FatTreeSwitch::FatTreeSwitch(EventList& eventlist, string s, switch_type t, uint32_t id,simtime_picosec delay, FatTreeTopology* ft, uint32_t hash_salt): Switch(eventlist, s), _flowlets(_flowlet_table_size), _egress(*this) {
     _id = id;
     _type = t;
-    _pipe = new CallbackPipe(delay,eventlist, this);
+    _pipe = new CallbackPipe(delay,eventlist, &_egress);
     _uproutes = NULL;
+    _fib_compiled = false;
     _ft = ft;
     _crt_route = 0;
-    _hash_salt = random();
+    _hash_salt = hash_salt;
     _last_choice = eventlist.now();
     _fib = new RouteTable();
 }
@@ -41,32 +42,115 @@ void FatTreeSwitch::receivePacket(Packet& pkt){
         return;
     }
 
-    if (_packets.find(&pkt)==_packets.end()){
-        //ingress pipeline processing.
+    //ingress pipeline processing.
+    const Route * nh = getNextHop(pkt,NULL);
+    //set next hop which is peer switch.
+    pkt.set_route(*nh);
 
-        _packets[&pkt] = true;
+    //emulate the switching latency between ingress and packet arriving at the egress queue.
+    _pipe->receivePacket(pkt); 
+};
 
-        const Route * nh = getNextHop(pkt,NULL);
-        //set next hop which is peer switch.
-        pkt.set_route(*nh);
+void FatTreeSwitch::Egress::receivePacket(Packet& pkt){
+    //egress queue processing.
+    //cout << "Switch type " << _switch._type <<  " id " << _switch._id << " pkt dst " << pkt.dst() << " dir " << pkt.get_direction() << endl;
+    pkt.sendOn();
+}
 
-        //emulate the switching latency between ingress and packet arriving at the egress queue.
-        _pipe->receivePacket(pkt); 
+void FatTreeSwitch::checkpoint_fib_entries(Checkpoint& cp, vector<FibEntry*>*& entries){
+    size_t n = cp.io_size(entries ? entries->size() : 0);
+    if (cp.restoring())
+        entries = new vector<FibEntry*>();
+    for (size_t i = 0; i < n; i++) {
+        const Route* r = NULL;
+        uint32_t cost = 0;
+        packet_direction direction = ::NONE;
+        if (cp.saving()) {
+            FibEntry* e = (*entries)[i];
+            r = e->getEgressPort();
+            cost = e->getCost();
+            direction = e->getDirection();
+        }
+        cp.io(r);
+        cp.io(cost);
+        cp.io(direction);
+        if (cp.restoring())
+            entries->push_back(new FibEntry(r, cost, direction));
     }
-    else {
-        _packets.erase(&pkt);
-        
-        //egress queue processing.
-        //cout << "Switch type " << _type <<  " id " << _id << " pkt dst " << pkt.dst() << " dir " << pkt.get_direction() << endl;
-        pkt.sendOn();
+}
+
+void FatTreeSwitch::checkpoint(Checkpoint& cp){
+    // The FIB is filled in as destinations are first seen, in an order
+    // shuffled with random(), so it is dynamic state too.  Entries that
+    // share _uproutes are saved as a reference to it.
+    if (cp.restoring() && (!_fib->routes().empty() || _fib_compiled))
+        cp.unsupported("a switch that has routed packets before the checkpoint was restored");
+    bool has_uproutes = _uproutes != NULL;
+    cp.io(has_uproutes);
+    if (has_uproutes)
+        checkpoint_fib_entries(cp, _uproutes);
+    cp.io(_fib_compiled);
+    size_t n = cp.io_size(_down_routes.size());
+    if (cp.restoring())
+        _down_routes.resize(n);
+    for (size_t i = 0; i < n; i++) {
+        checkpoint_fib_entries(cp, _down_routes[i]);
     }
-};
+    map<int, vector<FibEntry*>*> fib(_fib->routes().begin(), _fib->routes().end());
+    n = cp.io_size(fib.size());
+    auto it = fib.begin();
+    for (size_t i = 0; i < n; i++) {
+        int dst = cp.saving() ? it->first : 0;
+        vector<FibEntry*>* entries = cp.saving() ? it->second : NULL;
+        bool shared = entries && entries == _uproutes;
+        cp.io(dst);
+        cp.io(shared);
+        if (shared)
+            entries = _uproutes;
+        else
+            checkpoint_fib_entries(cp, entries);
+        if (cp.restoring())
+            _fib->setRoutes(dst, entries);
+        else
+            ++it;
+    }
+
+    cp.io(_flowlets);
+    cp.io(_crt_route);
+    cp.io(_last_choice);
+
+    cp.io(_port_states.flows());
+    if (cp.restoring() && _port_states.flows().size() != _port_states.size())
+        cp.unsupported("a switch saved with a different -ar_port_state setting");
+
+    // our share of the flow counts of all switches' ports
+    vector<pair<BaseQueue*, uint32_t>> counts;
+    for (auto& c : _port_flow_counts) {
+        if (c.first->getSwitch() == this)
+            counts.push_back(c);
+    }
+    cp.io(counts);
+    if (cp.restoring()) {
+        for (auto& c : counts) {
+            _port_flow_counts[c.first] = c.second;
+        }
+    }
+}
+
+int FatTreeSwitch::addPort(BaseQueue* q){
+    int port = Switch::addPort(q);
+    if ((_strategy == ADAPTIVE_ROUTING || _strategy == ECMP_ADAPTIVE) && (port_state_fields(fn) & PortStates::BANDWIDTH))
+        q->track_utilization();
+    if (_ar_port_state)
+        q->setPortState(&_port_states, _port_states.add(q));
+    return port;
+}
 
 void FatTreeSwitch::addHostPort(int addr, int flowid, PacketSink* transport_port){
-    Route* rt = new Route();
-    rt->push_back(_ft->queues_nlp_ns[_ft->cfg().HOST_POD_SWITCH(addr)][addr][0]);
-    rt->push_back(_ft->pipes_nlp_ns[_ft->cfg().HOST_POD_SWITCH(addr)][addr][0]);
-    rt->push_back(transport_port);
+    _ft->build_tor(_ft->cfg().HOST_POD_SWITCH(addr));
+    const Route* rt = RouteCache::intern({_ft->queues_nlp_ns[_ft->cfg().HOST_POD_SWITCH(addr)][addr][0],
+                                          _ft->pipes_nlp_ns[_ft->cfg().HOST_POD_SWITCH(addr)][addr][0],
+                                          transport_port});
     _fib->addHostRoute(addr,rt,flowid);
 }
 
@@ -85,25 +169,106 @@ uint32_t FatTreeSwitch::adaptive_route_p2c(vector<FibEntry*>* ecmp_set, int8_t (
     do {
         start = random()%ecmp_set->size();
 
-        Route * r= (*ecmp_set)[start]->getEgressPort();
-        assert(r && r->size()>1);
-        BaseQueue* q = (BaseQueue*)(r->at(0));
-        assert(q);
-        if (q->queuesize()<min){
-            choice = start;
-            min = q->queuesize();
+        if (_ar_port_state) {
+            // the port state keeps no raw queue size, so compare cmp's keys
+            uint32_t key = port_key((*ecmp_set)[start], port_state_fields(cmp));
+            if (key<min){
+                choice = start;
+                min = key;
+            }
+        } else {
+            const Route * r= (*ecmp_set)[start]->getEgressPort();
+            assert(r && r->size()>1);
+            BaseQueue* q = (BaseQueue*)(r->at(0));
+            assert(q);
+            if (q->queuesize()<min){
+                choice = start;
+                min = q->queuesize();
+            }
         }
         i++;
     } while (i<nr_choices);
     return choice;
 }
 
+uint32_t FatTreeSwitch::port_state_fields(int8_t (*cmp)(FibEntry*,FibEntry*)){
+    if (cmp == compare_flow_count)
+        return PortStates::FLOWS;
+    if (cmp == compare_pause)
+        return PortStates::PAUSE;
+    if (cmp == compare_bandwidth)
+        return PortStates::BANDWIDTH;
+    if (cmp == compare_pqb)
+        return PortStates::PAUSE | PortStates::QUEUE | PortStates::BANDWIDTH;
+    if (cmp == compare_pq)
+        return PortStates::PAUSE | PortStates::QUEUE;
+    if (cmp == compare_pb)
+        return PortStates::PAUSE | PortStates::BANDWIDTH;
+    if (cmp == compare_qb)
+        return PortStates::QUEUE | PortStates::BANDWIDTH;
+    assert(cmp == compare_queuesize);
+    return PortStates::QUEUE;
+}
+
+uint32_t FatTreeSwitch::port_key(FibEntry* e, uint32_t fields){
+    uint32_t port = e->getPort();
+    if (port == FibEntry::NO_PORT) {
+        const Route* r = e->getEgressPort();
+        assert(r && r->size()>1);
+        BaseQueue* q = (BaseQueue*)(r->at(0));
+        assert(q->getSwitch() == this);
+        port = q->port();
+        e->setPort(port);
+    }
+    if (fields & PortStates::BANDWIDTH)
+        _port_states.set_utilization(port, _port_states.queue(port)->quantized_utilization());
+    return _port_states.key(port, fields);
+}
+
+// the key of each entry of ecmp_set, in keys; the number of entries
+uint32_t FatTreeSwitch::port_keys(vector<FibEntry*>* ecmp_set, int8_t (*cmp)(FibEntry*,FibEntry*), uint32_t* keys){
+    uint32_t fields = port_state_fields(cmp);
+    uint32_t n = ecmp_set->size();
+    assert(n <= 256);
+    for (uint32_t i = 0; i < n; i++) {
+        keys[i] = port_key((*ecmp_set)[i], fields);
+    }
+    return n;
+}
+
+// as cmp(l, r), from the port state if the switch keeps it
+int8_t FatTreeSwitch::compare_ports(FibEntry* l, FibEntry* r, int8_t (*cmp)(FibEntry*,FibEntry*)){
+    if (!_ar_port_state)
+        return cmp(l, r);
+    uint32_t fields = port_state_fields(cmp);
+    uint32_t kl = port_key(l, fields), kr = port_key(r, fields);
+    return kl < kr ? 1 : (kl > kr ? -1 : 0);
+}
+
 uint32_t FatTreeSwitch::adaptive_route(vector<FibEntry*>* ecmp_set, int8_t (*cmp)(FibEntry*,FibEntry*)){
     //cout << "adaptive_route" << endl;
     uint32_t choice = 0;
 
     uint32_t best_choices[256];
     uint32_t best_choices_count = 0;
+
+    if (_ar_port_state) {
+        // the same choice as below: the best keys, in order, then a random one of them
+        uint32_t keys[256];
+        uint32_t n = port_keys(ecmp_set, cmp, keys);
+        uint32_t min = keys[0];
+        for (uint32_t i = 1; i < n; i++) {
+            min = keys[i] < min ? keys[i] : min;
+        }
+        for (uint32_t i = 0; i < n; i++) {
+            best_choices[best_choices_count] = i;
+            best_choices_count += keys[i] == min;
+        }
+        choice = best_choices[random()%best_choices_count];
+        if (cmp==compare_flow_count)
+            _port_states.add_flow((*ecmp_set)[choice]->getPort());
+        return choice;
+    }
   
     FibEntry* min = (*ecmp_set)[choice];
     best_choices[best_choices_count++] = choice;
@@ -145,6 +310,23 @@ uint32_t FatTreeSwitch::replace_worst_choice(vector<FibEntry*>* ecmp_set, int8_t
     uint32_t best_choices[256];
     uint32_t best_choices_count = 0;
 
+    if (_ar_port_state) {
+        uint32_t keys[256];
+        uint32_t n = port_keys(ecmp_set, cmp, keys);
+        uint32_t min = keys[0], max = keys[0];
+        for (uint32_t i = 1; i < n; i++) {
+            min = keys[i] < min ? keys[i] : min;
+            max = keys[i] > max ? keys[i] : max;
+        }
+        if (keys[my_choice] != max)
+            return my_choice;
+        for (uint32_t i = 0; i < n; i++) {
+            best_choices[best_choices_count] = i;
+            best_choices_count += keys[i] == min;
+        }
+        return best_choices[random()%best_choices_count];
+    }
+
     FibEntry* min = (*ecmp_set)[best_choice];
     FibEntry* max = (*ecmp_set)[worst_choice];
     best_choices[best_choices_count++] = best_choice;
@@ -182,10 +364,10 @@ uint32_t FatTreeSwitch::replace_worst_choice(vector<FibEntry*>* ecmp_set, int8_t
 
 
 int8_t FatTreeSwitch::compare_pause(FibEntry* left, FibEntry* right){
-    Route * r1= left->getEgressPort();
+    const Route * r1= left->getEgressPort();
     assert(r1 && r1->size()>1);
     LosslessOutputQueue* q1 = dynamic_cast<LosslessOutputQueue*>(r1->at(0));
-    Route * r2= right->getEgressPort();
+    const Route * r2= right->getEgressPort();
     assert(r2 && r2->size()>1);
     LosslessOutputQueue* q2 = dynamic_cast<LosslessOutputQueue*>(r2->at(0));
 
@@ -198,10 +380,10 @@ int8_t FatTreeSwitch::compare_pause(FibEntry* left, FibEntry* right){
 }
 
 int8_t FatTreeSwitch::compare_flow_count(FibEntry* left, FibEntry* right){
-    Route * r1= left->getEgressPort();
+    const Route * r1= left->getEgressPort();
     assert(r1 && r1->size()>1);
     BaseQueue* q1 = (BaseQueue*)(r1->at(0));
-    Route * r2= right->getEgressPort();
+    const Route * r2= right->getEgressPort();
     assert(r2 && r2->size()>1);
     BaseQueue* q2 = (BaseQueue*)(r2->at(0));
 
@@ -222,10 +404,10 @@ int8_t FatTreeSwitch::compare_flow_count(FibEntry* left, FibEntry* right){
 }
 
 int8_t FatTreeSwitch::compare_queuesize(FibEntry* left, FibEntry* right){
-    Route * r1= left->getEgressPort();
+    const Route * r1= left->getEgressPort();
     assert(r1 && r1->size()>1);
     BaseQueue* q1 = dynamic_cast<BaseQueue*>(r1->at(0));
-    Route * r2= right->getEgressPort();
+    const Route * r2= right->getEgressPort();
     assert(r2 && r2->size()>1);
     BaseQueue* q2 = dynamic_cast<BaseQueue*>(r2->at(0));
 
@@ -238,10 +420,10 @@ int8_t FatTreeSwitch::compare_queuesize(FibEntry* left, FibEntry* right){
 }
 
 int8_t FatTreeSwitch::compare_bandwidth(FibEntry* left, FibEntry* right){
-    Route * r1= left->getEgressPort();
+    const Route * r1= left->getEgressPort();
     assert(r1 && r1->size()>1);
     BaseQueue* q1 = dynamic_cast<BaseQueue*>(r1->at(0));
-    Route * r2= right->getEgressPort();
+    const Route * r2= right->getEgressPort();
     assert(r2 && r2->size()>1);
     BaseQueue* q2 = dynamic_cast<BaseQueue*>(r2->at(0));
 
@@ -315,18 +497,38 @@ void FatTreeSwitch::permute_paths(vector<FibEntry *>* uproutes) {
     }
 }
 
-FatTreeSwitch::routing_strategy FatTreeSwitch::_strategy = FatTreeSwitch::NIX;
-uint16_t FatTreeSwitch::_ar_fraction = 0;
-uint16_t FatTreeSwitch::_ar_sticky = FatTreeSwitch::PER_PACKET;
-simtime_picosec FatTreeSwitch::_sticky_delta = timeFromUs((uint32_t)10);
-double FatTreeSwitch::_ecn_threshold_fraction = 0.2;
-double FatTreeSwitch::_speculative_threshold_fraction = 0.2;
-int8_t (*FatTreeSwitch::fn)(FibEntry*,FibEntry*)= &FatTreeSwitch::compare_queuesize;
-uint16_t FatTreeSwitch::_trim_size = 64;
-bool FatTreeSwitch::_disable_trim = false;
+thread_local FatTreeSwitch::routing_strategy FatTreeSwitch::_strategy = FatTreeSwitch::NIX;
+thread_local uint16_t FatTreeSwitch::_ar_fraction = 0;
+thread_local uint16_t FatTreeSwitch::_ar_sticky = FatTreeSwitch::PER_PACKET;
+thread_local simtime_picosec FatTreeSwitch::_sticky_delta = timeFromUs((uint32_t)10);
+thread_local uint32_t FatTreeSwitch::_flowlet_table_size = 0;
+thread_local double FatTreeSwitch::_ecn_threshold_fraction = 0.2;
+thread_local double FatTreeSwitch::_speculative_threshold_fraction = 0.2;
+thread_local int8_t (*FatTreeSwitch::fn)(FibEntry*,FibEntry*)= &FatTreeSwitch::compare_queuesize;
+thread_local uint16_t FatTreeSwitch::_trim_size = 64;
+thread_local bool FatTreeSwitch::_disable_trim = false;
+thread_local bool FatTreeSwitch::_compiled_fib = false;
+thread_local bool FatTreeSwitch::_ar_port_state = false;
+
+vector<FibEntry*>* FatTreeSwitch::compiled_routes(uint32_t dst) {
+    const FatTreeTopologyCfg& cfg = _ft->cfg();
+    uint32_t tor = cfg.HOST_POD_SWITCH(dst);
+    switch (_type) {
+    case TOR:
+        return tor == _id ? NULL : _uproutes;
+    case AGG:
+        if (cfg.get_tiers() == 2)
+            return _down_routes[tor];
+        if (cfg.HOST_POD(dst) != cfg.AGG_SWITCH_POD_ID(_id))
+            return _uproutes;
+        return _down_routes[tor % cfg.tor_switches_per_pod()];
+    default:
+        return _down_routes[cfg.HOST_POD(dst)];
+    }
+}
 
-Route* FatTreeSwitch::getNextHop(Packet& pkt, BaseQueue* ingress_port){
-    vector<FibEntry*> * available_hops = _fib->getRoutes(pkt.dst());
+const Route* FatTreeSwitch::getNextHop(Packet& pkt, BaseQueue* ingress_port){
+    vector<FibEntry*> * available_hops = _fib_compiled ? compiled_routes(pkt.dst()) : _fib->getRoutes(pkt.dst());
 
     if (available_hops){
         //implement a form of ECMP hashing; might need to revisit based on measured performance.
@@ -348,32 +550,32 @@ Route* FatTreeSwitch::getNextHop(Packet& pkt, BaseQueue* ingress_port){
                     ecmp_choice = adaptive_route(available_hops,fn); 
                 } 
                 else if (_ar_sticky==FatTreeSwitch::PER_FLOWLET){     
-                    if (_flowlet_maps.find(pkt.flow_id())!=_flowlet_maps.end()){
-                        FlowletInfo* f = _flowlet_maps[pkt.flow_id()];
+                    FlowletTable::Entry* f = _flowlets.find(pkt.flow_id());
+                    if (f){
                         
                         // only reroute an existing flow if its inter packet time is larger than _sticky_delta and
                         // and
                         // 50% chance happens. 
                         // and (commented out) if the switch has not taken any other placement decision that we've not seen the effects of.
-                        if (eventlist().now() - f->_last > _sticky_delta && /*eventlist().now() - _last_choice > _pipe->delay() + BaseQueue::_update_period  &&*/ random()%2==0){ 
+                        if (eventlist().now() - f->last > _sticky_delta && /*eventlist().now() - _last_choice > _pipe->delay() + BaseQueue::_update_period  &&*/ random()%2==0){ 
                             //cout << "AR 1 " << timeAsUs(eventlist().now()) << endl;
                             uint32_t new_route = adaptive_route(available_hops,fn); 
-                            if (fn(available_hops->at(f->_egress),available_hops->at(new_route)) < 0){
-                                f->_egress = new_route;
+                            if (compare_ports(available_hops->at(f->egress),available_hops->at(new_route),fn) < 0){
+                                f->egress = new_route;
                                 _last_choice = eventlist().now();
-                                //cout << "Switch " << _type << ":" << _id << " choosing new path "<<  f->_egress << " for " << pkt.flow_id() << " at " << timeAsUs(eventlist().now()) << " last is " << timeAsUs(f->_last) << endl;
+                                //cout << "Switch " << _type << ":" << _id << " choosing new path "<<  f->egress << " for " << pkt.flow_id() << " at " << timeAsUs(eventlist().now()) << " last is " << timeAsUs(f->last) << endl;
                             }
                         }
-                        ecmp_choice = f->_egress;
+                        ecmp_choice = f->egress;
 
-                        f->_last = eventlist().now();
+                        f->last = eventlist().now();
                     }
                     else {
                         //cout << "AR 2 " << timeAsUs(eventlist().now()) << endl;
                         ecmp_choice = adaptive_route(available_hops,fn); 
                         _last_choice = eventlist().now();
 
-                        _flowlet_maps[pkt.flow_id()] = new FlowletInfo(ecmp_choice,eventlist().now());
+                        _flowlets.insert(pkt.flow_id(),ecmp_choice,eventlist().now(),_sticky_delta);
                     }
                 }
 
@@ -416,6 +618,19 @@ Route* FatTreeSwitch::getNextHop(Packet& pkt, BaseQueue* ingress_port){
     }
 
     //no route table entries for this destination. Add them to FIB or fail. 
+    //A lazy topology may not have built our links yet.
+    if (_type == TOR)
+        _ft->build_tor(_id);
+    else if (_type == AGG)
+        _ft->build_agg(_id);
+    else if (_type == CORE)
+        _ft->build_core(_id);
+
+    if (_compiled_fib && !_fib_compiled) {
+        compile_fib();
+        return getNextHop(pkt, ingress_port);
+    }
+
     if (_type == TOR){
         if ( _ft->cfg().HOST_POD_SWITCH(pkt.dst()) == _id) { 
             //this host is directly connected!
@@ -428,35 +643,9 @@ Route* FatTreeSwitch::getNextHop(Packet& pkt, BaseQueue* ingress_port){
             if (_uproutes)
                 _fib->setRoutes(pkt.dst(),_uproutes);
             else {
-                uint32_t podid,agg_min,agg_max;
-
-                if (_ft->cfg().get_tiers()==3) {
-                    podid = _id / _ft->cfg().tor_switches_per_pod();
-                    agg_min = _ft->cfg().MIN_POD_AGG_SWITCH(podid);
-                    agg_max = _ft->cfg().MAX_POD_AGG_SWITCH(podid);
-                }
-                else {
-                    agg_min = 0;
-                    agg_max = _ft->cfg().getNAGG()-1;
-                }
-
-                for (uint32_t k=agg_min; k<=agg_max;k++){
-                    for (uint32_t b = 0; b < _ft->cfg().bundlesize(AGG_TIER); b++) {
-                        Route * r = new Route();
-                        r->push_back(_ft->queues_nlp_nup[_id][k][b]);
-                        assert(((BaseQueue*)r->at(0))->getSwitch() == this);
-
-                        r->push_back(_ft->pipes_nlp_nup[_id][k][b]);
-                        r->push_back(_ft->queues_nlp_nup[_id][k][b]->getRemoteEndpoint());
-                        _fib->addRoute(pkt.dst(),r,1,UP);
-                    }
-
-                    /*
-                      FatTreeSwitch* next = (FatTreeSwitch*)_ft->queues_nlp_nup[_id][k]->getRemoteEndpoint();
-                      assert (next->getType()==AGG && next->getID() == k);
-                    */
-                }
-                _uproutes = _fib->getRoutes(pkt.dst());
+                _uproutes = new vector<FibEntry*>();
+                add_up_routes(_uproutes);
+                _fib->setRoutes(pkt.dst(),_uproutes);
                 permute_paths(_uproutes);
             }
         }
@@ -464,64 +653,26 @@ Route* FatTreeSwitch::getNextHop(Packet& pkt, BaseQueue* ingress_port){
         if (_ft->cfg().get_tiers()==2 || _ft->cfg().HOST_POD(pkt.dst()) == _ft->cfg().AGG_SWITCH_POD_ID(_id)) {
             //must go down!
             //target NLP id is 2 * pkt.dst()/K
-            uint32_t target_tor = _ft->cfg().HOST_POD_SWITCH(pkt.dst());
-            for (uint32_t b = 0; b < _ft->cfg().bundlesize(AGG_TIER); b++) {
-                Route * r = new Route();
-                r->push_back(_ft->queues_nup_nlp[_id][target_tor][b]);
-                assert(((BaseQueue*)r->at(0))->getSwitch() == this);
-
-                r->push_back(_ft->pipes_nup_nlp[_id][target_tor][b]);          
-                r->push_back(_ft->queues_nup_nlp[_id][target_tor][b]->getRemoteEndpoint());
-
-                _fib->addRoute(pkt.dst(),r,1, DOWN);
-            }
+            vector<FibEntry*>* routes = new vector<FibEntry*>();
+            add_down_routes(routes, _ft->cfg().HOST_POD_SWITCH(pkt.dst()));
+            _fib->setRoutes(pkt.dst(),routes);
         } else {
             //go up!
             if (_uproutes)
                 _fib->setRoutes(pkt.dst(),_uproutes);
             else {
-                uint32_t podpos = _id % _ft->cfg().agg_switches_per_pod();
-                uint32_t uplink_bundles = _ft->cfg().radix_up(AGG_TIER) / _ft->cfg().bundlesize(CORE_TIER);
-                for (uint32_t l = 0; l <  uplink_bundles ; l++) {
-                    uint32_t core = l * _ft->cfg().agg_switches_per_pod() + podpos;
-                    for (uint32_t b = 0; b < _ft->cfg().bundlesize(CORE_TIER); b++) {
-                        Route *r = new Route();
-                        r->push_back(_ft->queues_nup_nc[_id][core][b]);
-                        assert(((BaseQueue*)r->at(0))->getSwitch() == this);
-
-                        r->push_back(_ft->pipes_nup_nc[_id][core][b]);
-                        r->push_back(_ft->queues_nup_nc[_id][core][b]->getRemoteEndpoint());
-
-                        /*
-                          FatTreeSwitch* next = (FatTreeSwitch*)_ft->queues_nup_nc[_id][k]->getRemoteEndpoint();
-                          assert (next->getType()==CORE && next->getID() == k);
-                        */
-                    
-                        _fib->addRoute(pkt.dst(),r,1,UP);
-
-                        //cout << "AGG switch " << _id << " adding route to " << pkt.dst() << " via CORE " << k << " bundle_id " << b << endl;
-                    }
-                }
+                vector<FibEntry*>* routes = new vector<FibEntry*>();
+                add_up_routes(routes);
+                _fib->setRoutes(pkt.dst(),routes);
                 //_uproutes = _fib->getRoutes(pkt.dst());
-                permute_paths(_fib->getRoutes(pkt.dst()));
+                permute_paths(routes);
             }
         }
     } else if (_type == CORE) {
         uint32_t nup = _ft->cfg().MIN_POD_AGG_SWITCH(_ft->cfg().HOST_POD(pkt.dst())) + (_id % _ft->cfg().agg_switches_per_pod());
-        for (uint32_t b = 0; b < _ft->cfg().bundlesize(CORE_TIER); b++) {
-            Route *r = new Route();
-            //cout << "CORE switch " << _id << " adding route to " << pkt.dst() << " via AGG " << nup << endl;
-
-            assert (_ft->queues_nc_nup[_id][nup][b]);
-            r->push_back(_ft->queues_nc_nup[_id][nup][b]);
-            assert(((BaseQueue*)r->at(0))->getSwitch() == this);
-
-            assert (_ft->pipes_nc_nup[_id][nup][b]);
-            r->push_back(_ft->pipes_nc_nup[_id][nup][b]);
-
-            r->push_back(_ft->queues_nc_nup[_id][nup][b]->getRemoteEndpoint());
-            _fib->addRoute(pkt.dst(),r,1,DOWN);
-        }
+        vector<FibEntry*>* routes = new vector<FibEntry*>();
+        add_down_routes(routes, nup);
+        _fib->setRoutes(pkt.dst(),routes);
     }
     else {
         cerr << "Route lookup on switch with no proper type: " << _type << endl;
@@ -532,3 +683,122 @@ Route* FatTreeSwitch::getNextHop(Packet& pkt, BaseQueue* ingress_port){
     //FIB has been filled in; return choice. 
     return getNextHop(pkt, ingress_port);
 };
+
+// the FIB entries for our uplinks: a ToR's to the aggs in its pod (or
+// all of them with two tiers), an agg's to its cores
+void FatTreeSwitch::add_up_routes(vector<FibEntry*>* routes) {
+    if (_type == TOR) {
+        uint32_t podid,agg_min,agg_max;
+
+        if (_ft->cfg().get_tiers()==3) {
+            podid = _id / _ft->cfg().tor_switches_per_pod();
+            agg_min = _ft->cfg().MIN_POD_AGG_SWITCH(podid);
+            agg_max = _ft->cfg().MAX_POD_AGG_SWITCH(podid);
+        }
+        else {
+            agg_min = 0;
+            agg_max = _ft->cfg().getNAGG()-1;
+        }
+
+        for (uint32_t k=agg_min; k<=agg_max;k++){
+            for (uint32_t b = 0; b < _ft->cfg().bundlesize(AGG_TIER); b++) {
+                const Route * r = RouteCache::intern({_ft->queues_nlp_nup[_id][k][b],
+                                                      _ft->pipes_nlp_nup[_id][k][b],
+                                                      _ft->queues_nlp_nup[_id][k][b]->getRemoteEndpoint()});
+                assert(((BaseQueue*)r->at(0))->getSwitch() == this);
+                routes->push_back(new FibEntry(r,1,UP));
+            }
+
+            /*
+              FatTreeSwitch* next = (FatTreeSwitch*)_ft->queues_nlp_nup[_id][k]->getRemoteEndpoint();
+              assert (next->getType()==AGG && next->getID() == k);
+            */
+        }
+    } else {
+        assert(_type == AGG);
+        uint32_t podpos = _id % _ft->cfg().agg_switches_per_pod();
+        uint32_t uplink_bundles = _ft->cfg().radix_up(AGG_TIER) / _ft->cfg().bundlesize(CORE_TIER);
+        for (uint32_t l = 0; l <  uplink_bundles ; l++) {
+            uint32_t core = l * _ft->cfg().agg_switches_per_pod() + podpos;
+            for (uint32_t b = 0; b < _ft->cfg().bundlesize(CORE_TIER); b++) {
+                const Route *r = RouteCache::intern({_ft->queues_nup_nc[_id][core][b],
+                                                     _ft->pipes_nup_nc[_id][core][b],
+                                                     _ft->queues_nup_nc[_id][core][b]->getRemoteEndpoint()});
+                assert(((BaseQueue*)r->at(0))->getSwitch() == this);
+
+                /*
+                  FatTreeSwitch* next = (FatTreeSwitch*)_ft->queues_nup_nc[_id][k]->getRemoteEndpoint();
+                  assert (next->getType()==CORE && next->getID() == k);
+                */
+                    
+                routes->push_back(new FibEntry(r,1,UP));
+
+                //cout << "AGG switch " << _id << " adding route to " << pkt.dst() << " via CORE " << k << " bundle_id " << b << endl;
+            }
+        }
+    }
+}
+
+// the FIB entries for our downlinks to the switch below: to ToR next
+// from an agg, to agg next from a core
+void FatTreeSwitch::add_down_routes(vector<FibEntry*>* routes, uint32_t next) {
+    if (_type == AGG) {
+        for (uint32_t b = 0; b < _ft->cfg().bundlesize(AGG_TIER); b++) {
+            const Route * r = RouteCache::intern({_ft->queues_nup_nlp[_id][next][b],
+                                                  _ft->pipes_nup_nlp[_id][next][b],
+                                                  _ft->queues_nup_nlp[_id][next][b]->getRemoteEndpoint()});
+            assert(((BaseQueue*)r->at(0))->getSwitch() == this);
+            routes->push_back(new FibEntry(r,1,DOWN));
+        }
+    } else {
+        assert(_type == CORE);
+        for (uint32_t b = 0; b < _ft->cfg().bundlesize(CORE_TIER); b++) {
+            //cout << "CORE switch " << _id << " adding route to " << pkt.dst() << " via AGG " << next << endl;
+
+            assert (_ft->queues_nc_nup[_id][next][b]);
+            assert (_ft->pipes_nc_nup[_id][next][b]);
+            const Route *r = RouteCache::intern({_ft->queues_nc_nup[_id][next][b],
+                                                 _ft->pipes_nc_nup[_id][next][b],
+                                                 _ft->queues_nc_nup[_id][next][b]->getRemoteEndpoint()});
+            assert(((BaseQueue*)r->at(0))->getSwitch() == this);
+            routes->push_back(new FibEntry(r,1,DOWN));
+        }
+    }
+}
+
+// Fill in the routes to every destination at once, rather than as each
+// is first seen.  Destinations that go up share one set of routes, and
+// those that go down are indexed by the ToR (at an agg) or pod (at a
+// core) they are in, so a lookup is just an index.
+void FatTreeSwitch::compile_fib() {
+    const FatTreeTopologyCfg& cfg = _ft->cfg();
+    if (_type == TOR) {
+        // our own hosts have host routes
+        _uproutes = new vector<FibEntry*>();
+        add_up_routes(_uproutes);
+        permute_paths(_uproutes);
+    } else if (_type == AGG) {
+        uint32_t tor_min = 0, tor_count = cfg.getNTOR();
+        if (cfg.get_tiers() == 3) {
+            tor_min = cfg.MIN_POD_TOR_SWITCH(cfg.AGG_SWITCH_POD_ID(_id));
+            tor_count = cfg.tor_switches_per_pod();
+
+            _uproutes = new vector<FibEntry*>();
+            add_up_routes(_uproutes);
+            permute_paths(_uproutes);
+        }
+        _down_routes.resize(tor_count);
+        for (uint32_t t = 0; t < tor_count; t++) {
+            _down_routes[t] = new vector<FibEntry*>();
+            add_down_routes(_down_routes[t], tor_min + t);
+        }
+    } else {
+        assert(_type == CORE);
+        _down_routes.resize(cfg.no_of_pods());
+        for (uint32_t pod = 0; pod < cfg.no_of_pods(); pod++) {
+            _down_routes[pod] = new vector<FibEntry*>();
+            add_down_routes(_down_routes[pod], cfg.MIN_POD_AGG_SWITCH(pod) + (_id % cfg.agg_switches_per_pod()));
+        }
+    }
+    _fib_compiled = true;
+}
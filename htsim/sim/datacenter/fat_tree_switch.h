@@ -4,6 +4,8 @@
 
 #include "switch.h"
 #include "callback_pipe.h"
+#include "flowlet_table.h"
+#include "port_state.h"
 #include <unordered_map>
 
 class FatTreeTopology;
@@ -72,16 +74,7 @@ static inline uint32_t freeBSDHash(uint32_t target1, uint32_t target2 = 0, uint3
 
 #undef MIX
 
-class FlowletInfo {
-public:
-    uint32_t _egress;
-    simtime_picosec _last;
-
-    FlowletInfo(uint32_t egress,simtime_picosec lasttime) {_egress = egress; _last = lasttime;};
-
-};
-
-class FatTreeSwitch : public Switch {
+class FatTreeSwitch : public Switch, public Checkpointable {
 public:
     enum switch_type {
         NONE = 0, TOR = 1, AGG = 2, CORE = 3
@@ -95,11 +88,11 @@ public:
         PER_PACKET = 0, PER_FLOWLET = 1
     };
 
-    FatTreeSwitch(EventList& eventlist, string s, switch_type t, uint32_t id,simtime_picosec switch_delay, FatTreeTopology* ft);
+    FatTreeSwitch(EventList& eventlist, string s, switch_type t, uint32_t id,simtime_picosec switch_delay, FatTreeTopology* ft, uint32_t hash_salt);
     ~FatTreeSwitch() override;
   
     virtual void receivePacket(Packet& pkt);
-    virtual Route* getNextHop(Packet& pkt, BaseQueue* ingress_port);
+    virtual const Route* getNextHop(Packet& pkt, BaseQueue* ingress_port);
     virtual uint32_t getType() {return _type;}
 
     uint32_t adaptive_route(vector<FibEntry*>* ecmp_set, int8_t (*cmp)(FibEntry*,FibEntry*));
@@ -115,23 +108,43 @@ public:
     static int8_t compare_pb(FibEntry* l, FibEntry* r);//compare pause, bandwidth
     static int8_t compare_qb(FibEntry* l, FibEntry* r);//compare pause, bandwidth
 
-    static int8_t (*fn)(FibEntry*,FibEntry*);
+    static thread_local int8_t (*fn)(FibEntry*,FibEntry*);
 
+    virtual int addPort(BaseQueue* q);
     virtual void addHostPort(int addr, int flowid, PacketSink* transport_port);
 
+    const FlowletTable& flowlets() const {return _flowlets;}
+
     virtual void permute_paths(vector<FibEntry*>* uproutes);
+    void compile_fib();
+
+    virtual void checkpoint(Checkpoint& cp);
+    virtual const type_info& checkpoint_class() const {return typeid(FatTreeSwitch);}
 
     static void set_strategy(routing_strategy s) { assert (_strategy==NIX); _strategy = s; }
     static void set_ar_fraction(uint16_t f) { assert(f>=1);_ar_fraction = f;} 
 
-    static routing_strategy _strategy;
-    static uint16_t _ar_fraction;
-    static uint16_t _ar_sticky;
-    static simtime_picosec _sticky_delta;
-    static double _ecn_threshold_fraction;
-    static double _speculative_threshold_fraction;
-    static uint16_t _trim_size;
-    static bool _disable_trim;
+    static thread_local routing_strategy _strategy;
+    static thread_local uint16_t _ar_fraction;
+    static thread_local uint16_t _ar_sticky;
+    static thread_local simtime_picosec _sticky_delta;
+    // entries in each switch's flowlet table, or 0 to remember every flow
+    static thread_local uint32_t _flowlet_table_size;
+    static thread_local double _ecn_threshold_fraction;
+    static thread_local double _speculative_threshold_fraction;
+    static thread_local uint16_t _trim_size;
+    static thread_local bool _disable_trim;
+    // Compile each switch's whole FIB into arrays the first time it
+    // routes a packet, instead of adding destinations as they are seen.
+    // Up-routes are shared by every destination they lead to, so aggs
+    // balance across cores differently from the per-destination FIB.
+    static thread_local bool _compiled_fib;
+    // Have ports publish their state to an array per switch as it
+    // changes and choose adaptive routes from that, rather than
+    // comparing queues sampled every BaseQueue::_update_period.  The
+    // queue sizes compared are current, so routes differ from the
+    // sampled ones.
+    static thread_local bool _ar_port_state;
 private:
     switch_type _type;
     Pipe* _pipe;
@@ -140,15 +153,42 @@ private:
     //CAREFUL: can't always have a single FIB for all up destinations when there are failures!
     vector<FibEntry*>* _uproutes;
 
-    unordered_map<uint32_t,FlowletInfo*> _flowlet_maps;
+    // the compiled FIB's down-routes, by destination ToR at an agg (ToR
+    // within the pod with three tiers) and by destination pod at a core
+    bool _fib_compiled;
+    vector<vector<FibEntry*>*> _down_routes;
+    vector<FibEntry*>* compiled_routes(uint32_t dst);
+    void add_up_routes(vector<FibEntry*>* routes);
+    void add_down_routes(vector<FibEntry*>* routes, uint32_t next);
+
+    FlowletTable _flowlets;
+
+    static thread_local unordered_map<BaseQueue*,uint32_t> _port_flow_counts;
 
-    static unordered_map<BaseQueue*,uint32_t> _port_flow_counts;
+    PortStates _port_states;
+    static uint32_t port_state_fields(int8_t (*cmp)(FibEntry*,FibEntry*));
+    uint32_t port_key(FibEntry* e, uint32_t fields);
+    uint32_t port_keys(vector<FibEntry*>* ecmp_set, int8_t (*cmp)(FibEntry*,FibEntry*), uint32_t* keys);
+    int8_t compare_ports(FibEntry* l, FibEntry* r, int8_t (*cmp)(FibEntry*,FibEntry*));
 
     uint32_t _crt_route;
     uint32_t _hash_salt;
     simtime_picosec _last_choice;
 
-    unordered_map<Packet*,bool> _packets;
+    // _pipe, which models the switching latency, hands packets on to
+    // this rather than back to the switch, so receivePacket() only sees
+    // them on ingress
+    class Egress : public PacketSink {
+    public:
+        Egress(FatTreeSwitch& sw) : _switch(sw) {}
+        virtual void receivePacket(Packet& pkt);
+        virtual const string& nodename() {return _switch.nodename();}
+    private:
+        FatTreeSwitch& _switch;
+    };
+    Egress _egress;
+
+    void checkpoint_fib_entries(Checkpoint& cp, vector<FibEntry*>*& entries);
 };
 
 #endif
@@ -770,12 +770,14 @@ void FatTreeTopologyCfg::check_consistency() const {
 FatTreeTopology::FatTreeTopology(const FatTreeTopologyCfg* cfg,
                                 QueueLoggerFactory* logger_factory,
                                 EventList* ev,
-                                FirstFit * fit
+                                FirstFit * fit,
+                                bool lazy
                                 ):
                                 _logger_factory(logger_factory),
                                 _eventlist(ev),
                                 _ff(fit),
-                                _cfg(cfg)
+                                _cfg(cfg),
+                                _lazy(lazy)
                                 {
     // Only build topology after verifying that things are in order.
     if (_cfg->_from_file) {
@@ -783,7 +785,6 @@ FatTreeTopology::FatTreeTopology(const FatTreeTopologyCfg* cfg,
     }
     alloc_vectors();
 
-    QueueLogger* queueLogger;
     if (_cfg->_tiers == 3) {
         for (uint32_t j=0;j<_cfg->NCORE;j++) {
             for (uint32_t k=0;k<_cfg->NAGG;k++) {
@@ -819,20 +820,46 @@ FatTreeTopology::FatTreeTopology(const FatTreeTopologyCfg* cfg,
         }
     }
 
+    // the switches' ECMP hash salts, drawn in the order the switches
+    // are numbered whether or not they are built now, so a lazily built
+    // topology routes exactly like an eager one
+    _tor_salt.resize(_cfg->NTOR);
+    _agg_salt.resize(_cfg->NAGG);
+    _core_salt.resize(_cfg->NCORE);
+    for (uint32_t j=0;j<_cfg->NTOR;j++){
+        _tor_salt[j] = random();
+    }
+    for (uint32_t j=0;j<_cfg->NAGG;j++){
+        _agg_salt[j] = random();
+    }
+    for (uint32_t j=0;j<_cfg->NCORE;j++){
+        _core_salt[j] = random();
+    }
+
+    if (_lazy) {
+        // lossless switches size their thresholds by their port count,
+        // and first fit wants every queue up front
+        if (_cfg->_qt == LOSSLESS || _cfg->_qt == LOSSLESS_INPUT || _cfg->_qt == LOSSLESS_INPUT_ECN || _ff) {
+            cerr << "A lazily built fat tree doesn't support lossless queues or first fit" << endl;
+            exit(1);
+        }
+        _tor_built.resize(_cfg->NTOR, false);
+        _agg_built.resize(_cfg->NAGG, false);
+        _core_built.resize(_cfg->NCORE, false);
+        return;
+    }
+
     //create switches if we have lossless operation
     //if (_qt==LOSSLESS)
     // changed to always create switches
     for (uint32_t j=0;j<_cfg->NTOR;j++){
-        simtime_picosec switch_latency = (_cfg->_switch_latencies[TOR_TIER] > 0) ? _cfg->_switch_latencies[TOR_TIER] : _cfg->_switch_latency;
-        switches_lp[j] = new FatTreeSwitch(*_eventlist, "Switch_LowerPod_"+ntoa(j),FatTreeSwitch::TOR,j,switch_latency,this);
+        make_switch(TOR_TIER, j);
     }
     for (uint32_t j=0;j<_cfg->NAGG;j++){
-        simtime_picosec switch_latency = (_cfg->_switch_latencies[AGG_TIER] > 0) ? _cfg->_switch_latencies[AGG_TIER] : _cfg->_switch_latency;
-        switches_up[j] = new FatTreeSwitch(*_eventlist, "Switch_UpperPod_"+ntoa(j), FatTreeSwitch::AGG,j,switch_latency,this);
+        make_switch(AGG_TIER, j);
     }
     for (uint32_t j=0;j<_cfg->NCORE;j++){
-        simtime_picosec switch_latency = (_cfg->_switch_latencies[CORE_TIER] > 0) ? _cfg->_switch_latencies[CORE_TIER] : _cfg->_switch_latency;
-        switches_c[j] = new FatTreeSwitch(*_eventlist, "Switch_Core_"+ntoa(j), FatTreeSwitch::CORE,j,switch_latency,this);
+        make_switch(CORE_TIER, j);
     }
       
     // links from lower layer pod switch to server
@@ -841,49 +868,7 @@ FatTreeTopology::FatTreeTopology(const FatTreeTopologyCfg* cfg,
         for (uint32_t l = 0; l < link_bundles; l++) {
             uint32_t srv = tor * link_bundles + l;
             for (uint32_t b = 0; b < _cfg->_bundlesize[TOR_TIER]; b++) {
-                // Downlink
-                if (_logger_factory) {
-                    queueLogger = _logger_factory->createQueueLogger();
-                } else {
-                    queueLogger = NULL;
-                }
-            
-                queues_nlp_ns[tor][srv][b] = alloc_queue(queueLogger, _cfg->_queue_down[TOR_TIER], DOWNLINK, TOR_TIER, true);
-                queues_nlp_ns[tor][srv][b]->setName("LS" + ntoa(tor) + "->DST" +ntoa(srv) + "(" + ntoa(b) + ")");
-                //if (logfile) logfile->writeName(*(queues_nlp_ns[tor][srv]));
-                simtime_picosec hop_latency = (_cfg->_hop_latency == 0) ? _cfg->_link_latencies[TOR_TIER] : _cfg->_hop_latency;
-                pipes_nlp_ns[tor][srv][b] = new Pipe(hop_latency, *_eventlist);
-                pipes_nlp_ns[tor][srv][b]->setName("Pipe-LS" + ntoa(tor)  + "->DST" + ntoa(srv) + "(" + ntoa(b) + ")");
-                //if (logfile) logfile->writeName(*(pipes_nlp_ns[tor][srv]));
-            
-                // Uplink
-                if (_logger_factory) {
-                    queueLogger = _logger_factory->createQueueLogger();
-                } else {
-                    queueLogger = NULL;
-                }
-                queues_ns_nlp[srv][tor][b] = alloc_src_queue(queueLogger);   
-                queues_ns_nlp[srv][tor][b]->setName("SRC" + ntoa(srv) + "->LS" +ntoa(tor) + "(" + ntoa(b) + ")");
-                //cout << queues_ns_nlp[srv][tor][b]->str() << endl;
-                //if (logfile) logfile->writeName(*(queues_ns_nlp[srv][tor]));
-
-                queues_ns_nlp[srv][tor][b]->setRemoteEndpoint(switches_lp[tor]);
-
-                assert(switches_lp[tor]->addPort(queues_nlp_ns[tor][srv][b]) < 96);
-
-                if (cfg->_qt==LOSSLESS_INPUT || cfg->_qt == LOSSLESS_INPUT_ECN){
-                    //no virtual queue needed at server
-                    new LosslessInputQueue(*_eventlist, queues_ns_nlp[srv][tor][b], switches_lp[tor], hop_latency);
-                }
-        
-                pipes_ns_nlp[srv][tor][b] = new Pipe(hop_latency, *_eventlist);
-                pipes_ns_nlp[srv][tor][b]->setName("Pipe-SRC" + ntoa(srv) + "->LS" + ntoa(tor) + "(" + ntoa(b) + ")");
-                //if (logfile) logfile->writeName(*(pipes_ns_nlp[srv][tor]));
-            
-                if (_ff){
-                    _ff->add_queue(queues_nlp_ns[tor][srv][b]);
-                    _ff->add_queue(queues_ns_nlp[srv][tor][b]);
-                }
+                add_host_link(tor, srv, b);
             }
         }
     }
@@ -904,68 +889,7 @@ FatTreeTopology::FatTreeTopology(const FatTreeTopologyCfg* cfg,
         }
         for (uint32_t agg=agg_min; agg<=agg_max; agg++){
             for (uint32_t b = 0; b < _cfg->_bundlesize[AGG_TIER]; b++) {
-                // Downlink
-                if (_logger_factory) {
-                    queueLogger = _logger_factory->createQueueLogger();
-                } else {
-                    queueLogger = NULL;
-                }
-
-                if (_cfg->_tiers == 2 && (agg - agg_min) < _cfg->_num_failed_links){
-                    queues_nup_nlp[agg][tor][b] = alloc_queue(queueLogger, _cfg->_downlink_speeds[AGG_TIER],_cfg->_queue_down[AGG_TIER], DOWNLINK, AGG_TIER,false,true);
-                    cout << "Failure: US" + ntoa(agg) + "->LS_" + ntoa(tor) + "(" + ntoa(b) + ") linkspeed set to " << speedAsGbps(_cfg->_downlink_speeds[AGG_TIER] * _cfg->_failed_link_ratio) << endl;
-                }
-                else
-                    queues_nup_nlp[agg][tor][b] = alloc_queue((QueueLogger*)queueLogger, (const mem_b)_cfg->_queue_down[AGG_TIER], DOWNLINK, AGG_TIER);
-
-                queues_nup_nlp[agg][tor][b]->setName("US" + ntoa(agg) + "->LS_" + ntoa(tor) + "(" + ntoa(b) + ")");
-                //if (logfile) logfile->writeName(*(queues_nup_nlp[agg][tor]));
-            
-                simtime_picosec hop_latency = (_cfg->_hop_latency == 0) ? _cfg->_link_latencies[AGG_TIER] : _cfg->_hop_latency;
-                pipes_nup_nlp[agg][tor][b] = new Pipe(hop_latency, *_eventlist);
-                pipes_nup_nlp[agg][tor][b]->setName("Pipe-US" + ntoa(agg) + "->LS" + ntoa(tor) + "(" + ntoa(b) + ")");
-                //if (logfile) logfile->writeName(*(pipes_nup_nlp[agg][tor]));
-            
-                // Uplink
-                if (_logger_factory) {
-                    queueLogger = _logger_factory->createQueueLogger();
-                } else {
-                    queueLogger = NULL;
-                }
-
-                if (_cfg->_tiers == 2 && (agg - agg_min) < _cfg->_num_failed_links){
-                    queues_nlp_nup[tor][agg][b] = alloc_queue(queueLogger, _cfg->_downlink_speeds[AGG_TIER], _cfg->_queue_up[TOR_TIER], UPLINK, TOR_TIER, true, true);
-                    cout << "Failure: LS" + ntoa(tor) + "->US" + ntoa(agg) + "(" + ntoa(b) + ") linkspeed set to " << speedAsGbps(_cfg->_downlink_speeds[AGG_TIER] * _cfg->_failed_link_ratio) << endl;
-                }
-                else 
-                    queues_nlp_nup[tor][agg][b] = alloc_queue(queueLogger, _cfg->_queue_up[TOR_TIER], UPLINK, TOR_TIER, true);
-
-                queues_nlp_nup[tor][agg][b]->setName("LS" + ntoa(tor) + "->US" + ntoa(agg) + "(" + ntoa(b) + ")");
-                //cout << queues_nlp_nup[tor][agg][b]->str() << endl;
-                //if (logfile) logfile->writeName(*(queues_nlp_nup[tor][agg]));
-
-                assert(switches_lp[tor]->addPort(queues_nlp_nup[tor][agg][b]) < 128);
-                assert(switches_up[agg]->addPort(queues_nup_nlp[agg][tor][b]) < 128);
-                queues_nlp_nup[tor][agg][b]->setRemoteEndpoint(switches_up[agg]);
-                queues_nup_nlp[agg][tor][b]->setRemoteEndpoint(switches_lp[tor]);
-
-                /*if (_qt==LOSSLESS){
-                  ((LosslessQueue*)queues_nlp_nup[tor][agg])->setRemoteEndpoint(queues_nup_nlp[agg][tor]);
-                  ((LosslessQueue*)queues_nup_nlp[agg][tor])->setRemoteEndpoint(queues_nlp_nup[tor][agg]);
-                  }else */
-                if (_cfg->_qt==LOSSLESS_INPUT || _cfg->_qt == LOSSLESS_INPUT_ECN){            
-                    new LosslessInputQueue(*_eventlist, queues_nlp_nup[tor][agg][b],switches_up[agg], hop_latency);
-                    new LosslessInputQueue(*_eventlist, queues_nup_nlp[agg][tor][b],switches_lp[tor], hop_latency);
-                }
-        
-                pipes_nlp_nup[tor][agg][b] = new Pipe(hop_latency, *_eventlist);
-                pipes_nlp_nup[tor][agg][b]->setName("Pipe-LS" + ntoa(tor) + "->US" + ntoa(agg) + "(" + ntoa(b) + ")");
-                //if (logfile) logfile->writeName(*(pipes_nlp_nup[tor][agg]));
-        
-                if (_ff){
-                    _ff->add_queue(queues_nlp_nup[tor][agg][b]);
-                    _ff->add_queue(queues_nup_nlp[agg][tor][b]);
-                }
+                add_tor_agg_link(tor, agg, b);
             }
         }
     }
@@ -985,64 +909,7 @@ FatTreeTopology::FatTreeTopology(const FatTreeTopologyCfg* cfg,
                 uint32_t core = podpos +  _cfg->_agg_switches_per_pod * l;
                 assert(core < _cfg->NCORE);
                 for (uint32_t b = 0; b < _cfg->_bundlesize[CORE_TIER]; b++) {
-                
-                    // Downlink
-                    if (_logger_factory) {
-                        queueLogger = _logger_factory->createQueueLogger();
-                    } else {
-                        queueLogger = NULL;
-                    }
-                    assert(queues_nup_nc[agg][core][b] == NULL);
-                    queues_nup_nc[agg][core][b] = alloc_queue(queueLogger, _cfg->_queue_up[AGG_TIER], UPLINK, AGG_TIER);
-                    queues_nup_nc[agg][core][b]->setName("US" + ntoa(agg) + "->CS" + ntoa(core) + "(" + ntoa(b) + ")");
-                    //cout << queues_nup_nc[agg][core][b]->str() << endl;
-                    //if (logfile) logfile->writeName(*(queues_nup_nc[agg][core]));
-        
-                    simtime_picosec hop_latency = (_cfg->_hop_latency == 0) ? _cfg->_link_latencies[CORE_TIER] : _cfg->_hop_latency;
-                    pipes_nup_nc[agg][core][b] = new Pipe(hop_latency, *_eventlist);
-                    pipes_nup_nc[agg][core][b]->setName("Pipe-US" + ntoa(agg) + "->CS" + ntoa(core) + "(" + ntoa(b) + ")");
-                    //if (logfile) logfile->writeName(*(pipes_nup_nc[agg][core]));
-        
-                    // Uplink
-                    if (_logger_factory) {
-                        queueLogger = _logger_factory->createQueueLogger();
-                    } else {
-                        queueLogger = NULL;
-                    }
-        
-                    if ((l+agg*_cfg->_agg_switches_per_pod)<_cfg->_num_failed_links){
-                        queues_nc_nup[core][agg][b] = alloc_queue(queueLogger, _cfg->_downlink_speeds[CORE_TIER], _cfg->_queue_down[CORE_TIER], DOWNLINK, CORE_TIER, false,true);
-                        cout << "Adding link failure for agg_sw " << ntoa(agg) << " l " << ntoa(l) << " b " << ntoa(b) << endl;
-                    } else {
-                        queues_nc_nup[core][agg][b] = alloc_queue(queueLogger, _cfg->_queue_down[CORE_TIER], DOWNLINK, CORE_TIER);
-                    }
-        
-                    queues_nc_nup[core][agg][b]->setName("CS" + ntoa(core) + "->US" + ntoa(agg) + "(" + ntoa(b) + ")");
-
-                    assert(switches_up[agg]->addPort(queues_nup_nc[agg][core][b]) < 64);
-                    assert(switches_c[core]->addPort(queues_nc_nup[core][agg][b]) < 64);
-                    queues_nup_nc[agg][core][b]->setRemoteEndpoint(switches_c[core]);
-                    queues_nc_nup[core][agg][b]->setRemoteEndpoint(switches_up[agg]);
-
-                    /*if (_qt==LOSSLESS){
-                      ((LosslessQueue*)queues_nup_nc[agg][core])->setRemoteEndpoint(queues_nc_nup[core][agg]);
-                      ((LosslessQueue*)queues_nc_nup[core][agg])->setRemoteEndpoint(queues_nup_nc[agg][core]);
-                      }
-                      else*/
-                    if (_cfg->_qt == LOSSLESS_INPUT || _cfg->_qt == LOSSLESS_INPUT_ECN){
-                        new LosslessInputQueue(*_eventlist, queues_nup_nc[agg][core][b], switches_c[core], hop_latency);
-                        new LosslessInputQueue(*_eventlist, queues_nc_nup[core][agg][b], switches_up[agg], hop_latency);
-                    }
-                    //if (logfile) logfile->writeName(*(queues_nc_nup[core][agg]));
-            
-                    pipes_nc_nup[core][agg][b] = new Pipe(hop_latency, *_eventlist);
-                    pipes_nc_nup[core][agg][b]->setName("Pipe-CS" + ntoa(core) + "->US" + ntoa(agg) + "(" + ntoa(b) + ")");
-                    //if (logfile) logfile->writeName(*(pipes_nc_nup[core][agg]));
-            
-                    if (_ff){
-                        _ff->add_queue(queues_nup_nc[agg][core][b]);
-                        _ff->add_queue(queues_nc_nup[core][agg][b]);
-                    }
+                    add_agg_core_link(agg, core, b);
                 }
             }
         }
@@ -1067,6 +934,304 @@ FatTreeTopology::FatTreeTopology(const FatTreeTopologyCfg* cfg,
             switches_c[j]->configureLossless();
         }
     }
+
+    _tor_built.resize(_cfg->NTOR, true);
+    _agg_built.resize(_cfg->NAGG, true);
+    _core_built.resize(_cfg->NCORE, true);
+}
+
+Switch* FatTreeTopology::make_switch(int tier, uint32_t id) {
+    simtime_picosec switch_latency = (_cfg->_switch_latencies[tier] > 0) ? _cfg->_switch_latencies[tier] : _cfg->_switch_latency;
+    switch (tier) {
+    case TOR_TIER:
+        if (!switches_lp[id])
+            switches_lp[id] = new FatTreeSwitch(*_eventlist, "Switch_LowerPod_"+ntoa(id),FatTreeSwitch::TOR,id,switch_latency,this,_tor_salt[id]);
+        return switches_lp[id];
+    case AGG_TIER:
+        if (!switches_up[id])
+            switches_up[id] = new FatTreeSwitch(*_eventlist, "Switch_UpperPod_"+ntoa(id), FatTreeSwitch::AGG,id,switch_latency,this,_agg_salt[id]);
+        return switches_up[id];
+    case CORE_TIER:
+        if (!switches_c[id])
+            switches_c[id] = new FatTreeSwitch(*_eventlist, "Switch_Core_"+ntoa(id), FatTreeSwitch::CORE,id,switch_latency,this,_core_salt[id]);
+        return switches_c[id];
+    default:
+        abort();
+    }
+}
+
+void FatTreeTopology::add_host_link(uint32_t tor, uint32_t srv, uint32_t b) {
+    QueueLogger* queueLogger;
+
+    // Downlink
+    if (_logger_factory) {
+        queueLogger = _logger_factory->createQueueLogger();
+    } else {
+        queueLogger = NULL;
+    }
+            
+    queues_nlp_ns[tor][srv][b] = alloc_queue(queueLogger, _cfg->_queue_down[TOR_TIER], DOWNLINK, TOR_TIER, true);
+    queues_nlp_ns[tor][srv][b]->setName("LS" + ntoa(tor) + "->DST" +ntoa(srv) + "(" + ntoa(b) + ")");
+    //if (logfile) logfile->writeName(*(queues_nlp_ns[tor][srv]));
+    simtime_picosec hop_latency = (_cfg->_hop_latency == 0) ? _cfg->_link_latencies[TOR_TIER] : _cfg->_hop_latency;
+    pipes_nlp_ns[tor][srv][b] = new Pipe(hop_latency, *_eventlist);
+    pipes_nlp_ns[tor][srv][b]->setName("Pipe-LS" + ntoa(tor)  + "->DST" + ntoa(srv) + "(" + ntoa(b) + ")");
+    //if (logfile) logfile->writeName(*(pipes_nlp_ns[tor][srv]));
+            
+    // Uplink
+    if (_logger_factory) {
+        queueLogger = _logger_factory->createQueueLogger();
+    } else {
+        queueLogger = NULL;
+    }
+    queues_ns_nlp[srv][tor][b] = alloc_src_queue(queueLogger);   
+    queues_ns_nlp[srv][tor][b]->setName("SRC" + ntoa(srv) + "->LS" +ntoa(tor) + "(" + ntoa(b) + ")");
+    //cout << queues_ns_nlp[srv][tor][b]->str() << endl;
+    //if (logfile) logfile->writeName(*(queues_ns_nlp[srv][tor]));
+
+    queues_ns_nlp[srv][tor][b]->setRemoteEndpoint(switches_lp[tor]);
+
+    assert(switches_lp[tor]->addPort(queues_nlp_ns[tor][srv][b]) < 96);
+
+    if (_cfg->_qt==LOSSLESS_INPUT || _cfg->_qt == LOSSLESS_INPUT_ECN){
+        //no virtual queue needed at server
+        new LosslessInputQueue(*_eventlist, queues_ns_nlp[srv][tor][b], switches_lp[tor], hop_latency);
+    }
+        
+    pipes_ns_nlp[srv][tor][b] = new Pipe(hop_latency, *_eventlist);
+    pipes_ns_nlp[srv][tor][b]->setName("Pipe-SRC" + ntoa(srv) + "->LS" + ntoa(tor) + "(" + ntoa(b) + ")");
+    //if (logfile) logfile->writeName(*(pipes_ns_nlp[srv][tor]));
+            
+    if (_ff){
+        _ff->add_queue(queues_nlp_ns[tor][srv][b]);
+        _ff->add_queue(queues_ns_nlp[srv][tor][b]);
+    }
+}
+
+void FatTreeTopology::add_tor_agg_link(uint32_t tor, uint32_t agg, uint32_t b) {
+    QueueLogger* queueLogger;
+    // in two tiers every ToR connects to every agg, so the first
+    // _num_failed_links aggs are the ones whose links have failed
+    bool failed = _cfg->_tiers == 2 && agg < _cfg->_num_failed_links;
+
+    // Downlink
+    if (_logger_factory) {
+        queueLogger = _logger_factory->createQueueLogger();
+    } else {
+        queueLogger = NULL;
+    }
+
+    if (failed){
+        queues_nup_nlp[agg][tor][b] = alloc_queue(queueLogger, _cfg->_downlink_speeds[AGG_TIER],_cfg->_queue_down[AGG_TIER], DOWNLINK, AGG_TIER,false,true);
+        cout << "Failure: US" + ntoa(agg) + "->LS_" + ntoa(tor) + "(" + ntoa(b) + ") linkspeed set to " << speedAsGbps(_cfg->_downlink_speeds[AGG_TIER] * _cfg->_failed_link_ratio) << endl;
+    }
+    else
+        queues_nup_nlp[agg][tor][b] = alloc_queue((QueueLogger*)queueLogger, (const mem_b)_cfg->_queue_down[AGG_TIER], DOWNLINK, AGG_TIER);
+
+    queues_nup_nlp[agg][tor][b]->setName("US" + ntoa(agg) + "->LS_" + ntoa(tor) + "(" + ntoa(b) + ")");
+    //if (logfile) logfile->writeName(*(queues_nup_nlp[agg][tor]));
+            
+    simtime_picosec hop_latency = (_cfg->_hop_latency == 0) ? _cfg->_link_latencies[AGG_TIER] : _cfg->_hop_latency;
+    pipes_nup_nlp[agg][tor][b] = new Pipe(hop_latency, *_eventlist);
+    pipes_nup_nlp[agg][tor][b]->setName("Pipe-US" + ntoa(agg) + "->LS" + ntoa(tor) + "(" + ntoa(b) + ")");
+    //if (logfile) logfile->writeName(*(pipes_nup_nlp[agg][tor]));
+            
+    // Uplink
+    if (_logger_factory) {
+        queueLogger = _logger_factory->createQueueLogger();
+    } else {
+        queueLogger = NULL;
+    }
+
+    if (failed){
+        queues_nlp_nup[tor][agg][b] = alloc_queue(queueLogger, _cfg->_downlink_speeds[AGG_TIER], _cfg->_queue_up[TOR_TIER], UPLINK, TOR_TIER, true, true);
+        cout << "Failure: LS" + ntoa(tor) + "->US" + ntoa(agg) + "(" + ntoa(b) + ") linkspeed set to " << speedAsGbps(_cfg->_downlink_speeds[AGG_TIER] * _cfg->_failed_link_ratio) << endl;
+    }
+    else 
+        queues_nlp_nup[tor][agg][b] = alloc_queue(queueLogger, _cfg->_queue_up[TOR_TIER], UPLINK, TOR_TIER, true);
+
+    queues_nlp_nup[tor][agg][b]->setName("LS" + ntoa(tor) + "->US" + ntoa(agg) + "(" + ntoa(b) + ")");
+    //cout << queues_nlp_nup[tor][agg][b]->str() << endl;
+    //if (logfile) logfile->writeName(*(queues_nlp_nup[tor][agg]));
+
+    assert(switches_lp[tor]->addPort(queues_nlp_nup[tor][agg][b]) < 128);
+    assert(switches_up[agg]->addPort(queues_nup_nlp[agg][tor][b]) < 128);
+    queues_nlp_nup[tor][agg][b]->setRemoteEndpoint(switches_up[agg]);
+    queues_nup_nlp[agg][tor][b]->setRemoteEndpoint(switches_lp[tor]);
+
+    /*if (_qt==LOSSLESS){
+      ((LosslessQueue*)queues_nlp_nup[tor][agg])->setRemoteEndpoint(queues_nup_nlp[agg][tor]);
+      ((LosslessQueue*)queues_nup_nlp[agg][tor])->setRemoteEndpoint(queues_nlp_nup[tor][agg]);
+      }else */
+    if (_cfg->_qt==LOSSLESS_INPUT || _cfg->_qt == LOSSLESS_INPUT_ECN){            
+        new LosslessInputQueue(*_eventlist, queues_nlp_nup[tor][agg][b],switches_up[agg], hop_latency);
+        new LosslessInputQueue(*_eventlist, queues_nup_nlp[agg][tor][b],switches_lp[tor], hop_latency);
+    }
+        
+    pipes_nlp_nup[tor][agg][b] = new Pipe(hop_latency, *_eventlist);
+    pipes_nlp_nup[tor][agg][b]->setName("Pipe-LS" + ntoa(tor) + "->US" + ntoa(agg) + "(" + ntoa(b) + ")");
+    //if (logfile) logfile->writeName(*(pipes_nlp_nup[tor][agg]));
+        
+    if (_ff){
+        _ff->add_queue(queues_nlp_nup[tor][agg][b]);
+        _ff->add_queue(queues_nup_nlp[agg][tor][b]);
+    }
+}
+
+void FatTreeTopology::add_agg_core_link(uint32_t agg, uint32_t core, uint32_t b) {
+    QueueLogger* queueLogger;
+    // core is the l'th uplink bundle of agg
+    uint32_t l = core / _cfg->_agg_switches_per_pod;
+                
+    // Downlink
+    if (_logger_factory) {
+        queueLogger = _logger_factory->createQueueLogger();
+    } else {
+        queueLogger = NULL;
+    }
+    assert(queues_nup_nc[agg][core][b] == NULL);
+    queues_nup_nc[agg][core][b] = alloc_queue(queueLogger, _cfg->_queue_up[AGG_TIER], UPLINK, AGG_TIER);
+    queues_nup_nc[agg][core][b]->setName("US" + ntoa(agg) + "->CS" + ntoa(core) + "(" + ntoa(b) + ")");
+    //cout << queues_nup_nc[agg][core][b]->str() << endl;
+    //if (logfile) logfile->writeName(*(queues_nup_nc[agg][core]));
+        
+    simtime_picosec hop_latency = (_cfg->_hop_latency == 0) ? _cfg->_link_latencies[CORE_TIER] : _cfg->_hop_latency;
+    pipes_nup_nc[agg][core][b] = new Pipe(hop_latency, *_eventlist);
+    pipes_nup_nc[agg][core][b]->setName("Pipe-US" + ntoa(agg) + "->CS" + ntoa(core) + "(" + ntoa(b) + ")");
+    //if (logfile) logfile->writeName(*(pipes_nup_nc[agg][core]));
+        
+    // Uplink
+    if (_logger_factory) {
+        queueLogger = _logger_factory->createQueueLogger();
+    } else {
+        queueLogger = NULL;
+    }
+        
+    if ((l+agg*_cfg->_agg_switches_per_pod)<_cfg->_num_failed_links){
+        queues_nc_nup[core][agg][b] = alloc_queue(queueLogger, _cfg->_downlink_speeds[CORE_TIER], _cfg->_queue_down[CORE_TIER], DOWNLINK, CORE_TIER, false,true);
+        cout << "Adding link failure for agg_sw " << ntoa(agg) << " l " << ntoa(l) << " b " << ntoa(b) << endl;
+    } else {
+        queues_nc_nup[core][agg][b] = alloc_queue(queueLogger, _cfg->_queue_down[CORE_TIER], DOWNLINK, CORE_TIER);
+    }
+        
+    queues_nc_nup[core][agg][b]->setName("CS" + ntoa(core) + "->US" + ntoa(agg) + "(" + ntoa(b) + ")");
+
+    assert(switches_up[agg]->addPort(queues_nup_nc[agg][core][b]) < 64);
+    assert(switches_c[core]->addPort(queues_nc_nup[core][agg][b]) < 64);
+    queues_nup_nc[agg][core][b]->setRemoteEndpoint(switches_c[core]);
+    queues_nc_nup[core][agg][b]->setRemoteEndpoint(switches_up[agg]);
+
+    /*if (_qt==LOSSLESS){
+      ((LosslessQueue*)queues_nup_nc[agg][core])->setRemoteEndpoint(queues_nc_nup[core][agg]);
+      ((LosslessQueue*)queues_nc_nup[core][agg])->setRemoteEndpoint(queues_nup_nc[agg][core]);
+      }
+      else*/
+    if (_cfg->_qt == LOSSLESS_INPUT || _cfg->_qt == LOSSLESS_INPUT_ECN){
+        new LosslessInputQueue(*_eventlist, queues_nup_nc[agg][core][b], switches_c[core], hop_latency);
+        new LosslessInputQueue(*_eventlist, queues_nc_nup[core][agg][b], switches_up[agg], hop_latency);
+    }
+    //if (logfile) logfile->writeName(*(queues_nc_nup[core][agg]));
+            
+    pipes_nc_nup[core][agg][b] = new Pipe(hop_latency, *_eventlist);
+    pipes_nc_nup[core][agg][b]->setName("Pipe-CS" + ntoa(core) + "->US" + ntoa(agg) + "(" + ntoa(b) + ")");
+    //if (logfile) logfile->writeName(*(pipes_nc_nup[core][agg]));
+            
+    if (_ff){
+        _ff->add_queue(queues_nup_nc[agg][core][b]);
+        _ff->add_queue(queues_nc_nup[core][agg][b]);
+    }
+}
+
+// A lazily built switch is created, without links, as soon as a
+// neighbour that is built needs to point a queue at it.  Building it
+// adds the links to every neighbour, apart from those already added
+// when that neighbour was built, and for a ToR those to its hosts.
+void FatTreeTopology::build_tor_links(uint32_t tor) {
+    make_switch(TOR_TIER, tor);
+
+    uint32_t link_bundles = _cfg->_radix_down[TOR_TIER]/_cfg->_bundlesize[TOR_TIER];
+    for (uint32_t l = 0; l < link_bundles; l++) {
+        uint32_t srv = tor * link_bundles + l;
+        for (uint32_t b = 0; b < _cfg->_bundlesize[TOR_TIER]; b++) {
+            add_host_link(tor, srv, b);
+        }
+    }
+
+    uint32_t agg_min = 0, agg_max = _cfg->NAGG-1;
+    if (_cfg->_tiers == 3) {
+        uint32_t podid = tor/_cfg->_tor_switches_per_pod;
+        agg_min = _cfg->MIN_POD_AGG_SWITCH(podid);
+        agg_max = _cfg->MAX_POD_AGG_SWITCH(podid);
+    }
+    for (uint32_t agg=agg_min; agg<=agg_max; agg++){
+        make_switch(AGG_TIER, agg);
+        if (_agg_built[agg])
+            continue;
+        for (uint32_t b = 0; b < _cfg->_bundlesize[AGG_TIER]; b++) {
+            add_tor_agg_link(tor, agg, b);
+        }
+    }
+    _tor_built[tor] = true;
+}
+
+void FatTreeTopology::build_agg_links(uint32_t agg) {
+    make_switch(AGG_TIER, agg);
+
+    uint32_t tor_min = 0, tor_max = _cfg->NTOR-1;
+    if (_cfg->_tiers == 3) {
+        uint32_t podid = _cfg->AGG_SWITCH_POD_ID(agg);
+        tor_min = _cfg->MIN_POD_TOR_SWITCH(podid);
+        tor_max = _cfg->MAX_POD_TOR_SWITCH(podid);
+    }
+    for (uint32_t tor=tor_min; tor<=tor_max; tor++){
+        make_switch(TOR_TIER, tor);
+        if (_tor_built[tor])
+            continue;
+        for (uint32_t b = 0; b < _cfg->_bundlesize[AGG_TIER]; b++) {
+            add_tor_agg_link(tor, agg, b);
+        }
+    }
+
+    if (_cfg->_tiers == 3) {
+        uint32_t podpos = agg%(_cfg->_agg_switches_per_pod);
+        for (uint32_t l = 0; l < _cfg->_radix_up[AGG_TIER]/_cfg->_bundlesize[CORE_TIER]; l++) {
+            uint32_t core = podpos +  _cfg->_agg_switches_per_pod * l;
+            make_switch(CORE_TIER, core);
+            if (_core_built[core])
+                continue;
+            for (uint32_t b = 0; b < _cfg->_bundlesize[CORE_TIER]; b++) {
+                add_agg_core_link(agg, core, b);
+            }
+        }
+    }
+    _agg_built[agg] = true;
+}
+
+void FatTreeTopology::build_core_links(uint32_t core) {
+    make_switch(CORE_TIER, core);
+
+    // one agg in each pod, the one at the core's position in its pod
+    for (uint32_t agg = core % _cfg->_agg_switches_per_pod; agg < _cfg->NAGG; agg += _cfg->_agg_switches_per_pod) {
+        make_switch(AGG_TIER, agg);
+        if (_agg_built[agg])
+            continue;
+        for (uint32_t b = 0; b < _cfg->_bundlesize[CORE_TIER]; b++) {
+            add_agg_core_link(agg, core, b);
+        }
+    }
+    _core_built[core] = true;
+}
+
+void FatTreeTopology::build_all() {
+    for (uint32_t j=0;j<_cfg->NTOR;j++){
+        build_tor(j);
+    }
+    for (uint32_t j=0;j<_cfg->NAGG;j++){
+        build_agg(j);
+    }
+    for (uint32_t j=0;j<_cfg->NCORE;j++){
+        build_core(j);
+    }
 }
 
 template<class P> void delete_3d_vector(vector<vector<vector<P*>>>& vec3d) {
@@ -1253,6 +1418,7 @@ void FatTreeTopology::add_failed_link(uint32_t type, uint32_t switch_id, uint32_
 
     // note: if bundlesize > 1, we only fail the first link in a bundle.
     
+    build_agg(switch_id);
     assert(queues_nup_nc[switch_id][k][0]!=NULL && queues_nc_nup[k][switch_id][0]!=NULL );
     queues_nup_nc[switch_id][k][0] = NULL;
     queues_nc_nup[k][switch_id][0] = NULL;
@@ -1263,6 +1429,24 @@ void FatTreeTopology::add_failed_link(uint32_t type, uint32_t switch_id, uint32_
 }
 
 
+void FatTreeTopology::degrade_link(uint32_t switch_id, uint32_t link_id){
+    assert(_cfg->_tiers == 3);
+    assert(link_id < _cfg->_radix_up[AGG_TIER]);
+    assert(switch_id < _cfg->NAGG);
+
+    uint32_t podpos = switch_id%(_cfg->_agg_switches_per_pod);
+    uint32_t k = podpos * _cfg->_agg_switches_per_pod + link_id;
+
+    build_agg(switch_id);
+    BaseQueue* up = queues_nup_nc[switch_id][k][0];
+    BaseQueue* down = queues_nc_nup[k][switch_id][0];
+    assert(up && down);
+    up->setBitrate(up->bitrate() * _cfg->_failed_link_ratio);
+    down->setBitrate(down->bitrate() * _cfg->_failed_link_ratio);
+    cout << "Failure: " << up->str() << " and " << down->str() << " linkspeed set to "
+         << speedAsGbps(up->bitrate()) << endl;
+}
+
 vector<const Route*>* FatTreeTopology::get_bidir_paths(uint32_t src, uint32_t dest, bool reverse){
     vector<const Route*>* paths = new vector<const Route*>();
 
@@ -1274,6 +1458,18 @@ vector<const Route*>* FatTreeTopology::get_bidir_paths(uint32_t src, uint32_t de
     //Queue* pqueue = new Queue(_linkspeed, memFromPkt(FEEDER_BUFFER), *_eventlist, simplequeuelogger);
     //pqueue->setName("PQueue_" + ntoa(src) + "_" + ntoa(dest));
     //logfile->writeName(*pqueue);
+
+    // build every switch the paths go through
+    build_tor(_cfg->HOST_POD_SWITCH(src));
+    build_tor(_cfg->HOST_POD_SWITCH(dest));
+    if (_cfg->HOST_POD(src) != _cfg->HOST_POD(dest)) {
+        for (uint32_t pod : {_cfg->HOST_POD(src), _cfg->HOST_POD(dest)}) {
+            for (uint32_t agg = _cfg->MIN_POD_AGG_SWITCH(pod); agg <= _cfg->MAX_POD_AGG_SWITCH(pod); agg++) {
+                build_agg(agg);
+            }
+        }
+    }
+
     if (_cfg->HOST_POD_SWITCH(src)==_cfg->HOST_POD_SWITCH(dest)){
   
         // forward path
@@ -1606,6 +1802,8 @@ void FatTreeTopology::print_path(std::ofstream &paths,uint32_t src,const Route*
 }
 
 void FatTreeTopology::add_switch_loggers(Logfile& log, simtime_picosec sample_period) {
+    // a switch's logger covers the ports it has when it's added
+    build_all();
     for (uint32_t i = 0; i < _cfg->NTOR; i++) {
         switches_lp[i]->add_logger(log, sample_period);
     }
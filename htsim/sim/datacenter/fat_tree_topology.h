@@ -145,6 +145,7 @@ public:
     
     //uint32_t getK() const {return K;}
     uint32_t getNAGG() const {return NAGG;}
+    uint32_t getNTOR() const {return NTOR;}
 
     uint32_t no_of_nodes() const {return _no_of_nodes;}
     uint32_t no_of_cores() const {return NCORE;}
@@ -236,7 +237,8 @@ public:
     FatTreeTopology(const FatTreeTopologyCfg* cfg,
                     QueueLoggerFactory* logger_factory,
                     EventList* ev,
-                    FirstFit * fit);
+                    FirstFit * fit,
+                    bool lazy = false);
     ~FatTreeTopology() override;
 
     vector <Switch*> switches_lp;
@@ -272,19 +274,44 @@ public:
     vector<uint32_t>* get_neighbours(uint32_t src) { return NULL;};
 
     void add_failed_link(uint32_t type, uint32_t switch_id, uint32_t link_id);
+    // the same link failing while the simulation runs: both directions
+    // drop to _failed_link_ratio of their speed, like the -failed links
+    void degrade_link(uint32_t switch_id, uint32_t link_id);
 
     // add loggers to record total queue size at switches
     virtual void add_switch_loggers(Logfile& log, simtime_picosec sample_period); 
 
     const FatTreeTopologyCfg& cfg() { return *_cfg; };
+
+    // A lazy topology only builds a switch and its links when a route or
+    // FIB lookup first needs them, so parts of the vectors above stay
+    // NULL until then.  Anything indexing them directly builds the
+    // switches it wants first.  The result routes exactly like the eager
+    // build, but objects are created (and logged) in a different order,
+    // so it can't be checkpointed.
+    bool lazy() const {return _lazy;}
+    void build_tor(uint32_t tor) {if (!_tor_built[tor]) build_tor_links(tor);}
+    void build_agg(uint32_t agg) {if (!_agg_built[agg]) build_agg_links(agg);}
+    void build_core(uint32_t core) {if (!_core_built[core]) build_core_links(core);}
+    void build_all();
 private:
     const FatTreeTopologyCfg* _cfg;
+    bool _lazy;
+    vector<uint32_t> _tor_salt, _agg_salt, _core_salt;
+    vector<bool> _tor_built, _agg_built, _core_built;
     map<Queue*,int> _link_usage;
     int64_t find_lp_switch(Queue* queue);
     int64_t find_up_switch(Queue* queue);
     int64_t find_core_switch(Queue* queue);
     int64_t find_destination(Queue* queue);
     void alloc_vectors();
+    Switch* make_switch(int tier, uint32_t id);
+    void add_host_link(uint32_t tor, uint32_t srv, uint32_t b);
+    void add_tor_agg_link(uint32_t tor, uint32_t agg, uint32_t b);
+    void add_agg_core_link(uint32_t agg, uint32_t core, uint32_t b);
+    void build_tor_links(uint32_t tor);
+    void build_agg_links(uint32_t agg);
+    void build_core_links(uint32_t core);
 };
 
 #endif
@@ -0,0 +1,165 @@
+// -*- c-basic-offset: 4; indent-tabs-mode: nil -*-
+#ifndef FLOWLET_TABLE_H
+#define FLOWLET_TABLE_H
+
+/*
+ * A switch's flowlet state for adaptive routing: the egress each flow
+ * was last sent to and when.
+ *
+ * The entries sit inline in one open-addressed array, found by probing
+ * from the slot the flow id hashes to.  With a capacity set, the array
+ * is that size (rounded up to a power of two) and a flow is only looked
+ * for in the PROBES slots from its own, as in a hardware flowlet table.
+ * Entries are never removed; one that has been idle for longer than the
+ * expiry is reused when a new flow needs its slot, and if none of the
+ * new flow's slots is free or idle the least recently used live entry
+ * is evicted.  With no capacity the table doubles instead, so it never
+ * forgets a flow.
+ */
+
+#include <assert.h>
+#include <stdint.h>
+#include <vector>
+#include "config.h"
+
+class FlowletTable {
+public:
+    struct Entry {
+        uint32_t flow_id;
+        uint32_t egress;
+        simtime_picosec last;
+    };
+
+    static const uint32_t PROBES = 8;
+
+    FlowletTable(uint32_t capacity) : _capacity(capacity_for(capacity)), _used(0), _collisions(0), _reclaimed(0), _evictions(0) {}
+
+    // the number of entries a table asked for capacity really has
+    static uint32_t capacity_for(uint32_t capacity) {
+        if (!capacity)
+            return 0;
+        uint32_t c = PROBES;
+        while (c < capacity) {
+            c *= 2;
+        }
+        return c;
+    }
+
+    // the entry for flow_id, or NULL if the table doesn't have it
+    Entry* find(uint32_t flow_id) {
+        uint32_t n = probes();
+        for (uint32_t i = 0, s = home(flow_id); i < n; i++, s = (s + 1) & mask()) {
+            Entry& e = _slots[s];
+            if (e.egress == EMPTY)
+                return NULL;
+            if (e.flow_id == flow_id)
+                return &e;
+        }
+        return NULL;
+    }
+
+    // add an entry for flow_id, which must not have one; entries last
+    // used more than expiry ago may be reused
+    void insert(uint32_t flow_id, uint32_t egress, simtime_picosec now, simtime_picosec expiry) {
+        make_room();
+        Entry& e = slot_for(flow_id);
+        if (e.egress == EMPTY)
+            _used++;
+        else if (now - e.last > expiry)
+            _reclaimed++;
+        else
+            _evictions++;
+        e = Entry{flow_id, egress, now};
+    }
+
+    // flows that hashed to a slot another flow had
+    uint64_t collisions() const {return _collisions;}
+    // new flows that took over an idle flow's entry
+    uint64_t reclaimed() const {return _reclaimed;}
+    // new flows that pushed out the entry of a flow that wasn't idle
+    uint64_t evictions() const {return _evictions;}
+    size_t size() const {return _used;}
+
+    template<class C> void checkpoint(C& cp) {
+        std::vector<Entry> entries;
+        if (cp.saving()) {
+            for (const Entry& e : _slots) {
+                if (e.egress != EMPTY)
+                    entries.push_back(e);
+            }
+        }
+        cp.io(entries);
+        cp.io(_collisions);
+        cp.io(_reclaimed);
+        cp.io(_evictions);
+        if (cp.saving())
+            return;
+        // the saved table may have had another capacity
+        _slots.clear();
+        _used = 0;
+        for (const Entry& e : entries) {
+            make_room();
+            Entry& s = slot_for_quietly(e.flow_id);
+            if (s.egress == EMPTY)
+                _used++;
+            s = e;
+        }
+    }
+private:
+    static const uint32_t EMPTY = UINT32_MAX;
+
+    inline uint32_t mask() const {return _slots.size() - 1;}
+    inline uint32_t home(uint32_t flow_id) const {return (flow_id * 0x9e3779b1u) & mask();}
+    // a table that grows always has a free slot to stop at
+    inline uint32_t probes() const {return _capacity ? (_slots.empty() ? 0 : PROBES) : _slots.size();}
+
+    // where a new entry for flow_id goes: the first free slot, else the
+    // least recently used of those it may be in
+    Entry& slot_for(uint32_t flow_id) {
+        if (_slots[home(flow_id)].egress != EMPTY)
+            _collisions++;
+        return slot_for_quietly(flow_id);
+    }
+
+    Entry& slot_for_quietly(uint32_t flow_id) {
+        uint32_t n = probes();
+        Entry* oldest = NULL;
+        for (uint32_t i = 0, s = home(flow_id); i < n; i++, s = (s + 1) & mask()) {
+            Entry& e = _slots[s];
+            if (e.egress == EMPTY)
+                return e;
+            if (!oldest || e.last < oldest->last)
+                oldest = &e;
+        }
+        assert(oldest);
+        return *oldest;
+    }
+
+    // a table that grows is kept at most half full
+    void make_room() {
+        if (_slots.empty())
+            resize(_capacity ? _capacity : PROBES);
+        else if (!_capacity && 2 * (_used + 1) > _slots.size())
+            resize(2 * _slots.size());
+    }
+
+    void resize(size_t size) {
+        std::vector<Entry> slots;
+        slots.swap(_slots);
+        _slots.assign(size, Entry{0, EMPTY, 0});
+        for (const Entry& e : slots) {
+            if (e.egress != EMPTY)
+                slot_for_quietly(e.flow_id) = e;
+        }
+    }
+
+    // fixed size, or 0 to grow
+    uint32_t _capacity;
+    size_t _used;
+    uint64_t _collisions;
+    uint64_t _reclaimed;
+    uint64_t _evictions;
+    std::vector<Entry> _slots;
+};
+
+#endif
@@ -47,7 +47,7 @@ int DEFAULT_NODES = 432;
 EventList eventlist;
 
 void exit_error(char* progr) {
-    cout << "Usage " << progr << " [-nodes N]\n\t[-q queue_size]\n\t[-queue_type composite|random|lossless|lossless_input|]\n\t[-tm traffic_matrix_file]\n\t[-strat route_strategy (single,\n\tecmp_host,ecmp_ar,\n\tecmp_host_ar ar_thresh)]\n\t[-log log_level]\n\t[-seed random_seed]\n\t[-end end_time_in_usec]\n\t[-mtu MTU]\n\t[-hop_latency x] per hop wire latency in us,default 1\n\t[-switch_latency x] switching latency in us, default 0\n\t[-start_delta] time in us to randomly delay the start of connections\n\t[-pfc_thresholds low high]" << endl;
+    cout << "Usage " << progr << " [-nodes N]\n\t[-q queue_size]\n\t[-queue_type composite|random|lossless|lossless_input|]\n\t[-tm traffic_matrix_file]\n\t[-strat route_strategy (single,\n\tecmp_host,ecmp_ar,\n\tecmp_host_ar ar_thresh)]\n\t[-log log_level]\n\t[-seed random_seed]\n\t[-end end_time_in_usec]\n\t[-mtu MTU]\n\t[-hop_latency x] per hop wire latency in us,default 1\n\t[-switch_latency x] switching latency in us, default 0\n\t[-start_delta] time in us to randomly delay the start of connections\n\t[-pfc_thresholds low high]\n\t[-utilization_tracker intervals|buckets] how queues measure utilization for -ar_method bandwidth, default intervals" << endl;
     exit(1);
 }
 
@@ -237,6 +237,16 @@ int main(int argc, char **argv) {
             _packets_per_burst = atoi(argv[i+1]);
             cout << "NIC burst " << _packets_per_burst << endl;
             i++;
+        } else if (!strcmp(argv[i],"-utilization_tracker")){
+            if (!strcmp(argv[i+1],"intervals"))
+                BaseQueue::_utilization_tracker = BaseQueue::BUSY_INTERVALS;
+            else if (!strcmp(argv[i+1],"buckets"))
+                BaseQueue::_utilization_tracker = BaseQueue::BUSY_BUCKETS;
+            else {
+                cout << "Unknown utilization tracker " << argv[i+1] << ", expecting intervals or buckets" << endl;
+                exit_error(argv[0]);
+            }
+            i++;
         } else if (!strcmp(argv[i],"-ar_method")){
             if (!strcmp(argv[i+1],"pause")){
                 cout << "Adaptive routing based on pause state " << endl;
@@ -52,7 +52,7 @@ EventList eventlist;
 Logfile* lg;
 
 void exit_error(char* progr) {
-    cout << "Usage " << progr << " [UNCOUPLED(DEFAULT)|COUPLED_INC|FULLY_COUPLED|COUPLED_EPSILON] [epsilon][COUPLED_SCALABLE_TCP" << endl;
+    cout << "Usage " << progr << " [UNCOUPLED(DEFAULT)|COUPLED_INC|FULLY_COUPLED|COUPLED_EPSILON] [epsilon][COUPLED_SCALABLE_TCP] [-rtx_scan]" << endl;
     exit(1);
 }
 
@@ -81,6 +81,9 @@ int main(int argc, char **argv) {
         } else if (!strcmp(argv[i],"-nodes")){
             no_of_nodes = atoi(argv[i+1]);
             i++;
+        } else if (!strcmp(argv[i],"-rtx_scan")){
+            // retransmit timeouts only checked every scan period
+            RtxTimerScanner::_default_mode = RtxTimerScanner::SCAN;
         } else if (!strcmp(argv[i],"-tm")){
             tm_file = argv[i+1];
             cout << "traffic matrix input file: "<< tm_file << endl;
@@ -50,7 +50,7 @@ size_t subflow_count = 1;
 EventList eventlist;
 
 void exit_error(char* progr) {
-    cout << "Usage " << progr << " [UNCOUPLED(DEFAULT)|COUPLED_INC|FULLY_COUPLED|COUPLED_EPSILON] [epsilon][COUPLED_SCALABLE_TCP" << endl;
+    cout << "Usage " << progr << " [UNCOUPLED(DEFAULT)|COUPLED_INC|FULLY_COUPLED|COUPLED_EPSILON] [epsilon][COUPLED_SCALABLE_TCP] [-rtx_scan]" << endl;
     exit(1);
 }
 
@@ -95,6 +95,9 @@ int main(int argc, char **argv) {
             no_of_nodes = atoi(argv[i+1]);
             cout << "no_of_nodes "<<no_of_nodes << endl;
             i++;
+        } else if (!strcmp(argv[i],"-rtx_scan")){
+            // retransmit timeouts only checked every scan period
+            RtxTimerScanner::_default_mode = RtxTimerScanner::SCAN;
         } else if (!strcmp(argv[i], "UNCOUPLED"))
             algo = UNCOUPLED;
         else if (!strcmp(argv[i], "COUPLED_INC"))
@@ -1,5 +1,6 @@
 // -*- c-basic-offset: 4; indent-tabs-mode: nil -*-
 //#include "config.h"
+#include <algorithm>
 #include <cassert>
 #include <cstdlib>
 #include <memory>
@@ -7,7 +8,9 @@
 #include <string.h>
 
 #include <math.h>
+#include <fcntl.h>
 #include <unistd.h>
+#include <sys/wait.h>
 #include "network.h"
 #include "pipe.h"
 #include "eventlist.h"
@@ -26,9 +29,13 @@
 
 
 #include "logsim-interface.h"
+#include "eventprofiler.h"
 #include "fat_tree_topology.h"
 #include "fat_tree_switch.h"
+#include "simcontext.h"
+#include "checkpoint.h"
 
+#include <fstream>
 #include <list>
 
 // Simulation params
@@ -42,11 +49,183 @@ uint32_t DEFAULT_TRIMMING_QUEUESIZE_FACTOR = 1;
 uint32_t DEFAULT_NONTRIMMING_QUEUESIZE_FACTOR = 5;
 // #define DEFAULT_CWND 50
 
-EventList eventlist;
+// Print the usage; gives the status to fail with
+int usage_error(char* progr) {
+    cout << "Usage " << progr << " [-nodes N]\n\t[-cwnd cwnd_size]\n\t[-q queue_size]\n\t[-queue_type composite|random|lossless|lossless_input|]\n\t[-tm traffic_matrix_file]\n\t[-strat route_strategy (single,rand,perm,pull,ecmp,\n\tecmp_host path_count,ecmp_ar,ecmp_rr,\n\tecmp_host_ar ar_thresh)]\n\t[-log log_level]\n\t[-seed random_seed]\n\t[-end end_time_in_usec]\n\t[-mtu MTU]\n\t[-hop_latency x] per hop wire latency in us,default 1\n\t[-target_q_delay x] target_queuing_delay in us, default is 6us \n\t[-switch_latency x] switching latency in us, default 0\n\t[-host_queue_type  swift|prio|fair_prio]\n\t[-logtime dt] sample time for sinklogger, etc\n\t[-conn_reuse] enable connection reuse\n\t[-event_queue tree|calendar] pending event structure, default tree\n\t[-eventlist_stats] print event list statistics at the end\n\t[-packet_stats] print the packets allocated of each type at the end\n\t[-packet_cap N] abort if more than N packets of one type are in use at once\n\t[-route_stats] print how many routes are shared through the route cache at the end\n\t[-event_profile file] time events per source class, print a table and write JSON to file\n\t[-event_profile_instances] also break the event profile down per source\n\t[-idmap file] where to write the id to name map, default idmap.txt\n\t[-lazy_topology] only build the switches and links the traffic uses, when it first uses them\n\t[-compiled_fib] give each switch its whole forwarding table at once, as arrays;\n\t\taggs share one set of up-routes, so results differ from the default FIB\n\t[-ar_port_state] keep each switch's port state in arrays updated as queues change, and pick adaptive routes from them;\n\t\tqueue sizes are current rather than sampled every 0.1us, so results differ from the default\n\t[-utilization_tracker intervals|buckets] how queues measure the utilization adaptive routing compares,\n\t\tevery send in the window or busy time per 1/32 of it; default intervals\n\t[-flowlet_table N] with -ar_granularity flow, give each switch a flowlet table of N entries (at least 8, rounded up\n\t\tto a power of two) whose flows expire after -ar_sticky_delta; collisions and evictions are printed at the end.\n\t\tWithout it the table remembers every flow, so its memory grows with the number of flows\n\t[-checkpoint file -checkpoint_at t] save the simulation at t us, then carry on\n\t[-restore file] resume a checkpoint saved with the same setup\n\t[-branch_at t -branch name \"flags\" ...] at t us, fork a process per branch to run the rest with\n\t\tflags from -load_balancing_algo, -use_conga, -target_q_delay, -qa_gate and\n\t\t-fail_link agg_switch uplink; each writes name.txt and name.dat\n"
+         << "   or " << progr << " -sweep file [-threads N]\n\truns each line of file as the arguments of one simulation, N at a time;\n\trun i writes runi.dat and runi_idmap.txt unless its line sets -o and -idmap" << endl;
+    return 1;
+}
+
+void print_eventlist_stats(EventList& eventlist) {
+    cout << "Eventlist cancels: " << eventlist.cancelCount()
+         << " searched multiple pending events: " << eventlist.ambiguousCancelCount() << endl;
+    const vector<uint64_t>& batches = eventlist.batchSizeHistogram();
+    cout << "Eventlist same-time batches:";
+    for (size_t i = 0; i < batches.size(); i++) {
+        cout << " " << (1ULL << i) << "-" << (2ULL << i) - 1 << ":" << batches[i];
+    }
+    cout << endl;
+}
+
+void report_event_profile(EventProfiler& profiler, const string& json_filename) {
+    profiler.report(cout);
+    ofstream json(json_filename.c_str());
+    if (!json) {
+        cerr << "Can't write event profile to " << json_filename << endl;
+        return;
+    }
+    profiler.write_json(json);
+    cout << "Event profile written to " << json_filename << endl;
+}
+
+enum LoadBalancing_Algo { BITMAP, REPS, REPS_LEGACY, OBLIVIOUS, MIXED, ECMP};
+
+bool parse_load_balancing_algo(const char* name, LoadBalancing_Algo& algo) {
+    if (!strcmp(name, "bitmap")) {
+        algo = BITMAP;
+    } else if (!strcmp(name, "reps")) {
+        algo = REPS;
+    } else if (!strcmp(name, "reps_legacy")) {
+        algo = REPS_LEGACY;
+    } else if (!strcmp(name, "oblivious")) {
+        algo = OBLIVIOUS;
+    } else if (!strcmp(name, "mixed")) {
+        algo = MIXED;
+    } else if (!strcmp(name, "ecmp")) {
+        algo = ECMP;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+unique_ptr<UecMultipath> make_multipath(LoadBalancing_Algo algo, uint32_t path_entropy_size,
+                                        bool disable_trim, bool use_conga) {
+    switch (algo) {
+    case BITMAP:
+        return make_unique<UecMpBitmap>(path_entropy_size, UecSrc::_debug);
+    case REPS:
+        {
+            auto reps_mp = make_unique<UecMpReps>(path_entropy_size, UecSrc::_debug, !disable_trim);
+            reps_mp->setUseMql(use_conga);
+            return reps_mp;
+        }
+    case REPS_LEGACY:
+        return make_unique<UecMpRepsLegacy>(path_entropy_size, UecSrc::_debug);
+    case OBLIVIOUS:
+        return make_unique<UecMpOblivious>(path_entropy_size, UecSrc::_debug);
+    case MIXED:
+        return make_unique<UecMpMixed>(path_entropy_size, UecSrc::_debug);
+    case ECMP:
+        return make_unique<UecMpEcmp>(path_entropy_size, UecSrc::_debug);
+    }
+    cout << "ERROR: Failed to set multipath algorithm, abort." << endl;
+    abort();
+}
+
+// What a branch forked by -branch changes for the rest of the run
+struct Branch {
+    string name;
+    string flags;
+    optional<LoadBalancing_Algo> load_balancing_algo;
+    bool use_conga = false;
+    bool nscc_changed = false;
+    simtime_picosec target_Qdelay = 0;
+    int8_t qa_gate = -1;
+    vector<pair<uint32_t, uint32_t>> failed_links; // agg switch, uplink
+};
+
+// Returns false, having said why, if flags can't be parsed
+bool parse_branch(const string& name, const string& flags, Branch& branch) {
+    branch.name = name;
+    branch.flags = flags;
+    istringstream words(flags);
+    vector<string> args;
+    string word;
+    while (words >> word) {
+        args.push_back(word);
+    }
+    for (size_t i = 0; i < args.size(); i++) {
+        bool has_value = i + 1 < args.size();
+        if (args[i] == "-load_balancing_algo" && has_value) {
+            LoadBalancing_Algo algo;
+            if (!parse_load_balancing_algo(args[i+1].c_str(), algo)) {
+                cout << "Unknown load balancing algorithm " << args[i+1] << " in branch " << name << endl;
+                return false;
+            }
+            branch.load_balancing_algo = algo;
+            i++;
+        } else if (args[i] == "-use_conga") {
+            branch.use_conga = true;
+        } else if (args[i] == "-target_q_delay" && has_value) {
+            branch.target_Qdelay = timeFromUs(atof(args[i+1].c_str()));
+            branch.nscc_changed = true;
+            i++;
+        } else if (args[i] == "-qa_gate" && has_value) {
+            branch.qa_gate = atoi(args[i+1].c_str());
+            branch.nscc_changed = true;
+            i++;
+        } else if (args[i] == "-fail_link" && i + 2 < args.size()) {
+            branch.failed_links.push_back(make_pair(atoi(args[i+1].c_str()), atoi(args[i+2].c_str())));
+            i += 2;
+        } else {
+            cout << "Unknown branch parameter " << args[i] << " in branch " << name
+                 << ", expecting -load_balancing_algo, -use_conga, -target_q_delay, -qa_gate or -fail_link" << endl;
+            return false;
+        }
+    }
+    if (branch.use_conga && branch.load_balancing_algo != REPS) {
+        cout << "-use_conga in branch " << name << " needs -load_balancing_algo reps" << endl;
+        return false;
+    }
+    return true;
+}
 
-void exit_error(char* progr) {
-    cout << "Usage " << progr << " [-nodes N]\n\t[-cwnd cwnd_size]\n\t[-q queue_size]\n\t[-queue_type composite|random|lossless|lossless_input|]\n\t[-tm traffic_matrix_file]\n\t[-strat route_strategy (single,rand,perm,pull,ecmp,\n\tecmp_host path_count,ecmp_ar,ecmp_rr,\n\tecmp_host_ar ar_thresh)]\n\t[-log log_level]\n\t[-seed random_seed]\n\t[-end end_time_in_usec]\n\t[-mtu MTU]\n\t[-hop_latency x] per hop wire latency in us,default 1\n\t[-target_q_delay x] target_queuing_delay in us, default is 6us \n\t[-switch_latency x] switching latency in us, default 0\n\t[-host_queue_type  swift|prio|fair_prio]\n\t[-logtime dt] sample time for sinklogger, etc\n\t[-conn_reuse] enable connection reuse" << endl;
-    exit(1);
+// Fork a child process for each branch.  Returns the branch's index in
+// its child, which carries on with the simulation; the parent waits for
+// all of them and returns -1, with the number that failed in failed.
+int fork_branches(const vector<Branch>& branches, int& failed) {
+    // buffered output would otherwise be written again by each child
+    cout.flush();
+    fflush(NULL);
+    vector<pid_t> children;
+    for (size_t b = 0; b < branches.size(); b++) {
+        pid_t pid = fork();
+        if (pid < 0) {
+            perror("fork");
+            exit(1);
+        }
+        if (pid == 0) {
+            string out = branches[b].name + ".txt";
+            int fd = open(out.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+            if (fd < 0) {
+                perror(out.c_str());
+                exit(1);
+            }
+            dup2(fd, STDOUT_FILENO);
+            close(fd);
+            return b;
+        }
+        children.push_back(pid);
+    }
+    failed = 0;
+    for (size_t b = 0; b < branches.size(); b++) {
+        int status;
+        if (waitpid(children[b], &status, 0) < 0) {
+            perror("waitpid");
+            exit(1);
+        }
+        cout << "Branch " << branches[b].name;
+        if (WIFEXITED(status)) {
+            cout << " exited with status " << WEXITSTATUS(status) << endl;
+            if (WEXITSTATUS(status) != 0)
+                failed++;
+        } else {
+            cout << " killed by signal " << WTERMSIG(status) << endl;
+            failed++;
+        }
+    }
+    return -1;
 }
 
 simtime_picosec calculate_rtt(FatTreeTopologyCfg* t_cfg, linkspeed_bps host_linkspeed) { 
@@ -67,7 +246,10 @@ uint32_t calculate_bdp_pkt(FatTreeTopologyCfg* t_cfg, linkspeed_bps host_linkspe
     return bdp_pkt;
 }
 
-int main(int argc, char **argv) {
+// One complete simulation.  All of its global state is per thread, so
+// several of these can run at once in their own SimContexts.
+int run_uec(int argc, char **argv) {
+    EventList eventlist;
     Clock c(timeFromSec(5 / 100.), eventlist);
     bool param_queuesize_set = false;
     uint32_t queuesize_pkt = 0;
@@ -86,7 +268,6 @@ int main(int argc, char **argv) {
     simtime_picosec switch_latency = timeFromUs((uint32_t)0);
     queue_type qt = COMPOSITE;
 
-    enum LoadBalancing_Algo { BITMAP, REPS, REPS_LEGACY, OBLIVIOUS, MIXED, ECMP};
     LoadBalancing_Algo load_balancing_algo = MIXED;
     
     // SMaRTT-REPS-CONGA: Enable MQL-based path selection
@@ -121,6 +302,7 @@ int main(int argc, char **argv) {
     double pcie_rate = 1.1;
 
     filename << "logout.dat";
+    string idmap_filename = "idmap.txt";
     string goal_filename = "";
     int end_time = 1000;//in microseconds
     bool force_disable_oversubscribed_cc = false;
@@ -136,12 +318,68 @@ int main(int argc, char **argv) {
     char* topo_file = NULL;
     int8_t qa_gate = -1;
     bool conn_reuse = false;
+    bool eventlist_stats = false;
+    bool packet_stats = false;
+    bool route_stats = false;
+    bool lazy_topology = false;
+    string event_profile_filename;
+    bool event_profile_instances = false;
+    string checkpoint_filename, restore_filename;
+    simtime_picosec checkpoint_at = 0;
+    vector<Branch> branches;
+    simtime_picosec branch_at = 0;
 
     while (i<argc) {
         if (!strcmp(argv[i],"-o")) {
             filename.str(std::string());
             filename << argv[i+1];
             i++;
+        } else if (!strcmp(argv[i],"-idmap")) {
+            idmap_filename = argv[i+1];
+            i++;
+        } else if (!strcmp(argv[i],"-event_queue")) {
+            if (!strcmp(argv[i+1], "tree")) {
+                eventlist.setQueueType(EventQueue::TREE);
+            } else if (!strcmp(argv[i+1], "calendar")) {
+                eventlist.setQueueType(EventQueue::CALENDAR);
+            } else {
+                cout << "Expecting -event_queue tree|calendar, found " << argv[i+1] << endl;
+                return 1;
+            }
+            cout << "Event queue " << EventQueue::type_name(eventlist.queueType()) << endl;
+            i++;
+        } else if (!strcmp(argv[i],"-eventlist_stats")) {
+            eventlist_stats = true;
+        } else if (!strcmp(argv[i],"-packet_stats")) {
+            packet_stats = true;
+        } else if (!strcmp(argv[i],"-route_stats")) {
+            route_stats = true;
+        } else if (!strcmp(argv[i],"-packet_cap")) {
+            PacketDBBase::set_cap(atoll(argv[i+1]));
+            i++;
+        } else if (!strcmp(argv[i],"-event_profile")) {
+            event_profile_filename = argv[i+1];
+            i++;
+        } else if (!strcmp(argv[i],"-event_profile_instances")) {
+            event_profile_instances = true;
+        } else if (!strcmp(argv[i],"-checkpoint")) {
+            checkpoint_filename = argv[i+1];
+            i++;
+        } else if (!strcmp(argv[i],"-checkpoint_at")) {
+            checkpoint_at = timeFromUs(atof(argv[i+1]));
+            i++;
+        } else if (!strcmp(argv[i],"-restore")) {
+            restore_filename = argv[i+1];
+            i++;
+        } else if (!strcmp(argv[i],"-branch_at")) {
+            branch_at = timeFromUs(atof(argv[i+1]));
+            i++;
+        } else if (!strcmp(argv[i],"-branch")) {
+            Branch branch;
+            if (!parse_branch(argv[i+1], argv[i+2], branch))
+                return 1;
+            branches.push_back(branch);
+            i += 2;
         } else if (!strcmp(argv[i],"-conn_reuse")){
             conn_reuse = true;
             cout << "Enabling connection reuse" << endl;
@@ -209,7 +447,7 @@ int main(int argc, char **argv) {
                 UecSrc::_sender_cc_algo = UecSrc::CONSTANT;
             else {
                 cout << "UNKNOWN CC ALGO " << argv[i+1] << endl;
-                exit(1);
+                return 1;
             }    
             cout << "sender based algo "<< argv[i+1] << endl;
             i++;
@@ -224,30 +462,9 @@ int main(int argc, char **argv) {
             cout << "receiver based CC enabled " << endl;
         }
         else if (!strcmp(argv[i],"-load_balancing_algo")){
-            if (!strcmp(argv[i+1], "bitmap")) {
-                load_balancing_algo = BITMAP;
-            } 
-            else if (!strcmp(argv[i+1], "reps")) {
-                load_balancing_algo = REPS;
-            }
-            else if (!strcmp(argv[i+1], "reps_legacy")) {
-                load_balancing_algo = REPS_LEGACY;
-            }
-            else if (!strcmp(argv[i+1], "oblivious")) {
-                load_balancing_algo = OBLIVIOUS;
-            }
-            else if (!strcmp(argv[i+1], "mixed")) {
-                load_balancing_algo = MIXED;
-            }
-            else if (!strcmp(argv[i+1], "mixed")) {
-                load_balancing_algo = MIXED;
-            }
-            else if (!strcmp(argv[i+1], "ecmp")) {
-                load_balancing_algo = ECMP;
-            }
-            else {
-                cout << "Unknown load balancing algorithm of type " << argv[i+1] << ", expecting bitmap, reps or reps2" << endl;
-                exit_error(argv[0]);
+            if (!parse_load_balancing_algo(argv[i+1], load_balancing_algo)) {
+                cout << "Unknown load balancing algorithm of type " << argv[i+1] << ", expecting bitmap, reps, reps_legacy, oblivious, mixed or ecmp" << endl;
+                return usage_error(argv[0]);
             }
             cout << "Load balancing algorithm set to  "<< argv[i+1] << endl;
             i++;
@@ -271,7 +488,7 @@ int main(int argc, char **argv) {
             }
             else {
                 cout << "Unknown queue type " << argv[i+1] << endl;
-                exit_error(argv[0]);
+                return usage_error(argv[0]);
             }
             cout << "queue_type "<< qt << endl;
             i++;
@@ -290,7 +507,7 @@ int main(int argc, char **argv) {
             }
             else {
                 cout << "Unknown host queue type " << argv[i+1] << " expecting one of swift|prio|fair_prio" << endl;
-                exit_error(argv[0]);
+                return usage_error(argv[0]);
             }
             cout << "host queue_type "<< snd_type << endl;
             i++;
@@ -319,7 +536,7 @@ int main(int argc, char **argv) {
                 cout << "logging queue usage\n";
                 log_queue_usage = true;
             } else {
-                exit_error(argv[0]);
+                return usage_error(argv[0]);
             }
             i++;
         } else if (!strcmp(argv[i],"-cwnd")) {
@@ -334,6 +551,22 @@ int main(int argc, char **argv) {
             topo_file = argv[i+1];
             cout << "FatTree topology input file: "<< topo_file << endl;
             i++;
+        } else if (!strcmp(argv[i],"-lazy_topology")){
+            lazy_topology = true;
+        } else if (!strcmp(argv[i],"-compiled_fib")){
+            FatTreeSwitch::_compiled_fib = true;
+        } else if (!strcmp(argv[i],"-ar_port_state")){
+            FatTreeSwitch::_ar_port_state = true;
+        } else if (!strcmp(argv[i],"-utilization_tracker")){
+            if (!strcmp(argv[i+1],"intervals"))
+                BaseQueue::_utilization_tracker = BaseQueue::BUSY_INTERVALS;
+            else if (!strcmp(argv[i+1],"buckets"))
+                BaseQueue::_utilization_tracker = BaseQueue::BUSY_BUCKETS;
+            else {
+                cout << "Unknown utilization tracker " << argv[i+1] << ", expecting intervals or buckets" << endl;
+                return usage_error(argv[0]);
+            }
+            i++;
         } else if (!strcmp(argv[i],"-q")){
             param_queuesize_set = true;
             queuesize_pkt = atoi(argv[i+1]);
@@ -444,6 +677,10 @@ int main(int argc, char **argv) {
             ar_sticky_delta = atof(argv[i+1]);
             cout << "Adaptive routing sticky delta " << ar_sticky_delta << "us" << endl;
             i++;
+        } else if (!strcmp(argv[i],"-flowlet_table")){
+            FatTreeSwitch::_flowlet_table_size = FlowletTable::capacity_for(atoi(argv[i+1]));
+            cout << "Flowlet table size " << FatTreeSwitch::_flowlet_table_size << endl;
+            i++;
         } else if (!strcmp(argv[i],"-ar_granularity")){
             if (!strcmp(argv[i+1],"packet"))
                 ar_sticky = FatTreeSwitch::PER_PACKET;
@@ -451,7 +688,7 @@ int main(int argc, char **argv) {
                 ar_sticky = FatTreeSwitch::PER_FLOWLET;
             else  {
                 cout << "Expecting -ar_granularity packet|flow, found " << argv[i+1] << endl;
-                exit(1);
+                return 1;
             }   
             i++;
         } else if (!strcmp(argv[i],"-ar_method")){
@@ -485,7 +722,7 @@ int main(int argc, char **argv) {
             }
             else {
                 cout << "Unknown AR method expecting one of pause, queue, bandwidth, pqb, pq, pb, qb" << endl;
-                exit(1);
+                return 1;
             }
             i++;
         } else if (!strcmp(argv[i],"-strat")){
@@ -529,7 +766,7 @@ int main(int argc, char **argv) {
             i++;
         } else {
             cout << "Unknown parameter " << argv[i] << endl;
-            exit_error(argv[0]);
+            return usage_error(argv[0]);
         }
         i++;
     }
@@ -573,24 +810,35 @@ int main(int argc, char **argv) {
     case ECMP_FIB_ECN:
     case REACTIVE_ECN:
         if (qt != COMPOSITE_ECN_LB) {
-            fprintf(stderr, "Route Strategy is ECMP ECN.  Must use an ECN queue\n");
-            exit(1);
+            cerr << "Route Strategy is ECMP ECN.  Must use an ECN queue" << endl;
+            return 1;
         }
         assert(ecn_thresh > 0 && ecn_thresh < 1);
         // no break, fall through
     case ECMP_FIB:
         if (path_entropy_size > 10000) {
-            fprintf(stderr, "Route Strategy is ECMP.  Must specify path count using -paths\n");
-            exit(1);
+            cerr << "Route Strategy is ECMP.  Must specify path count using -paths" << endl;
+            return 1;
         }
         break;
     case NOT_SET:
-        fprintf(stderr, "Route Strategy not set.  Use the -strat param.  \nValid values are perm, rand, pull, rg and single\n");
-        exit(1);
+        cerr << "Route Strategy not set.  Use the -strat param.  \nValid values are perm, rand, pull, rg and single" << endl;
+        return 1;
     default:
         break;
     }
 
+    if (lazy_topology && (!checkpoint_filename.empty() || !restore_filename.empty())) {
+        // objects are numbered for the checkpoint as they are created
+        cerr << "-lazy_topology can't be used with -checkpoint or -restore" << endl;
+        return 1;
+    }
+    if (!goal_filename.empty() && (!branches.empty() || branch_at)) {
+        // an ATLAHS trace runs to completion before the branch point
+        cerr << "-branch and -branch_at can't be used with -goal" << endl;
+        return 1;
+    }
+
     // prepare the loggers
 
     cout << "Logging to " << filename.str() << endl;
@@ -645,7 +893,7 @@ int main(int argc, char **argv) {
 
         if (!conns->load(tm_file)){
             cout << "Failed to load connection matrix " << tm_file << endl;
-            exit(-1);
+            return -1;
         }
     }
     else if (goal_filename.size() == 0){
@@ -655,7 +903,7 @@ int main(int argc, char **argv) {
 
     if (conns->N != no_of_nodes && no_of_nodes != 0){
         cout << "Connection matrix number of nodes is " << conns->N << " while I am using " << no_of_nodes << endl;
-        exit(-1);
+        return -1;
     }
 
     no_of_nodes = conns->N;
@@ -682,7 +930,7 @@ int main(int argc, char **argv) {
         if (topo_cfg->no_of_nodes() != no_of_nodes) {
             cerr << "Mismatch between connection matrix (" << no_of_nodes << " nodes) and topology ("
                     << topo_cfg->no_of_nodes() << " nodes)" << endl;
-            exit(1);
+            return 1;
         }
     } else {
         topo_cfg = make_unique<FatTreeTopologyCfg>(tiers, no_of_nodes, linkspeed, memFromPkt(queuesize_pkt),
@@ -736,7 +984,7 @@ int main(int argc, char **argv) {
     vector<unique_ptr<FatTreeTopology>> topo;
     topo.resize(planes);
     for (uint32_t p = 0; p < planes; p++) {
-        topo[p] = make_unique<FatTreeTopology>(topo_cfg.get(), qlf, &eventlist, nullptr);
+        topo[p] = make_unique<FatTreeTopology>(topo_cfg.get(), qlf, &eventlist, nullptr, lazy_topology);
 
         if (log_switches) {
             topo[p]->add_switch_loggers(logfile, logtime);
@@ -744,6 +992,12 @@ int main(int argc, char **argv) {
     }
     cout << "network_max_unloaded_rtt " << timeAsUs(network_max_unloaded_rtt) << endl;
 
+    unique_ptr<EventProfiler> profiler;
+    if (!event_profile_filename.empty()) {
+        profiler = make_unique<EventProfiler>(event_profile_instances);
+        eventlist.setProfiler(profiler.get());
+    }
+
     if (UecSink::_oversubscribed_cc)
         OversubscribedCC::_base_rtt = network_max_unloaded_rtt;
 
@@ -820,62 +1074,35 @@ int main(int argc, char **argv) {
         api->print_stats_flows = LogSimInterface::print_stats_flows;
 
         // Build a factory for creating per-flow multipath instances
-        switch (load_balancing_algo) {
-            case BITMAP:
-                api->setMultipathFactory([path_entropy_size]() {
-                    return std::make_unique<UecMpBitmap>(path_entropy_size, UecSrc::_debug);
-                });
-                break;
-            case REPS:
-                api->setMultipathFactory([path_entropy_size, disable_trim, use_conga]() {
-                    auto mp = std::make_unique<UecMpReps>(path_entropy_size, UecSrc::_debug, !disable_trim);
-                    mp->setUseMql(use_conga);
-                    return mp;
-                });
-                break;
-            case REPS_LEGACY:
-                api->setMultipathFactory([path_entropy_size]() {
-                    return std::make_unique<UecMpRepsLegacy>(path_entropy_size, UecSrc::_debug);
-                });
-                break;
-            case OBLIVIOUS:
-                api->setMultipathFactory([path_entropy_size]() {
-                    return std::make_unique<UecMpOblivious>(path_entropy_size, UecSrc::_debug);
-                });
-                break;
-            case ECMP:
-                api->setMultipathFactory([path_entropy_size]() {
-                    return std::make_unique<UecMpEcmp>(path_entropy_size, UecSrc::_debug);
-                });
-                break;
-            case MIXED:
-                api->setMultipathFactory([path_entropy_size, disable_trim]() {
-                    return std::make_unique<UecMpMixed>(path_entropy_size, UecSrc::_debug);
-                });
-                break;
-            default:
-                cout << "ERROR: Failed to set multipath algorithm, abort." << endl;
-                abort();
-        }
+        api->setMultipathFactory([load_balancing_algo, path_entropy_size, disable_trim, use_conga]() {
+            return make_multipath(load_balancing_algo, path_entropy_size, disable_trim, use_conga);
+        });
 
         // Calculate G in cycles
         double linkSpeedBytesPerSec = (linkspeed/1000000000 * 1e9) / 8.0;
         lgs->htsim_api->htsim_G  = 1e9 / linkSpeedBytesPerSec;
 
-        printf("<HTSIM> G %f\n", lgs->htsim_api->htsim_G);
+        cout << "<HTSIM> G " << to_string(lgs->htsim_api->htsim_G) << endl;
 
         lgs->htsim_api->total_nodes = no_of_nodes;
         lgs->htsim_api->Setup();
-        printf("Started LGS\n");
+        cout << "Started LGS" << endl;
         
         start_lgs(goal_filename, *lgs);
-        printf("Iteration Terminated\n");
+        cout << "Iteration Terminated" << endl;
+        cout << "Connections: " << api->connectionsCreated() << " created, "
+             << api->connectionsReused() << " reused" << endl;
     }
     
 
     if (goal_filename.size() > 0) {
-        printf("Finished all\n");
-        fflush(stdout);
+        cout << "Finished all" << endl;
+        if (eventlist_stats) {
+            print_eventlist_stats(eventlist);
+        }
+        if (profiler) {
+            report_event_profile(*profiler, event_profile_filename);
+        }
         return 0;
     }
 
@@ -887,7 +1114,7 @@ int main(int argc, char **argv) {
 
         if (!conn_reuse and crt->msgid.has_value()) {
             cout << "msg keyword can only be used when conn_reuse is enabled.\n";
-            abort();
+            return 1;
         }
 
         assert(planes > 0);
@@ -899,25 +1126,8 @@ int main(int argc, char **argv) {
 
         if (!conn_reuse 
             || (crt->flowid and flowmap.find(crt->flowid) == flowmap.end())) {
-            unique_ptr<UecMultipath> mp = nullptr;
-            if (load_balancing_algo == BITMAP){
-                mp = make_unique<UecMpBitmap>(path_entropy_size, UecSrc::_debug);
-            } else if (load_balancing_algo == REPS){
-                auto reps_mp = make_unique<UecMpReps>(path_entropy_size, UecSrc::_debug, !disable_trim);
-                reps_mp->setUseMql(use_conga);
-                mp = std::move(reps_mp);
-            } else if (load_balancing_algo == REPS_LEGACY){
-                mp = make_unique<UecMpRepsLegacy>(path_entropy_size, UecSrc::_debug);
-            }else if (load_balancing_algo == OBLIVIOUS){
-                mp = make_unique<UecMpOblivious>(path_entropy_size, UecSrc::_debug);
-            } else if (load_balancing_algo == MIXED){
-                mp = make_unique<UecMpMixed>(path_entropy_size, UecSrc::_debug);
-            } else if (load_balancing_algo == ECMP){
-                mp = make_unique<UecMpEcmp>(path_entropy_size, UecSrc::_debug);
-            } else {
-                cout << "ERROR: Failed to set multipath algorithm, abort." << endl;
-                abort();
-            }
+            unique_ptr<UecMultipath> mp = make_multipath(load_balancing_algo, path_entropy_size,
+                                                         disable_trim, use_conga);
 
             uec_src = new UecSrc(traffic_logger, eventlist, move(mp), *nics.at(src), ports);
 
@@ -1043,15 +1253,15 @@ int main(int argc, char **argv) {
                 case ECMP_FIB_ECN:
                 case REACTIVE_ECN:
                     {
-                        Route* srctotor = new Route();
-                        srctotor->push_back(topo[p]->queues_ns_nlp[src][topo_cfg->HOST_POD_SWITCH(src)][0]);
-                        srctotor->push_back(topo[p]->pipes_ns_nlp[src][topo_cfg->HOST_POD_SWITCH(src)][0]);
-                        srctotor->push_back(topo[p]->queues_ns_nlp[src][topo_cfg->HOST_POD_SWITCH(src)][0]->getRemoteEndpoint());
+                        topo[p]->build_tor(topo_cfg->HOST_POD_SWITCH(src));
+                        topo[p]->build_tor(topo_cfg->HOST_POD_SWITCH(dest));
+                        const Route* srctotor = RouteCache::intern({topo[p]->queues_ns_nlp[src][topo_cfg->HOST_POD_SWITCH(src)][0],
+                                                                    topo[p]->pipes_ns_nlp[src][topo_cfg->HOST_POD_SWITCH(src)][0],
+                                                                    topo[p]->queues_ns_nlp[src][topo_cfg->HOST_POD_SWITCH(src)][0]->getRemoteEndpoint()});
 
-                        Route* dsttotor = new Route();
-                        dsttotor->push_back(topo[p]->queues_ns_nlp[dest][topo_cfg->HOST_POD_SWITCH(dest)][0]);
-                        dsttotor->push_back(topo[p]->pipes_ns_nlp[dest][topo_cfg->HOST_POD_SWITCH(dest)][0]);
-                        dsttotor->push_back(topo[p]->queues_ns_nlp[dest][topo_cfg->HOST_POD_SWITCH(dest)][0]->getRemoteEndpoint());
+                        const Route* dsttotor = RouteCache::intern({topo[p]->queues_ns_nlp[dest][topo_cfg->HOST_POD_SWITCH(dest)][0],
+                                                                    topo[p]->pipes_ns_nlp[dest][topo_cfg->HOST_POD_SWITCH(dest)][0],
+                                                                    topo[p]->queues_ns_nlp[dest][topo_cfg->HOST_POD_SWITCH(dest)][0]->getRemoteEndpoint()});
 
                         uec_src->connectPort(p, *srctotor, *dsttotor, *uec_snk, crt->start);
                         //uec_src->setPaths(path_entropy_size);
@@ -1107,7 +1317,7 @@ int main(int argc, char **argv) {
         }
     }
 
-    Logged::dump_idmap();
+    Logged::dump_idmap(idmap_filename);
     // Record the setup
     int pktsize = Packet::data_packet_size();
     logfile.write("# pktsize=" + ntoa(pktsize) + " bytes");
@@ -1115,12 +1325,90 @@ int main(int argc, char **argv) {
     //logfile.write("# corelinkrate = " + ntoa(HOST_NIC*CORE_TO_HOST) + " pkt/sec");
     //logfile.write("# buffer = " + ntoa((double) (queues_na_ni[0][1]->_maxsize) / ((double) pktsize)) + " pkt");
     
+    if (!restore_filename.empty()) {
+        // the setup above must match the run that saved it; the flags
+        // only used once the simulation is running may differ
+        Checkpoint::restore(restore_filename, eventlist);
+        cout << "Restored " << restore_filename << " at " << timeAsUs(eventlist.now()) << "us" << endl;
+    }
+
     // GO!
     cout << "Starting simulation" << endl;
+    if (!checkpoint_filename.empty()) {
+        while ((eventlist.hasPendingTriggers() || eventlist.nextEventTime() < checkpoint_at)
+               && eventlist.doNextEvent()) {
+        }
+        Checkpoint::save(checkpoint_filename, eventlist);
+        cout << "Checkpoint " << checkpoint_filename << " saved at " << timeAsUs(eventlist.now()) << "us" << endl;
+    }
+    if (!branches.empty()) {
+        for (const Branch& branch : branches) {
+            if (branch.nscc_changed && !sender_driven) {
+                cout << "Branch " << branch.name << " changes NSCC parameters, but NSCC is not in use" << endl;
+                return 1;
+            }
+        }
+        // everything so far is shared by the branches, copy-on-write
+        while (eventlist.nextEventTime() < branch_at && eventlist.doNextEvent()) {
+        }
+        cout << "Branching " << branches.size() << " ways at " << timeAsUs(eventlist.now()) << "us" << endl;
+        int failed;
+        int b = fork_branches(branches, failed);
+        if (b < 0)
+            return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+
+        const Branch& branch = branches[b];
+        cout << "Branch " << branch.name << " (" << branch.flags << ") at " << timeAsUs(eventlist.now()) << "us" << endl;
+        logfile.branch(branch.name + ".dat");
+        if (branch.load_balancing_algo) {
+            for (UecSrc* src : uec_srcs) {
+                src->setMultipath(make_multipath(*branch.load_balancing_algo, path_entropy_size,
+                                                 disable_trim, branch.use_conga));
+            }
+        }
+        if (branch.nscc_changed) {
+            UecSrc::initNsccParams(network_max_unloaded_rtt, linkspeed,
+                                   branch.target_Qdelay ? branch.target_Qdelay : target_Qdelay,
+                                   branch.qa_gate >= 0 ? branch.qa_gate : qa_gate, !disable_trim);
+        }
+        for (auto& link : branch.failed_links) {
+            topo[0]->degrade_link(link.first, link.second);
+        }
+    }
     while (eventlist.doNextEvent()) {
     }
 
     cout << "Done" << endl;
+    if (eventlist_stats) {
+        print_eventlist_stats(eventlist);
+    }
+    if (profiler) {
+        report_event_profile(*profiler, event_profile_filename);
+    }
+    if (packet_stats) {
+        PacketDBBase::report(cout);
+    }
+    if (route_stats) {
+        RouteCache::report(cout);
+    }
+    if (FatTreeSwitch::_flowlet_table_size) {
+        uint64_t flowlets = 0, collisions = 0, reclaimed = 0, evictions = 0;
+        for (uint32_t p = 0; p < planes; p++) {
+            for (vector<Switch*>* tier : {&topo[p]->switches_lp, &topo[p]->switches_up, &topo[p]->switches_c}) {
+                for (Switch* sw : *tier) {
+                    if (!sw)
+                        continue;
+                    const FlowletTable& t = static_cast<FatTreeSwitch*>(sw)->flowlets();
+                    flowlets += t.size();
+                    collisions += t.collisions();
+                    reclaimed += t.reclaimed();
+                    evictions += t.evictions();
+                }
+            }
+        }
+        cout << "Flowlet tables: " << flowlets << " entries, " << collisions << " collisions, "
+             << reclaimed << " expired entries reused, " << evictions << " live entries evicted" << endl;
+    }
     int new_pkts = 0, rtx_pkts = 0, bounce_pkts = 0, rts_pkts = 0, ack_pkts = 0, nack_pkts = 0, pull_pkts = 0, sleek_pkts = 0;
     for (size_t ix = 0; ix < uec_srcs.size(); ix++) {
         const struct UecSrc::Stats& s = uec_srcs[ix]->stats();
@@ -1184,3 +1472,70 @@ int main(int argc, char **argv) {
     return EXIT_SUCCESS;
 }
 
+int main(int argc, char **argv) {
+    if (argc < 3 || strcmp(argv[1], "-sweep"))
+        return run_uec(argc, argv);
+
+    unsigned threads = thread::hardware_concurrency();
+    if (argc == 5 && !strcmp(argv[3], "-threads")) {
+        threads = atoi(argv[4]);
+    } else if (argc != 3) {
+        return usage_error(argv[0]);
+    }
+    if (threads == 0)
+        threads = 1;
+
+    ifstream sweep(argv[2]);
+    if (!sweep) {
+        cout << "Cannot open sweep file " << argv[2] << endl;
+        return 1;
+    }
+    // each non-empty line not starting with # holds the arguments of one run
+    vector<vector<string>> runs;
+    string line;
+    while (getline(sweep, line)) {
+        istringstream words(line);
+        vector<string> args;
+        args.push_back(argv[0]);
+        string word;
+        while (words >> word) {
+            if (word == "-branch" || word == "-branch_at") {
+                cout << "-branch can't be used in a sweep" << endl;
+                return 1;
+            }
+            args.push_back(word);
+        }
+        if (args.size() > 1 && args[1][0] != '#')
+            runs.push_back(args);
+    }
+
+    vector<SimContext*> contexts;
+    for (size_t r = 0; r < runs.size(); r++) {
+        vector<string>* args = &runs[r];
+        string name = "run" + ntoa(r);
+        // runs running at once can't share the default output files
+        if (find(args->begin(), args->end(), "-o") == args->end()) {
+            args->push_back("-o");
+            args->push_back(name + ".dat");
+        }
+        if (find(args->begin(), args->end(), "-idmap") == args->end()) {
+            args->push_back("-idmap");
+            args->push_back(name + "_idmap.txt");
+        }
+        contexts.push_back(new SimContext(name, [args]() {
+            vector<char*> run_argv;
+            for (string& a : *args) {
+                run_argv.push_back(&a[0]);
+            }
+            run_argv.push_back(NULL);
+            return run_uec(args->size(), run_argv.data());
+        }));
+    }
+    cout << "Running " << contexts.size() << " simulations, " << threads << " at a time" << endl;
+    int failed = SimContext::run_all(contexts, threads, cout);
+    for (SimContext* ctx : contexts) {
+        delete ctx;
+    }
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
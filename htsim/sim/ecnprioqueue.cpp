@@ -57,6 +57,7 @@ ECNPrioQueue::completeService(){
 
     pkt = _enqueued[_serv].pop();
     _queuesize[_serv] -= pkt->size();
+    update_port_queuesize();
     _num_packets++;
     
     pkt->flow().logTraffic(*pkt,*this,TrafficLogger::PKT_DEPART);
@@ -124,6 +125,7 @@ ECNPrioQueue::receivePacket(Packet& pkt)
         Packet* pkt_p = &pkt; // force a non-temporary reference in push
         _enqueued[prio].push(pkt_p);
         _queuesize[prio] += pkt.size();
+        update_port_queuesize();
     }
     
     if (_serv==Q_NONE) {
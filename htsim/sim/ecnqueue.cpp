@@ -67,6 +67,7 @@ ECNQueue::receivePacket(Packet & pkt)
     Packet* pkt_p = &pkt;
     _enqueued.push(pkt_p);
     _queuesize += pkt.size();
+    update_port_queuesize();
     if (_logger) _logger->logQueue(*this, QueueLogger::PKT_ENQUEUE, pkt);
 
     if (queueWasEmpty && _state_send==LosslessQueue::READY) {
@@ -92,6 +93,7 @@ ECNQueue::completeService()
         pkt->set_flags(pkt->flags() | ECN_CE);
 
     _queuesize -= pkt->size();
+    update_port_queuesize();
     pkt->flow().logTraffic(*pkt, *this, TrafficLogger::PKT_DEPART);
     if (_logger) _logger->logQueue(*this, QueueLogger::PKT_SERVICE, *pkt);
 
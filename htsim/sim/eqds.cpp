@@ -362,6 +362,9 @@ EqdsSrc::EqdsSrc(TrafficLogger* trafficLogger, EventList& eventList, EqdsNIC& ni
     _credit_spec = _maxwnd;
     _in_flight = 0;
     _highest_sent = 0;
+    _live_send_times = 0;
+    _rtx_queue_size = 0;
+    _rtx_queue_head = 0;
     _send_blocked_on_nic = false;
     _no_of_paths = _path_entropy_size;
     _path_random = rand() % 0xffff;  // random upper bits of EV
@@ -538,23 +541,94 @@ void EqdsSrc::receivePacket(Packet& pkt, uint32_t portnum) {
     }
 }
 
+EqdsSrc::sendRecord* EqdsSrc::findInFlight(EqdsDataPacket::seq_t seqno) {
+    sendRecord* rec = _send_records.find(seqno);
+    return rec && rec->in_flight ? rec : NULL;
+}
+
+void EqdsSrc::addSendTime(simtime_picosec send_time, EqdsDataPacket::seq_t seqno) {
+    // like emplace() on a map: an entry for this time already in place wins
+    if (!_send_times.empty()) {
+        sendTimeEntry& last = _send_times.at(_send_times.size() - 1);
+        assert(last.send_time <= send_time);
+        if (last.live && last.send_time == send_time)
+            return;
+    }
+    if (_send_times.size() > 2 * (int)_live_send_times + 64) {
+        // mostly dead entries; drop them
+        int n = _send_times.size();
+        for (int i = 0; i < n; i++) {
+            sendTimeEntry entry = _send_times.pop();
+            if (entry.live)
+                _send_times.push(entry);
+        }
+    }
+    sendTimeEntry entry = {send_time, seqno, true};
+    _send_times.push(entry);
+    _live_send_times++;
+}
+
+void EqdsSrc::eraseSendTime(simtime_picosec send_time) {
+    // entries are in time order: find the last at this time, then the
+    // live one among those at this time, if there is one
+    int lo = 0, hi = _send_times.size();
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (_send_times.at(mid).send_time <= send_time)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    for (int i = lo - 1; i >= 0 && _send_times.at(i).send_time == send_time; i--) {
+        if (_send_times.at(i).live) {
+            _send_times.at(i).live = false;
+            _live_send_times--;
+            return;
+        }
+    }
+}
+
+EqdsSrc::sendTimeEntry* EqdsSrc::earliestSendTime() {
+    while (!_send_times.empty()) {
+        sendTimeEntry& entry = _send_times.next_to_pop();
+        if (entry.live)
+            return &entry;
+        _send_times.pop();
+    }
+    return NULL;
+}
+
+EqdsDataPacket::seq_t EqdsSrc::rtxQueueFront() {
+    assert(_rtx_queue_size > 0);
+    while (!_send_records.find(_rtx_queue_head)->queued) {
+        _rtx_queue_head++;
+    }
+    return _rtx_queue_head;
+}
+
+void EqdsSrc::dequeueRtx(sendRecord& rec) {
+    assert(rec.queued);
+    rec.queued = false;
+    _rtx_queue_size--;
+}
+
 mem_b EqdsSrc::handleAckno(EqdsDataPacket::seq_t ackno) {
-    auto i = _tx_bitmap.find(ackno);
-    if (i == _tx_bitmap.end())
+    sendRecord* rec = findInFlight(ackno);
+    if (!rec)
         return 0;
-    // mem_b pkt_size = i->second.pkt_size;
-    simtime_picosec send_time = i->second.send_time;
+    // mem_b pkt_size = rec->pkt_size;
+    simtime_picosec send_time = rec->send_time;
 
     // computeRTO(send_time);
     computeRTT(send_time);
 
-    mem_b pkt_size = i->second.pkt_size;
+    mem_b pkt_size = rec->pkt_size;
     _in_flight -= pkt_size;
     assert(_in_flight >= 0);
     if (_debug_src)
         cout << _flow.str() << " " << _nodename << " handleAck " << ackno << " flow " << _flow.str() << endl;
-    _tx_bitmap.erase(i);
-    _send_times.erase(send_time);
+    rec->in_flight = false;
+    eraseSendTime(send_time);
 
     if (send_time == _rto_send_time) {
         recalculateRTO();
@@ -565,29 +639,24 @@ mem_b EqdsSrc::handleAckno(EqdsDataPacket::seq_t ackno) {
 
 mem_b EqdsSrc::handleCumulativeAck(EqdsDataPacket::seq_t cum_ack) {
     mem_b newly_acked = 0;
+    EqdsDataPacket::seq_t acked_end = min(cum_ack, _send_records.end());
 
     // free up anything cumulatively acked
-    while (!_rtx_queue.empty()) {
-        auto seqno = _rtx_queue.begin()->first;
-
-        if (seqno < cum_ack) {
-            _rtx_queue.erase(_rtx_queue.begin());
-        } else
-            break;
+    for (auto seqno = _rtx_queue_head; _rtx_queue_size > 0 && seqno < acked_end; seqno++) {
+        sendRecord& rec = *_send_records.find(seqno);
+        if (rec.queued)
+            dequeueRtx(rec);
     }
 
-    auto i = _tx_bitmap.begin();
-    while (i != _tx_bitmap.end()) {
-        auto seqno = i->first;
+    for (auto seqno = _send_records.base(); seqno < acked_end; seqno++) {
+        sendRecord& rec = *_send_records.find(seqno);
         // cumulative ack is next expected packet, not yet received
-        if (seqno >= cum_ack) {
-            // nothing else acked
-            break;
-        }
-        mem_b pkt_size = i->second.pkt_size;
-        simtime_picosec send_time = i->second.send_time;
+        if (!rec.in_flight)
+            continue;
+        mem_b pkt_size = rec.pkt_size;
+        simtime_picosec send_time = rec.send_time;
 
-        newly_acked += i->second.pkt_size;
+        newly_acked += rec.pkt_size;
 
         // computeRTO(send_time);
         computeRTT(send_time);
@@ -596,13 +665,14 @@ mem_b EqdsSrc::handleCumulativeAck(EqdsDataPacket::seq_t cum_ack) {
         assert(_in_flight >= 0);
         if (_debug_src)
             cout << _flow.str() << " " << _nodename << " handleCumAck " << seqno << " flow " << _flow.str() << endl;
-        _tx_bitmap.erase(i);
-        i = _tx_bitmap.begin();
-        _send_times.erase(send_time);
+        rec.in_flight = false;
+        eraseSendTime(send_time);
         if (send_time == _rto_send_time) {
             recalculateRTO();
         }
     }
+    _send_records.advance(cum_ack);
+    _rtx_queue_head = max(_rtx_queue_head, _send_records.base());
     return newly_acked;
 }
 
@@ -864,8 +934,8 @@ void EqdsSrc::processNack(const EqdsNackPacket& pkt) {
     // bool ecn_echo = pkt.ecn_echo();
 
     // move the packet to the RTX queue
-    auto i = _tx_bitmap.find(nacked_seqno);
-    if (i == _tx_bitmap.end()) {
+    sendRecord* rec = findInFlight(nacked_seqno);
+    if (!rec) {
         if (_debug_src)
             cout << _flow.str() << " " << "Didn't find NACKed packet in _active_packets flow " << _flow.str() << endl;
 
@@ -878,15 +948,15 @@ void EqdsSrc::processNack(const EqdsNackPacket& pkt) {
         // packet. return;
     }
 
-    mem_b pkt_size = i->second.pkt_size;
+    mem_b pkt_size = rec->pkt_size;
 
     assert(pkt_size >= _hdr_size);  // check we're not seeing NACKed RTS packets.
     if (pkt_size == _hdr_size) {
         _stats.rts_nacks++;
     }
 
-    auto seqno = i->first;
-    simtime_picosec send_time = i->second.send_time;
+    auto seqno = nacked_seqno;
+    simtime_picosec send_time = rec->send_time;
 
     computeRTT(send_time);
     // computeDynamicRTO(send_time);
@@ -897,13 +967,13 @@ void EqdsSrc::processNack(const EqdsNackPacket& pkt) {
     if (_debug_src)
         cout << _flow.str() << " " << _nodename << " erasing send record, seqno: " << seqno << " flow " << _flow.str()
              << endl;
-    _tx_bitmap.erase(i);
-    assert(_tx_bitmap.find(seqno) == _tx_bitmap.end());  // xxx remove when working
+    // the CC update may have sent something, moving the record
+    _send_records.find(seqno)->in_flight = false;
 
     _in_flight -= pkt_size;
     assert(_in_flight >= 0);
 
-    _send_times.erase(send_time);
+    eraseSendTime(send_time);
 
     stopSpeculating();
     queueForRtx(seqno, pkt_size);
@@ -1069,7 +1139,7 @@ EqdsBasePacket::pull_quanta EqdsSrc::computePullTarget() {
     // try again This seems to work well for all-to-all and passes outcast_incast, but we should
     // rewrite it to not need to recurse.
     mem_b old_pull_target = EqdsBasePacket::unquantize(_pull_target);
-    if (!_speculating && pull_target - old_pull_target < PULL_QUANTUM && _credit_spec > 0 && (true || _backlog > 0 || !_rtx_queue.empty())) {
+    if (!_speculating && pull_target - old_pull_target < PULL_QUANTUM && _credit_spec > 0 && (true || _backlog > 0 || !rtxQueueEmpty())) {
         _credit_spec -= _mtu;
         pull_target += _mtu;
     }
@@ -1101,7 +1171,7 @@ void EqdsSrc::sendIfPermitted() {
         }
     }
 
-    if (_rtx_queue.empty()) {
+    if (rtxQueueEmpty()) {
         if (_backlog == 0) {
             // nothing to retransmit, and no backlog.  Nothing to do here.                                                                                        
             if (_credit_pull > 0) {
@@ -1149,7 +1219,7 @@ void EqdsSrc::sendIfPermitted() {
 // we will likely be sending something (sendNewPacket can return 0 if
 // we only had speculative credit we're not allowed to use though)
 mem_b EqdsSrc::sendPacket(const Route& route) {
-    if (_rtx_queue.empty()) {
+    if (rtxQueueEmpty()) {
         return sendNewPacket(route);
     } else {
         return sendRtxPacket(route);
@@ -1315,9 +1385,9 @@ mem_b EqdsSrc::sendNewPacket(const Route& route) {
 }
 
 mem_b EqdsSrc::sendRtxPacket(const Route& route) {
-    assert(!_rtx_queue.empty());
-    auto seq_no = _rtx_queue.begin()->first;
-    mem_b full_pkt_size = _rtx_queue.begin()->second;
+    assert(!rtxQueueEmpty());
+    auto seq_no = rtxQueueFront();
+    mem_b full_pkt_size = _send_records.find(seq_no)->pkt_size;
     bool speculative = false;
 
     bool can_send = spendCredit(full_pkt_size, speculative); // updates speculative
@@ -1330,7 +1400,7 @@ mem_b EqdsSrc::sendRtxPacket(const Route& route) {
         return 0;
     }
 
-    _rtx_queue.erase(_rtx_queue.begin());
+    dequeueRtx(*_send_records.find(seq_no));
     _in_flight += full_pkt_size;
     _pull_target = computePullTarget();
     
@@ -1385,14 +1455,21 @@ void EqdsSrc::createSendRecord(EqdsBasePacket::seq_t seqno, mem_b full_pkt_size)
     if (_debug_src)
         cout << _flow.str() << " " << _nodename << " createSendRecord seqno: " << seqno << " size " << full_pkt_size
              << endl;
-    assert(_tx_bitmap.find(seqno) == _tx_bitmap.end());
-    _tx_bitmap.emplace(seqno, sendRecord(full_pkt_size, eventlist().now()));
-    _send_times.emplace(eventlist().now(), seqno);
+    sendRecord& rec = _send_records.at(seqno);
+    assert(!rec.in_flight);
+    rec.in_flight = true;
+    rec.pkt_size = full_pkt_size;
+    rec.send_time = eventlist().now();
+    addSendTime(eventlist().now(), seqno);
 }
 
 void EqdsSrc::queueForRtx(EqdsBasePacket::seq_t seqno, mem_b pkt_size) {
-    assert(_rtx_queue.find(seqno) == _rtx_queue.end());
-    _rtx_queue.emplace(seqno, pkt_size);
+    sendRecord& rec = _send_records.at(seqno);
+    assert(!rec.queued);
+    rec.queued = true;
+    rec.pkt_size = pkt_size;
+    _rtx_queue_size++;
+    _rtx_queue_head = min(_rtx_queue_head, seqno);
     if (!_speculating) // don't rtx on speculative credit!
         sendIfPermitted();
 }
@@ -1402,7 +1479,7 @@ void EqdsSrc::timeToSend(const Route& route) {
         cout << "timeToSend"
              << " flow " << _flow.str() << " at " << timeAsUs(eventlist().now()) << endl;
 
-    if (_unsent == 0 && _rtx_queue.empty()) {
+    if (_unsent == 0 && rtxQueueEmpty()) {
         _nic.cantSend(*this);
         return;
     }
@@ -1418,7 +1495,7 @@ void EqdsSrc::timeToSend(const Route& route) {
 
     mem_b full_pkt_size;
     // how much do we want to send?
-    if (_rtx_queue.empty()) {
+    if (rtxQueueEmpty()) {
         // we want to send new data
         mem_b payload_size = _mss;
         if (_unsent < payload_size) {
@@ -1428,7 +1505,7 @@ void EqdsSrc::timeToSend(const Route& route) {
         full_pkt_size = payload_size + _hdr_size;
     } else {
         // we want to retransmit
-        full_pkt_size = _rtx_queue.begin()->second;
+        full_pkt_size = _send_records.find(rtxQueueFront())->pkt_size;
     }
 
     if (_sender_based_cc) {
@@ -1454,7 +1531,7 @@ void EqdsSrc::timeToSend(const Route& route) {
 
     // OK, we're probably good to send
     mem_b bytes_sent = 0;
-    if (_rtx_queue.empty()) {
+    if (rtxQueueEmpty()) {
         bytes_sent = sendNewPacket(route);
     } else {
         bytes_sent = sendRtxPacket(route);
@@ -1477,7 +1554,7 @@ void EqdsSrc::timeToSend(const Route& route) {
         return;
     }
 
-    if (_unsent == 0 && _rtx_queue.empty()) {
+    if (_unsent == 0 && rtxQueueEmpty()) {
         // we're done - nothing more to send.
         assert(_backlog == 0);
         return;
@@ -1499,11 +1576,12 @@ void EqdsSrc::recalculateRTO() {
     // we're no longer waiting for the packet we set the timer for -
     // figure out what the timer should be now.
     cancelRTO();
-    if (_send_times.empty()) {
+    sendTimeEntry* earliest = earliestSendTime();
+    if (!earliest) {
         // nothing left that we're waiting for
         return;
     }
-    auto earliest_send_time = _send_times.begin()->first;
+    auto earliest_send_time = earliest->send_time;
     startRTO(earliest_send_time);
 }
 
@@ -1511,23 +1589,24 @@ void EqdsSrc::rtxTimerExpired() {
     assert(eventlist().now() == _rtx_timeout);
     clearRTO();
 
-    auto first_entry = _send_times.begin();
-    assert(first_entry != _send_times.end());
-    auto seqno = first_entry->second;
+    sendTimeEntry* first_entry = earliestSendTime();
+    assert(first_entry);
+    auto seqno = first_entry->seqno;
 
-    auto send_record = _tx_bitmap.find(seqno);
-    assert(send_record != _tx_bitmap.end());
-    mem_b pkt_size = send_record->second.pkt_size;
+    sendRecord* send_record = findInFlight(seqno);
+    assert(send_record);
+    mem_b pkt_size = send_record->pkt_size;
 
     // update flightsize?
 
-    _send_times.erase(first_entry);
+    first_entry->live = false;
+    _live_send_times--;
     if (_debug_src)
         cout << _nodename << " rtx timer expired for " << seqno << " flow " << _flow.str() << endl;
-    _tx_bitmap.erase(send_record);
+    send_record->in_flight = false;
     recalculateRTO();
 
-    if (!_rtx_queue.empty()) {
+    if (!rtxQueueEmpty()) {
         // there's already a queue, so clearly we shouldn't just
         // resend right now.  But send an RTS (no more than once per
         // RTT) to cover the case where the receiver doesn't know
@@ -1632,9 +1711,9 @@ EqdsSink::EqdsSink(TrafficLogger* trafficLogger, EqdsPullPacer* pullPacer, EqdsN
       _received_bytes(0),
       _accepted_bytes(0),
       _end_trigger(NULL),
-      _epsn_rx_bitmap(0),
       _out_of_order_count(0),
-      _ack_request(false) {
+      _ack_request(false),
+      _entropy(0) {
     
     _nodename = "eqdsSink";  // TBD: would be nice at add nodenum to nodename
     _no_of_ports = no_of_ports;
@@ -1666,9 +1745,9 @@ EqdsSink::EqdsSink(TrafficLogger* trafficLogger,
       _received_bytes(0),
       _accepted_bytes(0),
       _end_trigger(NULL),
-      _epsn_rx_bitmap(0),
       _out_of_order_count(0),
-      _ack_request(false) {
+      _ack_request(false),
+      _entropy(0) {
     
     _pullPacer = new EqdsPullPacer(linkSpeed, rate_modifier, mtu, eventList, no_of_ports);
     _no_of_ports = no_of_ports;
@@ -1732,7 +1811,7 @@ void EqdsSink::processData(const EqdsDataPacket& pkt) {
 
     _pullPacer->updateReceiverCc(ecn, false);
 
-    if (pkt.epsn() < _expected_epsn || _epsn_rx_bitmap[pkt.epsn()]) {
+    if (pkt.epsn() < _expected_epsn || _epsn_rx_bitmap.test(pkt.epsn())) {
         if (EqdsSrc::_debug)
             cout << _nodename << " src " << _src->nodename() << " duplicate psn " << pkt.epsn()
                  << endl;
@@ -1778,11 +1857,10 @@ void EqdsSink::processData(const EqdsDataPacket& pkt) {
              << endl;
 
     if (pkt.epsn() == _expected_epsn) {
-        while (_epsn_rx_bitmap[++_expected_epsn]) {
-            // clean OOO state, this will wrap at some point.
-            _epsn_rx_bitmap[_expected_epsn] = 0;
-            _out_of_order_count--;
-        }
+        // skip the packets above the hole we just filled, clearing them
+        uint64_t run = _epsn_rx_bitmap.pop_run(_expected_epsn + 1);
+        _expected_epsn += 1 + run;
+        _out_of_order_count -= run;
         if (_src->debug())
             cout << " EqdsSink " << _nodename << " src " << _src->nodename()
                  << " >>    cumulative ack now: " << _expected_epsn << " ooo count "
@@ -1793,7 +1871,7 @@ void EqdsSink::processData(const EqdsDataPacket& pkt) {
             _ack_request = false;
         }
     } else {
-        _epsn_rx_bitmap[pkt.epsn()] = 1;
+        _epsn_rx_bitmap.set(pkt.epsn());
         _out_of_order_count++;
         _stats.out_of_order++;
     }
@@ -1820,7 +1898,7 @@ void EqdsSink::processTrimmed(const EqdsDataPacket& pkt) {
     _stats.trimmed++;
     _pullPacer->updateReceiverCc(false, true);
 
-    if (pkt.epsn() < _expected_epsn || _epsn_rx_bitmap[pkt.epsn()]) {
+    if (pkt.epsn() < _expected_epsn || _epsn_rx_bitmap.test(pkt.epsn())) {
         if (_src->debug())
             cout << " EqdsSink processTrimmed got a packet we already have: " << pkt.epsn()
                  << " time " << timeAsNs(getSrc()->eventlist().now()) << " flow"
@@ -1899,7 +1977,7 @@ void EqdsSink::processRts(const EqdsRtsPacket& pkt) {
 
     bool ecn = (bool)(pkt.flags() & ECN_CE);
 
-    if (pkt.epsn() < _expected_epsn || _epsn_rx_bitmap[pkt.epsn()]) {
+    if (pkt.epsn() < _expected_epsn || _epsn_rx_bitmap.test(pkt.epsn())) {
         if (_src->debug())
             cout << _nodename << " src " << _src->nodename() << " duplicate psn " << pkt.epsn()
                  << endl;
@@ -1922,11 +2000,10 @@ void EqdsSink::processRts(const EqdsRtsPacket& pkt) {
     _received_bytes += pkt.size() - EqdsAckPacket::ACKSIZE;
 
     if (pkt.epsn() == _expected_epsn) {
-        while (_epsn_rx_bitmap[++_expected_epsn]) {
-            // clean OOO state, this will wrap at some point.
-            _epsn_rx_bitmap[_expected_epsn] = 0;
-            _out_of_order_count--;
-        }
+        // skip the packets above the hole we just filled, clearing them
+        uint64_t run = _epsn_rx_bitmap.pop_run(_expected_epsn + 1);
+        _expected_epsn += 1 + run;
+        _out_of_order_count -= run;
         if (_src->debug())
             cout << " EqdsSink " << _nodename << " src " << _src->nodename()
                  << " >>    cumulative ack now: " << _expected_epsn << " ooo count "
@@ -1936,7 +2013,7 @@ void EqdsSink::processRts(const EqdsRtsPacket& pkt) {
             _ack_request = false;
         }
     } else {
-        _epsn_rx_bitmap[pkt.epsn()] = 1;
+        _epsn_rx_bitmap.set(pkt.epsn());
         _out_of_order_count++;
         _stats.out_of_order++;
     }
@@ -2021,49 +2098,16 @@ EqdsBasePacket::seq_t EqdsSink::sackBitmapBase(EqdsBasePacket::seq_t epsn) {
     return max((int64_t)epsn - 63, (int64_t)(_expected_epsn + 1));
 }
 
-EqdsBasePacket::seq_t EqdsSink::sackBitmapBaseIdeal() {
-    uint8_t lowest_value = UINT8_MAX;
-    // initialize to a safe default to avoid maybe-uninitialized warning
-    EqdsBasePacket::seq_t lowest_position = _expected_epsn + 1;
-
-    // find the lowest non-zero value in the sack bitmap; that is the candidate for the base, since
-    // it is the oldest packet that we are yet to sack. on sack bitmap construction that covers a
-    // given seqno, the value is incremented.
-    for (EqdsBasePacket::seq_t crt = _expected_epsn; crt <= _high_epsn; crt++)
-        if (_epsn_rx_bitmap[crt] && _epsn_rx_bitmap[crt] < lowest_value) {
-            lowest_value = _epsn_rx_bitmap[crt];
-            lowest_position = crt;
-        }
-
-    // clamp window end; avoid underflow if _high_epsn < 64
-    if (lowest_position + 64 > _high_epsn) {
-        if (_high_epsn > 64)
-            lowest_position = _high_epsn - 64;
-        else
-            lowest_position = _expected_epsn + 1;
-    }
-
-    if (lowest_position <= _expected_epsn)
-        lowest_position = _expected_epsn + 1;
-
-    return lowest_position;
-}
-
 uint64_t EqdsSink::buildSackBitmap(EqdsBasePacket::seq_t ref_epsn) {
     // take the next 64 entries from ref_epsn and create a SACK bitmap with them
     if (_src->debug())
         cout << " EqdsSink: building sack for ref_epsn " << ref_epsn << endl;
-    uint64_t bitmap = (uint64_t)(_epsn_rx_bitmap[ref_epsn] != 0) << 63;
-
-    for (int i = 1; i < 64; i++) {
-        bitmap = bitmap >> 1 | (uint64_t)(_epsn_rx_bitmap[ref_epsn + i] != 0) << 63;
-        if (_src->debug() && (_epsn_rx_bitmap[ref_epsn + i] != 0))
-            cout << "     Sack: " << ref_epsn + i << endl;
+    uint64_t bitmap = _epsn_rx_bitmap.bits(ref_epsn);
 
-        if (_epsn_rx_bitmap[ref_epsn + i]) {
-            // remember that we sacked this packet
-            if (_epsn_rx_bitmap[ref_epsn + i] < UINT8_MAX)
-                _epsn_rx_bitmap[ref_epsn + i]++;
+    if (_src->debug()) {
+        for (int i = 1; i < 64; i++) {
+            if ((bitmap >> i) & 1)
+                cout << "     Sack: " << ref_epsn + i << endl;
         }
     }
     if (_src->debug())
@@ -2094,14 +2138,8 @@ static unsigned pktByteTimes(unsigned size) {
 }
 
 uint32_t EqdsSink::reorder_buffer_size() {
-    uint32_t count = 0;
-    // it's not very efficient to count each time, but if we only do
-    // this occasionally when the sink logger runs, it should be OK.
-    for (uint32_t i = 0; i < eqdsMaxInFlightPkts; i++) {
-        if (_epsn_rx_bitmap[i])
-            count++;
-    }
-    return count;
+    // only run occasionally, when the sink logger does
+    return _epsn_rx_bitmap.count();
 }
 
 ////////////////////////////////////////////////////////////////
@@ -10,14 +10,14 @@
 #include "trigger.h"
 #include "eqdspacket.h"
 #include "circular_buffer.h"
-#include "modular_vector.h"
+#include "seq_bitmap.h"
+#include "seq_window.h"
 
 #define timeInf 0
 // min RTO bound in us
 //  *** don't change this default - override it by calling EqdsSrc::setMinRTO()
 #define DEFAULT_EQDS_RTO_MIN 100
 
-static const unsigned eqdsMaxInFlightPkts = 1 << 12;
 class EqdsPullPacer;
 class EqdsSink;
 class EqdsSrc;
@@ -174,10 +174,16 @@ public:
     uint32_t _no_of_ports;
     vector <EqdsSrcPort*> _ports;
     struct sendRecord {
-        // need a constructor to be able to put this in a map
-        sendRecord(mem_b psize, simtime_picosec stime) : pkt_size(psize), send_time(stime){};
+        sendRecord() : pkt_size(0), send_time(0), in_flight(false), queued(false) {};
         mem_b pkt_size;
         simtime_picosec send_time;
+        bool in_flight;  // sent and not yet acked, nacked or timed out
+        bool queued;     // waiting in the RTX queue
+    };
+    struct sendTimeEntry {
+        simtime_picosec send_time;
+        EqdsDataPacket::seq_t seqno;
+        bool live;
     };
     EqdsLogger* _logger;
     TrafficLogger* _pktlogger;
@@ -188,10 +194,26 @@ public:
     // list<EqdsDataPacket*> _activePackets;
 
     // we need to access the in_flight packet list quickly by sequence number, or by send time.
-    map<EqdsDataPacket::seq_t, sendRecord> _tx_bitmap;
-    map<simtime_picosec, EqdsDataPacket::seq_t> _send_times;
-
-    map<EqdsDataPacket::seq_t, mem_b> _rtx_queue;
+    // Records are kept from the cumulative ack up to the highest PSN sent.
+    SeqWindow<sendRecord> _send_records;
+    // Send time -> the first PSN sent at that time, still in flight.
+    // Send times only go up, so the entries are kept in the order they
+    // were added; erased ones stay, marked dead, until they reach the
+    // front.
+    CircularBuffer<sendTimeEntry> _send_times;
+    uint32_t _live_send_times;
+    // the RTX queue is the records marked queued, lowest PSN first; no
+    // queued record is below _rtx_queue_head
+    uint32_t _rtx_queue_size;
+    EqdsDataPacket::seq_t _rtx_queue_head;
+
+    sendRecord* findInFlight(EqdsDataPacket::seq_t seqno);
+    void addSendTime(simtime_picosec send_time, EqdsDataPacket::seq_t seqno);
+    void eraseSendTime(simtime_picosec send_time);
+    sendTimeEntry* earliestSendTime();
+    inline bool rtxQueueEmpty() const {return _rtx_queue_size == 0;}
+    EqdsDataPacket::seq_t rtxQueueFront();
+    void dequeueRtx(sendRecord& rec);
     void startFlow();
     bool isSpeculative();
     uint16_t nextEntropy();
@@ -380,7 +402,6 @@ class EqdsSink : public DataReceiver {
     void setEndTrigger(Trigger& trigger);
 
     EqdsBasePacket::seq_t sackBitmapBase(EqdsBasePacket::seq_t epsn);
-    EqdsBasePacket::seq_t sackBitmapBaseIdeal();
     uint64_t buildSackBitmap(EqdsBasePacket::seq_t ref_epsn);
     EqdsAckPacket* sack(uint16_t path_id, EqdsBasePacket::seq_t seqno, bool ce);
 
@@ -460,8 +481,7 @@ class EqdsSink : public DataReceiver {
     uint16_t _accepted_bytes;
 
     Trigger* _end_trigger;
-    ModularVector<uint8_t, eqdsMaxInFlightPkts>
-        _epsn_rx_bitmap;  // list of packets above a hole, that we've received
+    SeqBitmap _epsn_rx_bitmap;  // packets above a hole that we've received
 
     uint32_t _out_of_order_count;
     bool _ack_request;
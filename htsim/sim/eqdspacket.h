@@ -64,8 +64,7 @@ public:
         p->_ar = false;
         p->set_dst(destination);
 
-        p->_direction = NONE;
-        p->_path_len = route.size();
+        p->_direction = NONE;
         p->_trim_hop = {};
         p->_trim_direction = NONE;
 
@@ -138,7 +137,7 @@ protected:
     //trim information, need to see if this stays here or goes to separate header.
     std::optional<int32_t> _trim_hop;
     packet_direction _trim_direction;
-    static PacketDB<EqdsDataPacket> _packetdb;
+    static thread_local PacketDB<EqdsDataPacket> _packetdb;
 };
 
 class EqdsPullPacket : public EqdsBasePacket {
@@ -156,8 +155,7 @@ public:
         p->_type = EQDSPULL;
         p->_is_header = true;
         p->_bounced = false;
-        p->_pullno = pullno;
-        p->_path_len = 0;
+        p->_pullno = pullno;
         p->set_pathid(path_id);
         p->set_dst(destination);
         p->_direction = NONE;
@@ -185,7 +183,7 @@ protected:
 
     bool _rnr;
 
-    static PacketDB<EqdsPullPacket> _packetdb;
+    static thread_local PacketDB<EqdsPullPacket> _packetdb;
 };
 
 class EqdsAckPacket : public EqdsBasePacket {
@@ -244,7 +242,7 @@ protected:
     bool _ecn_echo;
     simtime_picosec _residency_time;
 
-    static PacketDB<EqdsAckPacket> _packetdb;
+    static thread_local PacketDB<EqdsAckPacket> _packetdb;
 };
 
 class EqdsNackPacket : public EqdsBasePacket {
@@ -271,8 +269,7 @@ public:
         p->_ecn_echo = false;
         p->_rnr = false;
 
-        p->_direction = NONE;
-        p->_path_len = 0;
+        p->_direction = NONE;
         p->set_dst(destination);
         return p;
     }
@@ -293,7 +290,7 @@ protected:
     uint16_t _ev;
     bool _rnr;
     bool _ecn_echo;
-    static PacketDB<EqdsNackPacket> _packetdb;
+    static thread_local PacketDB<EqdsNackPacket> _packetdb;
 };
 
 class EqdsRtsPacket : public EqdsDataPacket {
@@ -338,7 +335,7 @@ protected:
     pull_quanta _retx_backlog;
     bool _to;
 
-    static PacketDB<EqdsRtsPacket> _packetdb;
+    static thread_local PacketDB<EqdsRtsPacket> _packetdb;
 };
 
 #endif
@@ -36,7 +36,7 @@ class EthPausePacket : public Packet {
  protected:
     uint32_t _sleepTime;
     uint32_t _senderID;
-    static PacketDB<EthPausePacket> _packetdb;
+    static thread_local PacketDB<EthPausePacket> _packetdb;
 };
 
 #endif
@@ -1,26 +1,40 @@
 // -*- c-basic-offset: 4; indent-tabs-mode: nil -*-        
 
+#include <algorithm>
+#include <limits>
 #include "eventlist.h"
+#include "checkpoint.h"
 #include "trigger.h"
+#include "eventprofiler.h"
+#include "timerwheel.h"
 
-simtime_picosec EventList::_endtime = 0;
-simtime_picosec EventList::_lasteventtime = 0;
-int EventList::_trafficeventcount = 0;
-EventList::pendingsources_t EventList::_pendingsources;
-vector <TriggerTarget*> EventList::_pending_triggers;
-int EventList::_instanceCount = 0;
-EventList* EventList::_theEventList = nullptr;
+thread_local EventList* EventList::_theEventList = nullptr;
 
 EventList::EventList()
+    : _endtime(0), _lasteventtime(0), _queue_type(EventQueue::TREE),
+      _pendingsources(EventQueue::create(EventQueue::TREE)), _pendingseq(0),
+      _batch_next(0), _cancels(0), _ambiguous_cancels(0),
+      _profiler(nullptr), _timer_wheel(nullptr), _trafficeventcount(0)
 {
-    if (EventList::_instanceCount != 0) 
+    if (EventList::_theEventList != nullptr) 
     {
-        std::cerr << "There should be only one instance of EventList. Abort." << std::endl;
+        std::cerr << "There should be only one instance of EventList per thread. Abort." << std::endl;
         abort();
     }
 
     EventList::_theEventList = this;
-    EventList::_instanceCount += 1;
+}
+
+EventList::~EventList()
+{
+    // pending entries all live in _entry_blocks
+    delete _timer_wheel;
+    delete _pendingsources;
+    for (PendingEvent* block : _entry_blocks) {
+        delete[] block;
+    }
+    if (EventList::_theEventList == this)
+        EventList::_theEventList = nullptr;
 }
 
 EventList& 
@@ -36,7 +50,125 @@ EventList::getTheEventList()
 void
 EventList::setEndtime(simtime_picosec endtime)
 {
-    EventList::_endtime = endtime;
+    _endtime = endtime;
+}
+
+void
+EventList::setQueueType(EventQueue::queue_type type)
+{
+    if (type == _queue_type)
+        return;
+    // move anything already scheduled; seq numbers keep their order
+    EventQueue* q = EventQueue::create(type);
+    while (!_pendingsources->empty()) {
+        q->insert(_pendingsources->pop());
+    }
+    delete _pendingsources;
+    _pendingsources = q;
+    _queue_type = type;
+}
+
+simtime_picosec
+EventList::nextEventTime()
+{
+    for (size_t i = _batch_next; i < _batch.size(); i++) {
+        if (_batch[i]->src)
+            return _batch[i]->when;
+    }
+    PendingEvent* e = _pendingsources->top();
+    if (!e)
+        return numeric_limits<simtime_picosec>::max();
+    return e->when;
+}
+
+TimerWheel&
+EventList::timers()
+{
+    if (!_timer_wheel)
+        _timer_wheel = new TimerWheel(*this);
+    return *_timer_wheel;
+}
+
+EventList::Handle
+EventList::addPending(EventSource& src, simtime_picosec when, uint64_t seq)
+{
+    if (_free_entries.empty()) {
+        const size_t block = 1024;
+        PendingEvent* entries = new PendingEvent[block];
+        _entry_blocks.push_back(entries);
+        for (size_t i = block; i > 0; i--) {
+            _free_entries.push_back(&entries[i - 1]);
+        }
+    }
+    PendingEvent* e = _free_entries.back();
+    _free_entries.pop_back();
+    e->when = when;
+    e->seq = seq;
+    e->src = &src;
+    e->src_prev = NULL;
+    e->src_next = src._pending;
+    e->batched = false;
+    if (src._pending)
+        src._pending->src_prev = e;
+    src._pending = e;
+    _pendingsources->insert(e);
+    return e;
+}
+
+void
+EventList::unlinkFromSource(Handle handle)
+{
+    if (handle->src_prev)
+        handle->src_prev->src_next = handle->src_next;
+    else
+        handle->src->_pending = handle->src_next;
+    if (handle->src_next)
+        handle->src_next->src_prev = handle->src_prev;
+}
+
+void
+EventList::removePending(Handle handle)
+{
+    _cancels++;
+    unlinkPending(handle);
+}
+
+void
+EventList::unlinkPending(Handle handle)
+{
+    unlinkFromSource(handle);
+    if (handle->batched) {
+        // already out of the queue; recycled when the batch gets to it
+        handle->src = NULL;
+        return;
+    }
+    _pendingsources->remove(handle);
+    _free_entries.push_back(handle);
+}
+
+PendingEvent*
+EventList::nextBatched()
+{
+    while (true) {
+        while (_batch_next < _batch.size()) {
+            PendingEvent* e = _batch[_batch_next++];
+            if (e->src)
+                return e;
+            _free_entries.push_back(e);
+        }
+        _batch.clear();
+        _batch_next = 0;
+        if (_pendingsources->empty())
+            return NULL;
+        _pendingsources->pop_batch(_batch);
+        for (PendingEvent* e : _batch) {
+            e->batched = true;
+        }
+        size_t bucket = 63 - __builtin_clzll(_batch.size());
+        if (bucket >= _batch_sizes.size())
+            _batch_sizes.resize(bucket + 1, 0);
+        _batch_sizes[bucket]++;
+    }
 }
 
 bool
@@ -51,19 +183,26 @@ EventList::doNextEvent()
         return true;
     }
     
-    if (_pendingsources.empty())
+    // Events due at the same time as others already taken from the
+    // queue can only have been scheduled since, so they come after the
+    // rest of the batch anyway.
+    PendingEvent* e = nextBatched();
+    if (!e)
         return false;
     
-    pendingsources_t::iterator i = _pendingsources.begin();
-    simtime_picosec nexteventtime = i->first;
-    EventSource* nextsource = i->second;
-    if (nextsource->isTraffic()) {
+    simtime_picosec nexteventtime = e->when;
+    EventSource* nextsource = e->src;
+    if (nextsource->traffic()) {
         _trafficeventcount--;
     } 
-    _pendingsources.erase(i);
+    unlinkFromSource(e);
+    _free_entries.push_back(e);
     assert(nexteventtime >= _lasteventtime);
     _lasteventtime = nexteventtime; // set this before calling doNextEvent, so that this::now() is accurate
-    nextsource->doNextEvent();
+    if (_profiler)
+        _profiler->dispatch(nextsource);
+    else
+        nextsource->doNextEvent();
     return true;
 }
 
@@ -72,10 +211,10 @@ EventList::doNextEvent()
 EventList::sourceIsPending(EventSource &src, simtime_picosec when) 
 {
     assert(when>=now());
-    if ((_endtime==0 || when<_endtime) && (src.isTraffic() ||
+    if ((_endtime==0 || when<_endtime) && (src.traffic() ||
         (_trafficeventcount > 0 || _lasteventtime == 0))) {
         _pendingsources.insert(make_pair(when,&src));
-        if (src.isTraffic()) {
+        if (src.traffic()) {
             _trafficeventcount++;
         }
     }
@@ -86,7 +225,7 @@ void EventList::sourceIsPending(EventSource& src, simtime_picosec when) {
                src.str().c_str(), static_cast<unsigned long>(when), _endtime, when, _endtime); */
     assert(when >= now());
     if (_endtime == 0 || when < _endtime) {
-        _pendingsources.insert(make_pair(when, &src));
+        addPending(src, when);
         /* printf("EventList1::sourceIsPending: source %s at time %lu ps\n",
                src.str().c_str(), static_cast<unsigned long>(when)); */
     }
@@ -96,15 +235,126 @@ EventList::Handle
 EventList::sourceIsPendingGetHandle(EventSource &src, simtime_picosec when) 
 {
     assert(when>=now());
-    if ((_endtime==0 || when<_endtime) && (src.isTraffic() ||
+    if ((_endtime==0 || when<_endtime) && (src.traffic() ||
         (_trafficeventcount > 0 || _lasteventtime == 0))) {
-        EventList::Handle handle =_pendingsources.insert(make_pair(when,&src));
-        if (src.isTraffic()) {
+        EventList::Handle handle = addPending(src, when);
+        if (src.traffic()) {
             _trafficeventcount++;
         }
         return handle;
     }
-    return _pendingsources.end();
+    return nullHandle();
+}
+
+bool
+EventList::admitTimer(EventSource &src, simtime_picosec when)
+{
+    // as sourceIsPendingGetHandle
+    assert(when>=now());
+    if ((_endtime==0 || when<_endtime) && (src.traffic() ||
+        (_trafficeventcount > 0 || _lasteventtime == 0))) {
+        if (src.traffic()) {
+            _trafficeventcount++;
+        }
+        return true;
+    }
+    return false;
+}
+
+void
+EventList::timerCancelled(EventSource &src)
+{
+    if (src.traffic()) {
+        _trafficeventcount--;
+    }
+}
+
+EventList::Handle
+EventList::findPending(EventSource& src, uint64_t seq)
+{
+    for (Handle h = src._pending; h; h = h->src_next) {
+        if (h->seq == seq)
+            return h;
+    }
+    return NULL;
+}
+
+void
+EventList::checkpoint(Checkpoint& cp)
+{
+    if (cp.saving() && hasPendingTriggers())
+        cp.unsupported("pending triggers");
+    cp.io(_lasteventtime);
+    uint64_t seq = _pendingseq;
+    cp.io(seq);
+    cp.io(_trafficeventcount);
+
+    auto earlier = [](const PendingEvent* a, const PendingEvent* b) {return a->before(*b);};
+    if (cp.saving()) {
+        // the rest of the current batch is still pending too.  The
+        // wheel's own event is rebuilt as its timers are restored.
+        vector<PendingEvent*> events;
+        for (size_t i = _batch_next; i < _batch.size(); i++) {
+            if (_batch[i]->src)
+                events.push_back(_batch[i]);
+        }
+        _pendingsources->entries(events);
+        events.erase(remove_if(events.begin(), events.end(), [this](PendingEvent* e) {
+                    return e->src == _timer_wheel;
+                }), events.end());
+        sort(events.begin(), events.end(), earlier);
+        size_t n = cp.io_size(events.size());
+        for (size_t i = 0; i < n; i++) {
+            PendingEvent* e = events[i];
+            cp.io(e->when);
+            cp.io(e->seq);
+            cp.io(e->src);
+        }
+        return;
+    }
+
+    assert(_batch_next == _batch.size());
+    if (_timer_wheel)
+        _timer_wheel->checkpoint_clear();
+    // Replace the events of the objects in the checkpoint.  Those of
+    // objects set up after them are kept, after the restored ones.
+    vector<PendingEvent*> local;
+    _pendingsources->entries(local);
+    vector<PendingEvent*> kept;
+    for (PendingEvent* e : local) {
+        Checkpointable* c = dynamic_cast<Checkpointable*>(e->src);
+        unlinkFromSource(e);
+        _pendingsources->remove(e);
+        if (c && cp.covers(*c)) {
+            _free_entries.push_back(e);
+        } else {
+            if (e->when < _lasteventtime)
+                cp.unsupported("an event of " + e->src->str() + " set up before the time of the checkpoint");
+            kept.push_back(e);
+        }
+    }
+    size_t n = cp.io_size(0);
+    for (size_t i = 0; i < n; i++) {
+        simtime_picosec when;
+        uint64_t event_seq;
+        EventSource* src = NULL;
+        cp.io(when);
+        cp.io(event_seq);
+        cp.io(src);
+        addPending(*src, when, event_seq);
+    }
+    _pendingseq = seq;
+    // kept entries stay where they are, so any handles to them remain valid
+    sort(kept.begin(), kept.end(), earlier);
+    for (PendingEvent* e : kept) {
+        e->seq = _pendingseq++;
+        e->src_prev = NULL;
+        e->src_next = e->src->_pending;
+        if (e->src->_pending)
+            e->src->_pending->src_prev = e;
+        e->src->_pending = e;
+        _pendingsources->insert(e);
+    }
 }
 
 void
@@ -114,36 +364,37 @@ EventList::triggerIsPending(TriggerTarget &target) {
 
 void 
 EventList::cancelPendingSource(EventSource &src) {
-    pendingsources_t::iterator i = _pendingsources.begin();
-    while (i != _pendingsources.end()) {
-        if (i->second == &src) {
-            if (src.isTraffic()) {
-                _trafficeventcount--;
-            }
-            _pendingsources.erase(i);
-            return;
+    // cancel the earliest pending event of src.  Usually there is only one.
+    Handle handle = src._pending;
+    if (handle && handle->src_next) {
+        _ambiguous_cancels++;
+        for (Handle h = handle->src_next; h; h = h->src_next) {
+            if (h->before(*handle))
+                handle = h;
         }
-        i++;
+    }
+    if (handle) {
+        if (src.traffic()) {
+            _trafficeventcount--;
+        }
+        removePending(handle);
     }
 }
 
 void 
 EventList::cancelPendingSourceByTime(EventSource &src, simtime_picosec when) {
     // fast cancellation of a timer - the timer MUST exist
-    // this should normally be fast, except if we have a lot of events with exactly the same time value
-
-    auto range = _pendingsources.equal_range(when);
-
-    for (auto i = range.first; i != range.second; ++i) {
-        if (i->second == &src) {
-            if (src.isTraffic()) {
-                _trafficeventcount--;
-            }
-            _pendingsources.erase(i);
-            return;
-        }
+    Handle handle = NULL;
+    for (Handle h = src._pending; h; h = h->src_next) {
+        if (h->when == when && (!handle || h->before(*handle)))
+            handle = h;
+    }
+    if (!handle)
+        abort();
+    if (src.traffic()) {
+        _trafficeventcount--;
     }
-    abort();
+    removePending(handle);
 }
 
 
@@ -151,14 +402,14 @@ void EventList::cancelPendingSourceByHandle(EventSource &src, EventList::Handle
     // If we're cancelling timers often, cancel them by handle.  But
     // be careful - cancelling a handle that has already been
     // cancelled or has already expired is undefined behaviour
-    assert(handle->second == &src);
-    assert(handle != _pendingsources.end());
-    assert(handle->first >= now());
+    assert(handle != nullHandle());
+    assert(handle->src == &src);
+    assert(handle->when >= now());
     
-    if (src.isTraffic()) {
+    if (src.traffic()) {
         _trafficeventcount--;
     }
-    _pendingsources.erase(handle);
+    removePending(handle);
 }
 
 void 
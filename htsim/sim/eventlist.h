@@ -6,59 +6,134 @@
 #include <sys/time.h>
 #include "config.h"
 #include "loggertypes.h"
+#include "eventqueue.h"
 
 class EventList;
 class TriggerTarget;
+class EventProfiler;
+class TimerWheel;
+class Checkpoint;
 
 class EventSource : public Logged {
+    friend class EventList;
 public:
-    EventSource(EventList& eventlist, const string& name) : Logged(name), _eventlist(eventlist) {};
+    EventSource(EventList& eventlist, const string& name) : Logged(name), _eventlist(eventlist), _pending(NULL), _traffic(-1) {};
     EventSource(const string& name);
     virtual ~EventSource() {};
     virtual void doNextEvent() = 0;
     virtual bool isTraffic() {return true;}
     inline EventList& eventlist() const {return _eventlist;}
+    inline bool isPending() const {return _pending != NULL;}
 protected:
     EventList& _eventlist;
+private:
+    // isTraffic() is asked for every event scheduled and dispatched;
+    // no source changes its answer, so it is only asked once
+    inline bool traffic() {
+        if (_traffic < 0)
+            _traffic = isTraffic();
+        return _traffic;
+    }
+
+    // this source's entries in the event list, so that cancelling
+    // doesn't need to search the whole list
+    PendingEvent* _pending;
+    int8_t _traffic; // isTraffic(), or -1 until asked
 };
 
 class EventList {
 public:
-    typedef multimap <simtime_picosec, EventSource*>::iterator Handle;
+    typedef PendingEvent* Handle;
     EventList();
-    static void setEndtime(simtime_picosec endtime); // end simulation at endtime (rather than forever)
-    static bool doNextEvent(); // returns true if it did anything, false if there's nothing to do
-    static void sourceIsPending(EventSource &src, simtime_picosec when);
-    static Handle sourceIsPendingGetHandle(EventSource &src, simtime_picosec when);
-    static void sourceIsPendingRel(EventSource &src, simtime_picosec timefromnow)
-    { sourceIsPending(src, EventList::now()+timefromnow); }
-    static void cancelPendingSource(EventSource &src);
+    ~EventList();
+    // choose the pending event structure; call before the simulation starts
+    void setQueueType(EventQueue::queue_type type);
+    EventQueue::queue_type queueType() {return _queue_type;}
+    void setEndtime(simtime_picosec endtime); // end simulation at endtime (rather than forever)
+    bool doNextEvent(); // returns true if it did anything, false if there's nothing to do
+    void sourceIsPending(EventSource &src, simtime_picosec when);
+    Handle sourceIsPendingGetHandle(EventSource &src, simtime_picosec when);
+    void sourceIsPendingRel(EventSource &src, simtime_picosec timefromnow)
+    { sourceIsPending(src, now()+timefromnow); }
+    void cancelPendingSource(EventSource &src);
     // optimized cancel, if we know the expiry time
-    static void cancelPendingSourceByTime(EventSource &src, simtime_picosec when);   
+    void cancelPendingSourceByTime(EventSource &src, simtime_picosec when);   
     // optimized cancel by handle - be careful to ensure handle is still valid
-    static void cancelPendingSourceByHandle(EventSource &src, Handle handle);       
-    static void reschedulePendingSource(EventSource &src, simtime_picosec when);
-    static void triggerIsPending(TriggerTarget &target);
-    static inline simtime_picosec now() {return EventList::_lasteventtime;}
-    static inline int trafficEventCount() {return EventList::_trafficeventcount;}
-    static Handle nullHandle() {return _pendingsources.end();}
-    static multimap<simtime_picosec, EventSource*> getPendingSources() {return _pendingsources;}
-
+    void cancelPendingSourceByHandle(EventSource &src, Handle handle);       
+    void reschedulePendingSource(EventSource &src, simtime_picosec when);
+    // cancels that had to search several pending events of the same
+    // source, rather than going straight to its only one
+    uint64_t ambiguousCancelCount() {return _ambiguous_cancels;}
+    uint64_t cancelCount() {return _cancels;}
+    // Events that share a timestamp are taken from the queue together
+    // and then dispatched one per doNextEvent().  Entry i counts the
+    // batches of 2^i to 2^(i+1)-1 events.
+    const vector<uint64_t>& batchSizeHistogram() {return _batch_sizes;}
+    // time each event and attribute it to its source's class
+    void setProfiler(EventProfiler* profiler) {_profiler = profiler;}
+    void triggerIsPending(TriggerTarget &target);
+    inline bool hasPendingTriggers() const {return !_pending_triggers.empty();}
+    inline simtime_picosec now() {return _lasteventtime;}
+    inline int trafficEventCount() {return _trafficeventcount;}
+    static Handle nullHandle() {return NULL;}
+    // time of the earliest pending event, or the largest simtime if none
+    simtime_picosec nextEventTime();
+    // timers that are mostly cancelled before they expire are cheaper
+    // on the timer wheel than in the event list
+    TimerWheel& timers();
+    // save or restore the pending events (see checkpoint.h).  Timers
+    // still on the wheel are saved by the objects that own them.
+    void checkpoint(Checkpoint& cp);
 
+    // the event list of the simulation running on this thread.  Each
+    // thread runs at most one simulation at a time; the simulation's
+    // other global state (IDs, packet pools, protocol parameters) is
+    // thread_local for the same reason.
     static EventList& getTheEventList();
     EventList(const EventList&)      = delete;  // disable Copy Constructor
     void operator=(const EventList&) = delete;  // disable Assign Constructor
 
 private:
-    static simtime_picosec _endtime;
-    static simtime_picosec _lasteventtime;
-    typedef multimap <simtime_picosec, EventSource*> pendingsources_t;
-    static pendingsources_t _pendingsources;
-    static vector <TriggerTarget*> _pending_triggers;
+    friend class TimerWheel;
+    simtime_picosec _endtime;
+    simtime_picosec _lasteventtime;
+    Handle addPending(EventSource& src, simtime_picosec when) {return addPending(src, when, _pendingseq++);}
+    Handle addPending(EventSource& src, simtime_picosec when, uint64_t seq);
+    // TimerWheel keeps timers out of _pendingsources until they are
+    // nearly due, but they count as pending from when they are armed
+    bool admitTimer(EventSource& src, simtime_picosec when);
+    void timerCancelled(EventSource& src);
+    uint64_t reserveSeq() {return _pendingseq++;}
+    void removePending(Handle handle);
+    // removePending() without counting it as a cancel, for the
+    // TimerWheel moving its own event
+    void unlinkPending(Handle handle);
+    void unlinkFromSource(Handle handle);
+    // the pending entry of src with sequence number seq, or NULL
+    Handle findPending(EventSource& src, uint64_t seq);
+    // the next event of the current batch, taking a new batch from
+    // _pendingsources when it runs out; NULL if nothing is pending
+    PendingEvent* nextBatched();
+
+    EventQueue::queue_type _queue_type;
+    EventQueue* _pendingsources;
+    uint64_t _pendingseq; // orders events that share a timestamp
+    // PendingEvent entries are allocated in blocks and recycled
+    vector <PendingEvent*> _free_entries;
+    vector <PendingEvent*> _entry_blocks;
+    vector <TriggerTarget*> _pending_triggers;
+    // the events at the current time not yet dispatched start at
+    // _batch_next; cancelled ones are left in place with a NULL src
+    vector <PendingEvent*> _batch;
+    size_t _batch_next;
+    vector <uint64_t> _batch_sizes;
+    uint64_t _cancels;
+    uint64_t _ambiguous_cancels;
+    EventProfiler* _profiler;
+    TimerWheel* _timer_wheel;
 
-    static int _instanceCount;
-    static int _trafficeventcount; // number of events that are not loggers/samplers
-    static EventList* _theEventList;
+    int _trafficeventcount; // number of events that are not loggers/samplers
+    static thread_local EventList* _theEventList;
 };
 
 #endif
@@ -0,0 +1,138 @@
+// -*- c-basic-offset: 4; indent-tabs-mode: nil -*-
+#include "eventprofiler.h"
+#include <algorithm>
+#include <cxxabi.h>
+#include <cstdlib>
+#include <iomanip>
+#include <map>
+
+EventProfiler::EventProfiler(bool per_instance)
+    : _per_instance(per_instance)
+{
+}
+
+void
+EventProfiler::record(EventSource* src, uint64_t nanos) {
+    std::type_index type(typeid(*src));
+    Stats& t = _by_type[type];
+    t.events++;
+    t.nanos += nanos;
+    _total.events++;
+    _total.nanos += nanos;
+    if (!_per_instance)
+        return;
+    auto i = _instance_of.find(src);
+    if (i == _instance_of.end() || _instances[i->second].type != type) {
+        _instance_of[src] = _instances.size();
+        _instances.push_back(Instance{type, src->str(), Stats()});
+        i = _instance_of.find(src);
+    }
+    Stats& s = _instances[i->second].stats;
+    s.events++;
+    s.nanos += nanos;
+}
+
+string
+EventProfiler::class_name(std::type_index type) {
+    int status;
+    char* name = abi::__cxa_demangle(type.name(), NULL, NULL, &status);
+    if (status != 0)
+        return type.name();
+    string result(name);
+    free(name);
+    return result;
+}
+
+vector<EventProfiler::Row>
+EventProfiler::type_rows() const {
+    vector<Row> rows;
+    for (auto& t : _by_type) {
+        rows.push_back(Row{class_name(t.first), t.second});
+    }
+    sort(rows.begin(), rows.end(), [](const Row& a, const Row& b) {
+            return a.stats.nanos > b.stats.nanos;
+        });
+    return rows;
+}
+
+vector<EventProfiler::Row>
+EventProfiler::instance_rows() const {
+    // instances may share a name
+    map<string, Stats> by_name;
+    for (const Instance& inst : _instances) {
+        Stats& s = by_name[inst.name];
+        s.events += inst.stats.events;
+        s.nanos += inst.stats.nanos;
+    }
+    vector<Row> rows;
+    for (auto& n : by_name) {
+        rows.push_back(Row{n.first, n.second});
+    }
+    sort(rows.begin(), rows.end(), [](const Row& a, const Row& b) {
+            return a.stats.nanos > b.stats.nanos;
+        });
+    return rows;
+}
+
+void
+EventProfiler::print_rows(ostream& os, const char* heading, const vector<Row>& rows, size_t max_rows) {
+    os << left << setw(40) << heading << right << setw(14) << "events" << setw(14) << "ms"
+       << setw(10) << "ns/event" << setw(8) << "%time" << endl;
+    for (size_t i = 0; i < rows.size() && i < max_rows; i++) {
+        const Stats& s = rows[i].stats;
+        os << left << setw(40) << rows[i].name << right << setw(14) << s.events
+           << setw(14) << fixed << setprecision(3) << s.nanos / 1e6
+           << setw(10) << setprecision(1) << (s.events ? (double)s.nanos / s.events : 0.0)
+           << setw(8) << setprecision(1) << (_total.nanos ? 100.0 * s.nanos / _total.nanos : 0.0)
+           << endl;
+    }
+    if (rows.size() > max_rows)
+        os << "(" << rows.size() - max_rows << " more)" << endl;
+    os.unsetf(ios::floatfield);
+}
+
+void
+EventProfiler::report(ostream& os) {
+    os << "Event profile: " << _total.events << " events, "
+       << _total.nanos / 1000000 << " ms in doNextEvent" << endl;
+    print_rows(os, "class", type_rows(), SIZE_MAX);
+    if (_per_instance)
+        print_rows(os, "instance", instance_rows(), REPORT_INSTANCES);
+}
+
+static void
+json_string(ostream& os, const string& s) {
+    os << '"';
+    for (char c : s) {
+        if (c == '"' || c == '\\')
+            os << '\\' << c;
+        else if ((unsigned char)c < 0x20)
+            os << "\\u" << hex << setw(4) << setfill('0') << (int)c << dec << setfill(' ');
+        else
+            os << c;
+    }
+    os << '"';
+}
+
+void
+EventProfiler::json_rows(ostream& os, const vector<Row>& rows) {
+    os << "[";
+    for (size_t i = 0; i < rows.size(); i++) {
+        os << (i ? ",\n    " : "\n    ") << "{\"name\": ";
+        json_string(os, rows[i].name);
+        os << ", \"events\": " << rows[i].stats.events << ", \"ns\": " << rows[i].stats.nanos << "}";
+    }
+    os << "\n  ]";
+}
+
+void
+EventProfiler::write_json(ostream& os) {
+    os << "{\n  \"events\": " << _total.events << ",\n  \"ns\": " << _total.nanos
+       << ",\n  \"classes\": ";
+    json_rows(os, type_rows());
+    if (_per_instance) {
+        os << ",\n  \"instances\": ";
+        json_rows(os, instance_rows());
+    }
+    os << "\n}" << endl;
+}
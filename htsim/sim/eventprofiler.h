@@ -0,0 +1,74 @@
+// -*- c-basic-offset: 4; indent-tabs-mode: nil -*-
+#ifndef EVENTPROFILER_H
+#define EVENTPROFILER_H
+
+/*
+ * Counts the events dispatched by the EventList and the wall-clock
+ * time spent in them, per concrete EventSource class (Queue, Pipe,
+ * UecSrc, loggers, ...) and optionally per instance, as named by
+ * Logged::str().
+ *
+ * Install with EventList::setProfiler(); without one the event loop
+ * only tests a NULL pointer.  Time spent in an event includes anything
+ * it calls directly, such as packets passed on through
+ * receivePacket(), but not the events it schedules.
+ *
+ * Instances are remembered by address.  If a source is deleted and
+ * another of a different class is created at the same address it is
+ * counted separately; one of the same class is merged with the old.
+ */
+
+#include <chrono>
+#include <typeindex>
+#include <unordered_map>
+#include <vector>
+#include <ostream>
+#include "config.h"
+#include "eventlist.h"
+
+class EventProfiler {
+public:
+    EventProfiler(bool per_instance = false);
+
+    inline void dispatch(EventSource* src) {
+        auto start = std::chrono::steady_clock::now();
+        src->doNextEvent();
+        auto end = std::chrono::steady_clock::now();
+        record(src, std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+    }
+
+    // tables sorted by time, biggest first; only the busiest instances
+    // are printed, write_json() has them all
+    void report(ostream& os);
+    void write_json(ostream& os);
+    static const size_t REPORT_INSTANCES = 20;
+private:
+    struct Stats {
+        Stats() : events(0), nanos(0) {}
+        uint64_t events;
+        uint64_t nanos;
+    };
+    struct Instance {
+        std::type_index type;
+        string name;
+        Stats stats;
+    };
+    struct Row {
+        string name;
+        Stats stats;
+    };
+    void record(EventSource* src, uint64_t nanos);
+    vector<Row> type_rows() const;
+    vector<Row> instance_rows() const;
+    void print_rows(ostream& os, const char* heading, const vector<Row>& rows, size_t max_rows);
+    void json_rows(ostream& os, const vector<Row>& rows);
+    static string class_name(std::type_index type);
+
+    bool _per_instance;
+    unordered_map<std::type_index, Stats> _by_type;
+    unordered_map<EventSource*, size_t> _instance_of;
+    vector<Instance> _instances;
+    Stats _total;
+};
+
+#endif
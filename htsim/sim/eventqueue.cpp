@@ -0,0 +1,279 @@
+// -*- c-basic-offset: 4; indent-tabs-mode: nil -*-
+
+#include "eventqueue.h"
+#include <iostream>
+
+EventQueue*
+EventQueue::create(queue_type type) {
+    switch (type) {
+    case TREE:
+        return new TreeEventQueue();
+    case CALENDAR:
+        return new CalendarEventQueue();
+    }
+    abort();
+}
+
+const char*
+EventQueue::type_name(queue_type type) {
+    switch (type) {
+    case TREE:
+        return "tree";
+    case CALENDAR:
+        return "calendar";
+    }
+    return "unknown";
+}
+
+void
+EventQueue::pop_batch(vector<PendingEvent*>& batch) {
+    PendingEvent* e = pop();
+    if (!e)
+        return;
+    simtime_picosec when = e->when;
+    batch.push_back(e);
+    while ((e = top()) && e->when == when) {
+        batch.push_back(pop());
+    }
+}
+
+/* TreeEventQueue */
+
+void
+TreeEventQueue::insert(PendingEvent* e) {
+    _entries.insert(e);
+    _size++;
+}
+
+void
+TreeEventQueue::remove(PendingEvent* e) {
+    size_t erased = _entries.erase(e);
+    assert(erased == 1);
+    _size--;
+}
+
+PendingEvent*
+TreeEventQueue::top() {
+    if (_entries.empty())
+        return NULL;
+    return *_entries.begin();
+}
+
+PendingEvent*
+TreeEventQueue::pop() {
+    if (_entries.empty())
+        return NULL;
+    PendingEvent* e = *_entries.begin();
+    _entries.erase(_entries.begin());
+    _size--;
+    return e;
+}
+
+void
+TreeEventQueue::pop_batch(vector<PendingEvent*>& batch) {
+    if (_entries.empty())
+        return;
+    auto i = _entries.begin();
+    simtime_picosec when = (*i)->when;
+    size_t n = 0;
+    for (; i != _entries.end() && (*i)->when == when; i++, n++) {
+        batch.push_back(*i);
+    }
+    _entries.erase(_entries.begin(), i);
+    _size -= n;
+}
+
+void
+TreeEventQueue::entries(vector<PendingEvent*>& out) const {
+    out.insert(out.end(), _entries.begin(), _entries.end());
+}
+
+/* CalendarEventQueue */
+
+CalendarEventQueue::CalendarEventQueue()
+    : _width(timeFromNs(1.0)), _cur(0), _cur_start(0), _recent_count(0),
+      _pops(0), _scan_cost(0)
+{
+    _buckets.resize(MIN_BUCKETS, Bucket{NULL, NULL});
+    _mask = MIN_BUCKETS - 1;
+}
+
+void
+CalendarEventQueue::link(PendingEvent* e) {
+    // buckets are kept sorted.  New entries almost always belong at
+    // (or near) the tail, so search backwards.
+    Bucket& b = _buckets[bucket_of(e->when)];
+    PendingEvent* after = b.tail;
+    while (after && e->before(*after)) {
+        after = after->prev;
+        _scan_cost++;
+    }
+    e->prev = after;
+    if (after) {
+        e->next = after->next;
+        after->next = e;
+    } else {
+        e->next = b.head;
+        b.head = e;
+    }
+    if (e->next)
+        e->next->prev = e;
+    else
+        b.tail = e;
+}
+
+void
+CalendarEventQueue::unlink(PendingEvent* e) {
+    Bucket& b = _buckets[bucket_of(e->when)];
+    if (e->prev)
+        e->prev->next = e->next;
+    else
+        b.head = e->next;
+    if (e->next)
+        e->next->prev = e->prev;
+    else
+        b.tail = e->prev;
+}
+
+void
+CalendarEventQueue::insert(PendingEvent* e) {
+    if (e->when < _cur_start) {
+        _cur = bucket_of(e->when);
+        _cur_start = e->when - e->when % _width;
+    }
+    link(e);
+    _size++;
+    if (_size > 2 * _buckets.size())
+        resize(2 * _buckets.size());
+}
+
+void
+CalendarEventQueue::remove(PendingEvent* e) {
+    unlink(e);
+    _size--;
+    if (_size < _buckets.size() / 4 && _buckets.size() > MIN_BUCKETS)
+        resize(_buckets.size() / 2);
+}
+
+PendingEvent*
+CalendarEventQueue::top() {
+    if (_size == 0)
+        return NULL;
+
+    // walk one "year" of the calendar starting at the current day
+    size_t i = _cur;
+    simtime_picosec start = _cur_start;
+    for (size_t n = 0; n < _buckets.size(); n++) {
+        PendingEvent* e = _buckets[i].head;
+        if (e && e->when < start + _width) {
+            _scan_cost += n;
+            _cur = i;
+            _cur_start = start;
+            return e;
+        }
+        i = (i + 1) & _mask;
+        start += _width;
+    }
+    _scan_cost += _buckets.size();
+
+    // nothing due this year; jump straight to the earliest entry
+    PendingEvent* best = NULL;
+    for (size_t b = 0; b < _buckets.size(); b++) {
+        PendingEvent* e = _buckets[b].head;
+        if (e && (!best || e->before(*best)))
+            best = e;
+    }
+    assert(best);
+    _cur = bucket_of(best->when);
+    _cur_start = best->when - best->when % _width;
+    return best;
+}
+
+void
+CalendarEventQueue::entries(vector<PendingEvent*>& out) const {
+    for (const Bucket& b : _buckets) {
+        for (PendingEvent* e = b.head; e; e = e->next) {
+            out.push_back(e);
+        }
+    }
+}
+
+PendingEvent*
+CalendarEventQueue::pop() {
+    PendingEvent* e = top();
+    if (!e)
+        return NULL;
+    _recent[_recent_count % GAP_SAMPLES] = e->when;
+    _recent_count++;
+    remove(e);
+
+    // the width is normally re-tuned only on resize; also re-tune if
+    // the recent scans show it no longer matches the event spacing
+    _pops++;
+    if (_pops >= _buckets.size()) {
+        if (_scan_cost > 4 * _pops)
+            resize(_buckets.size());
+        _pops = 0;
+        _scan_cost = 0;
+    }
+    return e;
+}
+
+simtime_picosec
+CalendarEventQueue::estimate_width() const {
+    // Brown's heuristic: three times the mean gap between consecutive
+    // events, ignoring gaps more than twice the overall mean.
+    size_t n = min(_recent_count, (size_t)GAP_SAMPLES);
+    if (n < 2)
+        return _width;
+    size_t first = _recent_count - n;
+    simtime_picosec total = 0;
+    for (size_t k = first + 1; k < _recent_count; k++) {
+        total += _recent[k % GAP_SAMPLES] - _recent[(k - 1) % GAP_SAMPLES];
+    }
+    double mean = (double)total / (n - 1);
+    double trimmed = 0;
+    size_t count = 0;
+    for (size_t k = first + 1; k < _recent_count; k++) {
+        simtime_picosec gap = _recent[k % GAP_SAMPLES] - _recent[(k - 1) % GAP_SAMPLES];
+        if (gap <= 2 * mean) {
+            trimmed += gap;
+            count++;
+        }
+    }
+    if (count == 0 || trimmed == 0)
+        return _width;
+    simtime_picosec width = (simtime_picosec)(3 * trimmed / count);
+    return width > 0 ? width : 1;
+}
+
+void
+CalendarEventQueue::resize(size_t nbuckets) {
+    vector<PendingEvent*> entries;
+    entries.reserve(_size);
+    PendingEvent* first = NULL;
+    for (size_t b = 0; b < _buckets.size(); b++) {
+        for (PendingEvent* e = _buckets[b].head; e; e = e->next) {
+            entries.push_back(e);
+        }
+        PendingEvent* h = _buckets[b].head;
+        if (h && (!first || h->before(*first)))
+            first = h;
+    }
+
+    _width = estimate_width();
+    _buckets.assign(nbuckets, Bucket{NULL, NULL});
+    _mask = nbuckets - 1;
+    for (PendingEvent* e : entries) {
+        link(e);
+    }
+    if (first) {
+        _cur = bucket_of(first->when);
+        _cur_start = first->when - first->when % _width;
+    } else {
+        _cur = 0;
+        _cur_start = 0;
+    }
+    _pops = 0;
+    _scan_cost = 0;
+}
@@ -0,0 +1,127 @@
+// -*- c-basic-offset: 4; indent-tabs-mode: nil -*-
+#ifndef EVENTQUEUE_H
+#define EVENTQUEUE_H
+
+/*
+ * Priority structures holding the pending events of the EventList.
+ *
+ * Every pending event is a PendingEvent entry owned by the EventList.
+ * Entries are ordered by (when, seq), where seq is the order in which
+ * they were scheduled, so events with the same timestamp fire in FIFO
+ * order whichever backend is used.
+ *
+ * TreeEventQueue is the original balanced tree (O(log n) per
+ * operation).  CalendarEventQueue is a calendar queue (R. Brown,
+ * CACM 1988) with O(1) amortised insert, remove and pop; the number of
+ * buckets follows the number of pending events and the bucket width is
+ * re-tuned from the gaps between recently dispatched events whenever
+ * the calendar is resized.
+ *
+ * pop_batch() takes all the entries that share the earliest timestamp
+ * at once; the tree erases them as a single range.
+ */
+
+#include <set>
+#include <vector>
+#include "config.h"
+
+class EventSource;
+
+struct PendingEvent {
+    simtime_picosec when;
+    uint64_t seq;
+    EventSource* src;
+    // intrusive links, used by the calendar queue buckets
+    PendingEvent* prev;
+    PendingEvent* next;
+    // other pending entries of the same source
+    PendingEvent* src_prev;
+    PendingEvent* src_next;
+    // taken out of the queue by pop_batch(), not yet dispatched
+    bool batched;
+
+    inline bool before(const PendingEvent& other) const {
+        return when < other.when || (when == other.when && seq < other.seq);
+    }
+};
+
+class EventQueue {
+public:
+    enum queue_type { TREE, CALENDAR };
+
+    virtual ~EventQueue() {}
+    virtual void insert(PendingEvent* e) = 0;
+    virtual void remove(PendingEvent* e) = 0;
+    // earliest entry, or NULL if empty.  top() does not remove it.
+    virtual PendingEvent* top() = 0;
+    virtual PendingEvent* pop() = 0;
+    // pop every entry with the earliest timestamp, in order, onto batch
+    virtual void pop_batch(vector<PendingEvent*>& batch);
+    // append every entry to out, in no particular order
+    virtual void entries(vector<PendingEvent*>& out) const = 0;
+    inline bool empty() const {return _size == 0;}
+    inline size_t size() const {return _size;}
+
+    static EventQueue* create(queue_type type);
+    static const char* type_name(queue_type type);
+protected:
+    size_t _size = 0;
+};
+
+class TreeEventQueue : public EventQueue {
+public:
+    virtual void insert(PendingEvent* e);
+    virtual void remove(PendingEvent* e);
+    virtual PendingEvent* top();
+    virtual PendingEvent* pop();
+    virtual void pop_batch(vector<PendingEvent*>& batch);
+    virtual void entries(vector<PendingEvent*>& out) const;
+private:
+    struct EarlierFirst {
+        bool operator()(const PendingEvent* a, const PendingEvent* b) const {return a->before(*b);}
+    };
+    set<PendingEvent*, EarlierFirst> _entries;
+};
+
+class CalendarEventQueue : public EventQueue {
+public:
+    CalendarEventQueue();
+    virtual void insert(PendingEvent* e);
+    virtual void remove(PendingEvent* e);
+    virtual PendingEvent* top();
+    virtual PendingEvent* pop();
+    virtual void entries(vector<PendingEvent*>& out) const;
+
+    inline simtime_picosec bucket_width() const {return _width;}
+    inline size_t bucket_count() const {return _buckets.size();}
+private:
+    struct Bucket {
+        PendingEvent* head;
+        PendingEvent* tail;
+    };
+    static const size_t MIN_BUCKETS = 16;
+    static const size_t GAP_SAMPLES = 64;
+
+    inline size_t bucket_of(simtime_picosec when) const {return (when / _width) & _mask;}
+    void link(PendingEvent* e);
+    void unlink(PendingEvent* e);
+    void resize(size_t nbuckets);
+    simtime_picosec estimate_width() const;
+
+    vector<Bucket> _buckets;
+    size_t _mask;
+    simtime_picosec _width;
+    // the calendar scan resumes from bucket _cur, whose current "day"
+    // starts at _cur_start.  No pending entry is earlier than _cur_start.
+    size_t _cur;
+    simtime_picosec _cur_start;
+
+    // timestamps of the most recently popped entries, used to tune _width
+    simtime_picosec _recent[GAP_SAMPLES];
+    size_t _recent_count;
+    // buckets and entries stepped over since the last check
+    size_t _pops;
+    size_t _scan_cost;
+};
+
+#endif
@@ -0,0 +1,121 @@
+// -*- c-basic-offset: 4; indent-tabs-mode: nil -*-
+#include "eventqueue.h"
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "eventlist.h"
+
+class EventQueueTest : public ::testing::TestWithParam<EventQueue::queue_type> {
+   protected:
+    std::unique_ptr<EventQueue> queue_;
+    std::vector<PendingEvent>   entries_;
+    uint64_t                    seq_ = 0;
+
+    virtual void SetUp() {
+        queue_.reset(EventQueue::create(GetParam()));
+        // entries must not move once inserted
+        entries_.reserve(100000);
+    }
+
+    PendingEvent* add(simtime_picosec when) {
+        entries_.push_back(PendingEvent{when, seq_++, nullptr, nullptr, nullptr, nullptr, nullptr});
+        queue_->insert(&entries_.back());
+        return &entries_.back();
+    }
+};
+
+TEST_P(EventQueueTest, PopsInTimeOrder) {
+    srandom(1);
+    for (int i = 0; i < 50000; i++) {
+        add(random() % 1000000000);
+    }
+    simtime_picosec last = 0;
+    while (!queue_->empty()) {
+        PendingEvent* e = queue_->pop();
+        EXPECT_GE(e->when, last);
+        last = e->when;
+    }
+    EXPECT_EQ(queue_->pop(), nullptr);
+}
+
+TEST_P(EventQueueTest, EqualTimesAreFifo) {
+    for (int i = 0; i < 1000; i++) {
+        add(5000 + (i % 3) * 1000);
+    }
+    PendingEvent* prev = queue_->pop();
+    while (!queue_->empty()) {
+        PendingEvent* e = queue_->pop();
+        EXPECT_TRUE(prev->before(*e));
+        prev = e;
+    }
+}
+
+TEST_P(EventQueueTest, InterleavedInsertAndPop) {
+    // mimics a simulation: new events are never earlier than the last one popped
+    srandom(2);
+    simtime_picosec now = 0;
+    for (int i = 0; i < 1000; i++) {
+        add(random() % 100000);
+    }
+    for (int i = 0; i < 50000; i++) {
+        PendingEvent* e = queue_->pop();
+        ASSERT_NE(e, nullptr);
+        EXPECT_GE(e->when, now);
+        now = e->when;
+        add(now + random() % 100000);
+        if (i % 7 == 0)
+            add(now);
+    }
+}
+
+TEST_P(EventQueueTest, Remove) {
+    add(300);
+    PendingEvent* a = add(100);
+    PendingEvent* b = add(100);
+    add(200);
+
+    queue_->remove(a);
+    EXPECT_EQ(queue_->size(), 3u);
+    EXPECT_EQ(queue_->top(), b);
+    queue_->remove(b);
+    EXPECT_EQ(queue_->pop()->when, 200u);
+    EXPECT_EQ(queue_->pop()->when, 300u);
+    EXPECT_TRUE(queue_->empty());
+}
+
+TEST_P(EventQueueTest, PopBatchTakesEarliestTimestamp) {
+    srandom(3);
+    for (int i = 0; i < 20000; i++) {
+        add(random() % 500 * 1000);
+    }
+    std::vector<PendingEvent*> batch;
+    PendingEvent*              prev = nullptr;
+    while (!queue_->empty()) {
+        batch.clear();
+        queue_->pop_batch(batch);
+        ASSERT_FALSE(batch.empty());
+        for (PendingEvent* e : batch) {
+            EXPECT_EQ(e->when, batch.front()->when);
+            if (prev) {
+                EXPECT_TRUE(prev->before(*e));
+            }
+            prev = e;
+        }
+        if (queue_->top()) {
+            EXPECT_GT(queue_->top()->when, batch.front()->when);
+        }
+    }
+    EXPECT_EQ(queue_->size(), 0u);
+}
+
+INSTANTIATE_TEST_SUITE_P(Backends, EventQueueTest,
+                         ::testing::Values(EventQueue::TREE, EventQueue::CALENDAR));
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
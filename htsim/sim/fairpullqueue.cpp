@@ -1,6 +1,7 @@
 // -*- c-basic-offset: 4; indent-tabs-mode: nil -*-
 #include "fairpullqueue.h"
 #include <cassert>
+#include "checkpoint.h"
 
 // Define once in exactly one TU
 int _packets_per_burst = 1;
@@ -145,6 +146,36 @@ void FairPullQueue<PullPkt>::flush_flow(flowid_t flow_id, int /*priority*/) {
     }
 }
 
+template <class PullPkt>
+void FairPullQueue<PullPkt>::checkpoint(Checkpoint& cp) {
+    cp.io(this->_pull_count);
+    cp.io(this->_preferred_flow);
+    cp.io(_scheduled);
+    size_t n = cp.io_size(_queue_map.size());
+    if (cp.restoring()) {
+        for (auto& q : _queue_map) {
+            delete q.second;
+        }
+        _queue_map.clear();
+    }
+    auto it = _queue_map.begin();
+    for (size_t i = 0; i < n; i++) {
+        flowid_t flow_id = cp.saving() ? it->first : 0;
+        cp.io(flow_id);
+        if (cp.restoring())
+            it = _queue_map.insert(_queue_map.end(), std::make_pair(flow_id, new CircularBuffer<PullPkt*>()));
+        cp.io(*it->second);
+        ++it;
+    }
+    // the round robin position, as the flow it is at
+    bool at_end = _current_queue == _queue_map.end();
+    cp.io(at_end);
+    flowid_t current = at_end ? 0 : _current_queue->first;
+    cp.io(current);
+    if (cp.restoring())
+        _current_queue = at_end ? _queue_map.end() : _queue_map.find(current);
+}
+
 // ---- helpers (unchanged signatures) ----------------------------------------
 
 template <class PullPkt>
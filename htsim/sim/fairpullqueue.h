@@ -49,6 +49,7 @@ class FairPullQueue : public BasePullQueue<PullPkt>{
     virtual void enqueue(PullPkt& pkt, int priority = 0);
     virtual PullPkt* dequeue();
     virtual void flush_flow(flowid_t flow_id, int priority = 0);
+    void checkpoint(Checkpoint& cp);
  protected: 
 	map<flowid_t, CircularBuffer<PullPkt*>*> _queue_map;  // map flow id to pull queue
     bool queue_exists(const PullPkt& pkt);
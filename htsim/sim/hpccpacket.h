@@ -42,8 +42,7 @@ public:
         p->_is_header = false;
         p->_seqno = seqno;
         p->_retransmitted = retransmitted;
-        p->_last_packet = last_packet;
-        p->_path_len = 0;
+        p->_last_packet = last_packet;
         p->_direction = NONE;
         p->set_dst(destination);
         p->_int_hop = 0;
@@ -62,8 +61,7 @@ public:
         p->_is_header = false;
         p->_direction = NONE;        
         p->_retransmitted = retransmitted;
-        p->_last_packet = last_packet;
-        p->_path_len = route.size();
+        p->_last_packet = last_packet;
         p->_int_hop = 0;
         p->set_dst(destination);
         return p;
@@ -89,7 +87,7 @@ protected:
     bool _last_packet;  // set to true in the last packet in a flow.
 
     //area to aggregate switch INT information
-    static PacketDB<HPCCPacket> _packetdb;
+    static thread_local PacketDB<HPCCPacket> _packetdb;
 };
 
 class HPCCAck : public Packet {
@@ -102,8 +100,7 @@ public:
         p->set_route(flow,route,HPCCPacket::ACKSIZE,ackno);
         p->_type = HPCCACK;
         p->_is_header = true;
-        p->_ackno = ackno;
-        p->_path_len = 0;
+        p->_ackno = ackno;
         p->_direction = NONE;
         p->set_dst(destination);
         p->_int_hop = 0;
@@ -125,7 +122,7 @@ public:
 protected:
     seq_t _ackno;
     simtime_picosec _ts;
-    static PacketDB<HPCCAck> _packetdb;
+    static thread_local PacketDB<HPCCAck> _packetdb;
 };
 
 
@@ -157,7 +154,7 @@ public:
 protected:
     seq_t _ackno;
     simtime_picosec _ts;
-    static PacketDB<HPCCNack> _packetdb;
+    static thread_local PacketDB<HPCCNack> _packetdb;
 };
 
 
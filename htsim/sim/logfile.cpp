@@ -49,6 +49,25 @@ Logfile::addLogger(Logger& logger) {
 }
 
 
+void
+Logfile::branch(const string& filename) {
+    // the parent still has the inherited file open, so only read it
+    fclose(_logfile);
+    FILE* from = fopen(_logfilename.c_str(), "rbS");
+    _logfile = fopen(filename.c_str(), "wbS");
+    if (from == NULL || _logfile == NULL) {
+        cerr << "Failed to branch logfile " << _logfilename << " to " << filename << endl;
+        exit(1);
+    }
+    char buf[65536];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), from)) > 0) {
+        fwrite(buf, 1, n, _logfile);
+    }
+    fclose(from);
+    _logfilename = filename;
+}
+
 void 
 Logfile::write(const string& msg) {
     _preamble << msg << endl;
@@ -45,6 +45,9 @@ class Logfile {
     void writeRecord(uint32_t type, uint32_t id, uint32_t ev, 
                      double val1, double val2, double val3); // prepend uint64_t time
     void addLogger(Logger& logger);
+    // In a forked child: carry on logging to filename, starting with a
+    // copy of the records written so far.  Flush the file before forking.
+    void branch(const string& filename);
     simtime_picosec _starttime;
  private:
     EventList& _eventlist;
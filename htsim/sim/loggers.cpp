@@ -15,15 +15,15 @@ void LoggedManager::add_logged(Logged* logged) {
     _idmap.push_back(logged);
 }
 
-void LoggedManager::dump_idmap() {
-    std::ofstream fout("idmap.txt");
+void LoggedManager::dump_idmap(const string& filename) {
+    std::ofstream fout(filename);
     for (size_t i = 0; i < _idmap.size(); i++) {
         fout << _idmap[i]->get_id() << " " << _idmap[i]->_name << endl;
     }
     fout.close();
 }
 
-LoggedManager Logged::_logged_manager;
+thread_local LoggedManager Logged::_logged_manager;
 
 string Logger::event_to_str(RawLogEvent& event) {
     return event.str();
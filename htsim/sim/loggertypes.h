@@ -27,7 +27,7 @@ class LoggedManager {
 public:
     LoggedManager();
     void add_logged(Logged* logged);
-    void dump_idmap();
+    void dump_idmap(const string& filename);
 private:
     vector<Logged*> _idmap;
 };
@@ -43,11 +43,16 @@ class Logged {
     // usually things get their own IDs, but flows, for example, get associated with the sender ID
     void set_id(id_t id) {assert(id < LASTIDNUM); _log_id = id;}
     string _name;
-    static void dump_idmap() {_logged_manager.dump_idmap();}
+    static void dump_idmap(const string& filename = "idmap.txt") {_logged_manager.dump_idmap(filename);}
+ protected:
+    // for the few objects with a reserved ID (below FIRST_ID), which
+    // may be created at any point without shifting everyone else's
+    Logged(const string& name, id_t id) {assert(id < FIRST_ID); _name=name; _log_id=id; _logged_manager.add_logged(this);}
+    static const id_t FIRST_ID = 2; // 1 is Packet::_defaultFlow
  private:
     id_t _log_id;
-    static id_t LASTIDNUM;
-    static LoggedManager _logged_manager;
+    static thread_local id_t LASTIDNUM;
+    static thread_local LoggedManager _logged_manager;
 };
 
 class Logger {
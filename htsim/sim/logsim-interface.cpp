@@ -219,7 +219,7 @@ void LogSimInterface::htsim_simulate_until(int64_t until) {
 
     have_more = false;
 
-    //printf("While1 - Size eventlist %lu\n", _eventlist->getPendingSources().size());
+    //printf("While1 - Next event at %lu\n", _eventlist->nextEventTime());
 
     while (_eventlist->doNextEvent()) {
 
@@ -227,7 +227,7 @@ void LogSimInterface::htsim_simulate_until(int64_t until) {
             htsim_api->send_done_return_control = false;
             //printf("While2\n");
 
-            if (_eventlist->now() == _eventlist->getPendingSources().begin()->first) {
+            if (_eventlist->now() == _eventlist->nextEventTime()) {
               have_more = true;
             }
             break;
@@ -236,7 +236,7 @@ void LogSimInterface::htsim_simulate_until(int64_t until) {
         ////printf("While3\n");
         if (_latest_recv->updated) {
           this->reset_latest_receive();
-          if (_eventlist->now() == _eventlist->getPendingSources().begin()->first) {
+          if (_eventlist->now() == _eventlist->nextEventTime()) {
             have_more = true;
           }
             break;
@@ -245,7 +245,7 @@ void LogSimInterface::htsim_simulate_until(int64_t until) {
         //printf("While4\n");
         if (compute_if_finished) {
           //printf("While5\n");
-          if (_eventlist->now() == _eventlist->getPendingSources().begin()->first) {
+          if (_eventlist->now() == _eventlist->nextEventTime()) {
             have_more = true;
           }
             compute_if_finished = false;
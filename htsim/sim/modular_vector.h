@@ -14,6 +14,8 @@ class ModularVector {
         }
     }
     T& operator[](unsigned idx) { return buf[idx & (Size - 1)]; }
+    T* data() { return buf; }
+    static unsigned size() { return Size; }
 };
 
 #endif
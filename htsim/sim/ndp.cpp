@@ -78,6 +78,9 @@ NdpSrc::NdpSrc(NdpLogger* logger, TrafficLogger* pktlogger, EventList &eventlist
     _highest_sent = 0;
     _last_acked = 0;
     _dstaddr = UINT32_MAX;
+    _in_flight_count = 0;
+    _rtx_queue_size = 0;
+    _rtx_queue_head = 0;
 
     _sink = 0;
 
@@ -271,6 +274,7 @@ void NdpSrc::startflow(){
     cout << "startflow " <<  _flow._name <<  " CWND " << _cwnd << " rts " << _rts << " at " << timeAsUs(eventlist().now()) << endl;
     _highest_sent = 0;
     _last_acked = 0;
+    clear_send_records();
     
     _acked_packets = 0;
     _packets_sent = 0;
@@ -455,12 +459,12 @@ void NdpSrc::processRTS(NdpPacket& pkt){
     assert(pkt.bounced());
     pkt.unbounce(NdpPacket::ACKSIZE + _mss);
     
-    _sent_times.erase(pkt.seqno());
+    erase_sent_time(pkt.seqno());
     //resend from front of RTX
     //queue on any other path than the one we tried last time
     pkt.flow().logTraffic(pkt,*this,TrafficLogger::PKT_CREATE);
     //_rtx_queue.push_front(&pkt);
-    _rtx_queue[pkt.seqno()] = &pkt;
+    queue_for_rtx(&pkt);
 
     count_bounce(pkt.route()->path_id());
 
@@ -511,7 +515,7 @@ void NdpSrc::processNack(const NdpNack& nack){
 */
     
     bool last_packet = (nack.ackno() + _mss - 1) >= _flow_size;
-    _sent_times.erase(nack.ackno());
+    erase_sent_time(nack.ackno());
 
     count_nack(nack.path_id());
     if (nack.ecn_echo()) {
@@ -561,7 +565,7 @@ void NdpSrc::processNack(const NdpNack& nack){
     
     // need to add packet to rtx queue
     p->flow().logTraffic(*p,*this,TrafficLogger::PKT_CREATE);
-    _rtx_queue[seqno] = p;
+    queue_for_rtx(p);
 
     if (nack.pull() || _last_pull < _max_pull) {
         if (nack.pull())
@@ -595,9 +599,13 @@ void NdpSrc::processAck(const NdpAck& ack) {
       else
       printf("Receive ACK (----): %s\n", ack.pull_bitmap().to_string().c_str());
     */
-    log_rtt(_first_sent_times[ackno]);
-    _first_sent_times.erase(ackno);
-    _sent_times.erase(ackno);
+    sendRecord* rec = _send_records.find(pkt_num(ackno));
+    log_rtt(rec && rec->unacked ? rec->first_sent_time : 0);
+    if (rec) {
+        rec->unacked = false;
+        erase_sent_time(ackno);
+        release_acked();
+    }
 
     count_ack(path_id);
     if (ack.ecn_echo()) {
@@ -876,11 +884,16 @@ void NdpSrc::pull_packets(NdpPull::seq_t pull_no, NdpPull::seq_t pacer_no) {
 int NdpSrc::send_packet(NdpPull::seq_t pacer_no) {
     NdpPacket* p = NULL;
     int packets_sent = 0;
-    if (!_rtx_queue.empty()) {
+    if (_rtx_queue_size > 0) {
         // There are packets in the RTX queue for us to send
 
-        p = _rtx_queue.begin()->second;
-        _rtx_queue.erase(_rtx_queue.begin());
+        while (!_send_records.find(_rtx_queue_head)->rtx_pkt) {
+            _rtx_queue_head++;
+        }
+        sendRecord& queued = *_send_records.find(_rtx_queue_head);
+        p = queued.rtx_pkt;
+        queued.rtx_pkt = NULL;
+        _rtx_queue_size--;
         p->flow().logTraffic(*p,*this,TrafficLogger::PKT_SEND);
         p->set_ts(eventlist().now());
         p->set_pacerno(pacer_no);
@@ -921,12 +934,13 @@ int NdpSrc::send_packet(NdpPull::seq_t pacer_no) {
         //feeder queue isn't a FIFO but that would be hard to
         //implement in a real system, so this is a rough proxy.
         uint32_t service_time = q->serviceTime(*p);  
-        _sent_times[p->seqno()] = eventlist().now() + service_time;
+        set_sent_time(_send_records.at(pkt_num(p->seqno())), eventlist().now() + service_time);
         _packets_sent ++;
         _rtx_packets_sent++;
         update_rtx_time();
         if (_rtx_timeout == timeInf) {
             _rtx_timeout = eventlist().now() + _rto;
+            rtx_deadline_changed();
         }
     } else {
         // there are no packets in the RTX queue, so we'll send a new one
@@ -1008,11 +1022,14 @@ int NdpSrc::send_packet(NdpPull::seq_t pacer_no) {
         //implement in a real system, so this is a rough proxy.
         uint32_t service_time = q->serviceTime(*p);  
         //cout << "service_time2: " << service_time << endl;
-        _sent_times[p->seqno()] = eventlist().now() + service_time;
-        _first_sent_times[p->seqno()] = eventlist().now();
+        sendRecord& rec = _send_records.at(pkt_num(p->seqno()));
+        set_sent_time(rec, eventlist().now() + service_time);
+        rec.first_sent_time = eventlist().now();
+        rec.unacked = true;
 
         if (_rtx_timeout == timeInf) {
             _rtx_timeout = eventlist().now() + _rto;
+            rtx_deadline_changed();
         }
     }
     return packets_sent;
@@ -1021,58 +1038,111 @@ int NdpSrc::send_packet(NdpPull::seq_t pacer_no) {
 void 
 NdpSrc::update_rtx_time() {
     //simtime_picosec now = eventlist().now();
-    if (_sent_times.empty()) {
+    if (_in_flight_count == 0) {
         _rtx_timeout = timeInf;
         return;
     }
-    map<NdpPacket::seq_t, simtime_picosec>::iterator i;
     simtime_picosec first_senttime = timeInf;
-    for (i = _sent_times.begin(); i != _sent_times.end(); i++) {
-        simtime_picosec sent = i->second;
+    for (uint64_t n = _send_records.base(); n < _send_records.end(); n++) {
+        const sendRecord& rec = *_send_records.find(n);
+        if (!rec.in_flight)
+            continue;
+        simtime_picosec sent = rec.sent_time;
         if (sent < first_senttime || first_senttime == timeInf) {
             first_senttime = sent;
         }
     }
     _rtx_timeout = first_senttime + _rto;
+    rtx_deadline_changed();
 }
  
 void 
 NdpSrc::process_cumulative_ack(NdpPacket::seq_t cum_ackno) {
-    map<NdpPacket::seq_t, simtime_picosec>::iterator i, i_next;
-    i = _sent_times.begin();
-    while (i != _sent_times.end()) {
-        if (i->first <= cum_ackno) {
-            i_next = i; //juggling to keep i valid
-            i_next++;
-            _sent_times.erase(i);
-            i = i_next;
-        } else {
-            return;
-        }
+    for (uint64_t n = _send_records.base(); n < _send_records.end() && n * _mss + 1 <= cum_ackno; n++) {
+        erase_sent_time(n * _mss + 1);
     }
     //need to call update_rtx_time right after this!
 }
 
+void
+NdpSrc::set_sent_time(sendRecord& rec, simtime_picosec sent_time) {
+    if (!rec.in_flight)
+        _in_flight_count++;
+    rec.in_flight = true;
+    rec.sent_time = sent_time;
+}
+
+void
+NdpSrc::erase_sent_time(NdpPacket::seq_t seqno) {
+    sendRecord* rec = _send_records.find(pkt_num(seqno));
+    if (rec && rec->in_flight) {
+        rec->in_flight = false;
+        _in_flight_count--;
+    }
+}
+
+void
+NdpSrc::queue_for_rtx(NdpPacket* pkt) {
+    uint64_t n = pkt_num(pkt->seqno());
+    if (n < _send_records.base()) {
+        // already acked; only possible when retransmit_packet() has
+        // sent a second copy
+        pkt->free();
+        return;
+    }
+    sendRecord& rec = _send_records.at(n);
+    if (!rec.rtx_pkt)
+        _rtx_queue_size++;
+    rec.rtx_pkt = pkt;
+    if (_rtx_queue_size == 1 || n < _rtx_queue_head)
+        _rtx_queue_head = n;
+}
+
+/* forget everything sent so far, before sequence numbers start again
+   from the beginning */
+void
+NdpSrc::clear_send_records() {
+    for (uint64_t n = _send_records.base(); n < _send_records.end(); n++) {
+        NdpPacket* p = _send_records.find(n)->rtx_pkt;
+        if (p)
+            p->free();
+    }
+    _send_records = SeqWindow<sendRecord>();
+    _in_flight_count = 0;
+    _rtx_queue_size = 0;
+    _rtx_queue_head = 0;
+}
+
+/* forget the packets at the bottom of the window that have been acked
+   and are not waiting to be resent */
+void
+NdpSrc::release_acked() {
+    uint64_t n = _send_records.base();
+    while (n < _send_records.end()) {
+        const sendRecord& rec = *_send_records.find(n);
+        if (rec.in_flight || rec.unacked || rec.rtx_pkt)
+            break;
+        n++;
+    }
+    _send_records.advance(n);
+    if (_rtx_queue_head < n)
+        _rtx_queue_head = n;
+}
+
 void 
 NdpSrc::retransmit_packet() {
     //cout << "starting retransmit_packet\n";
     NdpPacket* p = NULL;
-    map<NdpPacket::seq_t, simtime_picosec>::iterator i, i_next;
-    i = _sent_times.begin();
     list <NdpPacket::seq_t> rtx_list;
-    // we build a list first because otherwise we're adding to and
-    // removing from _sent_times and the iterator gets confused
-    while (i != _sent_times.end()) {
-        if (i->second + _rto <= eventlist().now()) {
-            //cout << "_sent_time: " << timeAsUs(i->second) << "us rto " << timeAsUs(_rto) << "us now " << timeAsUs(eventlist().now()) << "us\n";
+    // we build a list first because sending adds to the window
+    for (uint64_t n = _send_records.base(); n < _send_records.end(); n++) {
+        sendRecord& rec = *_send_records.find(n);
+        if (rec.in_flight && rec.sent_time + _rto <= eventlist().now()) {
+            //cout << "_sent_time: " << timeAsUs(rec.sent_time) << "us rto " << timeAsUs(_rto) << "us now " << timeAsUs(eventlist().now()) << "us\n";
             //this one is due for retransmission
-            rtx_list.push_back(i->first);
-            i_next = i; //we're about to invalidate i when we call erase
-            i_next++;
-            _sent_times.erase(i);
-            i = i_next;
-        } else {
-            i++;
+            rtx_list.push_back(n * _mss + 1);
+            rec.in_flight = false;
+            _in_flight_count--;
         }
     }
     list <NdpPacket::seq_t>::iterator j;
@@ -1136,6 +1206,16 @@ NdpSrc::retransmit_packet() {
     update_rtx_time();
 }
 
+simtime_picosec NdpSrc::rtx_timer_due(simtime_picosec period) {
+#ifndef RESEND_ON_TIMEOUT
+    return NEVER;  // rtx_timer_hook does nothing
+#endif
+    // rtx_timer_hook acts up to a period early, and waits out the rest itself
+    if (_rtx_timeout == timeInf)
+        return NEVER;
+    return _rtx_timeout > period ? _rtx_timeout - period : 0;
+}
+
 void NdpSrc::rtx_timer_hook(simtime_picosec now, simtime_picosec period) {
 #ifndef RESEND_ON_TIMEOUT
     return;  // if we're using RTS, we shouldn't need to also use
@@ -1209,7 +1289,7 @@ void NdpSrc::print_stats() {
 
 /* Only use this constructor when there is only one for to this receiver */
 NdpSink::NdpSink(EventList& event, linkspeed_bps linkspeed, double pull_rate_modifier)
-    : DataReceiver("ndp_sink"),_cumulative_ack(0) , _total_received(0), _ooo(0)
+    : DataReceiver("ndp_sink"),_cumulative_ack(0) , _received_count(0), _total_received(0), _ooo(0)
 {
     _src = 0;
     _pacer = new NdpPullPacer(event, linkspeed, pull_rate_modifier);
@@ -1247,7 +1327,7 @@ NdpSink::NdpSink(EventList& event, linkspeed_bps linkspeed, double pull_rate_mod
 /* Use this constructor when there are multiple flows to one receiver
    - all the flows to one receiver need to share the same
    NdpPullPacer */
-NdpSink::NdpSink(NdpPullPacer* pacer) : DataReceiver("ndp_sink"),_cumulative_ack(0) , _total_received(0) , _ooo(0)
+NdpSink::NdpSink(NdpPullPacer* pacer) : DataReceiver("ndp_sink"),_cumulative_ack(0) , _received_count(0), _total_received(0) , _ooo(0)
 {
     _src = 0;
     _pacer = pacer;
@@ -1547,38 +1627,29 @@ void NdpSink::receivePacket(Packet& pkt) {
     if (seqno == _cumulative_ack+1) { // it's the next expected seq no
                 _cumulative_ack = seqno + size - 1;
                 // are there any additional received packets we can now ack?
-                while (!_received.empty() && (_received.front() == _cumulative_ack+1) ) {
-                        _received.pop_front();
-                        _cumulative_ack+= size;
-                        if (_buffer_logger) _buffer_logger->logBuffer(ReorderBufferLogger::BUF_DEQUEUE);
+                uint64_t run = _received.pop_run(_cumulative_ack / size);
+                _received_count -= run;
+                _cumulative_ack += run * size;
+                if (_buffer_logger) {
+                        for (uint64_t i = 0; i < run; i++) {
+                                _buffer_logger->logBuffer(ReorderBufferLogger::BUF_DEQUEUE);
+                        }
                 }
     } else if (seqno < _cumulative_ack+1) {
                 //must have been a bad retransmit
     } else { // it's not the next expected sequence number
-                if (_received.empty()) {
-                        _received.push_front(seqno);
+                uint64_t pkt_num = (seqno - 1) / size;
+                if (!_received.test(pkt_num)) { // otherwise it's a bad retransmit
+                        _received.set(pkt_num);
+                        _received_count++;
                         if (_buffer_logger) _buffer_logger->logBuffer(ReorderBufferLogger::BUF_ENQUEUE);
-                        
+
                         //commenting out the code below, probably copied from TCP and innacurate for NDP where reordering is expected
                         //it's a drop in this simulator there are no reorderings.
                         //_drops += (size + seqno-_cumulative_ack-1)/size;
-                } else if (seqno > _received.back()) { // likely case
-                        _received.push_back(seqno);
-                        if (_buffer_logger) _buffer_logger->logBuffer(ReorderBufferLogger::BUF_ENQUEUE);
-                } 
-                else { // uncommon case - it fills a hole
-                        list<uint64_t>::iterator i;
-                        for (i = _received.begin(); i != _received.end(); i++) {
-                                if (seqno == *i) break; // it's a bad retransmit
-                                if (seqno < (*i)) {
-                                        _received.insert(i, seqno);
-                                        if (_buffer_logger) _buffer_logger->logBuffer(ReorderBufferLogger::BUF_ENQUEUE);
-                                        break;
-                                }
-                    }
                 }
-                if (_ooo < _received.size())
-                        _ooo = _received.size();
+                if (_ooo < _received_count)
+                        _ooo = _received_count;
     }
     send_ack(ts, seqno, pacer_no, marked, pull);
 
@@ -2122,25 +2193,6 @@ void NdpRTSPacer::doNextEvent(){
 ////////////////////////////////////////////////////////////////
 
 NdpRtxTimerScanner::NdpRtxTimerScanner(simtime_picosec scanPeriod, EventList& eventlist)
-  : EventSource(eventlist,"RtxScanner"), 
-    _scanPeriod(scanPeriod)
-{
-    eventlist.sourceIsPendingRel(*this, 0);
-}
-
-void 
-NdpRtxTimerScanner::registerNdp(NdpSrc &tcpsrc)
+  : RtxTimerScanner(scanPeriod, 0, eventlist)
 {
-    _tcps.push_back(&tcpsrc);
-}
-
-void
-NdpRtxTimerScanner::doNextEvent() 
-{
-    simtime_picosec now = eventlist().now();
-    tcps_t::iterator i;
-    for (i = _tcps.begin(); i!=_tcps.end(); i++) {
-        (*i)->rtx_timer_hook(now,_scanPeriod);
-    }
-    eventlist().sourceIsPendingRel(*this, _scanPeriod);
 }
@@ -15,6 +15,9 @@
 #include "priopullqueue.h"
 #include "trigger.h"
 #include "eventlist.h"
+#include "rtx_timer.h"
+#include "seq_bitmap.h"
+#include "seq_window.h"
 
 #define timeInf 0
 #define NDP_PACKET_SCATTER
@@ -47,7 +50,7 @@ class ReceiptEvent {
     bool _is_header;
 };
 
-class NdpSrc : public PacketSink, public EventSource, public TriggerTarget {
+class NdpSrc : public PacketSink, public EventSource, public TriggerTarget, public RtxTimerClient {
     friend class NdpSink;
  public:
     NdpSrc(NdpLogger* logger, TrafficLogger* pktlogger, EventList &eventlist, bool rts = false, NdpRTSPacer* pacer = NULL);
@@ -86,6 +89,7 @@ class NdpSrc : public PacketSink, public EventSource, public TriggerTarget {
     void replace_route(Route* newroute);
 
     virtual void rtx_timer_hook(simtime_picosec now,simtime_picosec period);
+    virtual simtime_picosec rtx_timer_due(simtime_picosec period);
     
     //used by all routing strategies except SINGLE and ECMP_FIB
     void set_paths(vector<const Route*>* rt);
@@ -133,8 +137,18 @@ class NdpSrc : public PacketSink, public EventSource, public TriggerTarget {
     vector <int16_t> _avoid_score; //keeps path scores
     vector <bool> _bad_path; //keeps path scores
 
-    map<NdpPacket::seq_t, simtime_picosec> _sent_times;
-    map<NdpPacket::seq_t, simtime_picosec> _first_sent_times;
+    struct sendRecord {
+        sendRecord() : sent_time(0), first_sent_time(0), rtx_pkt(NULL), in_flight(false), unacked(false) {}
+        simtime_picosec sent_time;        // when it leaves the host queue, for the RTO
+        simtime_picosec first_sent_time;  // when it was first sent, for the RTT histogram
+        NdpPacket* rtx_pkt;               // queued for retransmission
+        bool in_flight;  // sent, and not yet acked, nacked or bounced
+        bool unacked;    // first_sent_time is set and no ACK has come back yet
+    };
+    // Send state by packet number ((seqno - 1) / _mss), from the oldest
+    // packet not yet acked up to the highest sent.
+    SeqWindow<sendRecord> _send_records;
+    uint32_t _in_flight_count;
 
     void print_stats();
 
@@ -207,6 +221,12 @@ class NdpSrc : public PacketSink, public EventSource, public TriggerTarget {
     void permute_paths();
     void update_rtx_time();
     void process_cumulative_ack(NdpPacket::seq_t cum_ackno);
+    inline uint64_t pkt_num(NdpPacket::seq_t seqno) const {return (seqno - 1) / _mss;}
+    void set_sent_time(sendRecord& rec, simtime_picosec sent_time);
+    void erase_sent_time(NdpPacket::seq_t seqno);
+    void queue_for_rtx(NdpPacket* pkt);
+    void release_acked();
+    void clear_send_records();
     inline void count_ack(int32_t path_id) {count_feedback(path_id, ACK);}
     inline void count_nack(int32_t path_id) {count_feedback(path_id, NACK);}
     inline void count_bounce(int32_t path_id) {count_feedback(path_id, BOUNCE);}
@@ -218,7 +238,11 @@ class NdpSrc : public PacketSink, public EventSource, public TriggerTarget {
     NdpPull::seq_t _max_pull;
     uint64_t _flow_size;  //The flow size in bytes.  Stop sending after this amount.
     simtime_picosec _stop_time;
-    map <NdpPacket::seq_t, NdpPacket*> _rtx_queue; //Packets queued for (hopefuly) imminent retransmission
+    // Packets queued for (hopefuly) imminent retransmission are the
+    // rtx_pkt of their records, sent lowest seqno first; none is below
+    // _rtx_queue_head
+    uint32_t _rtx_queue_size;
+    uint64_t _rtx_queue_head;
 };
 
 class NdpPullPacer;
@@ -243,7 +267,7 @@ class NdpSink : public PacketSink, public DataReceiver {
 
     NdpAck::seq_t _cumulative_ack; // the packet we have cumulatively acked
     uint32_t _drops;
-    uint64_t cumulative_ack() { return _cumulative_ack + _received.size()*9000;}
+    uint64_t cumulative_ack() { return _cumulative_ack + _received_count*9000;}
     uint64_t total_received() const { return _total_received;}
     uint32_t drops(){ return _src->_drops;}
     virtual const string& nodename() { return _nodename; }
@@ -253,7 +277,8 @@ class NdpSink : public PacketSink, public DataReceiver {
     void set_src(uint32_t s) {_srcaddr = s;}
     void set_end_trigger(Trigger& trigger);
 
-    list<NdpAck::seq_t> _received; // list of packets above a hole, that we've received
+    SeqBitmap _received; // packets above a hole that we've received, by packet number
+    uint32_t _received_count;
  
     NdpSrc* _src;
 
@@ -274,7 +299,7 @@ class NdpSink : public PacketSink, public DataReceiver {
 #endif
     static RouteStrategy _route_strategy;
 
-    uint64_t reorder_buffer_size() {return _received.size();};
+    uint64_t reorder_buffer_size() {return _received_count;};
     uint64_t reorder_buffer_max() {return _ooo;};
 
     void set_priority(int priority) {_priority = priority;}
@@ -415,15 +440,10 @@ class NdpRTSPacer : public EventSource {
 };
 
 
-class NdpRtxTimerScanner : public EventSource {
+class NdpRtxTimerScanner : public RtxTimerScanner {
  public:
     NdpRtxTimerScanner(simtime_picosec scanPeriod, EventList& eventlist);
-    void doNextEvent();
-    void registerNdp(NdpSrc &tcpsrc);
- private:
-    simtime_picosec _scanPeriod;
-    typedef list<NdpSrc*> tcps_t;
-    tcps_t _tcps;
+    void registerNdp(NdpSrc &tcpsrc) {registerClient(tcpsrc);}
 };
 
 #endif
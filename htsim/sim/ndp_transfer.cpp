@@ -105,6 +105,7 @@ NdpSinkTransfer::NdpSinkTransfer(NdpPullPacer* pace) : NdpSink(pace)
 void NdpSinkTransfer::reset(){
   _cumulative_ack = 0;
   _received.clear();
+  _received_count = 0;
 
   //queue logger sampling?
 }
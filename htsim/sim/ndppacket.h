@@ -40,7 +40,7 @@ public:
         p->_pacerno = pacerno;
         p->_retransmitted = retransmitted;
         p->_last_packet = last_packet;
-        p->_path_len = 0;
+        p->set_path_len(0);
         p->_direction = NONE;
         p->set_dst(destination);
         p->_trim_hop = {};
@@ -64,7 +64,7 @@ public:
         p->_retransmitted = retransmitted;
         p->_no_of_paths = no_of_paths;
         p->_last_packet = last_packet;
-        p->_path_len = route.size();
+        p->set_path_len(route.size());
         p->_trim_hop = {};
         p->_trim_direction = NONE;
         p->set_dst(destination);
@@ -120,7 +120,7 @@ protected:
     bool _last_packet;  // set to true in the last packet in a flow.
     std::optional<int32_t> _trim_hop;
     packet_direction _trim_direction;
-    static PacketDB<NdpPacket> _packetdb;
+    static thread_local PacketDB<NdpPacket> _packetdb;
 };
 
 class NdpAck : public Packet {
@@ -141,7 +141,7 @@ public:
         p->_pull = true;
         p->_pullno = pullno;
         p->_path_id = path_id;
-        p->_path_len = 0;
+        p->set_path_len(0);
         p->_direction = NONE;
         p->_ecn_echo = false;
         p->set_dst(destination);
@@ -175,7 +175,7 @@ protected:
     int32_t _path_id; //see comment in NdpPull
     bool _pull;
     bool _ecn_echo;
-    static PacketDB<NdpAck> _packetdb;
+    static thread_local PacketDB<NdpAck> _packetdb;
 };
 
 
@@ -199,7 +199,7 @@ public:
         p->_pullno = pullno;
         p->_path_id = path_id; // used to indicate which path the data
         // packet was trimmed on
-        p->_path_len = 0;
+        p->set_path_len(0);
         p->_ecn_echo = false;
         p->set_dst(destination);
         return p;
@@ -231,7 +231,7 @@ protected:
     int32_t _path_id;
     bool _pull;
     bool _ecn_echo;
-    static PacketDB<NdpNack> _packetdb;
+    static thread_local PacketDB<NdpNack> _packetdb;
 };
 
 class NdpRTS : public Packet {
@@ -282,7 +282,7 @@ protected:
     simtime_picosec _ts;
     seq_t _grants;
     int32_t _path_id; // indicates ??
-    static PacketDB<NdpRTS> _packetdb;
+    static thread_local PacketDB<NdpRTS> _packetdb;
 };
 
 
@@ -303,7 +303,7 @@ public:
         p->_ackno = ack->ackno();
         p->_cumulative_ack = ack->cumulative_ack();
         p->_pullno = ack->pullno();
-        p->_path_len = 0;
+        p->set_path_len(0);
         p->_direction = NONE;
         p->set_dst(ack->dst());
         return p;
@@ -322,7 +322,7 @@ public:
         p->_ackno = nack->ackno();
         p->_cumulative_ack = nack->cumulative_ack();
         p->_pullno = nack->pullno();
-        p->_path_len = 0;
+        p->set_path_len(0);
         p->_direction = NONE;
         p->set_dst(nack->dst());
         return p;
@@ -340,7 +340,7 @@ public:
         p->_pullno = pullno;
 
         //cout << "Creating PULL packet with pull no " << p->_pullno << " received pull no " << pullno << endl;
-        p->_path_len = 0;
+        p->set_path_len(0);
         p->_direction = NONE;
         p->set_dst(rts->dst());
         return p;
@@ -361,7 +361,7 @@ public:
 
         //cout << "Creating PULL2 packet with pull no " << p->_pullno << " received pull no " << pullno << endl;
 
-        p->_path_len = 0;
+        p->set_path_len(0);
         p->set_dst(destination);
         p->_direction = NONE;
         return p;
@@ -379,7 +379,7 @@ public:
         p->_ackno = cumack;
         p->_cumulative_ack = cumack;
         p->_pullno = pullno;
-        p->_path_len = 0;
+        p->set_path_len(0);
         p->set_dst(destination);
         p->_direction = NONE;
         return p;
@@ -403,7 +403,7 @@ protected:
     seq_t _cumulative_ack;
     seq_t _pullno;
     int32_t _path_id; // indicates ??
-    static PacketDB<NdpPull> _packetdb;
+    static thread_local PacketDB<NdpPull> _packetdb;
 };
 
 #endif
@@ -184,20 +184,11 @@ void NdpTunnelSrc::processNack(const NdpNack& nack){
     _sent_times.erase(nack.ackno());
 
     //_flight_size -= _mss;
-    //remove packet from _inflight
-    list <NdpTunnelPacket*>::iterator rit;
-
-    bool found = false;
-    for (rit = _inflight.begin(); rit!=_inflight.end(); ++rit){
-        p = (NdpTunnelPacket*)*rit;        
-        if (p->seqno() == nack.ackno()){
-            found = true;
-            _inflight.erase(rit);
-            break;
-        }
-    };
-
-    assert(found);
+    //remove packet from _inflight; it keeps its place until it's acked
+    sendRecord* rec = _inflight.find((nack.ackno() - 1) / _mss);
+    assert(rec && rec->in_flight);
+    rec->in_flight = false;
+    p = rec->pkt;
     assert(_flight_size>=0);
     
     //p = NdpTunnelPacket::newpkt(_flow, *_route, nack.ackno(), 0, _mss, true,
@@ -282,20 +273,17 @@ void NdpTunnelSrc::processAck(const NdpAck& ack) {
     //_flight_size -= _mss;
 
     //remove packet from _inflight
-    list<NdpTunnelPacket*>::iterator rit;
-
-    bool found = false;
-    NdpTunnelPacket* crt = NULL;
-    for (rit = _inflight.begin(); rit!=_inflight.end(); ++rit){
-        crt = (NdpTunnelPacket*)*rit;        
-        if (crt->seqno() == ackno){
-            found = true;
-            _inflight.erase(rit);
-            break;
-        }
-    };
-
-    assert(found);
+    sendRecord* rec = _inflight.find((ackno - 1) / _mss);
+    assert(rec && rec->in_flight);
+    NdpTunnelPacket* crt = rec->pkt;
+    rec->pkt = NULL;
+    rec->in_flight = false;
+    // forget the acked packets at the bottom of the window
+    uint64_t base = _inflight.base();
+    while (base < _inflight.end() && !_inflight.find(base)->pkt) {
+        base++;
+    }
+    _inflight.advance(base);
     crt->free();
     
     assert(_flight_size>=0);
@@ -467,7 +455,7 @@ int NdpTunnelSrc::send_packet(NdpPull::seq_t pacer_no) {
             p->set_route(*rt);
         }
 
-        _inflight.push_back(p);
+        _inflight.find((p->seqno() - 1) / _mss)->in_flight = true;
         _flight_size += _mss;
         
         p->sendOn();
@@ -477,6 +465,7 @@ int NdpTunnelSrc::send_packet(NdpPull::seq_t pacer_no) {
         update_rtx_time();
         if (_rtx_timeout == timeInf) {
             _rtx_timeout = eventlist().now() + _rto;
+            rtx_deadline_changed();
         }
         return 1;
     }
@@ -518,7 +507,9 @@ int NdpTunnelSrc::send_packet(NdpPull::seq_t pacer_no) {
         p->set_ts(eventlist().now());
       
         _flight_size += _mss;
-        _inflight.push_back(p);
+        sendRecord& rec = _inflight.at((p->seqno() - 1) / _mss);
+        rec.pkt = p;
+        rec.in_flight = true;
 
         //refcount to remember we saved this locally.
         p->save_state();
@@ -533,6 +524,7 @@ int NdpTunnelSrc::send_packet(NdpPull::seq_t pacer_no) {
       
         if (_rtx_timeout == timeInf) {
             _rtx_timeout = eventlist().now() + _rto;
+            rtx_deadline_changed();
         }
         return 1;
     }
@@ -565,6 +557,7 @@ NdpTunnelSrc::update_rtx_time() {
         }
     }
     _rtx_timeout = first_senttime + _rto;
+    rtx_deadline_changed();
 }
  
 void 
@@ -659,6 +652,16 @@ NdpTunnelSrc::retransmit_packet() {
     update_rtx_time();*/
 }
 
+simtime_picosec NdpTunnelSrc::rtx_timer_due(simtime_picosec period) {
+#ifndef RESEND_ON_TIMEOUT
+    return NEVER;  // rtx_timer_hook does nothing
+#endif
+    // rtx_timer_hook acts up to a period early, and waits out the rest itself
+    if (_rtx_timeout == timeInf)
+        return NEVER;
+    return _rtx_timeout > period ? _rtx_timeout - period : 0;
+}
+
 void NdpTunnelSrc::rtx_timer_hook(simtime_picosec now, simtime_picosec period) {
 #ifndef RESEND_ON_TIMEOUT
     return;  // if we're using RTS, we shouldn't need to also use
@@ -717,7 +720,7 @@ void NdpTunnelSrc::doNextEvent() {
 
 /* Only use this constructor when there is only one for to this receiver */
 NdpTunnelSink::NdpTunnelSink(EventList& event, linkspeed_bps linkspeed, double pull_rate_modifier)
-    : DataReceiver("ndp_sink"),_cumulative_ack(0) , _total_received(0) 
+    : DataReceiver("ndp_sink"),_cumulative_ack(0) , _received_count(0), _total_received(0) 
 {
     _src = 0;
     _pacer = new NdpTunnelPullPacer(event, linkspeed, pull_rate_modifier);
@@ -733,7 +736,7 @@ NdpTunnelSink::NdpTunnelSink(EventList& event, linkspeed_bps linkspeed, double p
 /* Use this constructor when there are multiple flows to one receiver
    - all the flows to one receiver need to share the same
    NdpTunnelPullPacer */
-NdpTunnelSink::NdpTunnelSink(NdpTunnelPullPacer* pacer) : DataReceiver("ndp_sink"),_cumulative_ack(0) , _total_received(0) 
+NdpTunnelSink::NdpTunnelSink(NdpTunnelPullPacer* pacer) : DataReceiver("ndp_sink"),_cumulative_ack(0) , _received_count(0), _total_received(0) 
 {
     _src = 0;
     _pacer = pacer;
@@ -876,19 +879,22 @@ void NdpTunnelSink::receivePacket(Packet& pkt) {
         //p->free();
   
         // are there any additional received packets we can now ack?
-        while (!_received.empty() && (_received.front()->seqno() == _cumulative_ack+1) ) {
-            NdpTunnelPacket * f = _received.front();
+        NdpTunnelPacket** next;
+        while ((next = _received.find(_cumulative_ack / size)) && *next) {
+            NdpTunnelPacket * f = *next;
 
             //cout << "Out of order delivery new PKT " << seqno << " ACK " << _cumulative_ack << " flow " << p->flow().flow_id() << endl;          
             inner = f->inner_packet();
             f->free();
 
-            _received.pop_front();
+            *next = NULL;
+            _received_count--;
 
             inner->sendOn();
             //send this packet ON!
             _cumulative_ack+= size;
         }
+        _received.advance(_cumulative_ack / size);
     } else if (seqno < _cumulative_ack+1) {
 
         assert(0);
@@ -897,20 +903,10 @@ void NdpTunnelSink::receivePacket(Packet& pkt) {
         p->inc_ref_count();
         p->inner_packet()->inc_ref_count();
       
-        if (_received.empty()) {
-            _received.push_front(p);
-        } else if (seqno > _received.back()->seqno()) { // likely case
-            _received.push_back(p);
-        } 
-        else { // uncommon case - it fills a hole
-            list<NdpTunnelPacket*>::iterator i;
-            for (i = _received.begin(); i != _received.end(); i++) {
-                if (seqno == (*i)->seqno()) break; // it's a bad retransmit
-                if (seqno < (*i)->seqno()) {
-                    _received.insert(i, p);
-                    break;
-                }
-            }
+        NdpTunnelPacket*& slot = _received.at((seqno - 1) / size);
+        if (!slot) { // otherwise it's a bad retransmit
+            slot = p;
+            _received_count++;
         }
     }
     send_ack(ts, seqno, pacer_no);
@@ -1223,25 +1219,6 @@ void NdpTunnelPullPacer::doNextEvent(){
 ////////////////////////////////////////////////////////////////
 
 NdpTunnelRtxTimerScanner::NdpTunnelRtxTimerScanner(simtime_picosec scanPeriod, EventList& eventlist)
-  : EventSource(eventlist,"RtxScanner"), 
-    _scanPeriod(scanPeriod)
+  : RtxTimerScanner(scanPeriod, 0, eventlist)
 {
-    eventlist.sourceIsPendingRel(*this, 0);
-}
-
-void 
-NdpTunnelRtxTimerScanner::registerNdp(NdpTunnelSrc &tcpsrc)
-{
-    _tcps.push_back(&tcpsrc);
-}
-
-void
-NdpTunnelRtxTimerScanner::doNextEvent() 
-{
-    simtime_picosec now = eventlist().now();
-    tcps_t::iterator i;
-    for (i = _tcps.begin(); i!=_tcps.end(); i++) {
-        (*i)->rtx_timer_hook(now,_scanPeriod);
-    }
-    eventlist().sourceIsPendingRel(*this, _scanPeriod);
 }
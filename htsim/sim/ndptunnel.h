@@ -16,6 +16,8 @@
 #include "ndptunnelpacket.h"
 #include "fairpullqueue.h"
 #include "eventlist.h"
+#include "rtx_timer.h"
+#include "seq_window.h"
 
 #define timeInf 0
 #define NDP_PACKET_SCATTER
@@ -26,7 +28,7 @@
 
 class NdpTunnelSink;
 
-class NdpTunnelSrc : public PacketSink, public EventSource {
+class NdpTunnelSrc : public PacketSink, public EventSource, public RtxTimerClient {
     friend class NdpTunnelSink;
 
 public:
@@ -51,6 +53,7 @@ public:
     void replace_route(Route* newroute);
 
     virtual void rtx_timer_hook(simtime_picosec now,simtime_picosec period);
+    virtual simtime_picosec rtx_timer_due(simtime_picosec period);
     void set_paths(vector<const Route*>* rt);
 
     // should really be private, but loggers want to see:
@@ -145,7 +148,14 @@ public:
 
     uint32_t _qs,_maxqs;
     list<Packet*> _queue;
-    list<NdpTunnelPacket*> _inflight;
+    struct sendRecord {
+        sendRecord() : pkt(NULL), in_flight(false) {}
+        NdpTunnelPacket* pkt;  // kept until it's acked
+        bool in_flight;        // not while it waits to be resent
+    };
+    // Packets by packet number ((seqno - 1) / _mss), from the oldest
+    // not yet acked up to the highest sent
+    SeqWindow<sendRecord> _inflight;
     list<NdpTunnelPacket*> _rtx_queue; //Packets queued for (hopefuly) imminent retransmission
 };
 
@@ -160,14 +170,16 @@ class NdpTunnelSink : public PacketSink, public DataReceiver {
     void receivePacket(Packet& pkt);
     NdpAck::seq_t _cumulative_ack; // the packet we have cumulatively acked
     uint32_t _drops;
-    uint64_t cumulative_ack() { return _cumulative_ack + _received.size()*9000;}
+    uint64_t cumulative_ack() { return _cumulative_ack + _received_count*9000;}
     uint64_t total_received() const { return _total_received;}
     uint32_t drops(){ return _src->_drops;}
     virtual const string& nodename() { return _nodename; }
     void increase_window() {_pull_no++;} 
     static void setRouteStrategy(RouteStrategy strat) {_route_strategy = strat;}
 
-    list<NdpTunnelPacket*> _received; // list of packets above a hole, that we've received
+    // packets above a hole that we've received, by packet number
+    SeqWindow<NdpTunnelPacket*> _received;
+    uint32_t _received_count;
  
     NdpTunnelSrc* _src;
 
@@ -254,15 +266,10 @@ class NdpTunnelPullPacer : public EventSource {
 };
 
 
-class NdpTunnelRtxTimerScanner : public EventSource {
+class NdpTunnelRtxTimerScanner : public RtxTimerScanner {
  public:
     NdpTunnelRtxTimerScanner(simtime_picosec scanPeriod, EventList& eventlist);
-    void doNextEvent();
-    void registerNdp(NdpTunnelSrc &tcpsrc);
- private:
-    simtime_picosec _scanPeriod;
-    typedef list<NdpTunnelSrc*> tcps_t;
-    tcps_t _tcps;
+    void registerNdp(NdpTunnelSrc &tcpsrc) {registerClient(tcpsrc);}
 };
 
 #endif
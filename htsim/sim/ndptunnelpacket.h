@@ -34,7 +34,6 @@ public:
         p->_pacerno = pacerno;
         p->_retransmitted = retransmitted;
         p->_last_packet = last_packet;
-        p->_path_len = 0;
 
         p->_encap_packet = encap;
         encap->inc_ref_count();
@@ -57,7 +56,6 @@ public:
         p->_retransmitted = retransmitted;
         p->_no_of_paths = no_of_paths;
         p->_last_packet = last_packet;
-        p->_path_len = route.size();
 
         p->_encap_packet = encap;
         encap->inc_ref_count();
@@ -72,14 +70,14 @@ public:
     void free() {_encap_packet->free();_packetdb.freePacket(this);}
 
     void save_state(){
-        _oldnexthop = _nexthop;
-        _oldsize = _size;
+        cold().oldnexthop = _nexthop;
+        _cold->oldsize = _size;
     }
 
     void load_state(){
         _is_header = false;
-        _nexthop = _oldnexthop;
-        _size = _oldsize;
+        _nexthop = _cold->oldnexthop;
+        _size = _cold->oldsize;
     }
     
     virtual ~NdpTunnelPacket(){}
@@ -116,7 +114,7 @@ protected:
     Packet* _encap_packet;
     bool _last_packet;  // set to true in the last packet in a flow.
     
-    static PacketDB<NdpTunnelPacket> _packetdb;
+    static thread_local PacketDB<NdpTunnelPacket> _packetdb;
 };
 
 #endif
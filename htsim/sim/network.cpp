@@ -1,10 +1,15 @@
 // -*- c-basic-offset: 4; indent-tabs-mode: nil -*- 
 #include "network.h"
+#include <algorithm>
+#include "compositequeue.h"
+#include "pipe.h"
 
 #define DEFAULTDATASIZE 1500
-int Packet::_data_packet_size = DEFAULTDATASIZE;
-bool Packet::_packet_size_fixed = false;
-PacketFlow Packet::_defaultFlow(nullptr);
+thread_local int Packet::_data_packet_size = DEFAULTDATASIZE;
+thread_local bool Packet::_packet_size_fixed = false;
+// constructed on first use in each thread; it has reserved IDs so that
+// this doesn't renumber the objects created before
+thread_local PacketFlow Packet::_defaultFlow(PacketFlow::DEFAULT_FLOW);
 
 // use set_attrs only when we want to do a late binding of the route -
 // otherwise use set_route or set_rg
@@ -12,10 +17,8 @@ void
 Packet::set_attrs(PacketFlow& flow, int pkt_size, packetid_t id){
     _flow = &flow;
     _size = pkt_size;
-    _oldsize = pkt_size;
     _id = id;
     _nexthop = 0;
-    _oldnexthop = 0;
     //_detour = NULL;
     _route = 0;
     _is_header = 0;
@@ -28,10 +31,8 @@ Packet::set_route(PacketFlow& flow, const Route &route, int pkt_size,
                   packetid_t id){
     _flow = &flow;
     _size = pkt_size;
-    _oldsize = pkt_size;
     _id = id;
     _nexthop = 0;
-    _oldnexthop = 0;    
     //_detour = NULL;
     _route = &route;
     _is_header = 0;
@@ -52,6 +53,32 @@ Packet::set_route(const Route *route){
     //_detour = NULL;
 }
 
+// Hand pkt to sink.  In a fat tree most hops alternate between
+// CompositeQueues and Pipes, which are called without virtual dispatch.
+// Only sinks of exactly those classes are, so a subclass that overrides
+// receivePacket() still gets its packets.
+static inline void
+deliver(PacketSink* sink, Packet& pkt) {
+    if (sink->_sink_kind == PacketSink::SINK_UNKNOWN) {
+        if (typeid(*sink) == typeid(Pipe))
+            sink->_sink_kind = PacketSink::SINK_PIPE;
+        else if (typeid(*sink) == typeid(CompositeQueue))
+            sink->_sink_kind = PacketSink::SINK_COMPOSITE_QUEUE;
+        else
+            sink->_sink_kind = PacketSink::SINK_GENERIC;
+    }
+    switch (sink->_sink_kind) {
+    case PacketSink::SINK_PIPE:
+        static_cast<Pipe*>(sink)->Pipe::receivePacket(pkt);
+        break;
+    case PacketSink::SINK_COMPOSITE_QUEUE:
+        static_cast<CompositeQueue*>(sink)->CompositeQueue::receivePacket(pkt);
+        break;
+    default:
+        sink->receivePacket(pkt);
+    }
+}
+
 PacketSink *
 Packet::sendOn() {
     PacketSink* nextsink;
@@ -80,7 +107,7 @@ Packet::sendOn() {
         assert(0);
     }
     //cout << "sendOn nextsink is: " << nextsink->nodename() << " pathid " << _pathid << endl;
-    nextsink->receivePacket(*this);
+    deliver(nextsink, *this);
     return nextsink;
 }
 
@@ -143,6 +170,42 @@ void
 Packet::free() {
 }
 
+void
+Packet::checkpoint(Checkpoint& cp) {
+    // the type was saved by the Checkpoint, and the allocator that
+    // restores the packet sets it and takes the reference
+    if (cp.saving()) {
+        if (_refcount != 1)
+            cp.unsupported("a packet held in more than one place");
+        if (_cold && _cold->ingressqueue)
+            cp.unsupported("a packet that holds lossless input queue credit");
+        if (!_route && _next_routed_hop)
+            cp.unsupported("a packet routed hop by hop");
+    }
+    cp.io(_size);
+    cp.io(_is_header);
+    cp.io(_bounced);
+    cp.io(_flags);
+    cp.io(_dst);
+    cp.io(_pathid);
+    cp.io(_direction);
+    cp.io(_route);
+    cp.io(_nexthop);
+    cp.io(_id);
+    cp.io(_flow);
+    bool has_cold = _cold != NULL;
+    cp.io(has_cold);
+    if (has_cold) {
+        cp.io(cold().oldsize);
+        cp.io(_cold->oldnexthop);
+        cp.io(_cold->path_len);
+    } else if (cp.restoring() && _cold) {
+        *_cold = ColdState();
+    }
+    if (cp.restoring())
+        _next_routed_hop = NULL;
+}
+
 string
 Packet::str() const {
     string s;
@@ -261,7 +324,8 @@ Packet::str() const {
 
 // flow ids above this are dynamically allocated; ones less than this can be manually allocated
 #define FLOW_ID_DYNAMIC_BASE 1000000000
-flowid_t PacketFlow::_max_flow_id = FLOW_ID_DYNAMIC_BASE;
+// the first dynamic flow id belongs to Packet::_defaultFlow
+thread_local flowid_t PacketFlow::_max_flow_id = FLOW_ID_DYNAMIC_BASE + 1;
 
 PacketFlow::PacketFlow(TrafficLogger* logger)
     : Logged("PacketFlow"),
@@ -270,6 +334,13 @@ PacketFlow::PacketFlow(TrafficLogger* logger)
     _flow_id = _max_flow_id++;
 }
 
+PacketFlow::PacketFlow(default_flow_t)
+    : Logged("PacketFlow", 1), Checkpointable(UNREGISTERED),
+      _logger(NULL)
+{
+    _flow_id = FLOW_ID_DYNAMIC_BASE;
+}
+
 void PacketFlow::set_flowid(flowid_t id) {
     if (id >= FLOW_ID_DYNAMIC_BASE) {
         cerr << "Illegal flow ID - manually allocation must be less than dynamic base\n";
@@ -320,4 +391,51 @@ void print_route(const Route& route) {
     cout << endl;
 }
 
-Logged::id_t Logged::LASTIDNUM = 1;
+thread_local Logged::id_t Logged::LASTIDNUM = Logged::FIRST_ID;
+
+thread_local uint64_t PacketDBBase::_cap = 0;
+
+PacketDBBase::PacketDBBase(const type_info& type, size_t packet_bytes)
+    : _type(type), _packet_bytes(packet_bytes), _constructed(0), _slots(0)
+{
+    registry().push_back(this);
+}
+
+PacketDBBase::~PacketDBBase()
+{
+    vector<PacketDBBase*>& dbs = registry();
+    dbs.erase(find(dbs.begin(), dbs.end(), this));
+}
+
+vector<PacketDBBase*>&
+PacketDBBase::registry()
+{
+    static thread_local vector<PacketDBBase*> dbs;
+    return dbs;
+}
+
+void
+PacketDBBase::report(ostream& os)
+{
+    os << "Packets by type: live peak allocated (bytes live peak allocated)" << endl;
+    uint64_t live_bytes = 0, peak_bytes = 0, slab_bytes = 0;
+    for (PacketDBBase* db : registry()) {
+        uint64_t live = db->_constructed - db->free_count();
+        os << "  " << Checkpoint::class_name(db->_type) << " " << live << " " << db->_constructed
+           << " " << db->_slots << " (" << live * db->_packet_bytes << " "
+           << db->_constructed * db->_packet_bytes << " " << db->_slots * db->_packet_bytes << ")" << endl;
+        live_bytes += live * db->_packet_bytes;
+        peak_bytes += db->_constructed * db->_packet_bytes;
+        slab_bytes += db->_slots * db->_packet_bytes;
+    }
+    os << "  total bytes " << live_bytes << " " << peak_bytes << " " << slab_bytes << endl;
+}
+
+void
+PacketDBBase::cap_exceeded()
+{
+    cerr << "More than " << _cap << " " << Checkpoint::class_name(_type)
+         << " packets are in use at once; is something not freeing them?" << endl;
+    report(cerr);
+    abort();
+}
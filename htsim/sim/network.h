@@ -4,9 +4,12 @@
 
 #include <vector>
 #include <iostream>
+#include <new>
+#include <typeinfo>
 #include "config.h"
 #include "loggertypes.h"
 #include "route.h"
+#include "checkpoint.h"
 
 class Packet;
 class PacketFlow;
@@ -25,18 +28,23 @@ class DataReceiver : public Logged {
     virtual uint32_t drops()=0;
 };
 
-class PacketFlow : public Logged {
+class PacketFlow : public Logged, public Checkpointable {
     friend class Packet;
  public:
     PacketFlow(TrafficLogger* logger);
     virtual ~PacketFlow() {};
+    // only a target for the pointers in packets
+    virtual void checkpoint(Checkpoint& cp) {}
+    virtual const type_info& checkpoint_class() const {return typeid(PacketFlow);}
     void set_logger(TrafficLogger* logger);
     void logTraffic(Packet& pkt, Logged& location, TrafficLogger::TrafficEvent ev);
     void set_flowid(flowid_t id);
     inline flowid_t flow_id() const {return _flow_id;}
     bool log_me() const {return _logger != NULL;}
  protected:
-    static packetid_t _max_flow_id;
+    typedef enum {DEFAULT_FLOW} default_flow_t;
+    PacketFlow(default_flow_t); // Packet::_defaultFlow
+    static thread_local packetid_t _max_flow_id;
     flowid_t _flow_id;
     TrafficLogger* _logger;
 };
@@ -72,7 +80,7 @@ class Packet {
     
     /* empty constructor; Packet::set must always be called as
        well. It's a separate method, for convenient reuse */
-    Packet() {_is_header = false; _bounced = false; _type = IP; _flags = 0; _refcount = 0; _dst = UINT32_MAX; _pathid = UINT32_MAX; _direction = NONE; _ingressqueue = NULL;} 
+    Packet() {_is_header = false; _bounced = false; _type = IP; _flags = 0; _refcount = 0; _dst = UINT32_MAX; _pathid = UINT32_MAX; _direction = NONE; _cold = NULL;} 
 
     /* say "this packet is no longer wanted". (doesn't necessarily
        destroy it, so it can be reused) */
@@ -108,7 +116,7 @@ class Packet {
     bool header_only() const {return _is_header;}
     bool bounced() const {return _bounced;}
     PacketFlow& flow() const {return *_flow;}
-    virtual ~Packet() {};
+    virtual ~Packet() {delete _cold;};
     inline const packetid_t id() const {return _id;}
     inline uint32_t flow_id() const {return _flow->flow_id();}
     inline uint32_t dst() const {return _dst;}
@@ -132,7 +140,9 @@ class Packet {
     }
     virtual void bounce();
     virtual void unbounce(uint16_t pktsize);
-    inline uint32_t path_len() const {return _path_len;}
+    inline uint32_t path_len() const {return _cold ? _cold->path_len : 0;}
+    // only packets used with BCube priority routing set a length
+    inline void set_path_len(uint32_t len) {if (len || _cold) cold().path_len = len;}
 
     virtual void go_up(){ if (_direction == NONE) _direction = UP; else if (_direction == DOWN) abort();}
     virtual void go_down(){ if (_direction == UP) _direction = DOWN; else if (_direction == NONE) abort();}
@@ -162,56 +172,73 @@ class Packet {
     virtual void set_route(const Route *route=nullptr);
     virtual void set_route(PacketFlow& flow, const Route &route, int pkt_size, packetid_t id);
 
-    void set_ingress_queue(LosslessInputQueue* t){assert(!_ingressqueue); _ingressqueue = t;}
-    LosslessInputQueue* get_ingress_queue(){assert(_ingressqueue); return _ingressqueue;}
-    void clear_ingress_queue(){assert(_ingressqueue); _ingressqueue = NULL;}
+    void set_ingress_queue(LosslessInputQueue* t){assert(!_cold || !_cold->ingressqueue); cold().ingressqueue = t;}
+    LosslessInputQueue* get_ingress_queue(){assert(_cold && _cold->ingressqueue); return _cold->ingressqueue;}
+    void clear_ingress_queue(){assert(_cold && _cold->ingressqueue); _cold->ingressqueue = NULL;}
 
     //    void set_detour(PacketSink* n, int rewind) {_detour = n;_nexthop -= rewind;}
     
     string str() const;
+
+    // Subclasses that can be checkpointed extend this with their own
+    // fields and register an allocator with Checkpoint::PacketType
+    virtual void checkpoint(Checkpoint& cp);
  protected:
     void set_attrs(PacketFlow& flow, int pkt_size, packetid_t id);
 
-    static int _data_packet_size; // default size of a TCP or NDP data packet,
+    static thread_local int _data_packet_size; // default size of a TCP or NDP data packet,
                                   // measured in bytes
-    static bool _packet_size_fixed; //prevent foot-shooting
-    
-    packet_type _type;
-    
-    uint16_t _size,_oldsize;
-    
-    
-    bool _is_header;
-    bool _bounced; // packet has hit a full queue, and is being bounced back to the sender
-    uint32_t _flags; // used for ECN & friends
+    static thread_local bool _packet_size_fixed; //prevent foot-shooting
+
+    // State that few packets ever use, kept out of the way of the
+    // fields read at every hop.  It is allocated the first time it is
+    // needed and stays with the packet when the PacketDB reuses it.
+    struct ColdState {
+        ColdState() : oldsize(0), oldnexthop(0), ingressqueue(NULL), path_len(0) {}
+        uint16_t oldsize;      // saved while a packet is tunnelled
+        uint32_t oldnexthop;
+        LosslessInputQueue* ingressqueue; // holds credit at a lossless input queue
+        uint32_t path_len; // length of the path in hops - used in BCube priority routing with NDP
+    };
+    ColdState& cold() {if (!_cold) _cold = new ColdState(); return *_cold;}
 
-    uint32_t _dst; //used for packets that do not have a route in switched networks.    
-    uint32_t _pathid;  //used for ECMP hashing.
-    packet_direction _direction; //used to avoid loop in FatTrees.   
+    // The fields below are read as the packet is forwarded at every
+    // hop, and fit in the first cache line with the vtable pointer.
 
     // A packet can contain a route or a routegraph, but not both.
     // Eventually switch over entirely to RouteGraph?
     const Route* _route;
 
+    //used when using routing tables in switches, i.e. the packet has no route.
+    PacketSink* _next_routed_hop;
+
+    PacketFlow* _flow{nullptr};
+    packetid_t _id;
+
     //PacketSink* _detour;
-    uint32_t _nexthop,_oldnexthop;
+    uint32_t _nexthop;
+    uint32_t _flags; // used for ECN & friends
+    uint16_t _size;
+
+    bool _is_header;
+    bool _bounced; // packet has hit a full queue, and is being bounced back to the sender
 
     //used for tunneling purposes when one packet can be referenced by multiple classes
     uint8_t _refcount;
 
-    //used when using routing tables in switches, i.e. the packet has no route.
-    PacketSink* _next_routed_hop;
+    packet_type _type;
 
-    packetid_t _id;
-    PacketFlow* _flow{nullptr};
-    static PacketFlow _defaultFlow;
-    LosslessInputQueue* _ingressqueue;
-    uint32_t _path_len; // length of the path in hops - used in BCube priority routing with NDP
+    uint32_t _dst; //used for packets that do not have a route in switched networks.    
+    uint32_t _pathid;  //used for ECMP hashing.
+    packet_direction _direction; //used to avoid loop in FatTrees.   
+
+    ColdState* _cold;
+    static thread_local PacketFlow _defaultFlow;
 };
 
 class PacketSink {
  public:
-    PacketSink() { _remoteEndpoint = NULL; }
+    PacketSink() { _remoteEndpoint = NULL; _sink_kind = SINK_UNKNOWN; }
     virtual ~PacketSink() {}
     virtual void receivePacket(Packet& pkt) =0;
     virtual void receivePacket(Packet& pkt,VirtualQueue* previousHop) {
@@ -225,6 +252,12 @@ class PacketSink {
     virtual const string& nodename()=0;
 
     PacketSink* _remoteEndpoint;
+
+    // Packet::sendOn() calls the sinks most packets pass through
+    // directly rather than through the vtable.  It works out which
+    // kind a sink is the first time a packet is sent to it.
+    enum sink_kind_t : uint8_t {SINK_UNKNOWN, SINK_GENERIC, SINK_PIPE, SINK_COMPOSITE_QUEUE};
+    sink_kind_t _sink_kind;
 };
 
 // NIC mostly exists to enable logging of an EqdsNIC, particularly
@@ -256,34 +289,65 @@ public:
 // have been allocated -- that way we don't need a malloc for every
 // new packet, we can just reuse old packets. Care, though -- the set()
 // method will need to be invoked properly for each new/reused packet
+//
+// Packets are carved out of cache-line-aligned slabs of about
+// SLAB_BYTES, so those of one type sit together in memory, and are
+// never given back: a freed packet goes on the freelist for reuse.
+// Since the freelist is always used first, the number of packets ever
+// constructed is also the most that were live at once.
+
+// What every PacketDB on this thread has allocated, for reporting, and
+// an optional cap on live packets to catch protocols that leak them.
+class PacketDBBase {
+ public:
+    PacketDBBase(const type_info& type, size_t packet_bytes);
+    virtual ~PacketDBBase();
+
+    // live, peak and allocated packets and bytes for each packet type
+    // used so far
+    static void report(ostream& os);
+    // abort when more than cap packets of one type are live at once;
+    // 0 (the default) means no cap
+    static void set_cap(uint64_t cap) {_cap = cap;}
+
+    static const size_t SLAB_BYTES = 64 * 1024;
+    static const size_t CACHE_LINE = 64;
+ protected:
+    [[noreturn]] void cap_exceeded();
+    virtual uint64_t free_count() const = 0;
+
+    static thread_local uint64_t _cap;
+    const type_info& _type;
+    size_t _packet_bytes;
+    uint64_t _constructed; // packets handed out at least once
+    uint64_t _slots;       // room for packets in the slabs
+ private:
+    static vector<PacketDBBase*>& registry();
+};
 
 template<class P>
-class PacketDB {
+class PacketDB : public PacketDBBase {
  public:
-    PacketDB() : _alloc_count(0) {}
+    PacketDB() : PacketDBBase(typeid(P), sizeof(P)), _next(NULL), _slab_end(NULL) {}
     ~PacketDB() {
+        // packets still in use at exit are left alone, with their slabs
+        if (_constructed != _freelist.size())
+            return;
         for (P* p : _freelist)
-            delete p;
-        //cout << "Pkt count: " << _alloc_count << endl;
-        //cout << "Pkt mem used: " << _alloc_count * sizeof(P) << endl;
+            p->~P();
+        for (P* slab : _slabs)
+            ::operator delete(slab, align_val_t(CACHE_LINE));
     }
     P* allocPacket() {
+        P* p;
         if (_freelist.empty()) {
-            P* p = new P();
-            p->inc_ref_count();
-            /*
-            if (_alloc_count == 0) {
-                cout << "Packet size: " << sizeof(P) << endl;
-            }
-            */
-            _alloc_count++;
-            return p;
+            p = newPacket();
         } else {
-            P* p = _freelist.back();
+            p = _freelist.back();
             _freelist.pop_back();
-            p->inc_ref_count();
-            return p;
         }
+        p->inc_ref_count();
+        return p;
     };
     void freePacket(P* pkt) {
         assert(pkt->ref_count()>=1);
@@ -294,8 +358,30 @@ class PacketDB {
     };
 
  protected:
+    virtual uint64_t free_count() const {return _freelist.size();}
+
     vector<P*> _freelist; // Irek says it's faster with vector than with list
-    int _alloc_count;
+ private:
+    P* newPacket() {
+        if (_cap && _constructed >= _cap)
+            cap_exceeded();
+        if (_next == _slab_end) {
+            size_t n = sizeof(P) < SLAB_BYTES ? SLAB_BYTES / sizeof(P) : 1;
+            P* slab = static_cast<P*>(::operator new(n * sizeof(P), align_val_t(CACHE_LINE)));
+            _slabs.push_back(slab);
+            _next = slab;
+            _slab_end = slab + n;
+            _slots += n;
+        }
+        P* p = new (_next) P();
+        _next++;
+        _constructed++;
+        return p;
+    }
+
+    vector<P*> _slabs;
+    P* _next;      // the next slot in the newest slab
+    P* _slab_end;
 };
 
 
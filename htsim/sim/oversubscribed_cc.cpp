@@ -2,12 +2,12 @@
 #include "oversubscribed_cc.h"
 #include "uec.h"
 
-simtime_picosec OversubscribedCC::_base_rtt = timeFromUs(12u);
-double OversubscribedCC::_target_congestion = 0.3;
-double OversubscribedCC::_Ai = .01;
-double OversubscribedCC::_Md = 0.5;
-double OversubscribedCC::_min_rate = 0.01;
-double OversubscribedCC::_alpha = 0.5;
+thread_local simtime_picosec OversubscribedCC::_base_rtt = timeFromUs(12u);
+thread_local double OversubscribedCC::_target_congestion = 0.3;
+thread_local double OversubscribedCC::_Ai = .01;
+thread_local double OversubscribedCC::_Md = 0.5;
+thread_local double OversubscribedCC::_min_rate = 0.01;
+thread_local double OversubscribedCC::_alpha = 0.5;
 
 OversubscribedCC::OversubscribedCC(EventList& eventList,UecPullPacer* pacer)
     : EventSource(eventList, "OversubscribedCC"),
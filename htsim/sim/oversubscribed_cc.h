@@ -35,10 +35,10 @@ public:
             _trimmed_other++;
     }
 
-    static double _target_congestion;
-    static double _Ai, _Md, _alpha;
-    static simtime_picosec _base_rtt;    
-    static double _min_rate;
+    static thread_local double _target_congestion;
+    static thread_local double _Ai, _Md, _alpha;
+    static thread_local simtime_picosec _base_rtt;    
+    static thread_local double _min_rate;
 
     inline static void setOversubscriptionRatio(double r) {
         _min_rate = 0.9/r;
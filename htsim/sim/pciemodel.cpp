@@ -2,8 +2,8 @@
 #include "pciemodel.h"
 #include "uec.h"
 
-mem_b PCIeModel::_max_pcie_backlog = 5000000;
-mem_b PCIeModel::_min_threshold = 1000000;
+thread_local mem_b PCIeModel::_max_pcie_backlog = 5000000;
+thread_local mem_b PCIeModel::_min_threshold = 1000000;
 
 static unsigned pktByteTimes(unsigned size) {
     // IPG (96 bit times) + preamble + SFD + ether header + FCS = 38B
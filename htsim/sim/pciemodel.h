@@ -29,8 +29,8 @@ public:
 
     void adjustCreditRate();
 
-    static mem_b _max_pcie_backlog;
-    static mem_b _min_threshold;
+    static thread_local mem_b _max_pcie_backlog;
+    static thread_local mem_b _min_threshold;
 
 private:
     const simtime_picosec _pktTime;
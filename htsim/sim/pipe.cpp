@@ -72,3 +72,23 @@ Pipe::doNextEvent() {
         _eventlist.sourceIsPending(*this, nexteventtime);
     }
 }
+
+void
+Pipe::checkpoint(Checkpoint& cp) {
+    size_t n = cp.io_size(_count);
+    if (cp.restoring()) {
+        _size = 16;
+        while ((size_t)_size <= n) {
+            _size *= 2;
+        }
+        _inflight_v.assign(_size, pktrecord_t{0, NULL});
+        _count = n;
+        _next_pop = 0;
+        _next_insert = n;
+    }
+    for (int i = 0; i < _count; i++) {
+        pktrecord_t& r = _inflight_v[(_next_pop + i) % _size];
+        cp.io(r.time);
+        cp.io(r.pkt);
+    }
+}
@@ -19,7 +19,7 @@ typedef struct pktrecord {
     Packet* pkt;
 } pktrecord_t;
 
-class Pipe : public EventSource, public PacketSink, public Drawable {
+class Pipe : public EventSource, public PacketSink, public Drawable, public Checkpointable {
  public:
     Pipe(simtime_picosec delay, EventList& eventlist=EventList::getTheEventList());
     virtual void receivePacket(Packet& pkt); // inherited from PacketSink
@@ -34,6 +34,12 @@ class Pipe : public EventSource, public PacketSink, public Drawable {
     PacketSink* next() const {
             return _next_sink;
     }
+    // packets in flight, oldest first
+    int count() const {return _count;}
+    Packet* inflight(int i) const {return _inflight_v[(_next_pop + i) % _size].pkt;}
+
+    virtual void checkpoint(Checkpoint& cp);
+    virtual const type_info& checkpoint_class() const {return typeid(Pipe);}
 protected:
     string _nodename;
     //typedef pair<simtime_picosec,Packet*> pktrecord_t;
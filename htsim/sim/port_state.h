@@ -0,0 +1,69 @@
+// -*- c-basic-offset: 4; indent-tabs-mode: nil -*-
+#ifndef PORT_STATE_H
+#define PORT_STATE_H
+
+/*
+ * The state of a switch's egress ports that adaptive routing compares
+ * them by, kept as one array per field rather than reached through each
+ * candidate's FibEntry, Route and queue.
+ *
+ * A queue that has been given a port here updates its quantized queue
+ * size as packets arrive and leave, and a lossless queue its pause
+ * state as pauses arrive; the switch counts the flows it places.
+ * Utilization falls while a link is idle, with no packet to update it,
+ * so it is sampled from the queue when a comparison needs it.
+ *
+ * key() packs the fields a comparison uses into one number that is
+ * smaller for a better port, so picking among candidates is a min over
+ * an array of keys.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+class BaseQueue;
+
+class PortStates {
+public:
+    enum field {PAUSE = 1, QUEUE = 2, BANDWIDTH = 4, FLOWS = 8};
+
+    uint32_t add(BaseQueue* q) {
+        _queues.push_back(q);
+        _queuesize.push_back(0);
+        _utilization.push_back(0);
+        _paused.push_back(0);
+        _flows.push_back(0);
+        return _queues.size() - 1;
+    }
+    size_t size() const {return _queues.size();}
+    BaseQueue* queue(uint32_t port) const {return _queues[port];}
+
+    inline void set_queuesize(uint32_t port, uint8_t q) {_queuesize[port] = q;}
+    inline void set_utilization(uint32_t port, uint8_t u) {_utilization[port] = u;}
+    inline void set_paused(uint32_t port, bool p) {_paused[port] = p;}
+    inline void add_flow(uint32_t port) {_flows[port]++;}
+    std::vector<uint32_t>& flows() {return _flows;}
+
+    // fields are ORed; FLOWS is only compared on its own
+    inline uint32_t key(uint32_t port, uint32_t fields) const {
+        if (fields & FLOWS)
+            return _flows[port];
+        uint32_t k = 0;
+        if (fields & PAUSE)
+            k = _paused[port];
+        if (fields & QUEUE)
+            k = (k << 8) | _queuesize[port];
+        if (fields & BANDWIDTH)
+            k = (k << 8) | _utilization[port];
+        return k;
+    }
+private:
+    std::vector<BaseQueue*> _queues;
+    std::vector<uint8_t> _queuesize;
+    std::vector<uint8_t> _utilization;
+    std::vector<uint8_t> _paused;
+    std::vector<uint32_t> _flows;
+};
+
+#endif
@@ -45,6 +45,7 @@ CtrlPrioQueue::completeService(){
     pkt = _enqueued_low.back();
     _enqueued_low.pop_back();
     _queuesize_low -= pkt->size();
+    update_port_queuesize();
     _num_packets++;
   } else if (_serv==QUEUE_HIGH) {
     assert(!_enqueued_high.empty());
@@ -54,6 +55,7 @@ CtrlPrioQueue::completeService(){
         _queuesize_high_watermark = _queuesize_high;
     }
     _queuesize_high -= pkt->size();
+    update_port_queuesize();
     switch (pkt->type()) {
     case NDPACK:
     case NDPLITEACK:
@@ -43,7 +43,7 @@ protected:
     routes_t* _routesback;
     seq_t _seqno;
     PacketSink* _reactor;
-    static PacketDB<QcnPacket> _packetdb;
+    static thread_local PacketDB<QcnPacket> _packetdb;
 };
 
 class QcnAck : public Packet {
@@ -72,7 +72,7 @@ public:
         return nextsink;
     }
 protected:
-    static PacketDB<QcnAck> _packetdb;
+    static thread_local PacketDB<QcnAck> _packetdb;
     PacketSink* _reactor;
     fb_t _fb;
 };
@@ -1,18 +1,23 @@
 // -*- c-basic-offset: 4; indent-tabs-mode: nil -*-        
 #include <sstream>
+#include <algorithm>
 #include <math.h>
 #include "queue.h"
 #include "ndppacket.h"
 #include "queue_lossless.h"
 
-simtime_picosec BaseQueue::_update_period = timeFromUs(0.1);
+thread_local simtime_picosec BaseQueue::_update_period = timeFromUs(0.1);
+thread_local BaseQueue::utilization_tracker BaseQueue::_utilization_tracker = BaseQueue::BUSY_INTERVALS;
 
 // base queue is a generic queue that we can log, but doesn't actually store anything
 BaseQueue::BaseQueue(linkspeed_bps bitrate, EventList& eventlist, QueueLogger* logger)
-    : EventSource(eventlist, "Queue"), _logger(logger), _bitrate(bitrate), _switch(NULL) {
+    : EventSource(eventlist, "Queue"), _logger(logger), _bitrate(bitrate), _switch(NULL), _port_states(NULL), _port(0) {
     _ps_per_byte = (simtime_picosec)((pow(10.0, 12.0) * 8) / _bitrate);
     _window = timeFromUs(30.0);
     _busy = 0;
+    _track_utilization = false;
+    _bucket = 0;
+    _bucket_end = 0;
 
     _last_update_qs = 0;
     _last_update_utilization = 0;
@@ -20,8 +25,41 @@ BaseQueue::BaseQueue(linkspeed_bps bitrate, EventList& eventlist, QueueLogger* l
     _last_utilization = 0;
 }
 
+void
+BaseQueue::setBitrate(linkspeed_bps bitrate) {
+    _bitrate = bitrate;
+    _ps_per_byte = (simtime_picosec)((pow(10.0, 12.0) * 8) / _bitrate);
+}
+
+void
+BaseQueue::checkpoint(Checkpoint& cp) {
+    cp.io(_busystart);
+    cp.io(_busyend);
+    cp.io(_busy);
+    cp.io(_track_utilization);
+    cp.io(_busy_buckets);
+    cp.io(_bucket);
+    cp.io(_bucket_end);
+    cp.io(_idle);
+    cp.io(_window);
+    cp.io(_last_update_qs);
+    cp.io(_last_update_utilization);
+    cp.io(_last_qs);
+    cp.io(_last_utilization);
+}
+
 void 
 BaseQueue::log_packet_send(simtime_picosec duration){
+    if (!_track_utilization)
+        return;
+    if (_utilization_tracker == BUSY_BUCKETS) {
+        // the whole send counts as the current bucket's
+        expire_buckets(eventlist().now());
+        _busy_buckets[_bucket] += duration;
+        _busy += duration;
+        return;
+    }
+
     //a packet tranmission has just finished; it lasted from a to b.
     simtime_picosec b = eventlist().now();
     simtime_picosec a = b - duration;
@@ -44,8 +82,43 @@ BaseQueue::log_packet_send(simtime_picosec duration){
     }
 }
 
+void
+BaseQueue::expire_buckets(simtime_picosec now){
+    simtime_picosec width = _window / UTILIZATION_BUCKETS;
+    if (_busy_buckets.empty()) {
+        _busy_buckets.assign(UTILIZATION_BUCKETS, 0);
+        _bucket_end = now + width;
+        return;
+    }
+    if (now >= _bucket_end + _window) {
+        // idle for the whole window
+        fill(_busy_buckets.begin(), _busy_buckets.end(), 0);
+        _busy = 0;
+        _bucket_end = now + width;
+        return;
+    }
+    while (now >= _bucket_end) {
+        _bucket = (_bucket + 1) % UTILIZATION_BUCKETS;
+        _busy -= _busy_buckets[_bucket];
+        _busy_buckets[_bucket] = 0;
+        _bucket_end += width;
+    }
+}
+
 uint16_t
 BaseQueue::average_utilization(){
+    if (!_track_utilization) {
+        // the first reading; sends are counted from now on
+        track_utilization();
+        return 0;
+    }
+    if (_utilization_tracker == BUSY_BUCKETS) {
+        if (_busy_buckets.empty())
+            return 0;
+        expire_buckets(eventlist().now());
+        return (_busy*100/_window);
+    }
+
     //how much time have we spent being busy in the current measurement window?
     if (_busystart.empty())
         return 0;
@@ -98,15 +171,7 @@ BaseQueue::quantized_queuesize(){
     if (eventlist().now()-_last_update_qs > _update_period){
         _last_update_qs = eventlist().now();
 
-        uint64_t qs = queuesize();
-        if (qs < maxsize() * 0.05)
-            _last_qs = 0;
-        else if (qs < maxsize() * 0.1)
-            _last_qs = 1;
-        else if (qs < maxsize() * 0.2)
-            _last_qs = 2;
-        else 
-            _last_qs = 3;
+        _last_qs = quantize_queuesize(queuesize());
         //_last_qs = queuesize();
 
         //cout << "QS " << (uint32_t)_last_qs << " queuesize " << queuesize() << " max " << maxsize() << endl;
@@ -114,6 +179,25 @@ BaseQueue::quantized_queuesize(){
     return _last_qs;
 }
 
+uint8_t
+BaseQueue::quantize_queuesize(mem_b qs) const {
+    if (qs < maxsize() * 0.05)
+        return 0;
+    else if (qs < maxsize() * 0.1)
+        return 1;
+    else if (qs < maxsize() * 0.2)
+        return 2;
+    else 
+        return 3;
+}
+
+void
+BaseQueue::setPortState(PortStates* states, uint32_t port) {
+    _port_states = states;
+    _port = port;
+    update_port_queuesize();
+}
+
 // MQL quantization for SMaRTT-REPS-CONGA
 // Maps queue length to 3-bit level (0-7)
 // This provides finer-grained congestion signal than ECN
@@ -149,6 +233,13 @@ Queue::Queue(linkspeed_bps bitrate, mem_b maxsize, EventList& eventlist,
     _nodename = ss.str();
 }
 
+void
+Queue::checkpoint(Checkpoint& cp) {
+    BaseQueue::checkpoint(cp);
+    cp.io(_queuesize);
+    cp.io(_enqueued);
+    cp.io(_num_drops);
+}
 
 void
 Queue::beginService()
@@ -167,6 +258,7 @@ Queue::completeService()
     //_enqueued.pop_back();
     Packet* pkt = _enqueued.pop();
     _queuesize -= pkt->size();
+    update_port_queuesize();
     pkt->flow().logTraffic(*pkt, *this, TrafficLogger::PKT_DEPART);
     if (_logger) _logger->logQueue(*this, QueueLogger::PKT_SERVICE, *pkt);
 
@@ -211,6 +303,7 @@ Queue::receivePacket(Packet& pkt)
     Packet* pkt_p = &pkt;
     _enqueued.push(pkt_p);
     _queuesize += pkt.size();
+    update_port_queuesize();
     if (_logger) _logger->logQueue(*this, QueueLogger::PKT_ENQUEUE, pkt);
 
     if (queueWasEmpty) {
@@ -414,6 +507,18 @@ FairPriorityQueue::FairPriorityQueue(linkspeed_bps bitrate, mem_b maxsize,
     _state_send = LosslessQueue::READY;
 }
 
+void
+FairPriorityQueue::checkpoint(Checkpoint& cp) {
+    Queue::checkpoint(cp);
+    for (int prio = 0; prio < Q_NONE; prio++) {
+        _queue[prio].checkpoint(cp);
+    }
+    cp.io(_sending);
+    cp.io_array(_queuesize, Q_NONE);
+    cp.io(_servicing);
+    cp.io(_state_send);
+}
+
 FairPriorityQueue::queue_priority_t 
 FairPriorityQueue::getPriority(Packet& pkt) {
     switch (pkt.priority()) {
@@ -8,6 +8,7 @@
 
 //#include <list>
 //#include "circular_buffer.h"
+#include "port_state.h"
 #include "config.h"
 #include "eventlist.h"
 #include "network.h"
@@ -22,7 +23,7 @@
 // disciplines. 
 class Switch;
 
-class BaseQueue  : public EventSource, public PacketSink, public Drawable {
+class BaseQueue  : public EventSource, public PacketSink, public Drawable, public Checkpointable {
  public:
     BaseQueue(linkspeed_bps bitrate, EventList &eventlist, QueueLogger* logger);
     virtual void setLogger(QueueLogger* logger) {
@@ -39,6 +40,15 @@ class BaseQueue  : public EventSource, public PacketSink, public Drawable {
 
     virtual void setSwitch(Switch* s){assert(!_switch);_switch = s;}
     virtual Switch* getSwitch(){return _switch;}
+
+    // keep port's entry in a switch's PortStates up to date
+    void setPortState(PortStates* states, uint32_t port);
+    uint32_t port() const {return _port;}
+    // called by the queuing disciplines whenever their size changes
+    inline void update_port_queuesize() {
+        if (_port_states)
+            _port_states->set_queuesize(_port, quantize_queuesize(queuesize()));
+    }
     
     void setNext(PacketSink* next_sink) {
             _next_sink = next_sink;
@@ -59,16 +69,38 @@ class BaseQueue  : public EventSource, public PacketSink, public Drawable {
             return (mem_b)(timeAsSec(t) * (double)_bitrate); 
     }
 
+    // change the link speed; a packet already being sent finishes at
+    // the old one
+    void setBitrate(linkspeed_bps bitrate);
+    linkspeed_bps bitrate() const { return _bitrate; }
+
+    // Utilization is the busy time in the last _window.  Sends are only
+    // recorded once something has asked for it, or called
+    // track_utilization() to say that it will.
+    enum utilization_tracker {
+        BUSY_INTERVALS = 0, // every send, dropped as it leaves the window
+        BUSY_BUCKETS = 1    // busy time per 1/UTILIZATION_BUCKETS of the window
+    };
+    static const uint32_t UTILIZATION_BUCKETS = 32;
+
+    void track_utilization() {_track_utilization = true;}
     virtual void log_packet_send(simtime_picosec duration);
     virtual uint16_t average_utilization();
 
     virtual uint64_t quantized_queuesize();
     virtual uint8_t quantized_utilization();
+    uint8_t quantize_queuesize(mem_b qs) const;
     
     // MQL quantization for SMaRTT-REPS-CONGA (3-bit: 0-7)
     virtual uint8_t quantizeQueueLengthMQL() const;
 
-    static simtime_picosec _update_period;
+    // the utilization and queue size history; each queuing discipline
+    // adds the packets it holds
+    virtual void checkpoint(Checkpoint& cp);
+    virtual const type_info& checkpoint_class() const {return typeid(BaseQueue);}
+
+    static thread_local simtime_picosec _update_period;
+    static thread_local utilization_tracker _utilization_tracker;
 
 protected:
     // Housekeeping
@@ -83,6 +115,13 @@ protected:
 
     //how much time have we spent being busy in the current measurement window?
     simtime_picosec _busy;
+    bool _track_utilization;
+    // BUSY_BUCKETS: a ring of busy time, the current bucket ending at
+    // _bucket_end
+    vector<simtime_picosec> _busy_buckets;
+    uint32_t _bucket;
+    simtime_picosec _bucket_end;
+    void expire_buckets(simtime_picosec now);
     simtime_picosec _idle;
     simtime_picosec _window;
 
@@ -90,6 +129,8 @@ protected:
     uint8_t _last_qs, _last_utilization;
 
     Switch* _switch;//which switch is this queue part of?
+    PortStates* _port_states;
+    uint32_t _port;
 };
 
 
@@ -108,6 +149,8 @@ class Queue : public BaseQueue {
     simtime_picosec serviceTime();
     int num_drops() const {return _num_drops;}
     void reset_drops() {_num_drops = 0;}
+    virtual void checkpoint(Checkpoint& cp);
+    virtual const type_info& checkpoint_class() const {return typeid(Queue);}
 
  protected:
     // Mechanism
@@ -167,6 +210,8 @@ class FairPriorityQueue : public HostQueue {
     virtual void receivePacket(Packet& pkt);
     virtual mem_b queuesize() const;
     virtual simtime_picosec serviceTime(Packet& pkt);
+    virtual void checkpoint(Checkpoint& cp);
+    virtual const type_info& checkpoint_class() const {return typeid(FairPriorityQueue);}
 
  protected:
     //this is needed for lossless operation!
@@ -76,6 +76,7 @@ LosslessQueue::receivePacket(Packet& pkt)
     Packet* pkt_p = &pkt;
     _enqueued.push(pkt_p);
     _queuesize += pkt.size();
+    update_port_queuesize();
 
     //send PAUSE notifications if that is the case!
     if (_queuesize > _high_threshold && _state_recv!=PAUSED){
@@ -113,6 +114,7 @@ void LosslessQueue::completeService(){
     //_enqueued.pop_back();
     Packet* pkt = _enqueued.pop();
     _queuesize -= pkt->size();
+    update_port_queuesize();
     
     pkt->flow().logTraffic(*pkt, *this, TrafficLogger::PKT_DEPART);
 
@@ -5,8 +5,8 @@
 #include <sstream>
 #include "switch.h"
 
-uint64_t LosslessInputQueue::_high_threshold = 0;
-uint64_t LosslessInputQueue::_low_threshold = 0;
+thread_local uint64_t LosslessInputQueue::_high_threshold = 0;
+thread_local uint64_t LosslessInputQueue::_low_threshold = 0;
 
 LosslessInputQueue::LosslessInputQueue(EventList& eventlist)
     : Queue(speedFromGbps(1),Packet::data_packet_size()*2000,eventlist,NULL),
@@ -36,8 +36,8 @@ public:
 
     enum {PAUSED,READY,PAUSE_RECEIVED};
 
-    static uint64_t _low_threshold;
-    static uint64_t _high_threshold;
+    static thread_local uint64_t _low_threshold;
+    static thread_local uint64_t _high_threshold;
 
 private:
     int _state_recv;
@@ -7,8 +7,8 @@
 #include "queue_lossless_output.h"
 #include "queue_lossless_input.h"
 
-int LosslessOutputQueue::_ecn_enabled = false;
-int LosslessOutputQueue::_K = 0;
+thread_local int LosslessOutputQueue::_ecn_enabled = false;
+thread_local int LosslessOutputQueue::_K = 0;
 
 LosslessOutputQueue::LosslessOutputQueue(linkspeed_bps bitrate, mem_b maxsize, 
                                          EventList& eventlist, QueueLogger* logger)
@@ -68,6 +68,8 @@ LosslessOutputQueue::receivePacket(Packet& pkt,VirtualQueue* prev)
                 beginService();
         }
         
+        if (_port_states)
+            _port_states->set_paused(_port, is_paused());
         pkt.free();
         return;
     }
@@ -86,6 +88,7 @@ LosslessOutputQueue::receivePacket(Packet& pkt,VirtualQueue* prev)
     _enqueued.push(pkt_p);
 
     _queuesize += pkt.size();
+    update_port_queuesize();
 
     if (_queuesize > _maxsize){
         cout << " Queue " << _name << " LOSSLESS not working! I should have dropped this packet" << _queuesize / Packet::data_packet_size() << endl;
@@ -142,6 +145,7 @@ void LosslessOutputQueue::completeService(){
     }   
 
     _queuesize -= pkt->size();
+    update_port_queuesize();
     _txbytes += pkt->size();
 
     pkt->flow().logTraffic(*pkt, *this, TrafficLogger::PKT_DEPART);
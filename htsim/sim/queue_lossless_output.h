@@ -36,8 +36,8 @@ private:
     uint64_t _txbytes;
 
 public:
-    static int _ecn_enabled;
-    static int _K;
+    static thread_local int _ecn_enabled;
+    static thread_local int _K;
 };
 
 #endif
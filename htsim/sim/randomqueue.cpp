@@ -58,6 +58,7 @@ RandomQueue::receivePacket(Packet& pkt)
     Packet* pkt_p = &pkt;
     _enqueued.push(pkt_p);
     _queuesize += pkt.size();
+    update_port_queuesize();
 
     if (_logger) 
         _logger->logQueue(*this, QueueLogger::PKT_ENQUEUE, pkt);
@@ -1,10 +1,14 @@
 #include <cstdlib>
 #include <climits>
 #include <random>
+#include <sstream>
+#include <string>
 
 using namespace std;
 
-static mt19937 random_engine;
+// per thread, so that simulations running side by side each have their
+// own reproducible sequence
+static thread_local mt19937 random_engine;
 
 void srand(unsigned seed)
 {
@@ -25,3 +29,17 @@ long random()
 {
     return rand();
 }
+
+// the generator's state, for checkpoints
+string random_state()
+{
+    ostringstream s;
+    s << random_engine;
+    return s.str();
+}
+
+void set_random_state(const string& state)
+{
+    istringstream s(state);
+    s >> random_engine;
+}
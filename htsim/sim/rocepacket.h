@@ -30,8 +30,7 @@ class RocePacket : public Packet {
                 p->_is_header = false;
                 p->_seqno = seqno;
                 p->_retransmitted = retransmitted;
-                p->_last_packet = last_packet;
-                p->_path_len = 0;
+                p->_last_packet = last_packet;
                 p->_direction = NONE;
                 p->set_dst(destination);
                 return p;
@@ -49,8 +48,7 @@ class RocePacket : public Packet {
                 p->_is_header = false;
                 p->_direction = NONE;        
                 p->_retransmitted = retransmitted;
-                p->_last_packet = last_packet;
-                p->_path_len = route.size();
+                p->_last_packet = last_packet;
                 p->set_dst(destination);
                 return p;
     }
@@ -71,7 +69,7 @@ class RocePacket : public Packet {
     simtime_picosec _ts;
     bool _retransmitted;
     bool _last_packet;  // set to true in the last packet in a flow.
-    static PacketDB<RocePacket> _packetdb;
+    static thread_local PacketDB<RocePacket> _packetdb;
 };
 
 class RoceAck : public Packet {
@@ -85,8 +83,7 @@ class RoceAck : public Packet {
                 p->set_route(flow,route,RocePacket::ACKSIZE,ackno);
                 p->_type = ROCEACK;
                 p->_is_header = true;
-                p->_ackno = ackno;
-                p->_path_len = 0;
+                p->_ackno = ackno;
                 p->_direction = NONE;
                 p->set_dst(destination);
                 return p;
@@ -103,7 +100,7 @@ class RoceAck : public Packet {
  protected:
     seq_t _ackno;
     simtime_picosec _ts;
-    static PacketDB<RoceAck> _packetdb;
+    static thread_local PacketDB<RoceAck> _packetdb;
 };
 
 
@@ -135,7 +132,7 @@ class RoceNack : public Packet {
  protected:
     seq_t _ackno;
     simtime_picosec _ts;
-    static PacketDB<RoceNack> _packetdb;
+    static thread_local PacketDB<RoceNack> _packetdb;
 };
 
 
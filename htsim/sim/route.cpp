@@ -1,4 +1,5 @@
 // -*- c-basic-offset: 4; indent-tabs-mode: nil -*-  
+#include <algorithm>
 #include <climits>
 #include "route.h"
 #include "network.h"
@@ -7,29 +8,69 @@
 
 #define MAXQUEUES 10
 
-Route::Route() : _hop_count(0), _reverse(NULL) {};
+Route::Route() : _hops(_inline), _size(0), _capacity(INLINE_HOPS), _hop_count(0),
+                 _path_id(0), _no_of_paths(0), _reverse(NULL) {};
 
-Route::Route(int size) : _hop_count(0), _reverse(NULL) {
-    _sinklist.reserve(size);
+Route::Route(int size) : Route() {
+    reserve(size);
 };
 
-Route::Route(const Route& orig, PacketSink& dst) : _sinklist(orig.size()+1){
-    //_sinklist.resize(orig.size()+1);
-    _path_id = orig.path_id();
-    _reverse = orig._reverse;
-    _hop_count = orig.hop_count();
-    _no_of_paths = orig.no_of_paths();
-    for (size_t i = 0; i < orig.size(); i++) {
-        _sinklist[i] = orig.at(i);
-    }
-    _sinklist[orig.size()] = &dst;
+Route::Route(const Route& orig) : Route() {
+    *this = orig;
+}
+
+Route::Route(const Route& orig, PacketSink& dst) : Route(orig.size()+1) {
+    *this = orig;
+    _hops[_size++] = &dst;
     _hop_count++;
 }
 
+Route::~Route() {
+    if (_hops != _inline)
+        delete[] _hops;
+}
+
+Route&
+Route::operator=(const Route& orig) {
+    if (this == &orig)
+        return *this;
+    reserve(orig._size);
+    copy(orig.begin(), orig.end(), _hops);
+    _size = orig._size;
+    _hop_count = orig._hop_count;
+    _path_id = orig._path_id;
+    _no_of_paths = orig._no_of_paths;
+    _reverse = orig._reverse;
+    return *this;
+}
+
+void
+Route::reserve(size_t n) {
+    if (n <= _capacity)
+        return;
+    PacketSink** hops = new PacketSink*[n];
+    copy(_hops, _hops + _size, hops);
+    if (_hops != _inline)
+        delete[] _hops;
+    _hops = hops;
+    _capacity = n;
+}
+
+void
+Route::insert(size_t pos, PacketSink* sink) {
+    assert(pos <= _size);
+    if (_size == _capacity)
+        reserve(2 * _capacity);
+    copy_backward(_hops + pos, _hops + _size, _hops + _size + 1);
+    _hops[pos] = sink;
+    _size++;
+    update_hopcount(sink);
+}
+
 
 Route*
 Route::clone() const {
-    Route *copy = new Route(_hop_count);
+    Route *copy = new Route(_size);
     copy->set_path_id(_path_id, _no_of_paths);
     /* don't clone the reverse path
        if (_reverse) {
@@ -37,16 +78,9 @@ Route::clone() const {
        }
     */
     copy->_reverse = _reverse;
-    /*
-      vector<PacketSink*>::const_iterator i;
-      for (i = _sinklist.begin(); i != _sinklist.end(); i++) {
-      copy->push_back(*i);
-      }
-    */
-    copy->_sinklist.resize(_sinklist.size());
-    for (uint32_t i = 0; i < _sinklist.size(); i++) {
-        copy->_sinklist[i] = _sinklist[i];
-    }
+    // the hop count is not copied
+    std::copy(begin(), end(), copy->_hops);
+    copy->_size = _size;
     return copy;
 }
 
@@ -89,3 +123,70 @@ void check_non_null(Route* rt){
         assert(0);
     }
 }
+
+RouteCache::Cache&
+RouteCache::cache() {
+    static thread_local Cache c;
+    return c;
+}
+
+RouteCache::Cache::~Cache() {
+    for (const Route* r : routes) {
+        delete r;
+    }
+}
+
+size_t
+RouteCache::Hash::operator()(const Route* r) const {
+    size_t h = hash<const Route*>()(r->reverse()) ^ ((size_t)r->path_id() << 32 | r->no_of_paths());
+    for (PacketSink* hop : *r) {
+        h = h * 31 + hash<PacketSink*>()(hop);
+    }
+    return h;
+}
+
+bool
+RouteCache::Equal::operator()(const Route* a, const Route* b) const {
+    return equal(a->begin(), a->end(), b->begin(), b->end()) && a->reverse() == b->reverse()
+        && a->path_id() == b->path_id() && a->no_of_paths() == b->no_of_paths();
+}
+
+size_t
+RouteCache::route_bytes(const Route* r) {
+    return sizeof(Route) + (r->_hops == r->_inline ? 0 : r->_capacity * sizeof(PacketSink*));
+}
+
+const Route*
+RouteCache::intern(const Route& route) {
+    Cache& c = cache();
+    c.interned++;
+    auto i = c.routes.find(&route);
+    if (i != c.routes.end()) {
+        c.saved_bytes += route_bytes(&route);
+        return *i;
+    }
+    Route* copy = new Route(route);
+    c.routes.insert(copy);
+    return copy;
+}
+
+const Route*
+RouteCache::intern(std::initializer_list<PacketSink*> hops) {
+    Route route(hops.size());
+    for (PacketSink* hop : hops) {
+        route.push_back(hop);
+    }
+    return intern(route);
+}
+
+void
+RouteCache::report(ostream& os) {
+    Cache& c = cache();
+    uint64_t bytes = 0;
+    for (const Route* r : c.routes) {
+        bytes += route_bytes(r);
+    }
+    os << "Route cache: " << c.routes.size() << " routes standing in for " << c.interned
+       << ", " << bytes / 1024 << " KB; unshared they would take "
+       << (bytes + c.saved_bytes) / 1024 << " KB" << endl;
+}
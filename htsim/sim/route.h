@@ -7,7 +7,10 @@
  */
 
 #include "config.h"
+#include <initializer_list>
 #include <list>
+#include <stdexcept>
+#include <unordered_set>
 #include <vector>
 
 class PacketSink;
@@ -15,28 +18,36 @@ class Route {
   public:
     Route();
     Route(int size);
+    Route(const Route& orig);
     Route(const Route& orig, PacketSink& dst);
+    ~Route();
+    Route& operator=(const Route& orig);
     Route* clone() const;
-    inline PacketSink* at(size_t n) const {return _sinklist.at(n);}
+    // Called for every hop of every packet, so only checked in builds
+    // with DEBUG_ROUTES; Packet::sendOn() asserts that its next hop is
+    // within size().
+    inline PacketSink* at(size_t n) const {
+#ifdef DEBUG_ROUTES
+        if (n >= _size)
+            throw out_of_range("Route::at");
+#endif
+        return _hops[n];
+    }
     void push_back(PacketSink* sink) {
         assert(sink != NULL);
-        _sinklist.push_back(sink);
-        update_hopcount(sink);
+        insert(_size, sink);
     }
     void push_at(PacketSink* sink,int id) {
-        _sinklist.insert(_sinklist.begin()+id, sink);
-            update_hopcount(sink);
+        insert(id, sink);
     }
     void push_front(PacketSink* sink) {
-        _sinklist.insert(_sinklist.begin(), sink);
-            update_hopcount(sink);
+        insert(0, sink);
     }
     void add_endpoints(PacketSink *src, PacketSink* dst);
-    inline size_t size() const {return _sinklist.size();}
-    typedef vector<PacketSink*>::const_iterator const_iterator;
-    //typedef vector<PacketSink*>::iterator iterator;
-    inline const_iterator begin() const {return _sinklist.begin();}
-    inline const_iterator end() const {return _sinklist.end();}
+    inline size_t size() const {return _size;}
+    typedef PacketSink* const* const_iterator;
+    inline const_iterator begin() const {return _hops;}
+    inline const_iterator end() const {return _hops + _size;}
     void set_reverse(Route* reverse) {_reverse = reverse;}
     inline const Route* reverse() const {return _reverse;}
     void set_path_id(int path_id, int no_of_paths) {
@@ -46,13 +57,23 @@ class Route {
     inline int path_id() const {return _path_id;}
     inline int no_of_paths() const {return _no_of_paths;}
     inline uint32_t hop_count() const {return _hop_count;}
+    // Hops are stored in the Route itself up to this many, which covers
+    // any path through a three tier fat tree; longer routes move them
+    // to the heap.
+    static const uint32_t INLINE_HOPS = 13;
  private:
+    void reserve(size_t n);
+    void insert(size_t pos, PacketSink* sink);
     void update_hopcount(PacketSink* sink);
-    vector<PacketSink*> _sinklist;
+    friend class RouteCache;
+    PacketSink** _hops; // _inline, or an array on the heap
+    uint32_t _size;
+    uint32_t _capacity;
     uint32_t _hop_count;
-    Route* _reverse;
     int _path_id; //path identifier for this path
     int _no_of_paths; //total number of paths sender is using
+    Route* _reverse;
+    PacketSink* _inline[INLINE_HOPS];
 };
 //typedef vector<PacketSink*> route_t;
 typedef Route route_t;
@@ -60,4 +81,40 @@ typedef vector<route_t*> routes_t;
 
 void check_non_null(Route* rt);
 
+/*
+ * Most routes are built at setup and never change afterwards, and many
+ * have the same hops: every connection from a host starts with the
+ * same hop to its ToR, and a switch's forwarding table has an entry
+ * per destination that only depends on where the destination is.
+ * RouteCache holds one shared Route for each distinct sequence of hops
+ * (with the same reverse route and path id), so that these are only
+ * stored once.  Shared routes belong to the cache, live as long as the
+ * thread's simulation and must not be modified.
+ */
+class RouteCache {
+public:
+    // the shared route equal to route, which the caller can then free
+    static const Route* intern(const Route& route);
+    static const Route* intern(std::initializer_list<PacketSink*> hops);
+    // the number of shared routes, how many routes they stand in for
+    // and the memory this saves
+    static void report(ostream& os);
+private:
+    struct Hash {
+        size_t operator()(const Route* r) const;
+    };
+    struct Equal {
+        bool operator()(const Route* a, const Route* b) const;
+    };
+    struct Cache {
+        Cache() : interned(0), saved_bytes(0) {}
+        ~Cache();
+        unordered_set<const Route*, Hash, Equal> routes;
+        uint64_t interned;
+        uint64_t saved_bytes;
+    };
+    static Cache& cache();
+    static size_t route_bytes(const Route* r);
+};
+
 #endif
@@ -5,7 +5,7 @@
 #include "queue.h"
 #include "pipe.h"
 
-void RouteTable::addRoute(int destination, Route* port, int cost, packet_direction direction){  
+void RouteTable::addRoute(int destination, const Route* port, int cost, packet_direction direction){  
     if (_fib.find(destination) == _fib.end())
         _fib[destination] = new vector<FibEntry*>(); 
     
@@ -14,7 +14,7 @@ void RouteTable::addRoute(int destination, Route* port, int cost, packet_directi
     _fib[destination]->push_back(new FibEntry(port,cost,direction));
 }
 
-void RouteTable::addHostRoute(int destination, Route* port, int flowid){  
+void RouteTable::addHostRoute(int destination, const Route* port, int flowid){  
     if (_hostfib.find(destination) == _hostfib.end())
         _hostfib[destination] = new unordered_map<int, HostFibEntry*>(); 
     
@@ -25,18 +25,22 @@ void RouteTable::addHostRoute(int destination, Route* port, int flowid){
 
 
 vector<FibEntry*>* RouteTable::getRoutes(int destination){
-    if (_fib.find(destination) == _fib.end())
+    auto i = _fib.find(destination);
+    if (i == _fib.end())
         return NULL;
     else        
-        return _fib[destination];
+        return i->second;
 }
 
 HostFibEntry* RouteTable::getHostRoute(int destination,int flowid){
-    if (_hostfib.find(destination) == _hostfib.end() ||
-        _hostfib[destination]->find(flowid) == _hostfib[destination]->end())
+    auto i = _hostfib.find(destination);
+    if (i == _hostfib.end())
+        return NULL;
+    auto j = i->second->find(flowid);
+    if (j == i->second->end())
         return NULL;
     else {
-        return (*_hostfib[destination])[flowid];
+        return j->second;
     }
 }
 
@@ -14,27 +14,33 @@
 
 class FibEntry{
 public:
-    FibEntry(Route* outport, uint32_t cost, packet_direction direction){ _out = outport; _cost = cost;_direction = direction;}
+    FibEntry(const Route* outport, uint32_t cost, packet_direction direction){ _out = outport; _cost = cost;_direction = direction; _port = NO_PORT;}
 
-    Route* getEgressPort(){return _out;}
+    const Route* getEgressPort(){return _out;}
     uint32_t getCost(){return _cost;}
     packet_direction getDirection(){return _direction;}
+
+    // the switch's index for the egress queue, once it has looked it up
+    static const uint32_t NO_PORT = UINT32_MAX;
+    uint32_t getPort(){return _port;}
+    void setPort(uint32_t port){_port = port;}
     
 protected:
-    Route* _out;
+    const Route* _out;
     uint32_t _cost;
     packet_direction _direction;
+    uint32_t _port;
 };
 
 class HostFibEntry{
 public:
-    HostFibEntry(Route* outport, int flowid){ _flowid = flowid; _out = outport;}
+    HostFibEntry(const Route* outport, int flowid){ _flowid = flowid; _out = outport;}
 
-    Route* getEgressPort(){return _out;}
+    const Route* getEgressPort(){return _out;}
     int getFlowID(){return _flowid;}
 
 protected:
-    Route* _out;
+    const Route* _out;
     uint32_t _flowid;
 
 };
@@ -42,11 +48,12 @@ protected:
 class RouteTable {
 public:
     RouteTable() {};
-    void addRoute(int destination, Route* port, int cost, packet_direction direction);  
-    void addHostRoute(int destination, Route* port, int flowid);  
+    void addRoute(int destination, const Route* port, int cost, packet_direction direction);  
+    void addHostRoute(int destination, const Route* port, int flowid);  
     void setRoutes(int destination, vector<FibEntry*>* routes);  
     vector <FibEntry*>* getRoutes(int destination);
     HostFibEntry* getHostRoute(int destination, int flowid);
+    const unordered_map<int,vector<FibEntry*>* >& routes() const {return _fib;}
     
 private:
     unordered_map<int,vector<FibEntry*>* > _fib;
@@ -1,114 +1,96 @@
+// -*- c-basic-offset: 4; indent-tabs-mode: nil -*-
 #include "rtx_timer.h"
+#include <algorithm>
 
-RtxTimer::RtxTimer(EventList& list):
-  _eventList(list)
-{
-  TimerBucket* bucket;
-  simtime_picosec now;
-  now = _eventList().now();
+thread_local RtxTimerScanner::mode_t RtxTimerScanner::_default_mode = RtxTimerScanner::EXACT;
 
-  for (int i=50;i<=400;i*=2){
-    bucket = new TimerBucket();
-    bucket->base = timeFromMs(i);
-    bucket->expire  = now + bucket->base;
-  }
+RtxTimerScanner::RtxTimerScanner(simtime_picosec scanPeriod, simtime_picosec firstScan, EventList& eventlist)
+    : EventSource(eventlist, "RtxScanner"), _mode(_default_mode), _scanPeriod(scanPeriod),
+      _clients(0), _scheduled(RtxTimerClient::NEVER), _handle(NULL)
+{
+    assert(scanPeriod > 0);
+    if (_mode == SCAN)
+        eventlist.sourceIsPendingRel(*this, firstScan);
 }
 
-//time is absolute!
-void RtxTimer::schedule_timer(TcpSrc* who,simtime_picosec when){
-  timer_entry * t;
-
-  if (active_timers.find(who)!=active_timers.end()){
-    t = remove_timer(who);
-  }
-  else {
-    t = new timer_entry();
-    active_timers.insert(who);
-  }
-  t->who = who;
-  t->when = when;
-  
-  simtime_picosec now = _eventList().now(), delta = when-now;
-
-  vector<TimerBucket*>::iterator it;
-  TimerBucket* crt = NULL;
-  int j = -1;
-
-  for (int i = 0;i<_buckets.size();i++){
-    crt = _buckets[i];
-    
-    if (crt->base>delta){
-      j = i-1;
-      break;
-    }
-    else j = i;
-  }
-
-  if (j<0){
-    _soon[t->when] = t;
-  }
-  else{
-    //insert in that timerbucket;
-    _buckets[j]->timers[who] = t;
-    _timer_to_bucket[who] = _buckets[j];
-  }
+void
+RtxTimerScanner::registerClient(RtxTimerClient& client) {
+    assert(client._rtx_scanner == NULL);
+    client._rtx_scanner = this;
+    client._rtx_index = _clients++;
+    update(client);
 }
 
-void RtxTimer::reschedule_timer(TcpSrc* who,simtime_picosec when){
-  //fast case only!
-  if (_active_timers.find(who)==_active_timers.end()){
-    return schedule_timer(who,when);
-  }  
-  bool ok = false;
-  
-  if (_timer_to_bucket.find(who)!=_timer_to_bucket.end()){
-    TimerBucket* bucket = _timer_to_bucket[who];
-    simtime_picosec now = _eventList().now(), delta = when-now;
-    if (delta>bucket->base) //ok to reschedule here!
-      if (bucket->timers.find(who)!=bucket->timers.end()){
-        t = bucket->timers[who];
-        t->when = when;
-        ok = true;
-      }
-  }
-
-  if (!ok) 
-    schedule_timer(who,when);
+void
+RtxTimerScanner::update(RtxTimerClient& client) {
+    simtime_picosec due = client.rtx_timer_due(_mode == SCAN ? _scanPeriod : 0);
+    if (due != RtxTimerClient::NEVER)
+        arm(client, due);
 }
 
-void RtxTimer::remove_timer(TcpSrc* who){
-  timer_entry * t = NULL;
-
-  if (_active_timers.find(who)==_active_timers.end()){
-    return NULL;
-  }  
-
-  _active_timers.erase(who);
+void
+RtxTimerScanner::arm(RtxTimerClient& client, simtime_picosec when) {
+    // a later deadline is picked up when the current entry comes due
+    if (when >= client._rtx_armed)
+        return;
+    client._rtx_armed = when;
+    _due.push(Entry{when, client._rtx_index, &client});
+    if (_mode == EXACT && when < _scheduled)
+        schedule();
+}
 
-  if (_timer_to_bucket.find(who)!=_timer_to_bucket.end()){
-    TimerBucket* bucket = _timer_to_bucket[who];
-    if (bucket->timers.find(who)!=bucket->timers.end()){
-      t = bucket->timers[who];
-      bucket->timers.erase(who);
+void
+RtxTimerScanner::schedule() {
+    // drop superseded entries so that we don't wake up for them
+    while (!_due.empty() && _due.top().when != _due.top().client->_rtx_armed) {
+        _due.pop();
     }
+    if (_handle) {
+        eventlist().cancelPendingSourceByHandle(*this, _handle);
+        _handle = NULL;
+    }
+    _scheduled = RtxTimerClient::NEVER;
+    if (_due.empty())
+        return;
+    _scheduled = _due.top().when;
+    _handle = eventlist().sourceIsPendingGetHandle(*this, max(_scheduled, eventlist().now()));
+}
 
-    _timer_to_bucket.erase(_timer_to_bucket.find(who).second);
-  }
-  else {
-    list<timer_entry*>::iterator it;
-    bool found = false;
-
-    for (it = _soon.begin();it!=_soon.end();it++){
-      t = _soon[*it];
-      if (t->who==who){
-        found = true;
-        _soon.erase(it);
-        break;
-      }
+void
+RtxTimerScanner::doNextEvent() {
+    simtime_picosec now = eventlist().now();
+    simtime_picosec period = _mode == SCAN ? _scanPeriod : 0;
+    _handle = NULL;
+    // re-armed hooks don't need us to reschedule as we go
+    _scheduled = 0;
+
+    _batch.clear();
+    while (!_due.empty() && _due.top().when <= now) {
+        Entry e = _due.top();
+        _due.pop();
+        if (e.when != e.client->_rtx_armed)
+            continue;  // superseded by an earlier deadline
+        e.client->_rtx_armed = RtxTimerClient::NEVER;
+        _batch.push_back(e.client);
+    }
+    sort(_batch.begin(), _batch.end(),
+         [](const RtxTimerClient* a, const RtxTimerClient* b) {return a->_rtx_index < b->_rtx_index;});
+
+    for (RtxTimerClient* client : _batch) {
+        if (client->rtx_timer_due(period) <= now)
+            client->rtx_timer_hook(now, period);
+        simtime_picosec due = client->rtx_timer_due(period);
+        if (due <= now) {
+            // the hook didn't act (the source may be idle); look again
+            // a scan period from now, as the old scanners did
+            arm(*client, now + _scanPeriod);
+        } else if (due != RtxTimerClient::NEVER) {
+            arm(*client, due);
+        }
     }
-    if (!found)
-      t = NULL;
-  }
 
-  return t;
+    if (_mode == SCAN)
+        eventlist().sourceIsPendingRel(*this, _scanPeriod);
+    else
+        schedule();
 }
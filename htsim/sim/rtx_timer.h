@@ -1,78 +1,95 @@
-#ifndef __RTX_TIMER
-#define __RTX_TIMER
-
-#include <list>
-#include <hash_map>
-#include <map>
+// -*- c-basic-offset: 4; indent-tabs-mode: nil -*-
+#ifndef RTX_TIMER_H
+#define RTX_TIMER_H
+
+/*
+ * Retransmission timers shared by the TCP, NDP, NDP tunnel, Swift and
+ * STrack sources.
+ *
+ * A source (an RtxTimerClient) keeps its own retransmit deadline and
+ * says when its rtx_timer_hook() could next act; the RtxTimerScanner
+ * only keeps track of sources that have a deadline, in a heap ordered
+ * by that time.  Deadlines that move later - the usual case, on every
+ * new ACK - cost nothing: the old heap entry is simply checked when it
+ * comes due and re-armed at the new deadline.
+ *
+ * In EXACT mode (the default) each hook is called when its deadline
+ * expires, with a period of zero.  In SCAN mode the scanner wakes up
+ * every scanPeriod, as the per-protocol scanners used to, and calls
+ * the hooks of the sources that are due with the scan period; this
+ * reproduces the old timer granularity exactly, but without visiting
+ * every source that was ever registered.  Hooks due at the same time
+ * are called in the order the sources were registered.
+ */
+
+#include <queue>
+#include <vector>
 #include "config.h"
-#include "network.h"
-#include "tcppacket.h"
 #include "eventlist.h"
 
+class RtxTimerScanner;
+
+class RtxTimerClient {
+    friend class RtxTimerScanner;
+public:
+    static const simtime_picosec NEVER = UINT64_MAX;
+
+    RtxTimerClient() : _rtx_scanner(NULL), _rtx_index(0), _rtx_armed(NEVER) {}
+    virtual ~RtxTimerClient() {}
+    virtual void rtx_timer_hook(simtime_picosec now, simtime_picosec period) = 0;
+    // the earliest time at which rtx_timer_hook(now, period) might
+    // act, or NEVER if nothing is waiting to be retransmitted (the
+    // protocols' own timeInf is 0, so it can't be used here)
+    virtual simtime_picosec rtx_timer_due(simtime_picosec period) = 0;
+protected:
+    // call after setting the retransmit deadline
+    inline void rtx_deadline_changed();
+private:
+    RtxTimerScanner* _rtx_scanner;
+    uint32_t _rtx_index;         // registration order
+    simtime_picosec _rtx_armed;  // time of our live heap entry, or NEVER
+};
 
-class RtxTimer {
- public:
-  RtxTimer(EventList & list);
-
-  void schedule_timer(TcpSrc* who,simtime_picosec when);
-  void reschedule_timer(TcpSrc* who,simtime_picosec when);
-  void remove_timer(TcpSrc* who);
-
-  void check_lists(); 
-
-  struct timer_entry {
-    TcpSrc* who;
-    simtime_picosec when;
-  };
-
-  EventList& _eventList;
-
-  struct eqint
-  {
-    bool operator()(const int i1, const int i2) const
-    {
-      return i1==i2;
-    }
-  };
-
-  struct ltint
-  {
-    bool operator()(const int i1, const int i2) const
-    {
-      return i1<i2;
-    }
-  };
-
-  struct lttime
-  {
-    bool operator()(const simtime_picosec i1, const simtime_picosec i2) const
-    {
-      return i1<i2;
-    }
-  };
-
-
-  struct eqtcp
-  {
-    bool operator()(const TcpSrc* src1, const TcpSrc* src2) const
-    {
-      return src1==src2;
-    }
-  };
-
-  typedef hash_map<const TcpSrc*, timer_entry*, hash<int>,eqtcp> Timers;
-
-  struct TimerBucket {
-    Timers timers;
-    simtime_picosec base;
-    simtime_picosec expire;
-  }
-
-  map<simtime_picosec,timer_entry*,lttime> _soon;
-  vector<TimerBucket*> _buckets;
-
-  hash_set<const TcpSrc*, hash<int>, eqint> _active_timers;
-  hash_map<const TcpSrc*, TimerBucket*,hash<int>,eqint> _timer_to_bucket;
+class RtxTimerScanner : public EventSource {
+public:
+    enum mode_t {EXACT, SCAN};
+
+    // in SCAN mode the first scan is at firstScan from now
+    RtxTimerScanner(simtime_picosec scanPeriod, simtime_picosec firstScan, EventList& eventlist);
+    void registerClient(RtxTimerClient& client);
+    // the client's deadline may have moved earlier
+    void update(RtxTimerClient& client);
+    virtual void doNextEvent();
+    inline mode_t mode() const {return _mode;}
+
+    // mode of scanners created from now on
+    static thread_local mode_t _default_mode;
+private:
+    struct Entry {
+        simtime_picosec when;
+        uint32_t index;
+        RtxTimerClient* client;
+        bool operator>(const Entry& other) const {
+            return when > other.when || (when == other.when && index > other.index);
+        }
+    };
+    void arm(RtxTimerClient& client, simtime_picosec when);
+    void schedule();
+
+    mode_t _mode;
+    simtime_picosec _scanPeriod;
+    uint32_t _clients;
+    std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> _due;
+    std::vector<RtxTimerClient*> _batch;
+    // our pending event in EXACT mode
+    simtime_picosec _scheduled;
+    EventList::Handle _handle;
 };
 
+inline void
+RtxTimerClient::rtx_deadline_changed() {
+    if (_rtx_scanner)
+        _rtx_scanner->update(*this);
+}
+
 #endif
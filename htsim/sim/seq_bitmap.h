@@ -0,0 +1,128 @@
+// -*- c-basic-offset: 4; indent-tabs-mode: nil -*-
+#ifndef SEQ_BITMAP_H
+#define SEQ_BITMAP_H
+
+/*
+ * One bit per sequence number, for a receiver to remember which
+ * packets above a hole it already has.
+ *
+ * Only numbers from base() upwards can be set.  The owner moves the
+ * base forward with pop_run() as holes are filled, which clears the
+ * bits it passes, so the storage only has to span from the base to the
+ * highest number set: a circular array of 64-bit words that doubles
+ * when a number beyond its end is set.  A receiver that never sees
+ * reordering allocates nothing.
+ */
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+class SeqBitmap {
+public:
+    SeqBitmap() : _base(0) {}
+
+    inline uint64_t base() const {return _base;}
+
+    inline bool test(uint64_t seq) const {
+        if (seq < _base || !in_window(seq >> 6))
+            return false;
+        return (word(seq >> 6) >> (seq & 63)) & 1;
+    }
+
+    void set(uint64_t seq) {
+        assert(seq >= _base);
+        uint64_t w = seq >> 6;
+        if (!in_window(w))
+            grow(w);
+        word(w) |= (uint64_t)1 << (seq & 63);
+    }
+
+    // the 64 bits from seq upwards, the bit for seq being bit 0
+    uint64_t bits(uint64_t seq) const {
+        uint64_t w = seq >> 6;
+        unsigned shift = seq & 63;
+        uint64_t b = read(w) >> shift;
+        if (shift)
+            b |= read(w + 1) << (64 - shift);
+        return b;
+    }
+
+    // Move the base to seq, then past the run of set bits that starts
+    // there, clearing them; returns how many there were.  No bits may
+    // be set below seq.
+    uint64_t pop_run(uint64_t seq) {
+        assert(seq >= _base);
+        _base = seq;
+        uint64_t n = 0;
+        while (true) {
+            uint64_t w = _base >> 6;
+            if (!in_window(w))
+                break;
+            unsigned shift = _base & 63;
+            uint64_t& b = word(w);
+            // set bits from _base upwards, up to the first clear one
+            uint64_t run = ~(b >> shift);
+            unsigned len = run ? __builtin_ctzll(run) : 64 - shift;
+            if (shift + len < 64) {
+                b &= ~(((((uint64_t)1 << len) - 1)) << shift);
+                n += len;
+                _base += len;
+                break;
+            }
+            b &= shift ? ((uint64_t)1 << shift) - 1 : 0;
+            n += len;
+            _base += len;
+        }
+        return n;
+    }
+
+    // clear every bit and move the base back to 0
+    void clear() {
+        _base = 0;
+        _words.clear();
+    }
+
+    // number of bits set
+    uint64_t count() const {
+        uint64_t n = 0;
+        for (uint64_t b : _words) {
+            n += __builtin_popcountll(b);
+        }
+        return n;
+    }
+
+    template<class C> void checkpoint(C& cp) {
+        cp.io(_base);
+        cp.io(_words);
+    }
+private:
+    // words outside [base, base + size) are all zero
+    inline bool in_window(uint64_t w) const {
+        return w - (_base >> 6) < _words.size();
+    }
+    inline uint64_t& word(uint64_t w) {return _words[w & (_words.size() - 1)];}
+    inline uint64_t word(uint64_t w) const {return _words[w & (_words.size() - 1)];}
+    inline uint64_t read(uint64_t w) const {
+        return in_window(w) ? word(w) : 0;
+    }
+
+    void grow(uint64_t w) {
+        uint64_t first = _base >> 6;
+        size_t size = _words.empty() ? 1 : _words.size();
+        while (w - first >= size) {
+            size *= 2;
+        }
+        std::vector<uint64_t> words(size, 0);
+        for (uint64_t i = first; i < first + _words.size(); i++) {
+            words[i & (size - 1)] = word(i);
+        }
+        _words.swap(words);
+    }
+
+    uint64_t _base;
+    std::vector<uint64_t> _words;
+};
+
+#endif
@@ -0,0 +1,130 @@
+// -*- c-basic-offset: 4; indent-tabs-mode: nil -*-
+#include "seq_bitmap.h"
+
+#include <cstdint>
+#include <random>
+#include <set>
+
+#include <gtest/gtest.h>
+
+TEST(SeqBitmapTest, EmptyAllocatesNothing) {
+    SeqBitmap bitmap;
+    EXPECT_EQ(bitmap.base(), 0u);
+    EXPECT_FALSE(bitmap.test(0));
+    EXPECT_EQ(bitmap.bits(0), 0u);
+    EXPECT_EQ(bitmap.pop_run(5), 0u);
+    EXPECT_EQ(bitmap.base(), 5u);
+    EXPECT_EQ(bitmap.count(), 0u);
+}
+
+TEST(SeqBitmapTest, OutOfOrderSets) {
+    SeqBitmap bitmap;
+    bitmap.set(9);
+    bitmap.set(3);
+    bitmap.set(5);
+    bitmap.set(4);
+    EXPECT_TRUE(bitmap.test(3));
+    EXPECT_TRUE(bitmap.test(4));
+    EXPECT_TRUE(bitmap.test(5));
+    EXPECT_FALSE(bitmap.test(6));
+    EXPECT_TRUE(bitmap.test(9));
+    EXPECT_EQ(bitmap.bits(3), 0x47u);
+    EXPECT_EQ(bitmap.count(), 4u);
+
+    // 0 to 2 arrive, then the run 3 to 5 is popped
+    EXPECT_EQ(bitmap.pop_run(3), 3u);
+    EXPECT_EQ(bitmap.base(), 6u);
+    EXPECT_FALSE(bitmap.test(3));
+    EXPECT_FALSE(bitmap.test(5));
+    EXPECT_TRUE(bitmap.test(9));
+    EXPECT_EQ(bitmap.count(), 1u);
+}
+
+TEST(SeqBitmapTest, BaseAdvancesPastHolesAcrossWords) {
+    SeqBitmap bitmap;
+    for (uint64_t seq = 60; seq < 140; seq++) {
+        if (seq != 65 && seq != 128)
+            bitmap.set(seq);
+    }
+    EXPECT_EQ(bitmap.bits(60), ~(uint64_t)0 & ~((uint64_t)1 << 5));
+
+    EXPECT_EQ(bitmap.pop_run(60), 5u);
+    EXPECT_EQ(bitmap.base(), 65u);
+    // 65 arrives in order, so the run after it is popped
+    EXPECT_EQ(bitmap.pop_run(66), 128u - 66);
+    EXPECT_EQ(bitmap.base(), 128u);
+    EXPECT_FALSE(bitmap.test(127));
+    EXPECT_EQ(bitmap.pop_run(129), 140u - 129);
+    EXPECT_EQ(bitmap.base(), 140u);
+    EXPECT_EQ(bitmap.count(), 0u);
+
+    // the bits cleared on the way are not set again in later words
+    bitmap.set(140 + 64);
+    EXPECT_EQ(bitmap.count(), 1u);
+    EXPECT_FALSE(bitmap.test(140));
+    EXPECT_TRUE(bitmap.test(140 + 64));
+}
+
+TEST(SeqBitmapTest, GrowsPastItsCapacity) {
+    SeqBitmap bitmap;
+    bitmap.set(1);
+    bitmap.set(1000);
+    bitmap.set(5000);
+    EXPECT_TRUE(bitmap.test(1));
+    EXPECT_TRUE(bitmap.test(1000));
+    EXPECT_TRUE(bitmap.test(5000));
+    EXPECT_FALSE(bitmap.test(4999));
+    EXPECT_EQ(bitmap.count(), 3u);
+
+    // grow again once the base has moved, so the words wrap around
+    EXPECT_EQ(bitmap.pop_run(1), 1u);
+    EXPECT_EQ(bitmap.pop_run(1000), 1u);
+    bitmap.set(9000);
+    bitmap.set(20000);
+    EXPECT_TRUE(bitmap.test(5000));
+    EXPECT_TRUE(bitmap.test(9000));
+    EXPECT_TRUE(bitmap.test(20000));
+    EXPECT_EQ(bitmap.count(), 3u);
+
+    bitmap.clear();
+    EXPECT_EQ(bitmap.base(), 0u);
+    EXPECT_FALSE(bitmap.test(5000));
+    EXPECT_EQ(bitmap.count(), 0u);
+}
+
+TEST(SeqBitmapTest, MatchesASet) {
+    std::mt19937_64 rng(1);
+    SeqBitmap bitmap;
+    std::set<uint64_t> model;
+    uint64_t base = 0;
+    for (int step = 0; step < 20000; step++) {
+        if (rng() % 3) {
+            // the span widens, so the storage grows while the base moves
+            uint64_t seq = base + rng() % (64 + step / 4);
+            bitmap.set(seq);
+            model.insert(seq);
+        } else {
+            // a run can only be popped from at or below the lowest bit set
+            uint64_t limit = model.empty() ? base + 100 : *model.begin();
+            uint64_t seq = base + rng() % (limit - base + 1);
+            uint64_t n = 0;
+            while (model.erase(seq + n)) {
+                n++;
+            }
+            base = seq + n;
+            ASSERT_EQ(bitmap.pop_run(seq), n);
+            ASSERT_EQ(bitmap.base(), base);
+        }
+        uint64_t probe = base + rng() % (64 + step / 4);
+        ASSERT_EQ(bitmap.test(probe), model.count(probe) == 1);
+    }
+    EXPECT_EQ(bitmap.count(), model.size());
+    for (uint64_t seq = base; seq < base + 5100; seq++) {
+        ASSERT_EQ(bitmap.test(seq), model.count(seq) == 1);
+    }
+}
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,91 @@
+// -*- c-basic-offset: 4; indent-tabs-mode: nil -*-
+#ifndef SEQ_WINDOW_H
+#define SEQ_WINDOW_H
+
+/*
+ * Per-sequence-number state for a sender, for the numbers from base()
+ * up to end(): those it has sent and not yet seen cumulatively acked.
+ *
+ * Sequence numbers are dense, so rather than a map keyed by them the
+ * records sit in a circular array indexed by sequence number, which
+ * doubles when the window outgrows it.  at() extends the window up to
+ * the number it is given, with default-constructed records; advance()
+ * drops the records below a new base.  Finding a record is an index.
+ */
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+template <typename T> class SeqWindow {
+public:
+    SeqWindow() : _base(0), _end(0) {}
+
+    inline uint64_t base() const {return _base;}
+    inline uint64_t end() const {return _end;}
+    inline bool empty() const {return _base == _end;}
+
+    // the record for seq, or NULL if it's outside the window
+    inline T* find(uint64_t seq) {
+        if (seq - _base >= _end - _base)
+            return NULL;
+        return &slot(seq);
+    }
+
+    // the record for seq, extending the window to cover it
+    T& at(uint64_t seq) {
+        assert(seq >= _base);
+        if (seq >= _end) {
+            if (seq - _base >= _slots.size())
+                grow(seq - _base + 1);
+            for (; _end <= seq; _end++) {
+                slot(_end) = T();
+            }
+        }
+        return slot(seq);
+    }
+
+    // forget the records below seq
+    void advance(uint64_t seq) {
+        if (seq <= _base)
+            return;
+        _base = seq;
+        if (_end < _base)
+            _end = _base;
+    }
+
+    template<class C> void checkpoint(C& cp) {
+        cp.io(_base);
+        uint64_t end = _end;
+        cp.io(end);
+        if (cp.restoring()) {
+            _end = _base;
+            if (end > _base)
+                at(end - 1);
+        }
+        for (uint64_t seq = _base; seq < _end; seq++) {
+            cp.io(slot(seq));
+        }
+    }
+private:
+    inline T& slot(uint64_t seq) {return _slots[seq & (_slots.size() - 1)];}
+
+    void grow(uint64_t n) {
+        size_t size = _slots.empty() ? 8 : _slots.size();
+        while (size < n) {
+            size *= 2;
+        }
+        std::vector<T> slots(size);
+        for (uint64_t seq = _base; seq < _end; seq++) {
+            slots[seq & (size - 1)] = slot(seq);
+        }
+        _slots.swap(slots);
+    }
+
+    uint64_t _base;
+    uint64_t _end;
+    std::vector<T> _slots;
+};
+
+#endif
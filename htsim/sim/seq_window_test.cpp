@@ -0,0 +1,136 @@
+// -*- c-basic-offset: 4; indent-tabs-mode: nil -*-
+#include "seq_window.h"
+
+#include <cstdint>
+#include <map>
+#include <random>
+
+#include <gtest/gtest.h>
+
+struct Record {
+    Record() : value(-1) {}
+    int64_t value;
+};
+
+TEST(SeqWindowTest, AtExtendsWithDefaultRecords) {
+    SeqWindow<Record> window;
+    EXPECT_TRUE(window.empty());
+    EXPECT_EQ(window.find(0), nullptr);
+
+    window.at(3).value = 3;
+    EXPECT_EQ(window.base(), 0u);
+    EXPECT_EQ(window.end(), 4u);
+    ASSERT_NE(window.find(0), nullptr);
+    EXPECT_EQ(window.find(0)->value, -1);
+    EXPECT_EQ(window.find(3)->value, 3);
+    EXPECT_EQ(window.find(4), nullptr);
+}
+
+TEST(SeqWindowTest, OutOfOrderRecords) {
+    SeqWindow<Record> window;
+    window.at(5).value = 5;
+    window.at(2).value = 2;
+    window.at(7).value = 7;
+    EXPECT_EQ(window.end(), 8u);
+    EXPECT_EQ(window.find(2)->value, 2);
+    EXPECT_EQ(window.find(5)->value, 5);
+    EXPECT_EQ(window.find(6)->value, -1);
+    EXPECT_EQ(window.find(7)->value, 7);
+}
+
+TEST(SeqWindowTest, AdvancePastHoles) {
+    SeqWindow<Record> window;
+    window.at(1).value = 1;
+    window.at(5).value = 5;
+
+    window.advance(3);
+    EXPECT_EQ(window.base(), 3u);
+    EXPECT_EQ(window.find(1), nullptr);
+    EXPECT_EQ(window.find(2), nullptr);
+    EXPECT_EQ(window.find(3)->value, -1);
+    EXPECT_EQ(window.find(5)->value, 5);
+
+    // going backwards does nothing
+    window.advance(2);
+    EXPECT_EQ(window.base(), 3u);
+
+    // past the end empties the window, and it restarts from there
+    window.advance(10);
+    EXPECT_TRUE(window.empty());
+    EXPECT_EQ(window.end(), 10u);
+    EXPECT_EQ(window.find(5), nullptr);
+    window.at(12).value = 12;
+    EXPECT_EQ(window.find(10)->value, -1);
+    EXPECT_EQ(window.find(11)->value, -1);
+    EXPECT_EQ(window.find(12)->value, 12);
+}
+
+TEST(SeqWindowTest, RecordsAreResetWhenSlotsAreReused) {
+    SeqWindow<Record> window;
+    for (uint64_t seq = 0; seq < 8; seq++) {
+        window.at(seq).value = seq;
+    }
+    window.advance(8);
+    // the same slots, for new numbers
+    window.at(15);
+    for (uint64_t seq = 8; seq < 16; seq++) {
+        EXPECT_EQ(window.find(seq)->value, -1);
+    }
+}
+
+TEST(SeqWindowTest, GrowsPastItsCapacity) {
+    SeqWindow<Record> window;
+    window.advance(5);
+    for (uint64_t seq = 5; seq < 1005; seq++) {
+        window.at(seq).value = seq;
+    }
+    // a window that wraps around its slots when it grows
+    window.advance(900);
+    for (uint64_t seq = 1005; seq < 5000; seq++) {
+        window.at(seq).value = seq;
+    }
+    EXPECT_EQ(window.base(), 900u);
+    EXPECT_EQ(window.end(), 5000u);
+    for (uint64_t seq = 900; seq < 5000; seq++) {
+        ASSERT_EQ(window.find(seq)->value, (int64_t)seq);
+    }
+}
+
+TEST(SeqWindowTest, MatchesAMap) {
+    std::mt19937_64 rng(1);
+    SeqWindow<Record> window;
+    std::map<uint64_t, int64_t> model;
+    uint64_t base = 0, end = 0;
+    for (int step = 0; step < 20000; step++) {
+        if (rng() % 4) {
+            // the span widens, so the slots grow while the base moves
+            uint64_t seq = base + rng() % (8 + step / 8);
+            int64_t value = rng() % 1000;
+            window.at(seq).value = value;
+            model[seq] = value;
+            end = seq + 1 > end ? seq + 1 : end;
+        } else {
+            uint64_t seq = base + rng() % (4 + step / 16);
+            window.advance(seq);
+            base = seq;
+            end = end < base ? base : end;
+            model.erase(model.begin(), model.lower_bound(base));
+        }
+        ASSERT_EQ(window.base(), base);
+        ASSERT_EQ(window.end(), end);
+        uint64_t probe = base + rng() % (8 + step / 8);
+        Record* r = window.find(probe);
+        if (probe >= end) {
+            ASSERT_EQ(r, nullptr);
+        } else {
+            auto it = model.find(probe);
+            ASSERT_NE(r, nullptr);
+            ASSERT_EQ(r->value, it == model.end() ? -1 : it->second);
+        }
+    }
+}
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
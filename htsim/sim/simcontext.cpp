@@ -0,0 +1,86 @@
+// -*- c-basic-offset: 4; indent-tabs-mode: nil -*-
+#include "simcontext.h"
+#include <iostream>
+
+// Installed as cout's and cerr's buffers while contexts run: output
+// goes to the buffer of the context running on the current thread, or
+// to the original buffer from any other thread.
+class ContextStreambuf : public streambuf {
+public:
+    ContextStreambuf(streambuf* fallback) : _fallback(fallback) {}
+    static thread_local streambuf* _target;
+protected:
+    virtual int overflow(int c) {
+        if (c == EOF)
+            return 0;
+        return target()->sputc(c);
+    }
+    virtual streamsize xsputn(const char* s, streamsize n) {
+        return target()->sputn(s, n);
+    }
+    virtual int sync() {
+        return target()->pubsync();
+    }
+private:
+    streambuf* target() {return _target ? _target : _fallback;}
+    streambuf* _fallback;
+};
+
+thread_local streambuf* ContextStreambuf::_target = NULL;
+
+SimContext::SimContext(const string& name, Body body)
+    : _name(name), _body(body), _result(0), _done(false)
+{
+}
+
+void
+SimContext::start() {
+    assert(!_thread.joinable() && !_done);
+    _thread = std::thread(&SimContext::run, this);
+}
+
+void
+SimContext::run() {
+    ContextStreambuf::_target = _output.rdbuf();
+    _result = _body();
+    cout.flush();
+    cerr.flush();
+    ContextStreambuf::_target = NULL;
+    _done = true;
+}
+
+int
+SimContext::join() {
+    _thread.join();
+    return _result;
+}
+
+int
+SimContext::run_all(vector<SimContext*>& contexts, unsigned max_threads, ostream& os) {
+    assert(max_threads > 0);
+    ContextStreambuf demux(cout.rdbuf());
+    ContextStreambuf demux_err(cerr.rdbuf());
+    streambuf* old = cout.rdbuf(&demux);
+    streambuf* old_err = cerr.rdbuf(&demux_err);
+
+    // contexts are started in order and joined in order, keeping at
+    // most max_threads running
+    int failed = 0;
+    size_t next = 0;
+    for (size_t i = 0; i < contexts.size(); i++) {
+        while (next < contexts.size() && next < i + max_threads) {
+            contexts[next++]->start();
+        }
+        int result = contexts[i]->join();
+        os << contexts[i]->output();
+        if (result != 0) {
+            os << contexts[i]->name() << " failed with status " << result << endl;
+            failed++;
+        }
+        os.flush();
+    }
+
+    cout.rdbuf(old);
+    cerr.rdbuf(old_err);
+    return failed;
+}
@@ -0,0 +1,67 @@
+// -*- c-basic-offset: 4; indent-tabs-mode: nil -*-
+#ifndef SIMCONTEXT_H
+#define SIMCONTEXT_H
+
+/*
+ * A SimContext runs one simulation on a thread of its own.
+ *
+ * Everything a simulation treats as global - its EventList, the
+ * Logged ID allocator, the PacketDB pools, the random number engine
+ * and the protocol and switch parameters (UecSrc::_mss,
+ * FatTreeSwitch::_strategy and so on) - is thread_local, so a context
+ * starts from the compiled-in defaults and is unaffected by any other
+ * context running at the same time.  The body of a context is
+ * typically a complete main(): it builds its own EventList, topology
+ * and connections and runs them to completion.
+ *
+ * Anything the body writes to cout or cerr is kept in the context and
+ * can be printed once it is done, so that the output of concurrent
+ * runs does not interleave.  C stdio (printf, fprintf) is not
+ * separated and goes straight to the process's stdout and stderr.
+ *
+ * A body reports failure by returning non-zero.  It must not call
+ * exit(), which would end every context and lose their output.  A
+ * context's thread exits when the body returns; a thread is never
+ * reused, as its thread_local state is not reset.
+ */
+
+#include <atomic>
+#include <functional>
+#include <sstream>
+#include <thread>
+#include <vector>
+#include "config.h"
+
+class SimContext {
+public:
+    typedef std::function<int()> Body;
+
+    SimContext(const string& name, Body body);
+    SimContext(const SimContext&) = delete;
+    void operator=(const SimContext&) = delete;
+
+    void start();
+    // wait for the body to return, and give its return value
+    int join();
+    bool done() const {return _done;}
+    const string& name() const {return _name;}
+    string output() const {return _output.str();}
+
+    // Run all the contexts, at most max_threads at a time, printing
+    // the output of each to os in order as they complete, and saying
+    // which of them failed.  Returns the number of contexts whose body
+    // returned non-zero.
+    static int run_all(std::vector<SimContext*>& contexts, unsigned max_threads, ostream& os);
+private:
+    void run();
+
+    string _name;
+    Body _body;
+    std::thread _thread;
+    int _result;
+    // set by the context's thread, read by any other
+    std::atomic<bool> _done;
+    ostringstream _output;
+};
+
+#endif
@@ -0,0 +1,85 @@
+// -*- c-basic-offset: 4; indent-tabs-mode: nil -*-
+#include "simcontext.h"
+
+#include <iostream>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "eventlist.h"
+
+class CountingSource : public EventSource {
+   public:
+    CountingSource(EventList& eventlist) : EventSource(eventlist, "counter"), count_(0) {}
+    virtual void doNextEvent() {
+        count_++;
+        if (count_ < 10)
+            eventlist().sourceIsPendingRel(*this, 1000);
+    }
+    int count_;
+};
+
+// a complete small simulation; returns the id of its first Logged object
+static int simulate(int delay) {
+    EventList eventlist;
+    CountingSource src(eventlist);
+    eventlist.sourceIsPending(src, delay);
+    while (eventlist.doNextEvent()) {
+    }
+    cout << "count " << src.count_ << " end " << eventlist.now() << endl;
+    return src.get_id();
+}
+
+TEST(SimContextTest, ContextsAreIndependent) {
+    std::vector<SimContext*> contexts;
+    std::vector<int> ids(4, 0);
+    for (int i = 0; i < 4; i++) {
+        contexts.push_back(new SimContext("sim", [i, &ids]() {
+            ids[i] = simulate(i * 100);
+            return 0;
+        }));
+    }
+    std::ostringstream out;
+    EXPECT_EQ(SimContext::run_all(contexts, 2, out), 0);
+
+    // each context starts from fresh IDs and its own event list, and
+    // the output comes back in order
+    for (int i = 1; i < 4; i++) {
+        EXPECT_EQ(ids[i], ids[0]);
+    }
+    EXPECT_EQ(out.str(),
+              "count 10 end 9000\ncount 10 end 9100\ncount 10 end 9200\ncount 10 end 9300\n");
+    for (SimContext* ctx : contexts) {
+        EXPECT_TRUE(ctx->done());
+        delete ctx;
+    }
+}
+
+TEST(SimContextTest, CerrIsKeptWithTheContext) {
+    std::vector<SimContext*> contexts;
+    for (int i = 0; i < 3; i++) {
+        contexts.push_back(new SimContext("sim" + std::to_string(i), [i]() {
+            cout << "run " << i << endl;
+            cerr << "warning " << i << endl;
+            return i == 1;
+        }));
+    }
+    std::ostringstream out;
+    EXPECT_EQ(SimContext::run_all(contexts, 3, out), 1);
+    EXPECT_EQ(out.str(), "run 0\nwarning 0\nrun 1\nwarning 1\nsim1 failed with status 1\n"
+                         "run 2\nwarning 2\n");
+    for (SimContext* ctx : contexts) {
+        delete ctx;
+    }
+}
+
+TEST(SimContextTest, EventListCanBeRecreated) {
+    // one simulation at a time per thread, but one after another is fine
+    simulate(0);
+    simulate(0);
+}
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -161,6 +161,7 @@ STrackSrc::handle_ack(STrackAck::seq_t ackno) {
             _highest_sent = ackno;
             _RFC2988_RTO_timeout = timeInf;// RFC 2988 5.2
         }
+        rtx_deadline_changed();
 
         if (!_in_fast_recovery) {
             // best behaviour: proper ack of a new packet, when we were expecting it.
@@ -272,6 +273,7 @@ STrackSrc::send_packets() {
 
         if(_RFC2988_RTO_timeout == timeInf) {// RFC2988 5.1
             _RFC2988_RTO_timeout = eventlist().now() + _rto;
+            rtx_deadline_changed();
         }        
         //cout << "Sending SYN, waiting for SYN/ACK" << endl;
         return sent_count;
@@ -329,6 +331,7 @@ STrackSrc::send_packets() {
 
         if(_RFC2988_RTO_timeout == timeInf) {// RFC2988 5.1
             _RFC2988_RTO_timeout = eventlist().now() + _rto;
+            rtx_deadline_changed();
             //cout << timeAsUs(eventlist().now()) << " " << nodename() << " RTO at " << timeAsUs(_RFC2988_RTO_timeout) << "us" << endl;
         }
     }
@@ -392,6 +395,7 @@ STrackSrc::retransmit_packet() {
 
     if(_RFC2988_RTO_timeout == timeInf) {// RFC2988 5.1
         _RFC2988_RTO_timeout = eventlist().now() + _rto;
+        rtx_deadline_changed();
     }
 }
 
@@ -444,6 +448,14 @@ STrackSrc::receivePacket(Packet& pkt)
     handle_ack(ackno);
 }
 
+simtime_picosec
+STrackSrc::rtx_timer_due(simtime_picosec period) {
+    // rtx_timer_hook acts once we're past the timeout
+    if (_RFC2988_RTO_timeout == timeInf)
+        return NEVER;
+    return _RFC2988_RTO_timeout + 1;
+}
+
 void
 STrackSrc::rtx_timer_hook(simtime_picosec now, simtime_picosec period) {
     //cout << timeAsUs(eventlist().now()) << " " << nodename() << " rtx_timer_hook" << endl;
@@ -827,20 +839,5 @@ STrackSink::drops() {
 ////////////////////////////////////////////////////////////////
 
 STrackRtxTimerScanner::STrackRtxTimerScanner(simtime_picosec scanPeriod, EventList& eventlist)
-    : EventSource(eventlist,"RtxScanner"), _scanPeriod(scanPeriod) {
-    eventlist.sourceIsPendingRel(*this, _scanPeriod);
-}
-
-void 
-STrackRtxTimerScanner::registerSrc(STrackSrc &src) {
-    _srcs.push_back(&src);
-}
-
-void STrackRtxTimerScanner::doNextEvent() {
-    simtime_picosec now = eventlist().now();
-    srcs_t::iterator i;
-    for (i = _srcs.begin(); i!=_srcs.end(); i++) {
-        (*i)->rtx_timer_hook(now,_scanPeriod);
-    }
-    eventlist().sourceIsPendingRel(*this, _scanPeriod);
+    : RtxTimerScanner(scanPeriod, scanPeriod, eventlist) {
 }
@@ -13,6 +13,7 @@
 #include "strackpacket.h"
 #include "swift_scheduler.h"
 #include "eventlist.h"
+#include "rtx_timer.h"
 #include "sent_packets.h"
 
 //#define MODEL_RECEIVE_WINDOW 1
@@ -39,7 +40,7 @@ private:
     simtime_picosec _next_send;  // when the next scheduled packet should be sent
 };
 
-class STrackSrc : public EventSource, public PacketSink, public ScheduledSrc {
+class STrackSrc : public EventSource, public PacketSink, public ScheduledSrc, public RtxTimerClient {
     friend class STrackSink;
     friend class STrackRtxTimerScanner;
     //friend class STrackSubflowSrc;
@@ -133,6 +134,7 @@ class STrackSrc : public EventSource, public PacketSink, public ScheduledSrc {
     void move_path();
     void reroute(const Route &route);
     void rtx_timer_hook(simtime_picosec now, simtime_picosec period);
+    simtime_picosec rtx_timer_due(simtime_picosec period);
     inline simtime_picosec pacing_delay() const {return _pacing_delay;}
     PacketFlow& flow() {return _flow;}
     uint32_t drops() { return _drops;}
@@ -232,15 +234,10 @@ class STrackSink : public PacketSink, public DataReceiver {
     ReorderBufferLogger* _buffer_logger;
 };
 
-class STrackRtxTimerScanner : public EventSource {
+class STrackRtxTimerScanner : public RtxTimerScanner {
  public:
     STrackRtxTimerScanner(simtime_picosec scanPeriod, EventList& eventlist);
-    void doNextEvent();
-    void registerSrc(STrackSrc &src);
- private:
-    simtime_picosec _scanPeriod;
-    typedef list<STrackSrc*> srcs_t;
-    srcs_t _srcs;
+    void registerSrc(STrackSrc &src) {registerClient(src);}
 };
 
 #endif
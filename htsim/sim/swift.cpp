@@ -181,6 +181,7 @@ SwiftSubflowSrc::handle_ack(SwiftAck::seq_t ackno) {
             //cout << timeAsUs(now) << " " << nodename() << " highest_sent now  " << _highest_sent << endl;
             _RFC2988_RTO_timeout = timeInf;// RFC 2988 5.2
         }
+        rtx_deadline_changed();
 
         if (!_in_fast_recovery) {
             // best behaviour: proper ack of a new packet, when we were expecting it.
@@ -292,6 +293,7 @@ SwiftSubflowSrc::send_packets() {
 
         if(_RFC2988_RTO_timeout == timeInf) {// RFC2988 5.1
             _RFC2988_RTO_timeout = eventlist().now() + _rto;
+            rtx_deadline_changed();
         }        
         //cout << "Sending SYN, waiting for SYN/ACK" << endl;
         return sent_count;
@@ -349,6 +351,7 @@ SwiftSubflowSrc::send_packets() {
 
         if(_RFC2988_RTO_timeout == timeInf) {// RFC2988 5.1
             _RFC2988_RTO_timeout = eventlist().now() + _rto;
+            rtx_deadline_changed();
             //cout << timeAsUs(eventlist().now()) << " " << nodename() << " RTO at " << timeAsUs(_RFC2988_RTO_timeout) << "us" << endl;
         }
     }
@@ -424,6 +427,7 @@ SwiftSubflowSrc::retransmit_packet() {
 
     if(_RFC2988_RTO_timeout == timeInf) {// RFC2988 5.1
         _RFC2988_RTO_timeout = eventlist().now() + _rto;
+        rtx_deadline_changed();
     }
 }
 
@@ -464,6 +468,14 @@ SwiftSubflowSrc::receivePacket(Packet& pkt)
     handle_ack(ackno);
 }
 
+simtime_picosec
+SwiftSubflowSrc::rtx_timer_due(simtime_picosec period) {
+    // rtx_timer_hook acts once we're past the timeout
+    if (_RFC2988_RTO_timeout == timeInf)
+        return NEVER;
+    return _RFC2988_RTO_timeout + 1;
+}
+
 void
 SwiftSubflowSrc::rtx_timer_hook(simtime_picosec now, simtime_picosec period) {
     //cout << timeAsUs(eventlist().now()) << " " << nodename() << " rtx_timer_hook" << endl;
@@ -1046,20 +1058,5 @@ SwiftSink::drops(){
 ////////////////////////////////////////////////////////////////
 
 SwiftRtxTimerScanner::SwiftRtxTimerScanner(simtime_picosec scanPeriod, EventList& eventlist)
-    : EventSource(eventlist,"RtxScanner"), _scanPeriod(scanPeriod) {
-    eventlist.sourceIsPendingRel(*this, _scanPeriod);
-}
-
-void 
-SwiftRtxTimerScanner::registerSubflow(SwiftSubflowSrc &subflow_src) {
-    _subflows.push_back(&subflow_src);
-}
-
-void SwiftRtxTimerScanner::doNextEvent() {
-    simtime_picosec now = eventlist().now();
-    subflows_t::iterator i;
-    for (i = _subflows.begin(); i!=_subflows.end(); i++) {
-        (*i)->rtx_timer_hook(now,_scanPeriod);
-    }
-    eventlist().sourceIsPendingRel(*this, _scanPeriod);
+    : RtxTimerScanner(scanPeriod, scanPeriod, eventlist) {
 }
@@ -13,6 +13,7 @@
 #include "swiftpacket.h"
 #include "swift_scheduler.h"
 #include "eventlist.h"
+#include "rtx_timer.h"
 #include "sent_packets.h"
 
 //#define MODEL_RECEIVE_WINDOW 1
@@ -41,7 +42,7 @@ private:
 };
 
 // stuff that is specific to a subflow rather than the whole connection
-class SwiftSubflowSrc : public EventSource, public PacketSink, public ScheduledSrc {
+class SwiftSubflowSrc : public EventSource, public PacketSink, public ScheduledSrc, public RtxTimerClient {
     friend class SwiftSrc;
     friend class SwiftLoggerSimple;
 public:
@@ -57,6 +58,7 @@ public:
     void reroute(const Route &route);
     void doNextEvent();
     void rtx_timer_hook(simtime_picosec now, simtime_picosec period);
+    simtime_picosec rtx_timer_due(simtime_picosec period);
     inline simtime_picosec pacing_delay() const {return _pacing_delay;}
     PacketFlow& flow() {return _flow;}
     uint32_t drops() const { return _drops;}
@@ -293,15 +295,10 @@ private:
     ReorderBufferLogger* _buffer_logger;
 };
 
-class SwiftRtxTimerScanner : public EventSource {
+class SwiftRtxTimerScanner : public RtxTimerScanner {
 public:
     SwiftRtxTimerScanner(simtime_picosec scanPeriod, EventList& eventlist);
-    void doNextEvent();
-    void registerSubflow(SwiftSubflowSrc &subflow_src);
-private:
-    simtime_picosec _scanPeriod;
-    typedef list<SwiftSubflowSrc*> subflows_t;
-    subflows_t _subflows;
+    void registerSubflow(SwiftSubflowSrc &subflow_src) {registerClient(subflow_src);}
 };
 
 #endif
@@ -45,8 +45,8 @@ class Switch : public EventSource, public Drawable, public PacketSink {
     virtual void doNextEvent() {abort();}
 
     //used when route strategy is ECMP_FIB and variants. 
-    virtual Route* getNextHop(Packet& pkt) { return getNextHop(pkt, NULL);}
-    virtual Route* getNextHop(Packet& pkt, BaseQueue* ingress_port) {abort();};
+    virtual const Route* getNextHop(Packet& pkt) { return getNextHop(pkt, NULL);}
+    virtual const Route* getNextHop(Packet& pkt, BaseQueue* ingress_port) {abort();};
 
     BaseQueue* getPort(int id) { assert(id >= 0); if ((unsigned int)id<_ports.size()) return _ports.at(id); else return NULL;}
 
@@ -69,6 +69,6 @@ protected:
 
     RouteTable* _fib;
  
-    static uint32_t id;
+    static thread_local uint32_t id;
 };
 #endif
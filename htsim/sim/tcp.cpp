@@ -203,6 +203,7 @@ TcpSrc::receivePacket(Packet& pkt)
             _RFC2988_RTO_timeout = timeInf;// RFC 2988 5.2
             _last_ping = timeInf;
         }
+        rtx_deadline_changed();
 
 #ifdef MODEL_RECEIVE_WINDOW
         int cnt;
@@ -393,6 +394,7 @@ TcpSrc::send_packets() {
 
         if(_RFC2988_RTO_timeout == timeInf) {// RFC2988 5.1
             _RFC2988_RTO_timeout = eventlist().now() + _rto;
+            rtx_deadline_changed();
         }        
         //cout << "Sending SYN, waiting for SYN/ACK" << endl;
         return;
@@ -471,6 +473,7 @@ TcpSrc::send_packets() {
 
         if(_RFC2988_RTO_timeout == timeInf) {// RFC2988 5.1
             _RFC2988_RTO_timeout = eventlist().now() + _rto;
+            rtx_deadline_changed();
         }
     }
 }
@@ -526,9 +529,17 @@ TcpSrc::retransmit_packet() {
 
     if(_RFC2988_RTO_timeout == timeInf) {// RFC2988 5.1
         _RFC2988_RTO_timeout = eventlist().now() + _rto;
+        rtx_deadline_changed();
     }
 }
 
+simtime_picosec TcpSrc::rtx_timer_due(simtime_picosec period) {
+    // rtx_timer_hook acts once we're past the timeout
+    if (_RFC2988_RTO_timeout == timeInf)
+        return NEVER;
+    return _RFC2988_RTO_timeout + 1;
+}
+
 void TcpSrc::rtx_timer_hook(simtime_picosec now, simtime_picosec period) {
     if (now <= _RFC2988_RTO_timeout || _RFC2988_RTO_timeout==timeInf) 
         return;
@@ -731,20 +742,5 @@ void TcpSink::set_paths(vector<const Route*>* rt) {
 ////////////////////////////////////////////////////////////////
 
 TcpRtxTimerScanner::TcpRtxTimerScanner(simtime_picosec scanPeriod, EventList& eventlist)
-    : EventSource(eventlist,"RtxScanner"), _scanPeriod(scanPeriod) {
-    eventlist.sourceIsPendingRel(*this, _scanPeriod);
-}
-
-void 
-TcpRtxTimerScanner::registerTcp(TcpSrc &tcpsrc) {
-    _tcps.push_back(&tcpsrc);
-}
-
-void TcpRtxTimerScanner::doNextEvent() {
-    simtime_picosec now = eventlist().now();
-    tcps_t::iterator i;
-    for (i = _tcps.begin(); i!=_tcps.end(); i++) {
-        (*i)->rtx_timer_hook(now,_scanPeriod);
-    }
-    eventlist().sourceIsPendingRel(*this, _scanPeriod);
+    : RtxTimerScanner(scanPeriod, scanPeriod, eventlist) {
 }
@@ -12,6 +12,7 @@
 #include "tcppacket.h"
 #include "eventlist.h"
 #include "sent_packets.h"
+#include "rtx_timer.h"
 
 //#define MODEL_RECEIVE_WINDOW 1
 
@@ -26,7 +27,7 @@ class TcpSink;
 class MultipathTcpSrc;
 class MultipathTcpSink;
 
-class TcpSrc : public PacketSink, public EventSource {
+class TcpSrc : public PacketSink, public EventSource, public RtxTimerClient {
     friend class TcpSink;
 public:
     TcpSrc(TcpLogger* logger, TrafficLogger* pktlogger, EventList &eventlist);
@@ -55,6 +56,7 @@ public:
 
     uint32_t effective_window();
     virtual void rtx_timer_hook(simtime_picosec now,simtime_picosec period);
+    virtual simtime_picosec rtx_timer_due(simtime_picosec period);
     virtual const string& nodename() { return _nodename; }
 
     // should really be private, but loggers want to see:
@@ -182,15 +184,10 @@ private:
     string _nodename;
 };
 
-class TcpRtxTimerScanner : public EventSource {
+class TcpRtxTimerScanner : public RtxTimerScanner {
 public:
     TcpRtxTimerScanner(simtime_picosec scanPeriod, EventList& eventlist);
-    void doNextEvent();
-    void registerTcp(TcpSrc &tcpsrc);
-private:
-    simtime_picosec _scanPeriod;
-    typedef list<TcpSrc*> tcps_t;
-    tcps_t _tcps;
+    void registerTcp(TcpSrc &tcpsrc) {registerClient(tcpsrc);}
 };
 
 #endif
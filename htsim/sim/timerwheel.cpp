@@ -0,0 +1,247 @@
+// -*- c-basic-offset: 4; indent-tabs-mode: nil -*-
+#include "timerwheel.h"
+#include <cstring>
+#include "checkpoint.h"
+
+TimerWheel::TimerWheel(EventList& eventlist, simtime_picosec granularity)
+    : EventSource(eventlist, "timerwheel"), _granularity(granularity),
+      _cursor(0), _overflow(NULL), _size(0), _scheduled_tick(NONE), _handle(NULL)
+{
+    assert(granularity > 0);
+    memset(_slots, 0, sizeof(_slots));
+    memset(_occupied, 0, sizeof(_occupied));
+}
+
+bool
+TimerWheel::arm(Timer& timer, simtime_picosec when) {
+    if (timer.armed())
+        cancel(timer);
+    if (!_eventlist.admitTimer(*timer._src, when))
+        return false;
+    timer._when = when;
+    timer._seq = _eventlist.reserveSeq();
+    if (_size == 0) {
+        // nothing on the wheel depends on the old cursor
+        _cursor = max(_cursor, tick_now());
+    }
+    if (key(when) <= tick_now()) {
+        // due before the wheel could move it
+        queue(timer);
+    } else {
+        insert(timer);
+    }
+    return true;
+}
+
+void
+TimerWheel::cancel(Timer& timer) {
+    assert(timer.armed());
+    if (timer._state == Timer::QUEUED) {
+        _eventlist.cancelPendingSourceByHandle(*timer._src, timer._handle);
+    } else {
+        unlink(timer);
+        _eventlist.timerCancelled(*timer._src);
+    }
+    timer._state = Timer::IDLE;
+}
+
+void
+TimerWheel::insert(Timer& timer) {
+    uint64_t k = key(timer._when);
+    if (k <= _cursor) {
+        queue(timer);
+        return;
+    }
+    // the level is the highest block of bits in which k differs from the cursor
+    int level = (63 - __builtin_clzll(k ^ _cursor)) / SLOT_BITS;
+    if (level >= LEVELS) {
+        timer._slot = &_overflow;
+        timer._prev = NULL;
+        timer._next = _overflow;
+        if (_overflow)
+            _overflow->_prev = &timer;
+        _overflow = &timer;
+        timer._state = Timer::ON_WHEEL;
+        _size++;
+        return;
+    }
+    int slot = (k >> (level * SLOT_BITS)) & (SLOTS - 1);
+    link(timer, level, slot);
+
+    // the slot becomes due at its first tick, or at once if the cursor
+    // has fallen behind
+    uint64_t start = (k >> (level * SLOT_BITS)) << (level * SLOT_BITS);
+    if (start < _scheduled_tick)
+        schedule(start);
+}
+
+void
+TimerWheel::link(Timer& timer, int level, int slot) {
+    Timer** head = &_slots[level][slot];
+    timer._slot = head;
+    timer._prev = NULL;
+    timer._next = *head;
+    if (*head)
+        (*head)->_prev = &timer;
+    *head = &timer;
+    _occupied[level][slot / 64] |= (uint64_t)1 << (slot % 64);
+    timer._state = Timer::ON_WHEEL;
+    _size++;
+}
+
+void
+TimerWheel::unlink(Timer& timer) {
+    if (timer._prev)
+        timer._prev->_next = timer._next;
+    else
+        *timer._slot = timer._next;
+    if (timer._next)
+        timer._next->_prev = timer._prev;
+    if (*timer._slot == NULL && timer._slot != &_overflow) {
+        size_t i = timer._slot - &_slots[0][0];
+        int level = i / SLOTS, slot = i % SLOTS;
+        _occupied[level][slot / 64] &= ~((uint64_t)1 << (slot % 64));
+    }
+    _size--;
+}
+
+TimerWheel::Timer*
+TimerWheel::take_slot(int level, int slot) {
+    Timer* list = _slots[level][slot];
+    _slots[level][slot] = NULL;
+    _occupied[level][slot / 64] &= ~((uint64_t)1 << (slot % 64));
+    return list;
+}
+
+void
+TimerWheel::queue(Timer& timer) {
+    timer._handle = _eventlist.addPending(*timer._src, timer._when, timer._seq);
+    timer._state = Timer::QUEUED;
+}
+
+uint64_t
+TimerWheel::next_tick() const {
+    if (_size == 0)
+        return NONE;
+    // Every timer on level l shares the cursor's bits above level l
+    // and is in a later slot than the cursor's, so the first occupied
+    // slot after the cursor's on each level is the next one due there.
+    uint64_t best = NONE;
+    for (int level = 0; level < LEVELS; level++) {
+        int shift = level * SLOT_BITS;
+        int from = ((_cursor >> shift) & (SLOTS - 1)) + 1;
+        for (int w = from / 64; w < WORDS && from < SLOTS; w++) {
+            uint64_t bits = _occupied[level][w];
+            if (w == from / 64)
+                bits &= ~(uint64_t)0 << (from % 64);
+            if (bits) {
+                uint64_t slot = w * 64 + __builtin_ctzll(bits);
+                uint64_t base = (_cursor >> (shift + SLOT_BITS)) << (shift + SLOT_BITS);
+                best = min(best, base + (slot << shift));
+                break;
+            }
+        }
+    }
+    if (_overflow) {
+        const int top = LEVELS * SLOT_BITS;
+        best = min(best, ((_cursor >> top) + 1) << top);
+    }
+    return best;
+}
+
+void
+TimerWheel::schedule(uint64_t tick) {
+    if (_handle)
+        _eventlist.unlinkPending(_handle);
+    _scheduled_tick = tick;
+    _handle = _eventlist.addPending(*this, max(tick * _granularity, _eventlist.now()));
+}
+
+void
+TimerWheel::advance(uint64_t tick) {
+    _cursor = tick;
+    const int top = LEVELS * SLOT_BITS;
+    if (_overflow && (tick & (((uint64_t)1 << top) - 1)) == 0) {
+        Timer* list = _overflow;
+        _overflow = NULL;
+        while (list) {
+            Timer* t = list;
+            list = list->_next;
+            _size--;
+            insert(*t);
+        }
+    }
+    // cascade the upper level slots that start here, top down
+    for (int level = LEVELS - 1; level > 0; level--) {
+        int shift = level * SLOT_BITS;
+        if (tick & (((uint64_t)1 << shift) - 1))
+            continue;
+        Timer* list = take_slot(level, (tick >> shift) & (SLOTS - 1));
+        while (list) {
+            Timer* t = list;
+            list = list->_next;
+            _size--;
+            insert(*t);
+        }
+    }
+    Timer* list = take_slot(0, tick & (SLOTS - 1));
+    while (list) {
+        Timer* t = list;
+        list = list->_next;
+        _size--;
+        queue(*t);
+    }
+}
+
+void
+TimerWheel::doNextEvent() {
+    _handle = NULL;
+    // timers cascaded below don't need us to reschedule as we go
+    _scheduled_tick = 0;
+    while (true) {
+        uint64_t tick = next_tick();
+        if (tick == NONE) {
+            _scheduled_tick = NONE;
+            return;
+        }
+        if (tick * _granularity > _eventlist.now()) {
+            schedule(tick);
+            return;
+        }
+        advance(tick);
+    }
+}
+
+void
+TimerWheel::checkpoint_clear() {
+    assert(_size == 0);
+    if (_handle)
+        _eventlist.unlinkPending(_handle);
+    _handle = NULL;
+    _scheduled_tick = NONE;
+}
+
+void
+TimerWheel::Timer::checkpoint(Checkpoint& cp) {
+    // Only the expiry is saved.  The traffic event count and the
+    // EventList entry of a QUEUED timer are restored with the EventList.
+    state_t state = _state;
+    cp.io(state);
+    cp.io(_when);
+    cp.io(_seq);
+    if (cp.saving())
+        return;
+    if (_state != IDLE)
+        cp.unsupported("a timer armed before the checkpoint was restored");
+    TimerWheel& wheel = _src->eventlist().timers();
+    if (state == ON_WHEEL) {
+        if (wheel._size == 0)
+            wheel._cursor = max(wheel._cursor, wheel.tick_now());
+        wheel.insert(*this);
+    } else if (state == QUEUED) {
+        _handle = _src->eventlist().findPending(*_src, _seq);
+        if (!_handle)
+            cp.unsupported("a queued timer without its event");
+        _state = QUEUED;
+    }
+}
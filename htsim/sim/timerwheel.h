@@ -0,0 +1,119 @@
+// -*- c-basic-offset: 4; indent-tabs-mode: nil -*-
+#ifndef TIMERWHEEL_H
+#define TIMERWHEEL_H
+
+/*
+ * A hierarchical timing wheel (Varghese & Lauck, SOSP 1987) for
+ * timers that are usually cancelled or re-armed long before they
+ * expire, such as retransmission timeouts.
+ *
+ * Arming, re-arming and cancelling a timer that is still on the wheel
+ * is O(1) list manipulation; nothing is inserted into the EventList.
+ * Time is divided into ticks of the wheel's granularity.  Level 0 has
+ * one slot per tick, and each level above has slots 256 times as wide
+ * as the one below; when a slot of an upper level is reached its
+ * timers are cascaded down.  Shortly before a timer expires (during
+ * the tick before it) it is moved into the EventList, and from then
+ * on it is an ordinary pending event of its source.  The wheel itself
+ * only has one event pending, for the next slot that needs attention.
+ *
+ * A timer keeps the sequence number it would have had if it had been
+ * put straight into the EventList when armed, so timers and other
+ * events with the same timestamp fire in exactly the order they would
+ * without the wheel.  The traffic event count and the end time are
+ * also applied as sourceIsPendingGetHandle() does when the timer is
+ * armed.
+ *
+ * Each EventList has one wheel, created on first use by
+ * EventList::timers().
+ */
+
+#include "eventlist.h"
+
+class TimerWheel : public EventSource {
+    friend class EventList;
+public:
+    // A timer belongs to one source; when it expires the source's
+    // doNextEvent() is called, just as for sourceIsPending().
+    class Timer {
+        friend class TimerWheel;
+    public:
+        Timer(EventSource& src) : _src(&src), _state(IDLE), _when(0), _seq(0),
+            _prev(NULL), _next(NULL), _slot(NULL), _handle(NULL) {}
+        inline bool armed() const {return _state != IDLE;}
+        inline simtime_picosec when() const {return _when;}
+        // The owner has seen the timer expire (or no longer cares
+        // about it): forget it without cancelling anything.
+        inline void expired() {assert(_state != ON_WHEEL); _state = IDLE;}
+        // save or restore the timer with its owner's state
+        void checkpoint(Checkpoint& cp);
+    private:
+        enum state_t {IDLE, ON_WHEEL, QUEUED};
+        EventSource* _src;
+        state_t _state;
+        simtime_picosec _when;
+        uint64_t _seq;
+        // links in a wheel slot
+        Timer* _prev;
+        Timer* _next;
+        Timer** _slot;
+        // the EventList entry, once QUEUED
+        EventList::Handle _handle;
+    };
+
+    TimerWheel(EventList& eventlist, simtime_picosec granularity = DEFAULT_GRANULARITY);
+    // Arm (or re-arm) timer to expire at when.  Returns false, leaving
+    // the timer idle, if it would expire after the end of the simulation.
+    bool arm(Timer& timer, simtime_picosec when);
+    // Cancel an armed timer that has not yet expired.
+    void cancel(Timer& timer);
+
+    virtual void doNextEvent();
+    virtual bool isTraffic() {return false;}
+
+    inline simtime_picosec granularity() const {return _granularity;}
+    // timers held on the wheel, not yet moved to the EventList
+    inline uint64_t size() const {return _size;}
+
+    static const simtime_picosec DEFAULT_GRANULARITY = 1000000; // 1us
+private:
+    static const int LEVELS = 4;
+    static const int SLOT_BITS = 8;
+    static const int SLOTS = 1 << SLOT_BITS;
+    static const int WORDS = SLOTS / 64;
+    static const uint64_t NONE = UINT64_MAX;
+
+    // timers expiring during tick k are moved to the EventList at the
+    // start of tick k-1.  key() is the tick at whose start a timer is
+    // moved, always strictly before it expires.
+    inline uint64_t key(simtime_picosec when) const {return when == 0 ? 0 : (when - 1) / _granularity;}
+    inline uint64_t tick_now() {return _eventlist.now() / _granularity;}
+
+    void insert(Timer& timer);
+    void link(Timer& timer, int level, int slot);
+    void unlink(Timer& timer);
+    Timer* take_slot(int level, int slot);
+    void queue(Timer& timer);
+    void advance(uint64_t tick);
+    // the next tick at which a slot becomes due, or NONE if the wheel is empty
+    uint64_t next_tick() const;
+    void schedule(uint64_t tick);
+    // before a checkpoint is restored: drop our pending event, there
+    // being no timers to keep
+    void checkpoint_clear();
+
+    simtime_picosec _granularity;
+    // timers with a key up to _cursor are already in the EventList
+    uint64_t _cursor;
+    Timer* _slots[LEVELS][SLOTS];
+    uint64_t _occupied[LEVELS][WORDS];
+    // timers beyond the top level, re-sorted when it wraps
+    Timer* _overflow;
+    uint64_t _size;
+
+    // our own pending event
+    uint64_t _scheduled_tick;
+    EventList::Handle _handle;
+};
+
+#endif
@@ -0,0 +1,169 @@
+// -*- c-basic-offset: 4; indent-tabs-mode: nil -*-
+#include "timerwheel.h"
+
+#include <cstdint>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "eventlist.h"
+
+typedef std::vector<std::pair<int, simtime_picosec>> FiringLog;
+
+// Each firing arms, re-arms or cancels the source's timer or schedules
+// a plain event, either on the timer wheel or directly in the event
+// list; both must give the same sequence of events.
+class TimerSource : public EventSource {
+   public:
+    TimerSource(EventList& eventlist, int index, bool use_wheel, std::mt19937_64& rng, FiringLog& log)
+        : EventSource(eventlist, "timersource"), index_(index), use_wheel_(use_wheel), rng_(rng),
+          log_(log), timer_(*this), handle_(nullptr), armed_(false), when_(0) {}
+
+    virtual void doNextEvent() {
+        simtime_picosec now = eventlist().now();
+        log_.push_back({index_, now});
+        if (armed_ && when_ == now) {
+            armed_ = false;
+            if (use_wheel_)
+                timer_.expired();
+        }
+        if (log_.size() > 200000)
+            return;
+        // a source always has something pending, so it keeps going
+        switch (rng_() % 4) {
+        case 0:
+            if (armed_)
+                cancel();
+            arm(now + delay());
+            if (armed_)
+                break;
+            // fall through
+        case 1:
+            if (armed_)
+                cancel();
+            // fall through
+        default:
+            eventlist().sourceIsPending(*this, now + step());
+        }
+    }
+
+   private:
+    simtime_picosec delay() {
+        // from within a wheel tick up to beyond the top level
+        switch (rng_() % 8) {
+        case 0:
+            return 0;
+        case 1:
+            return rng_() % 1000000;
+        case 2:
+            return rng_() % 10000000000000000ULL;
+        case 3:
+            return step();
+        default:
+            return rng_() % 100000000;
+        }
+    }
+    simtime_picosec step() {
+        // often a whole number of wheel ticks, so that events and
+        // timers collide on tick boundaries
+        if (rng_() % 2)
+            return (rng_() % 4) * TimerWheel::DEFAULT_GRANULARITY;
+        return rng_() % 3000000;
+    }
+    void arm(simtime_picosec when) {
+        if (use_wheel_) {
+            armed_ = eventlist().timers().arm(timer_, when);
+        } else {
+            handle_ = eventlist().sourceIsPendingGetHandle(*this, when);
+            armed_ = handle_ != nullptr;
+        }
+        when_ = when;
+    }
+    void cancel() {
+        if (use_wheel_)
+            eventlist().timers().cancel(timer_);
+        else
+            eventlist().cancelPendingSourceByHandle(*this, handle_);
+        armed_ = false;
+    }
+
+    int                    index_;
+    bool                   use_wheel_;
+    std::mt19937_64&       rng_;
+    FiringLog&             log_;
+    TimerWheel::Timer      timer_;
+    EventList::Handle      handle_;
+    bool                   armed_;
+    simtime_picosec        when_;
+};
+
+static FiringLog simulate(bool use_wheel, simtime_picosec endtime) {
+    EventList eventlist;
+    eventlist.setEndtime(endtime);
+    std::mt19937_64 rng(1);
+    FiringLog log;
+    std::vector<TimerSource*> sources;
+    for (int i = 0; i < 100; i++) {
+        sources.push_back(new TimerSource(eventlist, i, use_wheel, rng, log));
+        eventlist.sourceIsPending(*sources.back(), i % 10);
+    }
+    while (eventlist.doNextEvent()) {
+    }
+    for (TimerSource* src : sources) {
+        delete src;
+    }
+    return log;
+}
+
+TEST(TimerWheelTest, SameOrderAsEventList) {
+    FiringLog direct = simulate(false, 0);
+    FiringLog wheel = simulate(true, 0);
+    ASSERT_GT(direct.size(), 200000u);
+    EXPECT_EQ(direct, wheel);
+}
+
+TEST(TimerWheelTest, EndTime) {
+    // timers past the end of the simulation are refused
+    FiringLog direct = simulate(false, 50000000);
+    FiringLog wheel = simulate(true, 50000000);
+    EXPECT_EQ(direct, wheel);
+}
+
+TEST(TimerWheelTest, CancelOnWheel) {
+    EventList eventlist;
+    std::mt19937_64 rng(1);
+    FiringLog log;
+    TimerSource src(eventlist, 0, true, rng, log);
+    TimerWheel::Timer timer(src);
+    TimerWheel& wheel = eventlist.timers();
+    EXPECT_TRUE(wheel.arm(timer, 500000000));
+    EXPECT_EQ(wheel.size(), 1u);
+    EXPECT_TRUE(wheel.arm(timer, 900000000));
+    EXPECT_EQ(wheel.size(), 1u);
+    wheel.cancel(timer);
+    EXPECT_FALSE(timer.armed());
+    EXPECT_EQ(wheel.size(), 0u);
+    while (eventlist.doNextEvent()) {
+    }
+    EXPECT_TRUE(log.empty());
+}
+
+TEST(TimerWheelTest, ReschedulingIsNotACancel) {
+    // the wheel moving its own event earlier isn't counted in -eventlist_stats
+    EventList eventlist;
+    std::mt19937_64 rng(1);
+    FiringLog log;
+    TimerSource src(eventlist, 0, true, rng, log);
+    TimerWheel::Timer late(src), early(src);
+    TimerWheel& wheel = eventlist.timers();
+    EXPECT_TRUE(wheel.arm(late, 900000000));
+    EXPECT_TRUE(wheel.arm(early, 5000000));
+    EXPECT_EQ(eventlist.cancelCount(), 0u);
+}
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -8,79 +8,82 @@
 
 using namespace std;
 
-// Static stuff
-flowid_t UecSrc::_debug_flowid = UINT32_MAX;
+// Static stuff.  These are thread_local, one copy per simulation
+// context, and are initialised on first use in each thread - by which
+// time main may have changed some of them - so initialisers must not
+// read parameters that main sets.
+thread_local flowid_t UecSrc::_debug_flowid = UINT32_MAX;
 // _path_entropy_size is the number of paths we spray across.  If you don't set it, it will default
 // to all paths.
-int UecSrc::_global_node_count = 0;
-bool UecSrc::_shown = false;
-mem_b UecSrc::_configured_maxwnd = 0;
+thread_local int UecSrc::_global_node_count = 0;
+thread_local bool UecSrc::_shown = false;
+thread_local mem_b UecSrc::_configured_maxwnd = 0;
 
 /* _min_rto can be tuned using setMinRTO. Don't change it here.  */
-simtime_picosec UecSrc::_min_rto = timeFromUs((uint32_t)DEFAULT_UEC_RTO_MIN);
+thread_local simtime_picosec UecSrc::_min_rto = timeFromUs((uint32_t)DEFAULT_UEC_RTO_MIN);
 
-mem_b UecSink::_bytes_unacked_threshold = 16384;
-int UecSink::TGT_EV_SIZE = 7;
+thread_local mem_b UecSink::_bytes_unacked_threshold = 16384;
+thread_local int UecSink::TGT_EV_SIZE = 7;
 
-bool UecSink::_model_pcie = false;
+thread_local bool UecSink::_model_pcie = false;
 
 /* this default will be overridden from packet size*/
-uint16_t UecSrc::_hdr_size = 64;
-uint16_t UecSrc::_mss = 4096;
-uint16_t UecSrc::_mtu = _mss + _hdr_size;
+thread_local uint16_t UecSrc::_hdr_size = 64;
+thread_local uint16_t UecSrc::_mss = 4096;
+thread_local uint16_t UecSrc::_mtu = 4096 + 64; // _mss + _hdr_size
 
 // send 4 packets of credit per pull, as per default in UEC spec
-uint16_t UecSink::_mtus_per_pull = 4;
+thread_local uint16_t UecSink::_mtus_per_pull = 4;
 
 // units of UEC_PULL_QUANTA bytes (typically 256) - note round down to mss rather than mtu
-UecBasePacket::pull_quanta UecSink::_credit_per_pull = (UecSrc::_mss * UecSink::_mtus_per_pull) >> UEC_PULL_SHIFT;
+thread_local UecBasePacket::pull_quanta UecSink::_credit_per_pull = (4096 * 4) >> UEC_PULL_SHIFT; // _mss * _mtus_per_pull
 
-bool UecSrc::_debug = false;
+thread_local bool UecSrc::_debug = false;
 
-bool UecSrc::_sender_based_cc = false;
-bool UecSrc::_receiver_based_cc = false;
-bool UecSink::_oversubscribed_cc = false; // can only be enabled when receiver_based_cc is set to true
+thread_local bool UecSrc::_sender_based_cc = false;
+thread_local bool UecSrc::_receiver_based_cc = false;
+thread_local bool UecSink::_oversubscribed_cc = false; // can only be enabled when receiver_based_cc is set to true
 
-UecSrc::Sender_CC UecSrc::_sender_cc_algo = UecSrc::NSCC;
+thread_local UecSrc::Sender_CC UecSrc::_sender_cc_algo = UecSrc::NSCC;
 
 /* 
     The following variable values are not default values, there are initializer values. The actual
     default values are set in initNsccParams/initRcccParams.
 */
-linkspeed_bps UecSrc::_reference_network_linkspeed = 0; // set by initNsccParams
-simtime_picosec UecSrc::_reference_network_rtt = timeFromUs(12u); 
-mem_b UecSrc::_reference_network_bdp = 0; // set by initNsccParams
-linkspeed_bps UecSrc::_network_linkspeed = 0; // set by initNsccParams
-simtime_picosec UecSrc::_network_rtt = 0; // set by initNsccParams
-mem_b UecSrc::_network_bdp = 0; // set by initNsccParams
-bool UecSrc::_network_trimming_enabled = false; // set by initNsccParams
-double UecSrc::_scaling_factor_a = 1; //for 400Gbps. cf. spec must be set to BDP/(100Gbps*12us)
-double UecSrc::_scaling_factor_b = 0; // Needs to be inialized in initNscc
-uint32_t UecSrc::_qa_scaling = 1; //quick adapt scaling - how much of the achieved bytes should we use as new CWND?
-double UecSrc::_gamma = 0.8; //used for aggressive decrease
-double UecSrc::_alpha = UecSrc::_scaling_factor_a * 1000 * 4000 / timeFromUs(6u);
-double UecSrc::_fi = 1; //fair_increase constant
-double UecSrc::_fi_scale = .25 * UecSrc::_scaling_factor_a;
-mem_b UecSrc::_min_cwnd = 0;
-
-double UecSrc::_delay_alpha = 0.0125;//0.125;
-
-simtime_picosec UecSrc::_adjust_period_threshold = timeFromUs(12u);
-simtime_picosec UecSrc::_target_Qdelay = timeFromUs(6u);
-uint32_t UecSrc::_adjust_bytes_threshold = (simtime_picosec)32000*_target_Qdelay/timeFromUs(12u);
-double UecSrc::_qa_threshold = 4 * UecSrc::_target_Qdelay; 
-
-double UecSrc::_eta = 0;
-bool UecSrc::_disable_quick_adapt = false;
-uint8_t UecSrc::_qa_gate = 0;
-bool UecSrc::update_base_rtt_on_nack = true;
+thread_local linkspeed_bps UecSrc::_reference_network_linkspeed = 0; // set by initNsccParams
+thread_local simtime_picosec UecSrc::_reference_network_rtt = timeFromUs(12u); 
+thread_local mem_b UecSrc::_reference_network_bdp = 0; // set by initNsccParams
+thread_local linkspeed_bps UecSrc::_network_linkspeed = 0; // set by initNsccParams
+thread_local simtime_picosec UecSrc::_network_rtt = 0; // set by initNsccParams
+thread_local mem_b UecSrc::_network_bdp = 0; // set by initNsccParams
+thread_local bool UecSrc::_network_trimming_enabled = false; // set by initNsccParams
+thread_local double UecSrc::_scaling_factor_a = 1; //for 400Gbps. cf. spec must be set to BDP/(100Gbps*12us)
+thread_local double UecSrc::_scaling_factor_b = 0; // Needs to be inialized in initNscc
+thread_local uint32_t UecSrc::_qa_scaling = 1; //quick adapt scaling - how much of the achieved bytes should we use as new CWND?
+thread_local double UecSrc::_gamma = 0.8; //used for aggressive decrease
+thread_local double UecSrc::_alpha = 1.0 * 1000 * 4000 / timeFromUs(6u); // _scaling_factor_a * ...
+thread_local double UecSrc::_fi = 1; //fair_increase constant
+thread_local double UecSrc::_fi_scale = .25; // .25 * _scaling_factor_a
+thread_local mem_b UecSrc::_min_cwnd = 0;
+
+thread_local double UecSrc::_delay_alpha = 0.0125;//0.125;
+
+thread_local simtime_picosec UecSrc::_adjust_period_threshold = timeFromUs(12u);
+thread_local simtime_picosec UecSrc::_target_Qdelay = timeFromUs(6u);
+thread_local uint32_t UecSrc::_adjust_bytes_threshold = (simtime_picosec)32000*_target_Qdelay/timeFromUs(12u);
+thread_local double UecSrc::_qa_threshold = 4 * UecSrc::_target_Qdelay; 
+
+thread_local double UecSrc::_eta = 0;
+thread_local bool UecSrc::_disable_quick_adapt = false;
+thread_local uint8_t UecSrc::_qa_gate = 0;
+thread_local bool UecSrc::update_base_rtt_on_nack = true;
 
 /* SLEEK parameters */
-bool UecSrc::_enable_sleek = false;
-int UecSrc::probe_first_trial_time = 3;
-int UecSrc::probe_retry_time = 5;
-float UecSrc::loss_retx_factor = 1.5;
-int UecSrc::min_retx_config = 5;
+thread_local bool UecSrc::_enable_sleek = false;
+thread_local int UecSrc::probe_first_trial_time = 3;
+thread_local int UecSrc::probe_retry_time = 5;
+thread_local float UecSrc::loss_retx_factor = 1.5;
+thread_local int UecSrc::min_retx_config = 5;
 /* End SLEEK parameters */
 
 void UecSrc::initNsccParams(simtime_picosec network_rtt,
@@ -395,6 +398,20 @@ void UecNIC::sendControlPktNow() {
 }
 
 
+void UecNIC::checkpoint(Checkpoint& cp) {
+    cp.io(_active_srcs);
+    cp.io(_control);
+    cp.io(_control_size);
+    cp.io(_ports);
+    cp.io(_rr_port);
+    cp.io(_busy_ports);
+    cp.io(_crt);
+    cp.io(_total_data_received);
+    cp.io(_new_data_received);
+    cp.io(_trim_received);
+    cp.io(_ctrl_received);
+}
+
 void UecNIC::doNextEvent() {
     // doNextEvent should be called every time a packet will have finished being sent
     uint32_t last_port = _no_of_ports;
@@ -503,9 +520,7 @@ UecSrc::UecSrc(TrafficLogger* trafficLogger,
 
     _rtx_timeout_pending = false;
     _rtx_timeout = timeInf;
-    _rto_timer_handle = eventlist().nullHandle();
 
-    _probe_timer_handle = eventlist().nullHandle();
     _probe_timer_when = 0;
     _probe_seqno = 0; 
     _probe_send_time = 0; 
@@ -526,6 +541,10 @@ UecSrc::UecSrc(TrafficLogger* trafficLogger,
     _speculating = true;
     _in_flight = 0;
     _highest_sent = 0;
+    _send_stamp = 0;
+    _timed_count = 0;
+    _rtx_queue_size = 0;
+    _rtx_queue_head = 0;
     _send_blocked_on_nic = false;
     _inc_bytes = 0;
 
@@ -585,23 +604,121 @@ UecSrc::UecSrc(TrafficLogger* trafficLogger,
     _nscc_fulfill_stats = {};
 }
 
-void UecSrc::delFromSendTimes(simtime_picosec time, UecDataPacket::seq_t seq_no) {
-    //cout << eventlist().now() << " flowid " << _flow.flow_id() << " _send_times.erase " << time << " for " << seq_no << endl;
-    auto snd_seq_range = _send_times.equal_range(time);
-    auto snd_it = snd_seq_range.first;
-    while (snd_it != snd_seq_range.second) {
-        if (snd_it->second == seq_no) {
-            _send_times.erase(snd_it);
-            break;
-        } else {
-            ++snd_it;
-        }
-    }
+void UecSrc::checkpoint(Checkpoint& cp) {
+    if (cp.saving()) {
+        if (_msg_tracker)
+            cp.unsupported("a reused UecSrc connection");
+        if (_end_trigger)
+            cp.unsupported("a UecSrc with an end trigger");
+    }
+    _mp->checkpoint(cp);
+
+    cp.io(_send_records);
+    cp.io(_send_order);
+    cp.io(_send_stamp);
+    cp.io(_timed_count);
+    cp.io(_rtx_queue_size);
+    cp.io(_rtx_queue_head);
+    cp.io(_stats);
+    cp.io(_nscc_overall_stats);
+    cp.io(_nscc_fulfill_stats);
+
+    cp.io(_flow_size);
+    cp.io(_done_sending);
+    cp.io(_backlog);
+    cp.io(_rtx_backlog);
+    cp.io(_cwnd);
+    cp.io(_maxwnd);
+    cp.io(_pull_target);
+    cp.io(_pull);
+    cp.io(_credit);
+    cp.io(_highest_sent);
+    cp.io(_highest_rtx_sent);
+    cp.io(_in_flight);
+    cp.io(_bdp);
+    cp.io(_send_blocked_on_nic);
+    cp.io(_speculating);
+    cp.io(_last_event_time);
+    cp.io(last_data_sent_time);
+    cp.io(_flow_start_time);
+
+    cp.io(_rtt);
+    cp.io(_mdev);
+    cp.io(_rto);
+    cp.io(_raw_rtt);
+    cp.io(_rtx_timeout_pending);
+    cp.io(_rto_send_time);
+    cp.io(_rtx_timeout);
+    cp.io(_last_rts);
+    cp.io(_rto_timer);
+
+    cp.io(_recvd_bytes);
+    cp.io(_base_rtt);
+    cp.io(_base_bdp);
+    cp.io(_achieved_bytes);
+    cp.io(_received_bytes);
+    cp.io(_fi_count);
+    cp.io(_trigger_qa);
+    cp.io(_qa_endtime);
+    cp.io(_bytes_to_ignore);
+    cp.io(_bytes_ignored);
+    cp.io(_inc_bytes);
+    cp.io(_avg_delay);
+    cp.io(_last_eta_time);
+    cp.io(_last_adjust_time);
+    cp.io(_increase);
+    cp.io(_last_dec_time);
+    cp.io(_highest_recv_seqno);
+
+    cp.io(_loss_recovery_mode);
+    cp.io(_recovery_seqno);
+    cp.io(_probe_timer_when);
+    cp.io(_probe_seqno);
+    cp.io(_probe_send_time);
+    cp.io(_probe_timer);
+}
+
+UecSrc::sendRecord* UecSrc::findInFlight(UecDataPacket::seq_t seqno) {
+    sendRecord* rec = _send_records.find(seqno);
+    return rec && rec->in_flight ? rec : NULL;
+}
+
+void UecSrc::delFromSendTimes(sendRecord& rec) {
+    // its _send_order entry is skipped when it reaches the front
+    if (rec.timed) {
+        rec.timed = false;
+        _timed_count--;
+    }
+}
+
+UecSrc::sendOrderEntry* UecSrc::oldestTimed() {
+    while (!_send_order.empty()) {
+        sendOrderEntry& entry = _send_order.next_to_pop();
+        sendRecord* rec = _send_records.find(entry.seqno);
+        if (rec && rec->timed && rec->stamp == entry.stamp)
+            return &entry;
+        _send_order.pop();
+    }
+    return NULL;
+}
+
+UecDataPacket::seq_t UecSrc::rtxQueueFront() {
+    assert(_rtx_queue_size > 0);
+    while (!_send_records.find(_rtx_queue_head)->queued) {
+        _rtx_queue_head++;
+    }
+    return _rtx_queue_head;
+}
+
+void UecSrc::dequeueRtx(sendRecord& rec) {
+    assert(rec.queued);
+    rec.queued = false;
+    _rtx_queue_size--;
 }
 
 void UecSrc::connectPort(uint32_t port_num,
-                          Route& routeout,
-                          Route& routeback,
+                          const Route& routeout,
+                          const Route& routeback,
                           UecSink& sink,
                           simtime_picosec start_time) {
     _ports[port_num]->setRoute(routeout);
@@ -658,19 +775,18 @@ void UecSrc::receivePacket(Packet& pkt, uint32_t portnum) {
 }
 
 mem_b UecSrc::handleAckno(UecDataPacket::seq_t ackno) {
-    auto i = _tx_bitmap.find(ackno);
-    if (i == _tx_bitmap.end()) {
-        // The ackno is either in tx_bitmap or in rtx_queue
+    sendRecord* rec = _send_records.find(ackno);
+    if (!rec || !rec->in_flight) {
+        // The ackno is either in flight or in the rtx queue
         // or in neither, but never in both.
-        // Hence, if it's not in _tx_bitmap, check if it's 
-        // in _rtx_queue and remove and correct. 
+        // Hence, if it's not in flight, check if it's 
+        // in the rtx queue and remove and correct. 
         // If ackno is in neither, there is nothing else
         // to do here.
-        auto rtx_i = _rtx_queue.find(ackno);
-        if (rtx_i != _rtx_queue.end()) {
+        if (rec && rec->queued) {
             // packet was in RTX queue
-            mem_b pkt_size = rtx_i->second;
-            _rtx_queue.erase(rtx_i);
+            mem_b pkt_size = rec->pkt_size;
+            dequeueRtx(*rec);
             _rtx_backlog -= pkt_size;
             _in_flight += pkt_size; // don't double count - we decremented when we marked for rtx
             if (_debug_src) {
@@ -683,14 +799,13 @@ mem_b UecSrc::handleAckno(UecDataPacket::seq_t ackno) {
         }
         return 0;
     } else {
-        // If ackno is in tx_bitmap, it means we have recentely 
+        // If ackno is in flight, it means we have recentely 
         // send out an packet, either for the first time or
         // an rtx packet. Since the current ack tells us that
-        // it has been received already, we can remove it from 
-        // _tx_bitmap.
-        simtime_picosec send_time = i->second.send_time;
+        // it has been received already, it no longer is.
+        simtime_picosec send_time = rec->send_time;
 
-        mem_b pkt_size = i->second.pkt_size;
+        mem_b pkt_size = rec->pkt_size;
         
         if (_debug_src)
             cout << _flow.str() << " " << _nodename << " handleAck " << ackno << " flow " << _flow.str() << endl;
@@ -703,9 +818,10 @@ mem_b UecSrc::handleAckno(UecDataPacket::seq_t ackno) {
             _msg_tracker.value()->addSAck(ackno);
         }
 
-        _tx_bitmap.erase(i);
-        // _send_times.erase(send_time);
-        delFromSendTimes(send_time, ackno);
+        // the tracker may have sent something, moving the record
+        rec = _send_records.find(ackno);
+        rec->in_flight = false;
+        delFromSendTimes(*rec);
 
         if (send_time == _rto_send_time) {
             recalculateRTO();
@@ -743,18 +859,15 @@ mem_b UecSrc::handleAckno(UecDataPacket::seq_t ackno) {
 
 mem_b UecSrc::handleCumulativeAck(UecDataPacket::seq_t cum_ack) {
     mem_b newly_acked = 0;
+    UecDataPacket::seq_t acked_end = min(cum_ack, _send_records.end());
 
     // free up anything cumulatively acked
-    while (!_rtx_queue.empty()) {
-        auto seqno = _rtx_queue.begin()->first;
-
-        if (seqno < cum_ack) {
-            mem_b pkt_size = _rtx_queue.begin()->second;
-            _rtx_queue.erase(_rtx_queue.begin());
-            _rtx_backlog -= pkt_size;
-            _in_flight += pkt_size; // don't double count - we decremented when we marked for rtx
-        } else {
-            break;
+    for (auto seqno = _rtx_queue_head; _rtx_queue_size > 0 && seqno < acked_end; seqno++) {
+        sendRecord& rec = *_send_records.find(seqno);
+        if (rec.queued) {
+            dequeueRtx(rec);
+            _rtx_backlog -= rec.pkt_size;
+            _in_flight += rec.pkt_size; // don't double count - we decremented when we marked for rtx
         }
     }
 
@@ -762,17 +875,14 @@ mem_b UecSrc::handleCumulativeAck(UecDataPacket::seq_t cum_ack) {
         _msg_tracker.value()->addCumAck(cum_ack);
     }
 
-    auto i = _tx_bitmap.begin();
-    while (i != _tx_bitmap.end()) {
-        auto seqno = i->first;
+    for (auto seqno = _send_records.base(); seqno < acked_end; seqno++) {
+        sendRecord& rec = *_send_records.find(seqno);
         // cumulative ack is next expected packet, not yet received
-        if (seqno >= cum_ack) {
-            // nothing else acked
-            break;
-        }
-        simtime_picosec send_time = i->second.send_time;
+        if (!rec.in_flight)
+            continue;
+        simtime_picosec send_time = rec.send_time;
 
-        newly_acked += i->second.pkt_size;
+        newly_acked += rec.pkt_size;
 
         if (_debug_src)
             cout << _flow.str() << " " << _nodename << " handleCumAck " << seqno << " flow " << _flow.str() << endl;
@@ -780,19 +890,15 @@ mem_b UecSrc::handleCumulativeAck(UecDataPacket::seq_t cum_ack) {
             cout << timeAsUs(eventlist().now()) << " flowid " << _flow.flow_id() << " handleCumulativeAck seqno " << seqno
                 << endl;
         }  
-        _tx_bitmap.erase(i);
-        i = _tx_bitmap.begin();
-        // _send_times.erase(send_time);
-        delFromSendTimes(send_time, seqno);
+        rec.in_flight = false;
+        delFromSendTimes(rec);
         if (send_time == _rto_send_time) {
             recalculateRTO();
         }
-        //we can safely remove the number of retranmission times if we receive the packets' ACK
-        auto rtx_time = _rtx_times.find(seqno);
-        if (rtx_time != _rtx_times.end()){
-            _rtx_times.erase(rtx_time);
-        }
     }
+    //we can safely remove the number of retranmission times if we receive the packets' ACK
+    _send_records.advance(cum_ack);
+    _rtx_queue_head = max(_rtx_queue_head, _send_records.base());
     return newly_acked;
 }
 
@@ -813,7 +919,7 @@ bool UecSrc::checkFinished(UecDataPacket::seq_t cum_ack) {
 
     if (_done_sending) {
         // assert(_backlog == 0);
-        // assert(_rtx_queue.empty());
+        // assert(rtxQueueEmpty());
         // if (_pdc.has_value()) {
         //     assert(_pdc->checkFinished());
         // }
@@ -837,17 +943,6 @@ bool UecSrc::checkFinished(UecDataPacket::seq_t cum_ack) {
                     << endl; */
                 cancelRTO();
                 _done_sending = true;
-
-                // ATLAHS 
-                EventOver *flow_over = new EventOver(from, to, _flow_size, tag, eventlist().now(), AtlahsEventType::SEND_EVENT_OVER);
-                flow_over->node = lgs_node;
-                flow_over->start_time_event = _flow_start_time;
-                if (_atlahs_api) {
-                    if (_atlahs_api->print_stats_flows) {
-                        _atlahs_api->flowInfos.push_back(FlowInfo(timeAsUs(_flow_start_time), timeAsUs(eventlist().now()), timeAsUs(eventlist().now() - _flow_start_time), _flow_size, 1, _cwnd));
-                    }
-                    _atlahs_api->EventFinished(*flow_over);
-                }
             }
         } else {
             if ((((int64_t)cum_ack - _stats.rts_pkts_sent) * _mss) >= (int64_t)_flow_size) {
@@ -874,16 +969,6 @@ bool UecSrc::checkFinished(UecDataPacket::seq_t cum_ack) {
                     _flow_logger->logEvent(_flow, *this, FlowEventLogger::FINISH, _flow_size, cum_ack);
                 }
                 cancelRTO();
-                // ATLAHS 
-                EventOver *flow_over = new EventOver(from, to, _flow_size, tag, eventlist().now(), AtlahsEventType::SEND_EVENT_OVER);
-                flow_over->node = lgs_node;
-                flow_over->start_time_event = _flow_start_time;
-                if (_atlahs_api) {
-                    if (_atlahs_api->print_stats_flows) {
-                        _atlahs_api->flowInfos.push_back(FlowInfo(timeAsUs(_flow_start_time), timeAsUs(eventlist().now()), timeAsUs(eventlist().now() - _flow_start_time), _flow_size, 1, _cwnd));
-                    }
-                    _atlahs_api->EventFinished(*flow_over);
-                }
                 _done_sending = true;
             }
         }
@@ -895,7 +980,7 @@ bool UecSrc::checkFinished(UecDataPacket::seq_t cum_ack) {
              << " total bytes " << ((int64_t)cum_ack - _stats.rts_pkts_sent) * _mss 
              << " flow_size " << _flow_size 
              << " backlog " << _backlog
-             << " rtx_queue " << _rtx_queue.size()
+             << " rtx_queue " << _rtx_queue_size
              << " done_sending " << _done_sending << endl;
 
     return _done_sending;
@@ -910,12 +995,12 @@ bool UecSrc::isTotallyFinished() {
 }
 
 bool UecSrc::validateSendTs(UecBasePacket::seq_t acked_psn, bool rtx_echo) {
-    auto rtx_time = _rtx_times.find(acked_psn);
-    if(rtx_time == _rtx_times.end())
+    sendRecord* rec = _send_records.find(acked_psn);
+    if (!rec || !rec->recorded)
         return false;
 
-    if ((rtx_time->second == 0 && rtx_echo == false) 
-     || (rtx_time->second == 1 && rtx_echo == true)) {
+    if ((rec->rtx_times == 0 && rtx_echo == false) 
+     || (rec->rtx_times == 1 && rtx_echo == true)) {
         return true;
     } else {
         return false;
@@ -958,8 +1043,7 @@ void UecSrc::processAck(const UecAckPacket& pkt) {
 
     //compute RTT sample
     auto acked_psn = pkt.acked_psn();
-    auto i = _tx_bitmap.find(acked_psn);
-    auto rtx_time = _rtx_times.find(acked_psn);
+    sendRecord* rec = findInFlight(acked_psn);
     uint32_t ooo = pkt.ooo();
 
     mem_b pkt_size;
@@ -967,13 +1051,13 @@ void UecSrc::processAck(const UecAckPacket& pkt) {
     simtime_picosec raw_rtt = 0;
     simtime_picosec send_time = 0;
 
-    if (i != _tx_bitmap.end() && validateSendTs(acked_psn, pkt.rtx_echo()) && (!pkt.is_probe_ack()) ) {
+    if (rec && validateSendTs(acked_psn, pkt.rtx_echo()) && (!pkt.is_probe_ack()) ) {
     //a timestamp is valid if 
     //1. the received ack is new packet and no retransmission at local record;
     //or 2. the received ack is a retransmitted packet and local record shows this packet only gets retransmitted once. 
         if(_flow.flow_id() == _debug_flowid ){
             cout <<  timeAsUs(eventlist().now()) << " flowid " << _flow.flow_id() 
-                << " rtx_times "<< rtx_time->second
+                << " rtx_times "<< rec->rtx_times
                 << " rtx_echo " << rtx_echo 
                 << " packet_type " << pkt.is_probe_ack()
                 << " _probe_psn " << _probe_seqno
@@ -981,8 +1065,8 @@ void UecSrc::processAck(const UecAckPacket& pkt) {
                 << endl;
         }
         //auto seqno = i->first;
-        send_time = i->second.send_time;
-        pkt_size = i->second.pkt_size;
+        send_time = rec->send_time;
+        pkt_size = rec->pkt_size;
         raw_rtt = eventlist().now() - send_time;
 
         if (!pkt.is_rts()) {
@@ -1089,14 +1173,9 @@ void UecSrc::processAck(const UecAckPacket& pkt) {
     if (_sender_based_cc && _enable_sleek) {
         //probe packets
         if (_probe_timer_when != 0){
-            if (_probe_timer_handle->second != this){
-                if(_flow.flow_id() == _debug_flowid ){
-                    cout <<  timeAsUs(eventlist().now()) << " flowid " << _flow.flow_id() << " an assert soon"<< endl;
-                }                
-            }
-            eventlist().cancelPendingSourceByHandle(*this, _probe_timer_handle);
+            if (_probe_timer.armed())
+                eventlist().timers().cancel(_probe_timer);
             _probe_timer_when = 0;
-            _probe_timer_handle = eventlist().nullHandle();
         }
         if (cum_ack < _highest_sent || _backlog > 0){
             if (_backlog == 0){
@@ -1104,7 +1183,7 @@ void UecSrc::processAck(const UecAckPacket& pkt) {
             }else{
                 _probe_timer_when = eventlist().now() + probe_first_trial_time*_base_rtt;
             }
-            _probe_timer_handle = eventlist().sourceIsPendingGetHandle(*this, _probe_timer_when);
+            eventlist().timers().arm(_probe_timer, _probe_timer_when);
         }
         if(pkt.is_probe_ack() && delay < _target_Qdelay){
             _loss_recovery_mode = true;
@@ -1159,7 +1238,7 @@ bool UecSrc::can_send_NSCC(mem_b pkt_size) {
     assert(_sender_based_cc);
     return (pkt_size > 0) 
     	   && (((!_loss_recovery_mode && _cwnd >= _in_flight + pkt_size) 
-                || (_loss_recovery_mode && (!_rtx_queue.empty() || _cwnd >= _in_flight + pkt_size))));
+                || (_loss_recovery_mode && (!rtxQueueEmpty() || _cwnd >= _in_flight + pkt_size))));
 }
 
 void UecSrc::set_cwnd_bounds() {
@@ -1485,7 +1564,7 @@ void UecSrc::runSleek(uint32_t ooo, UecBasePacket::seq_t cum_ack) {
     if (ooo < threshold/avg_size && !_loss_recovery_mode)
         return;
 
-    if (!_loss_recovery_mode && _rtx_queue.empty() ) {
+    if (!_loss_recovery_mode && rtxQueueEmpty() ) {
         _loss_recovery_mode = true;
         _recovery_seqno = _highest_sent ;
         if (_flow.flow_id() == _debug_flowid || _debug_src ){
@@ -1500,15 +1579,13 @@ void UecSrc::runSleek(uint32_t ooo, UecBasePacket::seq_t cum_ack) {
         if (rtx_seqno < _highest_rtx_sent)
             continue;
 
-        auto i = _tx_bitmap.find(rtx_seqno);
-        if (i == _tx_bitmap.end()) {
+        sendRecord* rec = findInFlight(rtx_seqno);
+        if (!rec) {
             // this means this packet seqno has been acked.
             continue;
         }
-
-        if (_rtx_queue.find(rtx_seqno) != _rtx_queue.end()) {
-            continue;
-        }
+        // in flight, so not also waiting in the RTX queue
+        assert(!rec->queued);
 
         if (_flow.flow_id() == _debug_flowid ) {
             cout <<  timeAsUs(eventlist().now()) << " flowid " << _flow.flow_id() << " rtx_seqno " << rtx_seqno
@@ -1519,17 +1596,15 @@ void UecSrc::runSleek(uint32_t ooo, UecBasePacket::seq_t cum_ack) {
 
         _stats._sleek_counter++;
 
-        mem_b pkt_size = i->second.pkt_size;
+        mem_b pkt_size = rec->pkt_size;
         assert(pkt_size >= _hdr_size); // check we're not seeing NACKed RTS packets.
-        auto seqno = i->first;
-        simtime_picosec send_time = i->second.send_time;
-        _tx_bitmap.erase(i);
-        assert(_tx_bitmap.find(seqno) == _tx_bitmap.end()); // xxx remove when working
+        auto seqno = rtx_seqno;
+        simtime_picosec send_time = rec->send_time;
+        rec->in_flight = false;
 
         _in_flight -= pkt_size;
 
-        // _send_times.erase(send_time);
-        delFromSendTimes(send_time, rtx_seqno);
+        delFromSendTimes(*rec);
         _highest_rtx_sent = seqno+1;
         queueForRtx(seqno, pkt_size);
 
@@ -1567,8 +1642,8 @@ void UecSrc::processNack(const UecNackPacket& pkt) {
     // bool ecn_echo = pkt.ecn_echo();
 
     // move the packet to the RTX queue
-    auto i = _tx_bitmap.find(nacked_seqno);
-    if (i == _tx_bitmap.end()) {
+    sendRecord* rec = findInFlight(nacked_seqno);
+    if (!rec) {
         if (_debug_src)
             cout << _flow.str() << " " << "Didn't find NACKed packet in _active_packets flow " << _flow.str() << endl;
 
@@ -1582,15 +1657,15 @@ void UecSrc::processNack(const UecNackPacket& pkt) {
         return;
     }
 
-    mem_b pkt_size = i->second.pkt_size;
+    mem_b pkt_size = rec->pkt_size;
 
     assert(pkt_size >= _hdr_size);  // check we're not seeing NACKed RTS packets.
     if (pkt_size == _hdr_size) {
         _stats.rts_nacks++;
     }
 
-    auto seqno = i->first;
-    simtime_picosec send_time = i->second.send_time;
+    auto seqno = nacked_seqno;
+    simtime_picosec send_time = rec->send_time;
     simtime_picosec raw_rtt = eventlist().now() - send_time;
 
     if (update_base_rtt_on_nack) {
@@ -1613,14 +1688,14 @@ void UecSrc::processNack(const UecNackPacket& pkt) {
     if (_debug_src)
         cout << _flow.str() << " " << _nodename << " erasing send record, seqno: " << seqno << " flow " << _flow.str()
              << endl;
-    _tx_bitmap.erase(i);
-    assert(_tx_bitmap.find(seqno) == _tx_bitmap.end());  // xxx remove when working
+    // the CC update may have sent something, moving the record
+    rec = _send_records.find(seqno);
+    rec->in_flight = false;
 
     _in_flight -= pkt_size;
     //assert(_in_flight >= 0);
 
-    // _send_times.erase(send_time);
-    delFromSendTimes(send_time, seqno);
+    delFromSendTimes(*rec);
 
     stopSpeculating();
     queueForRtx(seqno, pkt_size);
@@ -1661,7 +1736,9 @@ void UecSrc::doNextEvent() {
             _logger->logUec(*this, UecLogger::UEC_TIMEOUT);
 
         rtxTimerExpired();
-    } else if(_highest_sent == 0) {
+    } else if (!hasStarted()) {
+        // a reusable connection may already have been started by its
+        // message tracker, without getting a packet past a busy NIC
         if (_debug_src)
             cout << _flow.str() << " " << "Starting flow " << _name << endl;
         startConnection();
@@ -1672,6 +1749,7 @@ void UecSrc::doNextEvent() {
             if ( _flow.flow_id() == _debug_flowid || _debug_src ) {
                 cout << timeAsUs(eventlist().now())<< " doNextEvent probe " <<  _rtx_timeout_pending << " flowid " << _flow.flow_id() << endl;
             }
+            _probe_timer.expired();
             sendProbe();
         }
     }
@@ -1698,7 +1776,7 @@ bool UecSrc::isActivelySending() {
     if (_send_blocked_on_nic) {
         // 1. 
         is_sending = true;
-    } else if (!(_backlog == 0 && _rtx_queue.empty())) {
+    } else if (!(_backlog == 0 && rtxQueueEmpty())) {
         // 2.
         is_sending = true;
     } else if (!_done_sending) {
@@ -1797,7 +1875,7 @@ void UecSrc::startConnection() {
 }
 
 bool UecSrc::isSendPermitted() {
-    if (_rtx_queue.empty() && _backlog == 0) {
+    if (rtxQueueEmpty() && _backlog == 0) {
         return false;
     }
 
@@ -1933,7 +2011,7 @@ UecBasePacket::pull_quanta UecSrc::computePullTarget() {
 }
 
 mem_b UecSrc::getNextPacketSize(){
-    if (_rtx_queue.empty()) {
+    if (rtxQueueEmpty()) {
         if(_backlog == 0){
             return 0;
         }
@@ -1945,8 +2023,8 @@ mem_b UecSrc::getNextPacketSize(){
         }        
         return full_pkt_size;
     } else {
-        assert(!_rtx_queue.empty());
-        mem_b full_pkt_size = _rtx_queue.begin()->second;
+        assert(!rtxQueueEmpty());
+        mem_b full_pkt_size = _send_records.find(rtxQueueFront())->pkt_size;
         return full_pkt_size;
     }
 }
@@ -1967,7 +2045,7 @@ void UecSrc::sendIfPermitted() {
         }
     }
 
-    if (_rtx_queue.empty()) {
+    if (rtxQueueEmpty()) {
         if (_backlog == 0) {
             return;
         }
@@ -2017,7 +2095,7 @@ void UecSrc::sendIfPermitted() {
 // we will likely be sending something (sendNewPacket can return 0 if
 // we only had speculative credit we're not allowed to use though)
 mem_b UecSrc::sendPacket(const Route& route) {
-    if (_rtx_queue.empty()) {
+    if (rtxQueueEmpty()) {
         return sendNewPacket(route);
     } else {
         return sendRtxPacket(route);
@@ -2038,8 +2116,7 @@ void UecSrc::startRTO(simtime_picosec send_time) {
             cout << "Start timer at " << timeAsUs(eventlist().now()) << " source " << _flow.str()
                  << " expires at " << timeAsUs(_rtx_timeout) << " flow " << _flow.str() << endl;
 
-        _rto_timer_handle = eventlist().sourceIsPendingGetHandle(*this, _rtx_timeout);
-        if (_rto_timer_handle == eventlist().nullHandle()) {
+        if (!eventlist().timers().arm(_rto_timer, _rtx_timeout)) {
             // this happens when _rtx_timeout is past the configured simulation end time.
             _rtx_timeout_pending = false;
             if (_debug_src)
@@ -2057,7 +2134,7 @@ void UecSrc::startRTO(simtime_picosec send_time) {
 
 void UecSrc::clearRTO() {
     // clear the state
-    _rto_timer_handle = eventlist().nullHandle();
+    _rto_timer.expired();
     _rtx_timeout_pending = false;
 
     if (_debug_src)
@@ -2067,7 +2144,7 @@ void UecSrc::clearRTO() {
 void UecSrc::cancelRTO() {
     if (_rtx_timeout_pending) {
         // cancel the timer
-        eventlist().cancelPendingSourceByHandle(*this, _rto_timer_handle);
+        eventlist().timers().cancel(_rto_timer);
         clearRTO();
     }
 }
@@ -2143,12 +2220,13 @@ mem_b UecSrc::sendNewPacket(const Route& route) {
 }
 
 mem_b UecSrc::sendRtxPacket(const Route& route) {
-    assert(!_rtx_queue.empty());
-    auto seq_no = _rtx_queue.begin()->first;
-    mem_b full_pkt_size = _rtx_queue.begin()->second;
+    assert(!rtxQueueEmpty());
+    auto seq_no = rtxQueueFront();
+    sendRecord& rec = *_send_records.find(seq_no);
+    mem_b full_pkt_size = rec.pkt_size;
     spendCredit(full_pkt_size);
 
-    _rtx_queue.erase(_rtx_queue.begin());
+    dequeueRtx(rec);
     _rtx_backlog -= full_pkt_size;
     assert(_rtx_backlog >= 0);
     _in_flight += full_pkt_size;
@@ -2170,7 +2248,7 @@ mem_b UecSrc::sendRtxPacket(const Route& route) {
     if (_flow.flow_id() == _debug_flowid)
     {
         cout << timeAsUs(eventlist().now()) << " flowid " << _flow.flow_id() <<" sending rtx pkt " << seq_no
-             << " size " << full_pkt_size << " cwnd " << _cwnd <<" ev " << ev << " rtx_times " << _rtx_times[seq_no]
+             << " size " << full_pkt_size << " cwnd " << _cwnd <<" ev " << ev << " rtx_times " << _send_records.find(seq_no)->rtx_times
              << " in_flight " << _in_flight << " pull_target " << _pull_target << " pull " << _pull << endl;
     }
     p->set_ar(true);
@@ -2196,7 +2274,7 @@ void UecSrc::sendProbe() {
 
     _probe_send_time = eventlist().now();
     _probe_timer_when = eventlist().now() + probe_retry_time * _base_rtt;
-    _probe_timer_handle = eventlist().sourceIsPendingGetHandle(*this, _probe_timer_when);
+    eventlist().timers().arm(_probe_timer, _probe_timer_when);
 }
 
 void UecSrc::sendRTS() {
@@ -2236,21 +2314,44 @@ void UecSrc::createSendRecord(UecBasePacket::seq_t seqno, mem_b full_pkt_size) {
         cout << _flow.str() << " " << _nodename << " createSendRecord seqno: " << seqno << " size " << full_pkt_size
              << endl;
 
-    assert(_tx_bitmap.find(seqno) == _tx_bitmap.end());
+    sendRecord& rec = _send_records.at(seqno);
+    assert(!rec.in_flight);
 
-    _tx_bitmap.emplace(seqno, sendRecord(full_pkt_size, eventlist().now()));
-    _send_times.emplace(eventlist().now(), seqno);
+    rec.in_flight = true;
+    rec.timed = true;
+    rec.pkt_size = full_pkt_size;
+    rec.send_time = eventlist().now();
+    rec.stamp = ++_send_stamp;
+    _timed_count++;
 
-    if (_rtx_times.find(seqno) == _rtx_times.end()) {
-        _rtx_times.emplace(seqno, 0);
+    if (!rec.recorded) {
+        rec.recorded = true;
+        rec.rtx_times = 0;
     } else {
-        _rtx_times[seqno] += 1;
+        rec.rtx_times += 1;
+    }
+
+    if (_send_order.size() > 2 * (int)_timed_count + 64) {
+        // mostly entries of packets that are no longer timed; drop them
+        int n = _send_order.size();
+        for (int i = 0; i < n; i++) {
+            sendOrderEntry entry = _send_order.pop();
+            sendRecord* r = _send_records.find(entry.seqno);
+            if (r && r->timed && r->stamp == entry.stamp)
+                _send_order.push(entry);
+        }
     }
+    sendOrderEntry entry = {seqno, rec.stamp};
+    _send_order.push(entry);
 }
 
 void UecSrc::queueForRtx(UecBasePacket::seq_t seqno, mem_b pkt_size) {
-    assert(_rtx_queue.find(seqno) == _rtx_queue.end());
-    _rtx_queue.emplace(seqno, pkt_size);
+    sendRecord& rec = _send_records.at(seqno);
+    assert(!rec.queued);
+    rec.queued = true;
+    rec.pkt_size = pkt_size;
+    _rtx_queue_size++;
+    _rtx_queue_head = min(_rtx_queue_head, seqno);
     _rtx_backlog += pkt_size;
     if (!_speculating || !_receiver_based_cc)
         sendIfPermitted();
@@ -2273,7 +2374,7 @@ void UecSrc::timeToSend(const Route& route) {
     // we are in sync either way.
     _send_blocked_on_nic = false;
 
-    if (_backlog == 0 && _rtx_queue.empty()) {
+    if (_backlog == 0 && rtxQueueEmpty()) {
         _nic.cantSend(*this);
         return;
     }
@@ -2303,7 +2404,7 @@ void UecSrc::timeToSend(const Route& route) {
 
     // OK, we're probably good to send
     mem_b bytes_sent = 0;
-    if (_rtx_queue.empty()) {
+    if (rtxQueueEmpty()) {
         bytes_sent = sendNewPacket(route);
     } else {
         bytes_sent = sendRtxPacket(route);
@@ -2337,11 +2438,12 @@ void UecSrc::recalculateRTO() {
     // we're no longer waiting for the packet we set the timer for -
     // figure out what the timer should be now.
     cancelRTO();
-    if (_send_times.empty()) {
+    sendOrderEntry* oldest = oldestTimed();
+    if (!oldest) {
         // nothing left that we're waiting for
         return;
     }
-    auto earliest_send_time = _send_times.begin()->first;
+    auto earliest_send_time = _send_records.find(oldest->seqno)->send_time;
     startRTO(earliest_send_time);
 }
 
@@ -2349,13 +2451,13 @@ void UecSrc::rtxTimerExpired() {
     assert(eventlist().now() == _rtx_timeout);
     clearRTO();
 
-    auto first_entry = _send_times.begin();
-    assert(first_entry != _send_times.end());
-    auto seqno = first_entry->second;
+    sendOrderEntry* first_entry = oldestTimed();
+    assert(first_entry);
+    auto seqno = first_entry->seqno;
 
-    auto send_record = _tx_bitmap.find(seqno);
-    assert(send_record != _tx_bitmap.end());
-    mem_b pkt_size = send_record->second.pkt_size;
+    sendRecord* send_record = findInFlight(seqno);
+    assert(send_record);
+    mem_b pkt_size = send_record->pkt_size;
 
     // Trigger multipathing feedback for timeout. Unless we save EVs on the sender per packet, we will 
     // not be able to recover the original timed-out ev.
@@ -2363,18 +2465,17 @@ void UecSrc::rtxTimerExpired() {
 
     // update flightsize?
 
-    //_send_times.erase(first_entry);
-    delFromSendTimes(send_record->second.send_time,seqno);
+    delFromSendTimes(*send_record);
 
-    //cout << _nodename << " rtx timer expired for seqno " << seqno << " flow " << _flow.str() << " packet sent at " << timeAsUs(send_record->second.send_time) << " now time is " << timeAsUs(eventlist().now()) << endl;
+    //cout << _nodename << " rtx timer expired for seqno " << seqno << " flow " << _flow.str() << " packet sent at " << timeAsUs(send_record->send_time) << " now time is " << timeAsUs(eventlist().now()) << endl;
 
     if (_debug_src)
-        cout << _nodename << " rtx timer expired for seqno " << seqno << " flow " << _flow.str() << " packet sent at " << timeAsUs(send_record->second.send_time) << " now time is " << timeAsUs(eventlist().now()) << endl;
+        cout << _nodename << " rtx timer expired for seqno " << seqno << " flow " << _flow.str() << " packet sent at " << timeAsUs(send_record->send_time) << " now time is " << timeAsUs(eventlist().now()) << endl;
     
     if (_flow.flow_id() == UecSrc::_debug_flowid ) {
         cout << timeAsUs(eventlist().now()) << " flowid " << _flow.flow_id() 
             <<" rtx timer expired for seqno " << seqno << " packet sent at " 
-            << timeAsUs(send_record->second.send_time) << " now time is " << timeAsUs(eventlist().now()) 
+            << timeAsUs(send_record->send_time) << " now time is " << timeAsUs(eventlist().now()) 
             << " _loss_recovery_mode " << _loss_recovery_mode
             << endl;
     }
@@ -2383,7 +2484,7 @@ void UecSrc::rtxTimerExpired() {
     //I would expect that that the fast loss recovery will retransmit this packet, when the send_times record the sending timestamp for this packet
     if (_sender_based_cc && _enable_sleek) {
         if (_loss_recovery_mode) {
-            if (_rtx_times[seqno] < 1) {
+            if (send_record->rtx_times < 1) {
                 recalculateRTO();
             } else {
                 _highest_rtx_sent = seqno;
@@ -2392,13 +2493,13 @@ void UecSrc::rtxTimerExpired() {
         }
     }
 
-    _tx_bitmap.erase(send_record);
+    send_record->in_flight = false;
     recalculateRTO();
 
     if (_sender_based_cc)
         mark_packet_for_retransmission(seqno, pkt_size);
 
-    if (!_rtx_queue.empty()) {
+    if (!rtxQueueEmpty()) {
         // there's already a queue, so clearly we shouldn't just
         // resend right now.  But send an RTS (no more than once per
         // RTT) to cover the case where the receiver doesn't know
@@ -2507,7 +2608,6 @@ UecSink::UecSink(TrafficLogger* trafficLogger, UecPullPacer* pullPacer, UecNIC&
       _recvd_bytes(0),
       _rcv_cwnd_pen(255),
       _end_trigger(NULL),
-      _epsn_rx_bitmap(0),
       _out_of_order_count(0),
       _ack_request(false),
       _entropy(0)  {
@@ -2547,7 +2647,6 @@ UecSink::UecSink(TrafficLogger* trafficLogger,
       _recvd_bytes(0),
       _rcv_cwnd_pen(255),
       _end_trigger(NULL),
-      _epsn_rx_bitmap(0),
       _out_of_order_count(0),
       _ack_request(false),
       _entropy(0) {
@@ -2570,6 +2669,34 @@ UecSink::UecSink(TrafficLogger* trafficLogger,
     _receiver_cc = NULL;
 }
 
+void UecSink::checkpoint(Checkpoint& cp) {
+    if (cp.saving()) {
+        if (_pcie || _receiver_cc)
+            cp.unsupported("a UecSink with a PCIe or oversubscription model");
+        if (_end_trigger)
+            cp.unsupported("a UecSink with an end trigger");
+    }
+    cp.io(_expected_epsn);
+    cp.io(_high_epsn);
+    cp.io(_ref_epsn);
+    cp.io(_retx_backlog);
+    cp.io(_latest_pull);
+    cp.io(_highest_pull_target);
+    cp.io(_in_pull);
+    cp.io(_in_slow_pull);
+    cp.io(_received_bytes);
+    cp.io(_accepted_bytes);
+    cp.io(_recvd_bytes);
+    cp.io(_rcv_cwnd_pen);
+    cp.io(_epsn_rx_bitmap);
+    cp.io(_out_of_order_count);
+    cp.io(_ack_request);
+    cp.io(_entropy);
+    cp.io(_stats);
+    cp.io(_path_mql_map);
+    cp.io(last_data_sent_time);
+}
+
 void UecSink::connectPort(uint32_t port_num, UecSrc& src, const Route& route) {
     _src = &src;
     _ports[port_num]->setRoute(route);
@@ -2670,7 +2797,7 @@ void UecSink::processData(UecDataPacket& pkt) {
             _receiver_cc->ecn_received(pkt.size());
     }
 
-    if (pkt.epsn() < _expected_epsn || _epsn_rx_bitmap[pkt.epsn()]) {
+    if (pkt.epsn() < _expected_epsn || _epsn_rx_bitmap.test(pkt.epsn())) {
         if (UecSrc::_debug)
             cout << _nodename << " src " << _src->nodename() << " duplicate psn " << pkt.epsn()
                  << endl;
@@ -2724,11 +2851,10 @@ void UecSink::processData(UecDataPacket& pkt) {
              << endl;
 
     if (pkt.epsn() == _expected_epsn) {
-        while (_epsn_rx_bitmap[++_expected_epsn]) {
-            // clean OOO state, this will wrap at some point.
-            _epsn_rx_bitmap[_expected_epsn] = 0;
-            _out_of_order_count--;
-        }
+        // skip the packets above the hole we just filled, clearing them
+        uint64_t run = _epsn_rx_bitmap.pop_run(_expected_epsn + 1);
+        _expected_epsn += 1 + run;
+        _out_of_order_count -= run;
         if (_src->debug())
             cout << " UecSink " << _nodename << " src " << _src->nodename()
                  << " >>    cumulative ack now: " << _expected_epsn << " ooo count "
@@ -2739,7 +2865,7 @@ void UecSink::processData(UecDataPacket& pkt) {
             _ack_request = false;
         }
     } else {
-        _epsn_rx_bitmap[pkt.epsn()] = 1;
+        _epsn_rx_bitmap.set(pkt.epsn());
         _out_of_order_count++;
         _stats.out_of_order++;
     }
@@ -2791,7 +2917,7 @@ void UecSink::processTrimmed(const UecDataPacket& pkt) {
         _receiver_cc->trimmed_received(is_last_hop);
     }
 
-    if (pkt.epsn() < _expected_epsn || _epsn_rx_bitmap[pkt.epsn()]) {
+    if (pkt.epsn() < _expected_epsn || _epsn_rx_bitmap.test(pkt.epsn())) {
         if (_src->debug())
             cout << " UecSink processTrimmed got a packet we already have: " << pkt.epsn()
                  << " time " << timeAsNs(getSrc()->eventlist().now()) << " flow"
@@ -2861,7 +2987,7 @@ void UecSink::processRts(const UecRtsPacket& pkt) {
         cout << "Warning: ECN set on RTS packet in high congestion scenario" << endl;
     }
 
-    if (pkt.epsn() < _expected_epsn || _epsn_rx_bitmap[pkt.epsn()]) {
+    if (pkt.epsn() < _expected_epsn || _epsn_rx_bitmap.test(pkt.epsn())) {
         if (_src->debug())
             cout << _nodename << " src " << _src->nodename() << " duplicate RTS psn " << pkt.epsn()
                  << endl;
@@ -2881,11 +3007,10 @@ void UecSink::processRts(const UecRtsPacket& pkt) {
 
 
     if (pkt.epsn() == _expected_epsn) {
-        while (_epsn_rx_bitmap[++_expected_epsn]) {
-            // clean OOO state, this will wrap at some point.
-            _epsn_rx_bitmap[_expected_epsn] = 0;
-            _out_of_order_count--;
-        }
+        // skip the packets above the hole we just filled, clearing them
+        uint64_t run = _epsn_rx_bitmap.pop_run(_expected_epsn + 1);
+        _expected_epsn += 1 + run;
+        _out_of_order_count -= run;
         if (_src->debug())
             cout << " UecSink " << _nodename << " src " << _src->nodename()
                  << " >>    cumulative ack now: " << _expected_epsn << " ooo count "
@@ -2895,7 +3020,7 @@ void UecSink::processRts(const UecRtsPacket& pkt) {
             _ack_request = false;
         }
     } else {
-        _epsn_rx_bitmap[pkt.epsn()] = 1;
+        _epsn_rx_bitmap.set(pkt.epsn());
         _out_of_order_count++;
         _stats.out_of_order++;
     }
@@ -2996,43 +3121,16 @@ UecBasePacket::seq_t UecSink::sackBitmapBase(UecBasePacket::seq_t epsn) {
     return max((int64_t)epsn - 63, (int64_t)(_expected_epsn + 1));
 }
 
-UecBasePacket::seq_t UecSink::sackBitmapBaseIdeal() {
-    uint8_t lowest_value = UINT8_MAX;
-    UecBasePacket::seq_t lowest_position = 0;
-
-    // find the lowest non-zero value in the sack bitmap; that is the candidate for the base, since
-    // it is the oldest packet that we are yet to sack. on sack bitmap construction that covers a
-    // given seqno, the value is incremented.
-    for (UecBasePacket::seq_t crt = _expected_epsn; crt <= _high_epsn; crt++)
-        if (_epsn_rx_bitmap[crt] && _epsn_rx_bitmap[crt] < lowest_value) {
-            lowest_value = _epsn_rx_bitmap[crt];
-            lowest_position = crt;
-        }
-
-    if (lowest_position + 64 > _high_epsn)
-        lowest_position = _high_epsn - 64;
-
-    if (lowest_position <= _expected_epsn)
-        lowest_position = _expected_epsn + 1;
-
-    return lowest_position;
-}
-
 uint64_t UecSink::buildSackBitmap(UecBasePacket::seq_t ref_epsn) {
     // take the next 64 entries from ref_epsn and create a SACK bitmap with them
     if (_src->debug())
         cout << " UecSink: building sack for ref_epsn " << ref_epsn << endl;
-    uint64_t bitmap = (uint64_t)(_epsn_rx_bitmap[ref_epsn] != 0) << 63;
+    uint64_t bitmap = _epsn_rx_bitmap.bits(ref_epsn);
 
-    for (int i = 1; i < 64; i++) {
-        bitmap = bitmap >> 1 | (uint64_t)(_epsn_rx_bitmap[ref_epsn + i] != 0) << 63;
-        if (_src->debug() && (_epsn_rx_bitmap[ref_epsn + i] != 0))
-            cout << "     Sack: " << ref_epsn + i << endl;
-
-        if (_epsn_rx_bitmap[ref_epsn + i]) {
-            // remember that we sacked this packet
-            if (_epsn_rx_bitmap[ref_epsn + i] < UINT8_MAX)
-                _epsn_rx_bitmap[ref_epsn + i]++;
+    if (_src->debug()) {
+        for (int i = 1; i < 64; i++) {
+            if ((bitmap >> i) & 1)
+                cout << "     Sack: " << ref_epsn + i << endl;
         }
     }
     if (_src->debug())
@@ -3075,14 +3173,8 @@ void UecSink::setEndTrigger(Trigger& end_trigger) {
 }*/
 
 uint32_t UecSink::reorder_buffer_size() {
-    uint32_t count = 0;
-    // it's not very efficient to count each time, but if we only do
-    // this occasionally when the sink logger runs, it should be OK.
-    for (uint32_t i = 0; i < uecMaxInFlightPkts; i++) {
-        if (_epsn_rx_bitmap[i])
-            count++;
-    }
-    return count;
+    // only run occasionally, when the sink logger does
+    return _epsn_rx_bitmap.count();
 }
 
 ////////////////////////////////////////////////////////////////
@@ -3177,6 +3269,14 @@ void UecPullPacer::doNextEvent() {
     eventlist().sourceIsPendingRel(*this, pkt_time);
 }
 
+void UecPullPacer::checkpoint(Checkpoint& cp) {
+    cp.io(_active_senders);
+    cp.io(_idle_senders);
+    cp.io(_actual_time_per_quanta);
+    cp.io(_active);
+    cp.io_array(_rates, 2);
+}
+
 void UecPullPacer::updatePullRate(reason r, double relative_rate){
     _rates[r] = relative_rate;
 
@@ -9,15 +9,15 @@
 
 #include "uec_base.h"
 #include "eventlist.h"
+#include "timerwheel.h"
 #include "trigger.h"
 #include "uecpacket.h"
 #include "circular_buffer.h"
-#include "modular_vector.h"
+#include "seq_bitmap.h"
+#include "seq_window.h"
 #include "pciemodel.h"
 #include "oversubscribed_cc.h"
 #include "uec_mp.h"
-#include "atlahs_event.h"
-#include "atlahs_htsim_api.h"
 
 #define timeInf 0
 // min RTO bound in us
@@ -36,7 +36,7 @@ class UecLogger;
 // linkspeed due to outcast (or just at startup) - this avoids
 // building an output queue like the old NDP simulator did, and so
 // better models what happens in a h/w NIC.
-class UecNIC : public EventSource, public NIC {
+class UecNIC : public EventSource, public NIC, public Checkpointable {
     struct PortData {
         simtime_picosec send_end_time;
         bool busy;
@@ -46,6 +46,7 @@ class UecNIC : public EventSource, public NIC {
         UecBasePacket* pkt;
         UecSrc* src;
         UecSink* sink;
+        void checkpoint(Checkpoint& cp) {cp.io(pkt); cp.io(src); cp.io(sink);}
     };
 public:
     UecNIC(id_t src_num, EventList& eventList, linkspeed_bps linkspeed, uint32_t ports);
@@ -67,6 +68,9 @@ public:
     virtual const string& nodename() const {return _nodename;}
     list<UecSrc*> _active_srcs;
 
+    virtual void checkpoint(Checkpoint& cp);
+    virtual const type_info& checkpoint_class() const {return typeid(UecNIC);}
+
 private:
     void sendControlPktNow();
     uint32_t sendOnFreePortNow(simtime_picosec endtime, const Route* rt);
@@ -87,20 +91,23 @@ private:
 };
 
 // Packets are received on ports, but then passed to the Src for handling
-class UecSrcPort : public PacketSink {
+class UecSrcPort : public PacketSink, public Checkpointable {
 public:
     UecSrcPort(UecSrc& src, uint32_t portnum);
     void setRoute(const Route& route);
     inline const Route* route() const {return _route;}
     virtual void receivePacket(Packet& pkt);
     virtual const string& nodename();
+    // only a hop on saved routes
+    virtual void checkpoint(Checkpoint& cp) {}
+    virtual const type_info& checkpoint_class() const {return typeid(UecSrcPort);}
 private:
     UecSrc& _src;
     uint8_t _port_num;
     const Route* _route;  // we're only going to support ECMP_HOST for now.
 };
 
-class UecSrc : public EventSource, public TriggerTarget, public UecTransportConnection {
+class UecSrc : public EventSource, public TriggerTarget, public UecTransportConnection, public Checkpointable {
 public:
     struct Stats {
         /* all must be non-negative, but we'll make them signed so we
@@ -131,7 +138,6 @@ public:
            UecNIC& nic, 
            uint32_t no_of_ports, 
            bool rts = false);
-    void delFromSendTimes(simtime_picosec time, UecDataPacket::seq_t seq_no);
     /**
      * Initialize global NSCC parameters.
      */
@@ -148,7 +154,7 @@ public:
     void initRccc(mem_b cwnd,simtime_picosec peer_rtt=UecSrc::_network_rtt);
 
     void logFlowEvents(FlowEventLogger& flow_logger) { _flow_logger = &flow_logger; }
-    virtual void connectPort(uint32_t portnum, Route& routeout, Route& routeback, UecSink& sink, simtime_picosec start);
+    virtual void connectPort(uint32_t portnum, const Route& routeout, const Route& routeback, UecSink& sink, simtime_picosec start);
     const Route* getPortRoute(uint32_t port_num) const {return _ports[port_num]->route();}
     UecSrcPort* getPort(uint32_t port_num) {return _ports[port_num];}
     void timeToSend(const Route& route);
@@ -172,6 +178,7 @@ public:
         //_maxwnd = cwnd;
         _cwnd = cwnd;
     }
+    mem_b cwnd() const {return _cwnd;}
     void setMaxWnd(mem_b maxwnd) {
         //_maxwnd = cwnd;
         _maxwnd = maxwnd;
@@ -205,29 +212,35 @@ public:
     // Print multipath statistics (for path selection analysis)
     void printMultipathStats() const;
 
+    virtual void checkpoint(Checkpoint& cp);
+    virtual const type_info& checkpoint_class() const {return typeid(UecSrc);}
+
     void setEndTrigger(Trigger& trigger);
     // called from a trigger to start the flow.
     virtual void activate();
-    static int _global_node_count;
-    static simtime_picosec _min_rto;
-    static uint16_t _hdr_size;
-    static uint16_t _mss;  // does not include header
-    static uint16_t _mtu;  // does include header
+    static thread_local int _global_node_count;
+    static thread_local simtime_picosec _min_rto;
+    static thread_local uint16_t _hdr_size;
+    static thread_local uint16_t _mss;  // does not include header
+    static thread_local uint16_t _mtu;  // does include header
 
-    static bool _sender_based_cc;
-    static bool _receiver_based_cc;
+    static thread_local bool _sender_based_cc;
+    static thread_local bool _receiver_based_cc;
 
     enum Sender_CC { DCTCP, NSCC, CONSTANT};
-    static Sender_CC _sender_cc_algo;
+    static thread_local Sender_CC _sender_cc_algo;
 
-    static bool _disable_quick_adapt;
-    static uint8_t _qa_gate;
+    static thread_local bool _disable_quick_adapt;
+    static thread_local uint8_t _qa_gate;
 
-    static bool update_base_rtt_on_nack;
-    static bool _enable_sleek;
+    static thread_local bool update_base_rtt_on_nack;
+    static thread_local bool _enable_sleek;
 
     virtual const string& nodename() { return _nodename; }
     virtual void setName(const string& name) override { _name=name; _mp->set_debug_tag(name); }
+    // change the load balancing of a running flow; the new algorithm
+    // starts without any knowledge of the paths
+    void setMultipath(unique_ptr<UecMultipath> mp) { _mp = move(mp); _mp->set_debug_tag(_name); }
     inline void setFlowId(flowid_t flow_id) { _flow.set_flowid(flow_id); }
     void setFlowsize(uint64_t flow_size_in_bytes);
     mem_b flowsize() { return _flow_size; }
@@ -236,8 +249,8 @@ public:
 
     inline flowid_t flowId() const { return _flow.flow_id(); }
 
-    static bool _debug;
-    static bool _shown;
+    static thread_local bool _debug;
+    static thread_local bool _shown;
     bool _debug_src;
     bool debug() const { return _debug_src; }
 
@@ -247,10 +260,20 @@ public:
     uint32_t _no_of_ports;
     vector <UecSrcPort*> _ports;
     struct sendRecord {
-        // need a constructor to be able to put this in a map
-        sendRecord(mem_b psize, simtime_picosec stime) : pkt_size(psize), send_time(stime){};
+        sendRecord() : pkt_size(0), send_time(0), stamp(0), rtx_times(0),
+                       in_flight(false), timed(false), queued(false), recorded(false) {};
         mem_b pkt_size;
         simtime_picosec send_time;
+        uint32_t stamp;      // which send this is, to match its _send_order entry
+        uint16_t rtx_times;  // times it has been retransmitted, once recorded
+        bool in_flight;      // sent and not yet acked, nacked or given up on
+        bool timed;          // in flight and covered by the RTO
+        bool queued;         // waiting in the RTX queue
+        bool recorded;       // sent at least once
+    };
+    struct sendOrderEntry {
+        UecDataPacket::seq_t seqno;
+        uint32_t stamp;
     };
     UecLogger* _logger;
     TrafficLogger* _pktlogger;
@@ -261,11 +284,25 @@ public:
     // list<UecDataPacket*> _activePackets;
 
     // we need to access the in_flight packet list quickly by sequence number, or by send time.
-    map<UecDataPacket::seq_t, sendRecord> _tx_bitmap;
-    multimap<simtime_picosec, UecDataPacket::seq_t> _send_times;
-    map<UecDataPacket::seq_t, uint16_t> _rtx_times;
-
-    map<UecDataPacket::seq_t, mem_b> _rtx_queue;
+    // Records are kept from the cumulative ack up to the highest PSN sent.
+    SeqWindow<sendRecord> _send_records;
+    // the timed packets in the order they were sent, which is also send
+    // time order; entries of packets that stopped being timed are
+    // skipped when they reach the front
+    CircularBuffer<sendOrderEntry> _send_order;
+    uint32_t _send_stamp;
+    uint32_t _timed_count;
+    // the RTX queue is the records marked queued, lowest PSN first; no
+    // queued record is below _rtx_queue_head
+    uint32_t _rtx_queue_size;
+    UecDataPacket::seq_t _rtx_queue_head;
+
+    sendRecord* findInFlight(UecDataPacket::seq_t seqno);
+    void delFromSendTimes(sendRecord& rec);
+    sendOrderEntry* oldestTimed();
+    inline bool rtxQueueEmpty() const {return _rtx_queue_size == 0;}
+    UecDataPacket::seq_t rtxQueueFront();
+    void dequeueRtx(sendRecord& rec);
     bool isSendPermitted();
     void sendIfPermitted();
     mem_b sendPacket(const Route& route);
@@ -283,10 +320,7 @@ public:
 
     // not used, except for debugging timer issues
     void checkRTO() {
-        if (_rtx_timeout_pending)
-            assert(_rto_timer_handle != eventlist().nullHandle());
-        else
-            assert(_rto_timer_handle == eventlist().nullHandle());
+        assert(_rto_timer.armed() == _rtx_timeout_pending);
     }
 
     void rtxTimerExpired();
@@ -334,7 +368,7 @@ public:
     mem_b _rtx_backlog;
     mem_b _cwnd;
     mem_b _maxwnd;
-    static mem_b _configured_maxwnd;
+    static thread_local mem_b _configured_maxwnd;
     UecBasePacket::pull_quanta _pull_target;
     UecBasePacket::pull_quanta _pull;
     mem_b _credit;  // receive request credit in pull_quanta, but consume it in bytes
@@ -351,37 +385,35 @@ public:
     // Record last time this UecSrc was scheduled.
     optional<simtime_picosec> _last_event_time;
 public:
-    static linkspeed_bps _reference_network_linkspeed; 
-    static simtime_picosec _reference_network_rtt; 
-    static mem_b _reference_network_bdp; 
-    static linkspeed_bps _network_linkspeed; 
-    static simtime_picosec _network_rtt; 
-    static mem_b _network_bdp; 
-    static bool _network_trimming_enabled; 
+    static thread_local linkspeed_bps _reference_network_linkspeed; 
+    static thread_local simtime_picosec _reference_network_rtt; 
+    static thread_local mem_b _reference_network_bdp; 
+    static thread_local linkspeed_bps _network_linkspeed; 
+    static thread_local simtime_picosec _network_rtt; 
+    static thread_local mem_b _network_bdp; 
+    static thread_local bool _network_trimming_enabled; 
     // Smarttrack parameters
-    static mem_b _min_cwnd; 
-    static uint32_t _qa_scaling; 
-    static simtime_picosec _target_Qdelay;
-    static double _gamma;
-    static double _alpha;
+    static thread_local mem_b _min_cwnd; 
+    static thread_local uint32_t _qa_scaling; 
+    static thread_local simtime_picosec _target_Qdelay;
+    static thread_local double _gamma;
+    static thread_local double _alpha;
     // static double _scaling_c;
     // static double _fd;
-    static double _fi;
-    static double _fi_scale;
-    static double _scaling_factor_a;
-    static double _scaling_factor_b;
-    static double _eta;
-    static double _qa_threshold; 
-    static double _delay_alpha;
+    static thread_local double _fi;
+    static thread_local double _fi_scale;
+    static thread_local double _scaling_factor_a;
+    static thread_local double _scaling_factor_b;
+    static thread_local double _eta;
+    static thread_local double _qa_threshold; 
+    static thread_local double _delay_alpha;
     // static double _ecn_thresh;
-    static uint32_t _adjust_bytes_threshold;
-    static simtime_picosec _adjust_period_threshold;
+    static thread_local uint32_t _adjust_bytes_threshold;
+    static thread_local simtime_picosec _adjust_period_threshold;
     //debug
-    static flowid_t _debug_flowid;
+    static thread_local flowid_t _debug_flowid;
 
-    // ATLAHS
-    AtlahsHtsimApi *_atlahs_api = nullptr;
-    graph_node_properties *lgs_node; // used for logging purposes
+    // ATLAHS; pooled connections report completion through UecPdcSes
     uint64_t send_size = 0;
     uint32_t from = -1;
     uint32_t to = -1;
@@ -429,7 +461,7 @@ private:
     simtime_picosec _rto_send_time;  // when we sent the oldest packet that the RTO is waiting on.
     simtime_picosec _rtx_timeout;    // when the RTO is currently set to expire
     simtime_picosec _last_rts;       // time when we last sent an RTS (or zero if never sent)
-    EventList::Handle _rto_timer_handle;
+    TimerWheel::Timer _rto_timer{*this};
 
 
     //used to drive ACK clock
@@ -457,19 +489,19 @@ private:
 
     /******** SLEEK parameters *********/
 
-    static float loss_retx_factor;
-    static int min_retx_config ;
+    static thread_local float loss_retx_factor;
+    static thread_local int min_retx_config ;
     bool _loss_recovery_mode = false;
     uint32_t _recovery_seqno = 0;
     /******** END SLEEK parameters *********/
 
     /******** Probe parameters *********/    
-    static int probe_first_trial_time;
-    static int probe_retry_time;
+    static thread_local int probe_first_trial_time;
+    static thread_local int probe_retry_time;
     simtime_picosec _probe_timer_when = 0;
     simtime_picosec _probe_seqno = 0; 
     simtime_picosec _probe_send_time = 0; 
-    EventList::Handle _probe_timer_handle; 
+    TimerWheel::Timer _probe_timer{*this};
     /******** END Probe parameters *********/
 
 
@@ -481,20 +513,23 @@ private:
 };
 
 // Packets are received on ports, but then passed to the Sink for handling
-class UecSinkPort : public PacketSink {
+class UecSinkPort : public PacketSink, public Checkpointable {
 public:
     UecSinkPort(UecSink& sink, uint32_t portnum);
     void setRoute(const Route& route);
     inline const Route* route() const {return _route;}
     virtual void receivePacket(Packet& pkt);
     virtual const string& nodename();
+    // only a hop on saved routes
+    virtual void checkpoint(Checkpoint& cp) {}
+    virtual const type_info& checkpoint_class() const {return typeid(UecSinkPort);}
 private:
     UecSink& _sink;
     uint8_t _port_num;
     const Route* _route;
 };
 
-class UecSink : public DataReceiver {
+class UecSink : public DataReceiver, public Checkpointable {
    public:
     struct Stats {
         uint64_t received;
@@ -536,7 +571,6 @@ class UecSink : public DataReceiver {
     void setEndTrigger(Trigger& trigger);
 
     UecBasePacket::seq_t sackBitmapBase(UecBasePacket::seq_t epsn);
-    UecBasePacket::seq_t sackBitmapBaseIdeal();
     uint64_t buildSackBitmap(UecBasePacket::seq_t ref_epsn);
     UecAckPacket* sack(uint16_t path_id, UecBasePacket::seq_t seqno, UecBasePacket::seq_t acked_psn, bool ce, bool rtx_echo);
 
@@ -558,6 +592,9 @@ class UecSink : public DataReceiver {
     UecBasePacket::pull_quanta rtx_backlog() { return _retx_backlog; }
     const Stats& stats() const { return _stats; }
     void connectPort(uint32_t port_num, UecSrc& src, const Route& routeback);
+
+    virtual void checkpoint(Checkpoint& cp);
+    virtual const type_info& checkpoint_class() const {return typeid(UecSink);}
     const Route* getPortRoute(uint32_t port_num) const {return _ports[port_num]->route();}
     UecSinkPort* getPort(uint32_t port_num) {return _ports[port_num];}
     void setSrc(uint32_t s) { _srcaddr = s; }
@@ -588,12 +625,12 @@ class UecSink : public DataReceiver {
 
     PCIeModel* pcieModel() const{ return _pcie;}
 
-    static mem_b _bytes_unacked_threshold;
-    static uint16_t _mtus_per_pull;
-    static UecBasePacket::pull_quanta _credit_per_pull;
-    static int TGT_EV_SIZE;
+    static thread_local mem_b _bytes_unacked_threshold;
+    static thread_local uint16_t _mtus_per_pull;
+    static thread_local UecBasePacket::pull_quanta _credit_per_pull;
+    static thread_local int TGT_EV_SIZE;
 
-    static bool _receiver_oversubscribed_cc; 
+    static thread_local bool _receiver_oversubscribed_cc; 
 
     // for sink logger
     inline mem_b total_received() const { return _stats.bytes_received; }
@@ -602,8 +639,6 @@ class UecSink : public DataReceiver {
     inline UecPullPacer* pullPacer() const {return _pullPacer;}
 
         // ATLAHS
-    AtlahsHtsimApi *_atlahs_api = nullptr;
-    graph_node_properties *lgs_node; // used for logging purposes
     uint64_t send_size = 0;
     uint32_t from_sink = -1;
     uint32_t to_sink = -1;
@@ -660,8 +695,7 @@ class UecSink : public DataReceiver {
     uint8_t _rcv_cwnd_pen;
 
     Trigger* _end_trigger;
-    ModularVector<uint8_t, uecMaxInFlightPkts>
-        _epsn_rx_bitmap;  // list of packets above a hole, that we've received
+    SeqBitmap _epsn_rx_bitmap;  // packets above a hole that we've received
 
     uint32_t _out_of_order_count;
     bool _ack_request;
@@ -680,11 +714,11 @@ class UecSink : public DataReceiver {
     map<uint16_t, uint8_t> _path_mql_map;
 
 public:
-    static bool _oversubscribed_cc;
-    static bool _model_pcie;
+    static thread_local bool _oversubscribed_cc;
+    static thread_local bool _model_pcie;
 };
 
-class UecPullPacer : public EventSource {
+class UecPullPacer : public EventSource, public Checkpointable {
    public:
     enum reason {PCIE = 0, OVERSUBSCRIBED_CC = 1};
 
@@ -703,6 +737,9 @@ class UecPullPacer : public EventSource {
 
     void updatePullRate(reason r,double relative_rate);
 
+    virtual void checkpoint(Checkpoint& cp);
+    virtual const type_info& checkpoint_class() const {return typeid(UecPullPacer);}
+
    private:
     list<UecSink*> _active_senders;  // TODO priorities?
     list<UecSink*> _idle_senders;    // TODO priorities?
@@ -7,6 +7,10 @@
 #include <cmath>  // for sqrt
 
 
+void UecMultipath::checkpoint(Checkpoint& cp) {
+    cp.unsupported("multipath " + Checkpoint::class_name(typeid(*this)));
+}
+
 UecMpOblivious::UecMpOblivious(uint16_t no_of_paths,
                                bool debug)
     : UecMultipath(debug),
@@ -30,6 +34,12 @@ void UecMpOblivious::processEv(uint16_t path_id, PathFeedback feedback) {
     return;
 }
 
+void UecMpOblivious::checkpoint(Checkpoint& cp) {
+    cp.io(_path_random);
+    cp.io(_path_xor);
+    cp.io(_current_ev_index);
+}
+
 uint16_t UecMpOblivious::nextEntropy(uint64_t seq_sent, uint64_t cur_cwnd_in_pkts) {
     // _no_of_paths must be a power of 2
     uint16_t mask = _no_of_paths - 1;
@@ -75,6 +85,15 @@ UecMpBitmap::UecMpBitmap(uint16_t no_of_paths, bool debug)
             << endl;
 }
 
+void UecMpBitmap::checkpoint(Checkpoint& cp) {
+    cp.io(_path_random);
+    cp.io(_path_xor);
+    cp.io(_current_ev_index);
+    cp.io(_ev_skip_bitmap);
+    cp.io(_ev_skip_count);
+    cp.io(_max_penalty);
+}
+
 void UecMpBitmap::processEv(uint16_t path_id, PathFeedback feedback) {
     // _no_of_paths must be a power of 2
     uint16_t mask = _no_of_paths - 1;
@@ -152,6 +171,20 @@ UecMpReps::UecMpReps(uint16_t no_of_paths, bool debug, bool is_trimming_enabled)
             << endl;
 }
 
+void UecMpReps::checkpoint(Checkpoint& cp) {
+    circular_buffer_reps->checkpoint(cp);
+    cp.io(_crt_path);
+    cp.io(_next_pathid);
+    cp.io(_path_mql_map);
+    cp.io(_use_mql);
+    cp.io(_paths_by_mql_level);
+    cp.io(_stats.total_selections);
+    cp.io(_stats.mql_based_selections);
+    cp.io(_stats.mql_updates);
+    cp.io(_stats.path_selection_count);
+    cp.io(_stats.mql_level_distribution);
+}
+
 void UecMpReps::processEv(uint16_t path_id, PathFeedback feedback) {
 
     if ((feedback == PATH_TIMEOUT) && !circular_buffer_reps->isFrozenMode() && circular_buffer_reps->explore_counter == 0) {
@@ -457,6 +490,11 @@ void UecMpRepsLegacy::processEv(uint16_t path_id, PathFeedback feedback) {
     }
 }
 
+void UecMpRepsLegacy::checkpoint(Checkpoint& cp) {
+    cp.io(_crt_path);
+    cp.io(_next_pathid);
+}
+
 uint16_t UecMpRepsLegacy::nextEntropy(uint64_t seq_sent, uint64_t cur_cwnd_in_pkts) {
     if (seq_sent < min(cur_cwnd_in_pkts, (uint64_t)_no_of_paths)) {
         _crt_path++;
@@ -518,6 +556,11 @@ void UecMpMixed::processEv(uint16_t path_id, PathFeedback feedback) {
     _reps_legacy.processEv(path_id, feedback);
 }
 
+void UecMpMixed::checkpoint(Checkpoint& cp) {
+    _bitmap.checkpoint(cp);
+    _reps_legacy.checkpoint(cp);
+}
+
 uint16_t UecMpMixed::nextEntropy(uint64_t seq_sent, uint64_t cur_cwnd_in_pkts) {
     auto reps_val = _reps_legacy.nextEntropyRecycle();
     if (reps_val.has_value()) {
@@ -538,6 +581,10 @@ UecMpEcmp::UecMpEcmp(uint16_t no_of_paths, bool debug)
     _crt_path = rand() % no_of_paths;
 }
 
+void UecMpEcmp::checkpoint(Checkpoint& cp) {
+    cp.io(_crt_path);
+}
+
 void UecMpEcmp::processEv(uint16_t path_id, PathFeedback feedback) {
     // No OP in ECMP
     return;
@@ -6,6 +6,7 @@
 #include <optional>
 #include "eventlist.h"
 #include "buffer_reps.h"
+#include "checkpoint.h"
 
 class UecMultipath {
 public:
@@ -31,6 +32,9 @@ public:
      * @param mql_level The Maximum Queue Length level (0-7)
      */
     virtual void processMql(uint16_t path_id, uint8_t mql_level) {};
+
+    // save or restore the path selection state with the UecSrc's
+    virtual void checkpoint(Checkpoint& cp);
 protected:
     bool _debug;
     string _debug_tag;
@@ -41,6 +45,7 @@ public:
     UecMpOblivious(uint16_t no_of_paths, bool debug);
     void processEv(uint16_t path_id, PathFeedback feedback) override;
     uint16_t nextEntropy(uint64_t seq_sent, uint64_t cur_cwnd_in_pkts) override;
+    void checkpoint(Checkpoint& cp) override;
 private:
     uint16_t _no_of_paths;       // must be a power of 2
     uint16_t _path_random;       // random upper bits of EV, set at startup and never changed
@@ -54,6 +59,7 @@ public:
     UecMpBitmap(uint16_t no_of_paths, bool debug);
     void processEv(uint16_t path_id, PathFeedback feedback) override;
     uint16_t nextEntropy(uint64_t seq_sent, uint64_t cur_cwnd_in_pkts) override;
+    void checkpoint(Checkpoint& cp) override;
 private:
     uint16_t _no_of_paths;       // must be a power of 2
     uint16_t _path_random;       // random upper bits of EV, set at startup and never changed
@@ -71,6 +77,7 @@ public:
     UecMpRepsLegacy(uint16_t no_of_paths, bool debug);
     void processEv(uint16_t path_id, PathFeedback feedback) override;
     uint16_t nextEntropy(uint64_t seq_sent, uint64_t cur_cwnd_in_pkts) override;
+    void checkpoint(Checkpoint& cp) override;
     optional<uint16_t> nextEntropyRecycle();
 private:
     uint16_t _no_of_paths;
@@ -85,6 +92,7 @@ public:
     void processEv(uint16_t path_id, PathFeedback feedback) override;
     uint16_t nextEntropy(uint64_t seq_sent, uint64_t cur_cwnd_in_pkts) override;
     void processMql(uint16_t path_id, uint8_t mql_level) override;
+    void checkpoint(Checkpoint& cp) override;
     
     // Enable/disable MQL-based path selection for SMaRTT-REPS-CONGA
     void setUseMql(bool use_mql) { _use_mql = use_mql; }
@@ -138,6 +146,7 @@ public:
     UecMpMixed(uint16_t no_of_paths, bool debug);
     void processEv(uint16_t path_id, PathFeedback feedback) override;
     uint16_t nextEntropy(uint64_t seq_sent, uint64_t cur_cwnd_in_pkts) override;
+    void checkpoint(Checkpoint& cp) override;
     void set_debug_tag(string debug_tag) override;
 private:
     UecMpBitmap _bitmap;
@@ -149,6 +158,7 @@ public:
     UecMpEcmp(uint16_t no_of_paths, bool debug);
     void processEv(uint16_t path_id, PathFeedback feedback) override;
     uint16_t nextEntropy(uint64_t seq_sent, uint64_t cur_cwnd_in_pkts) override;
+    void checkpoint(Checkpoint& cp) override;
 private:
     uint16_t _crt_path;
 };
@@ -4,8 +4,8 @@
 #include <cstdint>
 #include <algorithm>
 
-bool UecPdcSes::_debug = false;
-bool UecMsg::_output_completion_time = false;
+thread_local bool UecPdcSes::_debug = false;
+thread_local bool UecMsg::_output_completion_time = false;
 
 UecMsg::UecMsg(UecPdcSes& pdc, msgid_t msg_id, mem_b size, bool debug): 
         _debug(debug),
@@ -146,9 +146,14 @@ mem_b UecMsg::addAck(UecDataPacket::seq_t ackno) {
         assert(getRemainingBytes() == 0);
         assert(_sent_pkt_notacked.empty());
 
-        set_status(MsgStatus::Finished);
+        // nothing is looked up by sequence number once all is acked;
+        // free the per-packet state of long-lived connections' messages
+        unordered_map<UecDataPacket::seq_t, mem_b>().swap(_pkt_size);
+        unordered_set<UecDataPacket::seq_t>().swap(_sent_pkt_notrecvd);
+        unordered_set<UecDataPacket::seq_t>().swap(_sent_pkt_notacked);
 
         _stats.end_time=EventList::getTheEventList().now();
+        set_status(MsgStatus::Finished);
 
         if (_output_completion_time) {
             cout << timeAsUs(EventList::getTheEventList().now()) 
@@ -238,6 +243,8 @@ UecPdcSes::UecPdcSes(UecTransportConnection* connection,
                      _msgs_queue_eligible(),
                      _msgs_in_flight(),
                      _msgs_complete(),
+                     _free_completed(false),
+                     _msgs_freed(0),
                      _ctrl_seq(),
                      _seq_to_msg(), 
                      _msgs()
@@ -395,6 +402,7 @@ void UecPdcSes::addCumAck(UecDataPacket::seq_t cum_ack) {
     mem_b sum_acked_msg_bytes = 0;
     mem_b sum_acked_pkt_bytes = 0;
     map<UecDataPacket::seq_t, UecMsg*>::iterator seq_it;
+    vector<UecMsg*> completed;
 
     for (seq_it=_seq_to_msg.begin(); seq_it!=_seq_to_msg.end();) {
 
@@ -420,7 +428,7 @@ void UecPdcSes::addCumAck(UecDataPacket::seq_t cum_ack) {
         if (cur_acked_pkt_bytes > 0) {
             if (seq_it->second->checkFinished()) {
                 _msgs_in_flight.erase(seq_it->second);
-                _msgs_complete.push_back(seq_it->second);
+                completed.push_back(seq_it->second);
             }
             seq_it = _seq_to_msg.erase(seq_it);
         } else {
@@ -429,6 +437,9 @@ void UecPdcSes::addCumAck(UecDataPacket::seq_t cum_ack) {
     }
 
     _acked_pkt_bytes += sum_acked_pkt_bytes;
+    for (UecMsg* msg : completed) {
+        msgCompleted(msg);
+    }
 
     _max_contiguous_ack.emplace(cum_ack);
     if (_seq_to_msg.empty()) {
@@ -471,6 +482,7 @@ void UecPdcSes::addSAck(UecDataPacket::seq_t ackno) {
     }
 
     UecMsg* cur_msg = _seq_to_msg.at(ackno);
+    UecMsg::msgid_t msg_id = cur_msg->msg_id();
     _seq_to_msg.erase(_seq_to_msg.find(ackno));
 
     acked_msg_bytes = cur_msg->addAck(ackno);
@@ -481,7 +493,7 @@ void UecPdcSes::addSAck(UecDataPacket::seq_t ackno) {
 
     if (cur_msg->checkFinished()) {
         _msgs_in_flight.erase(cur_msg);
-        _msgs_complete.push_back(cur_msg);
+        msgCompleted(cur_msg);
     }
 
     if (_seq_to_msg.empty()) {
@@ -497,7 +509,7 @@ void UecPdcSes::addSAck(UecDataPacket::seq_t ackno) {
         cout << timeAsUs(eventlist().now())
             << " UecPdc::addSAck"
             << " " << _debug_tag
-            << " msgid " << cur_msg->msg_id()
+            << " msgid " << msg_id
             << " ackno " << ackno
             << " acked msg bytes " << acked_msg_bytes
             << " acked pkt bytes " << acked_pkt_bytes
@@ -588,7 +600,7 @@ bool UecPdcSes::checkFinished() {
         assert(checkDoneSending());
         assert(_acked_pkt_bytes == _sent_pkt_bytes);
         assert(_acked_pkt_bytes == _recvd_pkt_bytes);
-        assert(_msgs.size() == _msgs_complete.size());
+        assert(_msgs.size() + _msgs_freed == getMsgCompleted());
         assert(_msgs_in_flight.empty() and _msgs_queue_eligible.empty());
     }
 
@@ -618,7 +630,25 @@ bool UecPdcSes::isTotallyFinished() {
 }
 
 uint32_t UecPdcSes::getMsgCompleted() {
-    return _msgs_complete.size();
+    return _msgs_complete.size() + _msgs_freed;
+}
+
+void UecPdcSes::msgCompleted(UecMsg* msg) {
+    if (!_free_completed) {
+        _msgs_complete.push_back(msg);
+        return;
+    }
+    // nothing may look it up by sequence number once it's gone
+    for (auto it = _seq_to_msg.begin(); it != _seq_to_msg.end();) {
+        if (it->second == msg) {
+            it = _seq_to_msg.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    _msgs.erase(msg->msg_id());
+    delete msg;
+    _msgs_freed++;
 }
 
 mem_b UecPdcSes::eligiblePktSize() {
@@ -75,7 +75,7 @@ public:
 
     Stats& stats() { return _stats; };
 public:  // static
-    static bool _output_completion_time;
+    static thread_local bool _output_completion_time;
 private:  // Methods
     /* 
      * Set status, fire triggers as needed. Must only be called once per status change.
@@ -128,6 +128,12 @@ public: // Methods
     * scheduled for the given point in time.
     */
     UecMsg* enque(mem_b size, optional<simtime_picosec> scheduled_time, bool schedule_event = false);
+    /*
+    * Delete messages once they finish, after their Finished callback,
+    * instead of keeping them. For long-lived connections that are
+    * given one message after another.
+    */
+    void freeCompletedMsgs() { _free_completed = true; };
 
     /*
     * None if the msg has not be completely sent yet.
@@ -158,7 +164,7 @@ public:  // UecMsgTacker
     virtual bool isTotallyFinished() override;
     virtual uint32_t getMsgCompleted() override;
 public:  // Variables
-    static bool _debug; 
+    static thread_local bool _debug; 
 private:  // Methods
     inline UecMsg::msgid_t get_next_msg_id();
     /*
@@ -166,6 +172,7 @@ private:  // Methods
     */
     mem_b updateScheduledMsgs(simtime_picosec now);
     mem_b makeMsgEligible(UecMsg* msg);
+    void msgCompleted(UecMsg* msg);
     void schedule_connection(mem_b new_bytes);
     inline mem_b calc_packeted_size(mem_b size) {
         return ceil(((double)size) / _mss) * _hdr_size + size;
@@ -205,8 +212,10 @@ private:  // Variables
     // Messages that have been sent, though they might not have been
     // fully acked yet.
     unordered_set<UecMsg*> _msgs_in_flight;
-    // Messages that have been completed.
+    // Messages that have been completed, unless they are freed.
     list<UecMsg*> _msgs_complete;
+    bool _free_completed;
+    uint32_t _msgs_freed;
     // The message currently being sent.
     optional<UecMsg*> _cur_msg;
     unordered_set<UecDataPacket::seq_t> _ctrl_seq;
@@ -1,10 +1,16 @@
 #include "uecpacket.h"
 
-PacketDB<UecDataPacket> UecDataPacket::_packetdb;
-PacketDB<UecAckPacket> UecAckPacket::_packetdb;
-PacketDB<UecNackPacket> UecNackPacket::_packetdb;
-PacketDB<UecPullPacket> UecPullPacket::_packetdb;
-PacketDB<UecRtsPacket> UecRtsPacket::_packetdb;
+thread_local PacketDB<UecDataPacket> UecDataPacket::_packetdb;
+thread_local PacketDB<UecAckPacket> UecAckPacket::_packetdb;
+thread_local PacketDB<UecNackPacket> UecNackPacket::_packetdb;
+thread_local PacketDB<UecPullPacket> UecPullPacket::_packetdb;
+thread_local PacketDB<UecRtsPacket> UecRtsPacket::_packetdb;
+
+static Checkpoint::PacketType data_type(UECDATA, UecDataPacket::checkpoint_alloc);
+static Checkpoint::PacketType pull_type(UECPULL, UecPullPacket::checkpoint_alloc);
+static Checkpoint::PacketType ack_type(UECACK, UecAckPacket::checkpoint_alloc);
+static Checkpoint::PacketType nack_type(UECNACK, UecNackPacket::checkpoint_alloc);
+static Checkpoint::PacketType rts_type(UECRTS, UecRtsPacket::checkpoint_alloc);
 
 UecBasePacket::pull_quanta
 UecBasePacket::quantize_floor(mem_b bytes) {
@@ -20,3 +26,65 @@ mem_b
 UecBasePacket::unquantize(UecBasePacket::pull_quanta credit_chunks) {
   return credit_chunks << UEC_PULL_SHIFT;
 }
+
+void
+UecBasePacket::checkpoint(Checkpoint& cp) {
+  Packet::checkpoint(cp);
+  cp.io(_eqsrcid);
+  cp.io(_eqtgtid);
+}
+
+void
+UecDataPacket::checkpoint(Checkpoint& cp) {
+  UecBasePacket::checkpoint(cp);
+  cp.io(_epsn);
+  cp.io(_pull_target);
+  cp.io(_truncated);
+  cp.io(_ar);
+  cp.io(_syn);
+  cp.io(_fin);
+  cp.io(_packet_type);
+  cp.io(_trim_hop);
+  cp.io(_trim_direction);
+  cp.io(_mql_level);
+}
+
+void
+UecPullPacket::checkpoint(Checkpoint& cp) {
+  UecBasePacket::checkpoint(cp);
+  cp.io(_pullno);
+  cp.io(_slow_pull);
+  cp.io(_rnr);
+}
+
+void
+UecAckPacket::checkpoint(Checkpoint& cp) {
+  UecBasePacket::checkpoint(cp);
+  cp.io(_ref_ack);
+  cp.io(_acked_psn);
+  cp.io(_cumulative_ack);
+  cp.io(_sack_bitmap);
+  cp.io(_ev);
+  cp.io(_recvd_bytes);
+  cp.io(_rcv_cwnd_pen);
+  cp.io(_rnr);
+  cp.io(_ecn_echo);
+  cp.io(_rtx_echo);
+  cp.io(_is_rts);
+  cp.io(_residency_time);
+  cp.io(_out_of_order_count);
+  cp.io(_is_probe_ack);
+  cp.io(_mql_level);
+}
+
+void
+UecNackPacket::checkpoint(Checkpoint& cp) {
+  UecBasePacket::checkpoint(cp);
+  cp.io(_ref_epsn);
+  cp.io(_ev);
+  cp.io(_recvd_bytes);
+  cp.io(_target_bytes);
+  cp.io(_last_hop);
+  cp.io(_rnr);
+  cp.io(_ecn_echo);
+}
@@ -34,6 +34,7 @@ public:
     static pull_quanta quantize_floor(mem_b bytes); // quantize and round down
     static mem_b unquantize(pull_quanta credit_chunks);  // unquantize
     static mem_b get_ack_size() {return ACKSIZE;}
+    virtual void checkpoint(Checkpoint& cp);
 };
 
 class UecDataPacket : public UecBasePacket {
@@ -64,7 +65,6 @@ public:
         p->set_dst(destination);
 
         p->_direction = NONE;
-        p->_path_len = route.size();
         p->_trim_hop = {};
         p->_trim_direction = NONE;
         
@@ -96,6 +96,12 @@ public:
 
     void free() {set_pathid(UINT32_MAX),  _packetdb.freePacket(this);}
     virtual ~UecDataPacket(){}
+    virtual void checkpoint(Checkpoint& cp);
+    static Packet* checkpoint_alloc() {
+        UecDataPacket* p = _packetdb.allocPacket();
+        p->_type = UECDATA;
+        return p;
+    }
 
     inline seq_t epsn() const {return _epsn;}
 
@@ -148,7 +154,7 @@ protected:
     // MQL (Maximum Queue Length) for SMaRTT-REPS-CONGA
     uint8_t _mql_level;  // 3-bit queue length level (0-7), records max along path
     
-    static PacketDB<UecDataPacket> _packetdb;
+    static thread_local PacketDB<UecDataPacket> _packetdb;
 };
 
 class UecPullPacket : public UecBasePacket {
@@ -167,7 +173,6 @@ public:
         p->_is_header = true;
         p->_bounced = false;
         p->_pullno = pullno;
-        p->_path_len = 0;
         p->set_dst(destination);
         p->_direction = NONE;
 
@@ -188,6 +193,12 @@ public:
     virtual PktPriority priority() const {return Packet::PRIO_HI;}
   
     virtual ~UecPullPacket(){}
+    virtual void checkpoint(Checkpoint& cp);
+    static Packet* checkpoint_alloc() {
+        UecPullPacket* p = _packetdb.allocPacket();
+        p->_type = UECPULL;
+        return p;
+    }
 
 protected:
     pull_quanta _pullno;
@@ -195,7 +206,7 @@ protected:
 
     bool _rnr;
 
-    static PacketDB<UecPullPacket> _packetdb;
+    static thread_local PacketDB<UecPullPacket> _packetdb;
 };
 
 class UecAckPacket : public UecBasePacket {
@@ -265,6 +276,12 @@ public:
     }
 
     virtual ~UecAckPacket(){}
+    virtual void checkpoint(Checkpoint& cp);
+    static Packet* checkpoint_alloc() {
+        UecAckPacket* p = _packetdb.allocPacket();
+        p->_type = UECACK;
+        return p;
+    }
 
 protected:
     seq_t _ref_ack;  // corresponds to the base of the bitmap
@@ -290,7 +307,7 @@ protected:
     // MQL (Maximum Queue Length) feedback for SMaRTT-REPS-CONGA
     uint8_t _mql_level;  // Feedback of path congestion level (0-7)
 
-    static PacketDB<UecAckPacket> _packetdb;
+    static thread_local PacketDB<UecAckPacket> _packetdb;
 };
 
 class UecNackPacket : public UecBasePacket {
@@ -319,7 +336,6 @@ public:
         p->_rnr = false;
 
         p->_direction = NONE;
-        p->_path_len = 0;
         p->set_dst(destination);
 
         p->_recvd_bytes = recv_bytes;
@@ -343,6 +359,12 @@ public:
     virtual PktPriority priority() const {return Packet::PRIO_HI;}
   
     virtual ~UecNackPacket(){}
+    virtual void checkpoint(Checkpoint& cp);
+    static Packet* checkpoint_alloc() {
+        UecNackPacket* p = _packetdb.allocPacket();
+        p->_type = UECNACK;
+        return p;
+    }
 
 protected:
     seq_t _ref_epsn;
@@ -354,7 +376,7 @@ protected:
 
     bool _rnr;
     bool _ecn_echo;
-    static PacketDB<UecNackPacket> _packetdb;
+    static thread_local PacketDB<UecNackPacket> _packetdb;
 };
 
 class UecRtsPacket : public UecDataPacket {
@@ -387,9 +409,14 @@ public:
     virtual PktPriority priority() const {return Packet::PRIO_HI;}
     
     virtual ~UecRtsPacket(){}
+    static Packet* checkpoint_alloc() {
+        UecRtsPacket* p = _packetdb.allocPacket();
+        p->_type = UECRTS;
+        return p;
+    }
 
 protected:
-    static PacketDB<UecRtsPacket> _packetdb;
+    static thread_local PacketDB<UecRtsPacket> _packetdb;
 };
 
 #endif